@@ -131,6 +131,13 @@ bool LLAudioEngine::init(const S32 num_channels, void* userdata)
 
 void LLAudioEngine::shutdown()
 {
+	// A sound still on its way would call back into a deleted engine.
+	if (mCurrentTransfer.notNull() && gAssetStorage)
+	{
+		gAssetStorage->cancelAssetRequest(mCurrentTransfer, LLAssetType::AT_SOUND, assetCallback, NULL);
+		mCurrentTransfer.setNull();
+	}
+
 	// Clean up decode manager
 	delete gAudioDecodeMgrp;
 	gAudioDecodeMgrp = NULL;
@@ -1168,6 +1175,8 @@ void LLAudioEngine::startNextTransfer()
 	data_map::iterator data_iter;
 
 	// Check all channels for currently playing sounds.
+	// Anything playing or queued to play is heard as soon as it arrives.
+	EAssetPriority asset_priority = ASSET_PRIORITY_VISIBLE;
 	F32 max_pri = -1.f;
 	for (i = 0; i < MAX_CHANNELS; i++)
 	{
@@ -1244,6 +1253,7 @@ void LLAudioEngine::startNextTransfer()
 	// Check all live channels for other sounds (preloads).
 	if (asset_id.isNull())
 	{
+		asset_priority = ASSET_PRIORITY_NORMAL;
 		max_pri = -1.f;
 		for (i = 0; i < MAX_CHANNELS; i++)
 		{
@@ -1285,6 +1295,7 @@ void LLAudioEngine::startNextTransfer()
 	// Check all sources
 	if (asset_id.isNull())
 	{
+		asset_priority = ASSET_PRIORITY_BACKGROUND;
 		max_pri = -1.f;
 		source_map::iterator source_iter;
 		for (source_iter = mAllSources.begin(); source_iter != mAllSources.end(); source_iter++)
@@ -1340,7 +1351,7 @@ void LLAudioEngine::startNextTransfer()
 		gAudiop->mCurrentTransfer = asset_id;
 		gAudiop->mCurrentTransferTimer.reset();
 		gAssetStorage->getAssetData(asset_id, LLAssetType::AT_SOUND,
-									assetCallback, NULL);
+									assetCallback, NULL, asset_priority);
 	}
 	else
 	{
@@ -1349,6 +1360,15 @@ void LLAudioEngine::startNextTransfer()
 }
 
 
+void LLAudioEngine::raiseTransferPriority(const LLUUID &uuid)
+{
+	if (uuid.notNull() && (uuid == mCurrentTransfer) && gAssetStorage)
+	{
+		gAssetStorage->setAssetPriority(uuid, LLAssetType::AT_SOUND, ASSET_PRIORITY_VISIBLE);
+	}
+}
+
+
 // static
 void LLAudioEngine::assetCallback(LLVFS *vfs, const LLUUID &uuid, LLAssetType::EType type, void *user_data, S32 result_code, LLExtStat ext_status)
 {
@@ -1512,6 +1532,8 @@ bool LLAudioSource::play(const LLUUID &audio_uuid)
 	// Reset our age timeout if someone attempts to play the source.
 	mAgeTimer.reset();
 
+	gAudiop->raiseTransferPriority(audio_uuid);
+
 	LLAudioData *adp = gAudiop->getAudioData(audio_uuid);
 
 	bool has_buffer = gAudiop->updateBufferForData(adp, audio_uuid);
@@ -182,6 +182,8 @@ public:
 
 	// Asset callback when we're retrieved a sound from the asset server.
 	void startNextTransfer();
+	// Move a sound that was fetched as a preload up, since it is wanted now.
+	void raiseTransferPriority(const LLUUID &uuid);
 	static void assetCallback(LLVFS *vfs, const LLUUID &uuid, LLAssetType::EType type, void *user_data, S32 result_code, LLExtStat ext_status);
 
 	friend class LLPipeline; // For debugging
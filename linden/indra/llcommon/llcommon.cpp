@@ -32,6 +32,9 @@
 #include "linden_common.h"
 
 #include "llcommon.h"
+#include "llerrorcontrol.h"
+#include "llfasttimer.h"
+#include "llsd.h"
 #include "llthread.h"
 
 //static
@@ -46,6 +49,10 @@ void LLCommon::initClass()
 		ll_init_apr();
 		sAprInitialized = TRUE;
 	}
+	// Thread-local LLSD arena support
+	LLSD::Arena::initClass();
+	// Give each thread its own fast timer stack
+	LLFastTimer::initClass();
 	LLTimer::initClass();
 	LLThreadSafeRefCount::initThreadSafeRefCount();
 // 	LLWorkerThread::initClass();
@@ -59,6 +66,8 @@ void LLCommon::cleanupClass()
 // 	LLWorkerThread::cleanupClass();
 	LLThreadSafeRefCount::cleanupThreadSafeRefCount();
 	LLTimer::cleanupClass();
+	// Write out anything still queued and stop the log drain thread
+	LLError::cleanupAsyncLogging();
 	if (sAprInitialized)
 	{
 		ll_cleanup_apr();
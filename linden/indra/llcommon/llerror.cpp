@@ -58,6 +58,7 @@
 #include "llsd.h"
 #include "llsdserialize.h"
 #include "llstl.h"
+#include "llthread.h"
 
 
 namespace {
@@ -395,6 +396,38 @@ namespace
 		static Globals* globals = new Globals;		
 		return *globals;
 	}
+
+	class LogQueue;
+	LogQueue* sLogQueue = NULL;	// set once asynchronous logging has been used
+	// Held while queued log messages are written. Nested, since a recorder
+	// may log while the queue is being drained.
+	apr_thread_mutex_t* sLogDrainMutexp = NULL;
+
+	// Held by whoever writes to or changes the recorders once asynchronous
+	// logging has started, as the log drain thread may be using them.
+	class DrainLock
+	{
+	public:
+		DrainLock()
+			: mLocked(sLogQueue && sLogDrainMutexp)
+		{
+			if (mLocked)
+			{
+				apr_thread_mutex_lock(sLogDrainMutexp);
+			}
+		}
+
+		~DrainLock()
+		{
+			if (mLocked)
+			{
+				apr_thread_mutex_unlock(sLogDrainMutexp);
+			}
+		}
+
+	private:
+		bool mLocked;
+	};
 }
 
 namespace LLError
@@ -740,6 +773,7 @@ namespace LLError
 		{
 			return;
 		}
+		DrainLock lock;
 		Settings& s = Settings::get();
 		s.recorders.push_back(recorder);
 	}
@@ -750,6 +784,7 @@ namespace LLError
 		{
 			return;
 		}
+		DrainLock lock;
 		Settings& s = Settings::get();
 		s.recorders.erase(
 			std::remove(s.recorders.begin(), s.recorders.end(), recorder),
@@ -811,7 +846,21 @@ namespace LLError
 
 namespace
 {
-	void writeToRecorders(LLError::ELevel level, const std::string& message)
+	std::string formatUTCTime(time_t when)
+	{
+		const size_t BUF_SIZE = 64;
+		char time_str[BUF_SIZE];	/* Flawfinder: ignore */
+		
+		int chars = strftime(time_str, BUF_SIZE, 
+								  "%Y-%m-%dT%H:%M:%SZ",
+								  gmtime(&when));
+
+		return chars ? time_str : "time error";
+	}
+
+	// when is the time a queued message was logged, or 0 for now.
+	void writeToRecorders(LLError::ELevel level, const std::string& message,
+						  time_t when = 0)
 	{
 		LLError::Settings& s = LLError::Settings::get();
 	
@@ -827,7 +876,10 @@ namespace
 			{
 				if (messageWithTime.empty())
 				{
-					messageWithTime = s.timeFunction() + " " + message;
+					// Queued messages keep the time they were logged at.
+					std::string time_str = (when && s.timeFunction == LLError::utcTime)
+						? formatUTCTime(when) : s.timeFunction();
+					messageWithTime = time_str + " " + message;
 				}
 				
 				r->recordMessage(level, messageWithTime);
@@ -932,6 +984,266 @@ namespace {
 	}
 }
 
+namespace
+{
+	/*
+		Asynchronous logging.
+
+		A logging thread formats its message in a stream of its own and
+		pushes the finished record onto a lock-free multiple producer,
+		single consumer queue. A drain thread pops the records and writes
+		them to the recorders, holding sLogDrainMutexp while it does.
+		Anything else that writes to the recorders, or changes them, takes
+		the same mutex, so records come out in order and the recorders are
+		only ever used by one thread at a time.
+	*/
+
+	struct LogRecord
+	{
+		LogRecord* volatile mNext;
+		LLError::ELevel mLevel;
+		time_t mTime;
+		std::string mMessage;
+	};
+
+	class LogQueue
+	{
+	public:
+		LogQueue();
+		~LogQueue();
+
+		// Any thread. Returns false, and counts a drop, if the queue is full.
+		bool push(LLError::ELevel level, const std::string& message);
+
+		// Only with sLogDrainMutexp held. Returns NULL if nothing is ready.
+		LogRecord* pop();
+
+		void setMaxQueued(U32 max_queued)	{ mMaxQueued = max_queued; }
+		U32 getDroppedCount()				{ return mDropped; }
+
+	private:
+		void link(LogRecord* record);
+
+		LogRecord* volatile mHead;	// newest record, swapped in by producers
+		LogRecord* mTail;			// oldest record, owned by the consumer
+		LogRecord mStub;
+		U32 mMaxQueued;
+		LLAtomicU32 mCount;
+		LLAtomicU32 mDropped;
+	};
+
+	LogQueue::LogQueue()
+		: mHead(&mStub), mTail(&mStub), mMaxQueued(0), mCount(0), mDropped(0)
+	{
+		mStub.mNext = NULL;
+	}
+
+	LogQueue::~LogQueue()
+	{
+		while (LogRecord* record = pop())
+		{
+			delete record;
+		}
+	}
+
+	bool LogQueue::push(LLError::ELevel level, const std::string& message)
+	{
+		if (mCount++ >= mMaxQueued)
+		{
+			mCount--;
+			mDropped++;
+			return false;
+		}
+
+		LogRecord* record = new LogRecord;
+		record->mLevel = level;
+		record->mTime = time(NULL);
+		record->mMessage = message;
+		link(record);
+		return true;
+	}
+
+	void LogQueue::link(LogRecord* record)
+	{
+		record->mNext = NULL;
+		LogRecord* prev;
+		do
+		{
+			prev = mHead;
+		}
+		while (apr_atomic_casptr((volatile void**)&mHead, record, prev) != prev);
+		// Until this store lands the consumer sees the queue end at prev.
+		prev->mNext = record;
+	}
+
+	LogRecord* LogQueue::pop()
+	{
+		LogRecord* tail = mTail;
+		LogRecord* next = tail->mNext;
+		if (tail == &mStub)
+		{
+			if (!next)
+			{
+				return NULL;
+			}
+			mTail = next;
+			tail = next;
+			next = next->mNext;
+		}
+		if (!next)
+		{
+			if (tail != mHead)
+			{
+				// A producer has swapped in a record but not yet linked it.
+				return NULL;
+			}
+			// tail is the last record; put the stub behind it so it can
+			// be handed out without leaving the queue empty of nodes.
+			link(&mStub);
+			next = tail->mNext;
+			if (!next)
+			{
+				return NULL;
+			}
+		}
+		mTail = next;
+		mCount--;
+		return tail;
+	}
+
+	// A message stream owned by one thread, reused for every message.
+	struct LogStream
+	{
+		LogStream() : mInUse(false) { }
+
+		std::ostringstream mStream;
+		bool mInUse;
+	};
+
+	void deleteLogStream(void* stream)
+	{
+		delete (LogStream*)stream;
+	}
+
+	apr_threadkey_t* sLogStreamKey = NULL;
+	volatile bool sAsyncLogging = false;
+	U32 sReportedDrops = 0;
+
+	LogStream* getLogStream()
+	{
+		void* stream = NULL;
+		apr_threadkey_private_get(&stream, sLogStreamKey);
+		if (!stream)
+		{
+			stream = new LogStream;
+			apr_threadkey_private_set(stream, sLogStreamKey);
+		}
+		return (LogStream*)stream;
+	}
+
+	// Returns false if out is not this thread's stream.
+	bool releaseLogStream(std::ostringstream* out)
+	{
+		if (!sLogStreamKey)
+		{
+			return false;
+		}
+		void* data = NULL;
+		apr_threadkey_private_get(&data, sLogStreamKey);
+		LogStream* stream = (LogStream*)data;
+		if (!stream || out != &stream->mStream)
+		{
+			return false;
+		}
+		stream->mStream.clear();
+		stream->mStream.str("");
+		stream->mInUse = false;
+		return true;
+	}
+
+	// Writes everything queued so far. Returns false if there was nothing.
+	bool drainLogQueue()
+	{
+		if (!sLogQueue)
+		{
+			return false;
+		}
+
+		DrainLock lock;
+		bool drained = false;
+		while (LogRecord* record = sLogQueue->pop())
+		{
+			writeToRecorders(record->mLevel, record->mMessage, record->mTime);
+			delete record;
+			drained = true;
+		}
+
+		U32 dropped = sLogQueue->getDroppedCount();
+		if (dropped != sReportedDrops)
+		{
+			std::ostringstream message;
+			message << "WARNING: " << (dropped - sReportedDrops)
+					<< " log messages dropped, the log queue was full";
+			writeToRecorders(LLError::LEVEL_WARN, message.str());
+			sReportedDrops = dropped;
+		}
+		return drained;
+	}
+
+	class LogDrainThread : public LLThread
+	{
+	public:
+		LogDrainThread() : LLThread("Log Drain") { }
+
+		/*virtual*/ void run()
+		{
+			// Producers never signal, so that pushing stays lock-free;
+			// poll instead, which is plenty for a log.
+			const U32 IDLE_SLEEP_MS = 5;
+			while (!isQuitting())
+			{
+				if (!drainLogQueue())
+				{
+					ms_sleep(IDLE_SLEEP_MS);
+				}
+			}
+		}
+	};
+
+	LogDrainThread* sDrainThread = NULL;
+
+	void formatPrefix(std::ostream& prefix, LLError::ELevel level,
+					  const char* file, int line,
+					  const std::type_info& class_info, const char* function,
+					  bool print_location)
+	{
+		switch (level)
+		{
+			case LLError::LEVEL_DEBUG:		prefix << "DEBUG: ";	break;
+			case LLError::LEVEL_INFO:		prefix << "INFO: ";		break;
+			case LLError::LEVEL_WARN:		prefix << "WARNING: ";	break;
+			case LLError::LEVEL_ERROR:		prefix << "ERROR: ";	break;
+			default:						prefix << "XXX: ";		break;
+		};
+		
+		if (print_location)
+		{
+			prefix << LLError::abbreviateFile(file)
+					<< "(" << line << ") : ";
+		}
+		
+	#if LL_WINDOWS
+		// DevStudio: __FUNCTION__ already includes the full class name
+	#else
+		if (class_info != typeid(LLError::NoClassInfo))
+		{
+			prefix << className(class_info) << "::";
+		}
+	#endif
+		prefix << function << ": ";
+	}
+}
+
 namespace LLError
 {
 	bool Log::shouldLog(CallSite& site)
@@ -974,6 +1286,17 @@ namespace LLError
 
 	std::ostringstream* Log::out()
 	{
+		if (sAsyncLogging)
+		{
+			LogStream* stream = getLogStream();
+			if (!stream->mInUse)
+			{
+				stream->mInUse = true;
+				return &stream->mStream;
+			}
+			return new std::ostringstream;
+		}
+
 		LogLock lock;
 		if (lock.ok())
 		{
@@ -1014,7 +1337,7 @@ namespace LLError
            g.messageStream.str("");
            g.messageStreamInUse = false;
        }
-       else
+       else if (!releaseLogStream(out))
        {
            delete out;
        }
@@ -1023,6 +1346,24 @@ namespace LLError
 
 	void Log::flush(std::ostringstream* out, const CallSite& site)
 	{
+		if (sAsyncLogging && site.mLevel != LEVEL_ERROR && !site.mPrintOnce
+			&& out != &Globals::get().messageStream)
+		{
+			// No locks on this path: out belongs to this thread and the
+			// queue is lock-free.
+			std::ostringstream message;
+			formatPrefix(message, site.mLevel, site.mFile, site.mLine,
+						 site.mClassInfo, site.mFunction,
+						 Settings::get().printLocation);
+			message << out->str();
+			if (!releaseLogStream(out))
+			{
+				delete out;
+			}
+			sLogQueue->push(site.mLevel, message.str());
+			return;
+		}
+
 		LogLock lock;
 		if (!lock.ok())
 		{
@@ -1039,11 +1380,16 @@ namespace LLError
 			g.messageStream.str("");
 			g.messageStreamInUse = false;
 		}
-		else
+		else if (!releaseLogStream(out))
 		{
 			delete out;
 		}
 
+		// Anything queued goes out first, and nothing else may write to
+		// the recorders until this message has.
+		DrainLock drain_lock;
+		drainLogQueue();
+
 		if (site.mLevel == LEVEL_ERROR)
 		{
 			std::ostringstream fatalMessage;
@@ -1055,31 +1401,8 @@ namespace LLError
 		
 		
 		std::ostringstream prefix;
-
-		switch (site.mLevel)
-		{
-			case LEVEL_DEBUG:		prefix << "DEBUG: ";	break;
-			case LEVEL_INFO:		prefix << "INFO: ";		break;
-			case LEVEL_WARN:		prefix << "WARNING: ";	break;
-			case LEVEL_ERROR:		prefix << "ERROR: ";	break;
-			default:				prefix << "XXX: ";		break;
-		};
-		
-		if (s.printLocation)
-		{
-			prefix << abbreviateFile(site.mFile)
-					<< "(" << site.mLine << ") : ";
-		}
-		
-	#if LL_WINDOWS
-		// DevStudio: __FUNCTION__ already includes the full class name
-	#else
-		if (site.mClassInfo != typeid(NoClassInfo))
-		{
-			prefix << className(site.mClassInfo) << "::";
-		}
-	#endif
-		prefix << site.mFunction << ": ";
+		formatPrefix(prefix, site.mLevel, site.mFile, site.mLine,
+					 site.mClassInfo, site.mFunction, s.printLocation);
 
 		if (site.mPrintOnce)
 		{
@@ -1142,6 +1465,82 @@ namespace LLError
 
 
 
+namespace LLError
+{
+	void startAsyncLogging(unsigned int max_queued, bool drain_thread)
+	{
+		if (!gAPRPoolp)
+		{
+			llwarns << "APR is not initialized, logging synchronously" << llendl;
+			return;
+		}
+
+		if (!sLogDrainMutexp)
+		{
+			apr_thread_mutex_create(&sLogDrainMutexp, APR_THREAD_MUTEX_NESTED, gAPRPoolp);
+		}
+		if (!sLogQueue)
+		{
+			apr_threadkey_private_create(&sLogStreamKey, deleteLogStream, gAPRPoolp);
+			// Never deleted: another thread may be pushing to it at any time.
+			sLogQueue = new LogQueue;
+		}
+		sLogQueue->setMaxQueued(max_queued);
+
+		if (drain_thread && !sDrainThread)
+		{
+			sDrainThread = new LogDrainThread;
+			sDrainThread->start();
+		}
+		sAsyncLogging = true;
+	}
+
+	void stopAsyncLogging()
+	{
+		if (!sLogQueue)
+		{
+			return;
+		}
+
+		sAsyncLogging = false;
+		if (sDrainThread)
+		{
+			// The destructor shuts the thread down.
+			delete sDrainThread;
+			sDrainThread = NULL;
+		}
+		drainLogQueue();
+	}
+
+	void cleanupAsyncLogging()
+	{
+		stopAsyncLogging();
+		if (sLogDrainMutexp)
+		{
+			// Writing to the recorders no longer takes the drain lock.
+			// All other threads NEED to be done by now.
+			apr_thread_mutex_destroy(sLogDrainMutexp);
+			sLogDrainMutexp = NULL;
+		}
+	}
+
+	void flushAsyncLog()
+	{
+		drainLogQueue();
+	}
+
+	bool isAsyncLogging()
+	{
+		return sAsyncLogging;
+	}
+
+	unsigned int asyncLogDroppedCount()
+	{
+		return sLogQueue ? sLogQueue->getDroppedCount() : 0;
+	}
+}
+
+
 namespace LLError
 {
 	Settings* saveAndResetSettings()
@@ -1223,15 +1622,7 @@ namespace LLError
 
 	std::string utcTime()
 	{
-		time_t now = time(NULL);
-		const size_t BUF_SIZE = 64;
-		char time_str[BUF_SIZE];	/* Flawfinder: ignore */
-		
-		int chars = strftime(time_str, BUF_SIZE, 
-								  "%Y-%m-%dT%H:%M:%SZ",
-								  gmtime(&now));
-
-		return chars ? time_str : "time error";
+		return formatUTCTime(time(NULL));
 	}
 }
 
@@ -130,6 +130,31 @@ namespace LLError
 		// returns name of current logging file, empty string if none
 
 
+	/*
+		Asynchronous logging.
+	*/
+
+	void startAsyncLogging(unsigned int max_queued = 8192, bool drain_thread = true);
+		// Messages are formatted by the logging thread and queued without
+		// taking a lock; a drain thread writes them to the recorders. Errors
+		// and print once messages are still written synchronously, after
+		// anything already queued. Once max_queued messages are waiting,
+		// further messages are dropped and counted.
+		// Without a drain thread, messages wait for flushAsyncLog().
+		// Requires ll_init_apr().
+	void stopAsyncLogging();
+		// stops the drain thread, writes anything still queued and goes
+		// back to synchronous logging
+	void cleanupAsyncLogging();
+		// stops, and frees what asynchronous logging set up, once no other
+		// thread can log. Called from LLCommon::cleanupClass().
+	void flushAsyncLog();
+		// writes everything queued so far, from the calling thread
+	bool isAsyncLogging();
+	unsigned int asyncLogDroppedCount();
+		// messages dropped because the queue was full
+
+
 	/*
 		Utilities for use by the unit tests of LLError itself.
 	*/
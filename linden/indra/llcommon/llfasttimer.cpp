@@ -33,7 +33,13 @@
 
 #include "llfasttimer.h"
 
+#include <algorithm>
+
+#include "llapr.h"
+#include "llfile.h"
 #include "llprocessor.h"
+#include "llstring.h"
+#include "llthread.h"
 
 
 #if LL_WINDOWS
@@ -51,20 +57,70 @@
 
 
 LLFastTimer::EFastTimerType LLFastTimer::sCurType = LLFastTimer::FTM_OTHER;
-int LLFastTimer::sCurDepth = 0;
-U64 LLFastTimer::sStart[LLFastTimer::FTM_MAX_DEPTH];
-U64 LLFastTimer::sCounter[LLFastTimer::FTM_NUM_TYPES];
-U64 LLFastTimer::sCountHistory[LLFastTimer::FTM_HISTORY_NUM][LLFastTimer::FTM_NUM_TYPES];
-U64 LLFastTimer::sCountAverage[LLFastTimer::FTM_NUM_TYPES];
-U64 LLFastTimer::sCalls[LLFastTimer::FTM_NUM_TYPES];
-U64 LLFastTimer::sCallHistory[LLFastTimer::FTM_HISTORY_NUM][LLFastTimer::FTM_NUM_TYPES];
-U64 LLFastTimer::sCallAverage[LLFastTimer::FTM_NUM_TYPES];
+U64 LLFastTimer::sCountHistory[LLFastTimer::FTM_HISTORY_NUM][LLFastTimer::FTM_MAX_TIMERS];
+U64 LLFastTimer::sCountAverage[LLFastTimer::FTM_MAX_TIMERS];
+U64 LLFastTimer::sCallHistory[LLFastTimer::FTM_HISTORY_NUM][LLFastTimer::FTM_MAX_TIMERS];
+U64 LLFastTimer::sCallAverage[LLFastTimer::FTM_MAX_TIMERS];
 S32 LLFastTimer::sCurFrameIndex = -1;
 S32 LLFastTimer::sLastFrameIndex = -1;
 int LLFastTimer::sPauseHistory = 0;
 int LLFastTimer::sResetHistory = 0;
 
 F64 LLFastTimer::sCPUClockFrequency = 0.0;
+volatile bool LLFastTimer::sTracing = false;
+
+// Declared timers are numbered from here. This is constant initialized,
+// so it is safe to use from other static constructors.
+static S32 sNumTimers = LLFastTimer::FTM_NUM_TYPES;
+
+// Used before initClass() and by any code outside of LLApp.
+static LLFastTimer::ThreadState sMainThreadState;
+static apr_threadkey_t* sThreadStateKey = NULL;
+
+// Guards sThreadStates, the exited thread totals and the trace file.
+static LLMutex* sThreadMutex = NULL;
+static std::vector<LLFastTimer::ThreadState*> sThreadStates;
+static S32 sNextThreadID = 1;
+
+// What threads which have exited spent since the last reset()
+static U64 sExitedCounts[LLFastTimer::FTM_MAX_TIMERS];
+static U64 sExitedCalls[LLFastTimer::FTM_MAX_TIMERS];
+
+static llofstream* sTraceFile = NULL;
+static U64 sTraceStart = 0;
+static bool sTraceFirstEvent = true;
+
+// Trace events for one thread. Only that thread adds events and only
+// flushTrace(), holding sThreadMutex, takes them out, so the two share
+// nothing but the counters. Events are dropped if a thread records more
+// than EVENT_COUNT between two flushes.
+struct LLFastTimer::TraceBuffer
+{
+	struct Event
+	{
+		S32 mType;
+		U64 mStart;
+		U64 mEnd;
+	};
+
+	enum { EVENT_COUNT = 16384 }; // must be power of 2
+
+	TraceBuffer() : mEvents(NULL), mWriteCount(0), mReadCount(0), mDropped(0) {}
+	~TraceBuffer() { delete [] mEvents; }
+
+	Event* volatile mEvents;	// made by the owning thread on its first event
+	LLAtomicU32 mWriteCount;	// only written by the owning thread
+	LLAtomicU32 mReadCount;		// only written by flushTrace()
+	LLAtomicU32 mDropped;
+};
+
+// Function static so that DeclareTimer instances in other files can
+// use it during static initialization.
+static std::string* timer_names()
+{
+	static std::string names[LLFastTimer::FTM_MAX_TIMERS];
+	return names;
+}
 
 #if LL_LINUX || LL_SOLARIS
 U64 LLFastTimer::sClockResolution = 1e9; // Nanosecond resolution
@@ -151,14 +207,366 @@ U64 LLFastTimer::countsPerSecond()
 }
 #endif
 
+LLFastTimer::DeclareTimer::DeclareTimer(const char* name)
+{
+	if (sNumTimers < FTM_MAX_TIMERS)
+	{
+		mIndex = sNumTimers++;
+		timer_names()[mIndex] = name;
+	}
+	else
+	{
+		mIndex = FTM_OTHER;
+	}
+}
+
+LLFastTimer::ThreadState::ThreadState()
+	: mCurDepth(0), mThreadID(0), mTrace(NULL)
+{
+	memset(mStart, 0, sizeof(mStart));
+	memset(mCounter, 0, sizeof(mCounter));
+	memset(mCalls, 0, sizeof(mCalls));
+	memset(mLastCounter, 0, sizeof(mLastCounter));
+	memset(mLastCalls, 0, sizeof(mLastCalls));
+}
+
+//static
+void LLFastTimer::initClass()
+{
+	if (sThreadStateKey)
+	{
+		return;
+	}
+	sThreadMutex = new LLMutex(NULL);
+	sMainThreadState.mName = "Main";
+	sMainThreadState.mTrace = new TraceBuffer;
+	sThreadStates.push_back(&sMainThreadState);
+	if (apr_threadkey_private_create(&sThreadStateKey, &threadExited, gAPRPoolp) == APR_SUCCESS)
+	{
+		apr_threadkey_private_set(&sMainThreadState, sThreadStateKey);
+	}
+	else
+	{
+		sThreadStateKey = NULL;
+	}
+}
+
+//static
+LLFastTimer::ThreadState* LLFastTimer::getThreadState()
+{
+	if (!sThreadStateKey)
+	{
+		return &sMainThreadState;
+	}
+	void* data = NULL;
+	apr_threadkey_private_get(&data, sThreadStateKey);
+	if (data)
+	{
+		return (ThreadState*)data;
+	}
+
+	// First timer on this thread. threadExited() frees it again.
+	ThreadState* state = new ThreadState;
+	state->mTrace = new TraceBuffer;
+	{
+		LLMutexLock lock(sThreadMutex);
+		state->mThreadID = sNextThreadID++;
+		state->mName = llformat("Thread %d", state->mThreadID);
+		sThreadStates.push_back(state);
+	}
+	apr_threadkey_private_set(state, sThreadStateKey);
+	return state;
+}
+
+//static
+// Called by APR on a thread which ran timers, as it exits
+void LLFastTimer::threadExited(void* data)
+{
+	ThreadState* state = (ThreadState*)data;
+	if (!state || state == &sMainThreadState)
+	{
+		return;
+	}
+
+	LLMutexLock lock(sThreadMutex);
+	// Keep what it spent this frame for the next reset()
+	for (S32 i = 0; i < sNumTimers; i++)
+	{
+		sExitedCounts[i] += state->mCounter[i] - state->mLastCounter[i];
+		sExitedCalls[i] += state->mCalls[i] - state->mLastCalls[i];
+	}
+	if (sTraceFile)
+	{
+		writeTraceEvents(state);
+		writeThreadName(state);
+	}
+	sThreadStates.erase(std::find(sThreadStates.begin(), sThreadStates.end(), state));
+	delete state->mTrace;
+	delete state;
+}
+
+//static
+S32 LLFastTimer::getThreadCount()
+{
+	if (!sThreadMutex)
+	{
+		return 1;
+	}
+	LLMutexLock lock(sThreadMutex);
+	return (S32)sThreadStates.size();
+}
+
+//static
+void LLFastTimer::setThreadName(const std::string& name)
+{
+	ThreadState* state = getThreadState();
+	if (sThreadMutex)
+	{
+		LLMutexLock lock(sThreadMutex);
+		state->mName = name;
+	}
+	else
+	{
+		state->mName = name;
+	}
+}
+
+//static
+void LLFastTimer::setTimerName(S32 index, const std::string& name)
+{
+	if (index >= 0 && index < FTM_MAX_TIMERS)
+	{
+		timer_names()[index] = name;
+	}
+}
+
+//static
+const std::string& LLFastTimer::getTimerName(S32 index)
+{
+	static const std::string empty;
+	if (index >= 0 && index < FTM_MAX_TIMERS)
+	{
+		return timer_names()[index];
+	}
+	return empty;
+}
+
+//static
+S32 LLFastTimer::getNumTimers()
+{
+	return sNumTimers;
+}
+
+//static
+void LLFastTimer::recordTrace(ThreadState* state, S32 type, U64 start, U64 end)
+{
+	TraceBuffer* trace = state->mTrace;
+	if (!trace || start < sTraceStart)
+	{
+		return;
+	}
+	if (!trace->mEvents)
+	{
+		trace->mEvents = new TraceBuffer::Event[TraceBuffer::EVENT_COUNT];
+	}
+	U32 write_count = trace->mWriteCount;
+	if (write_count - trace->mReadCount >= (U32)TraceBuffer::EVENT_COUNT)
+	{
+		trace->mDropped++;
+		return;
+	}
+	TraceBuffer::Event& event = trace->mEvents[write_count & (TraceBuffer::EVENT_COUNT - 1)];
+	event.mType = type;
+	event.mStart = start;
+	event.mEnd = end;
+	// publish the event
+	trace->mWriteCount = write_count + 1;
+}
+
+static void write_trace_string(std::ostream& out, const std::string& str)
+{
+	out << '"';
+	for (std::string::const_iterator it = str.begin(); it != str.end(); ++it)
+	{
+		if (*it == '"' || *it == '\\')
+		{
+			out << '\\';
+		}
+		if ((U8)*it >= 0x20)
+		{
+			out << *it;
+		}
+	}
+	out << '"';
+}
+
+//static
+bool LLFastTimer::beginTraceCapture(const std::string& filename)
+{
+	if (!sThreadMutex)
+	{
+		llwarns << "LLFastTimer::beginTraceCapture() before initClass()" << llendl;
+		return false;
+	}
+	endTraceCapture();
+
+	LLMutexLock lock(sThreadMutex);
+	sTraceFile = new llofstream(filename.c_str());
+	if (!sTraceFile->is_open())
+	{
+		llwarns << "Unable to open fast timer trace " << filename << llendl;
+		delete sTraceFile;
+		sTraceFile = NULL;
+		return false;
+	}
+	llinfos << "Writing fast timer trace to " << filename << llendl;
+	*sTraceFile << "{\"traceEvents\":[\n";
+	sTraceFirstEvent = true;
+	sTraceStart = get_cpu_clock_count();
+	sTracing = true;
+	return true;
+}
+
+//static
+void LLFastTimer::endTraceCapture()
+{
+	if (!sTraceFile)
+	{
+		return;
+	}
+	sTracing = false;
+	flushTrace();
+
+	LLMutexLock lock(sThreadMutex);
+	for (std::vector<ThreadState*>::iterator it = sThreadStates.begin();
+		 it != sThreadStates.end(); ++it)
+	{
+		writeThreadName(*it);
+	}
+	*sTraceFile << "\n]}\n";
+	sTraceFile->close();
+	delete sTraceFile;
+	sTraceFile = NULL;
+}
+
+//static
+// sThreadMutex must be locked
+void LLFastTimer::writeThreadName(ThreadState* state)
+{
+	*sTraceFile << (sTraceFirstEvent ? "" : ",\n")
+		<< "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+		<< state->mThreadID << ",\"args\":{\"name\":";
+	write_trace_string(*sTraceFile, state->mName);
+	*sTraceFile << "}}";
+	sTraceFirstEvent = false;
+}
+
+//static
+// sThreadMutex must be locked
+void LLFastTimer::writeTraceEvents(ThreadState* state)
+{
+	TraceBuffer* trace = state->mTrace;
+	if (!trace)
+	{
+		return;
+	}
+	const F64 usec_per_count = 1000000.0 / (F64)countsPerSecond();
+	U32 read_count = trace->mReadCount;
+	U32 write_count = trace->mWriteCount;
+	for ( ; read_count != write_count; ++read_count)
+	{
+		const TraceBuffer::Event& ev = trace->mEvents[read_count & (TraceBuffer::EVENT_COUNT - 1)];
+		if (ev.mStart < sTraceStart)
+		{
+			// left over from an earlier capture
+			continue;
+		}
+		*sTraceFile << (sTraceFirstEvent ? "" : ",\n") << "{\"name\":";
+		const std::string& name = timer_names()[ev.mType];
+		write_trace_string(*sTraceFile,
+			name.empty() ? llformat("Timer %d", ev.mType) : name);
+		*sTraceFile << llformat(",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+			state->mThreadID,
+			(F64)(ev.mStart - sTraceStart) * usec_per_count,
+			(F64)(ev.mEnd - ev.mStart) * usec_per_count);
+		sTraceFirstEvent = false;
+	}
+	trace->mReadCount = read_count;
+
+	U32 dropped = trace->mDropped;
+	if (dropped)
+	{
+		trace->mDropped -= dropped;
+		llwarns << "Fast timer trace dropped " << dropped << " events from "
+				<< state->mName << llendl;
+	}
+}
+
+//static
+void LLFastTimer::flushTrace()
+{
+	if (!sTraceFile)
+	{
+		return;
+	}
+	LLMutexLock lock(sThreadMutex);
+	for (std::vector<ThreadState*>::iterator it = sThreadStates.begin();
+		 it != sThreadStates.end(); ++it)
+	{
+		writeTraceEvents(*it);
+	}
+	sTraceFile->flush();
+}
+
+static void gather_frame(LLFastTimer::ThreadState* state, U64* counts, U64* calls)
+{
+	for (S32 i=0; i<sNumTimers; i++)
+	{
+		U64 count = state->mCounter[i];
+		U64 call_count = state->mCalls[i];
+		counts[i] += count - state->mLastCounter[i];
+		calls[i] += call_count - state->mLastCalls[i];
+		state->mLastCounter[i] = count;
+		state->mLastCalls[i] = call_count;
+	}
+}
+
 void LLFastTimer::reset()
 {
 	countsPerSecond(); // good place to calculate clock frequency
 	
-	if (sCurDepth != 0)
+	ThreadState* main_state = getThreadState();
+	if (main_state->mCurDepth != 0)
 	{
 		llerrs << "LLFastTimer::Reset() when sCurDepth != 0" << llendl;
 	}
+
+	// Gather what every thread spent since the last frame. Worker
+	// counters may be updated while this runs; the stats tolerate that.
+	static U64 frame_counts[FTM_MAX_TIMERS];
+	static U64 frame_calls[FTM_MAX_TIMERS];
+	memset(frame_counts, 0, sizeof(frame_counts));
+	memset(frame_calls, 0, sizeof(frame_calls));
+	if (sThreadMutex)
+	{
+		LLMutexLock lock(sThreadMutex);
+		for (std::vector<ThreadState*>::iterator it = sThreadStates.begin();
+			 it != sThreadStates.end(); ++it)
+		{
+			gather_frame(*it, frame_counts, frame_calls);
+		}
+		for (S32 i = 0; i < sNumTimers; i++)
+		{
+			frame_counts[i] += sExitedCounts[i];
+			frame_calls[i] += sExitedCalls[i];
+		}
+		memset(sExitedCounts, 0, sizeof(sExitedCounts));
+		memset(sExitedCalls, 0, sizeof(sExitedCalls));
+	}
+	else
+	{
+		gather_frame(main_state, frame_counts, frame_calls);
+	}
 	if (sPauseHistory)
 	{
 		sResetHistory = 1;
@@ -171,18 +579,18 @@ void LLFastTimer::reset()
 	else if (sCurFrameIndex >= 0)
 	{
 		int hidx = sCurFrameIndex % FTM_HISTORY_NUM;
-		for (S32 i=0; i<FTM_NUM_TYPES; i++)
+		for (S32 i=0; i<FTM_MAX_TIMERS; i++)
 		{
-			sCountHistory[hidx][i] = sCounter[i];
-			sCountAverage[i] = (sCountAverage[i]*sCurFrameIndex + sCounter[i]) / (sCurFrameIndex+1);
-			sCallHistory[hidx][i] = sCalls[i];
-			sCallAverage[i] = (sCallAverage[i]*sCurFrameIndex + sCalls[i]) / (sCurFrameIndex+1);
+			sCountHistory[hidx][i] = frame_counts[i];
+			sCountAverage[i] = (sCountAverage[i]*sCurFrameIndex + frame_counts[i]) / (sCurFrameIndex+1);
+			sCallHistory[hidx][i] = frame_calls[i];
+			sCallAverage[i] = (sCallAverage[i]*sCurFrameIndex + frame_calls[i]) / (sCurFrameIndex+1);
 		}
 		sLastFrameIndex = sCurFrameIndex;
 	}
 	else
 	{
-		for (S32 i=0; i<FTM_NUM_TYPES; i++)
+		for (S32 i=0; i<FTM_MAX_TIMERS; i++)
 		{
 			sCountAverage[i] = 0;
 			sCallAverage[i] = 0;
@@ -191,12 +599,12 @@ void LLFastTimer::reset()
 	
 	sCurFrameIndex++;
 	
-	for (S32 i=0; i<FTM_NUM_TYPES; i++)
+	main_state->mCurDepth = 0;
+
+	if (sTracing)
 	{
-		sCounter[i] = 0;
-		sCalls[i] = 0;
+		flushTrace();
 	}
-	sCurDepth = 0;
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -33,6 +33,8 @@
 #ifndef LL_LLFASTTIMER_H
 #define LL_LLFASTTIMER_H
 
+#include <string>
+
 #define FAST_TIMER_ON 1
 
 U64 get_cpu_clock_count();
@@ -193,25 +195,72 @@ public:
 	};
 	enum { FTM_HISTORY_NUM = 60 };
 	enum { FTM_MAX_DEPTH = 64 };
-	
+	enum { FTM_MAX_DECLARED = 128 };
+	enum { FTM_MAX_TIMERS = FTM_NUM_TYPES + FTM_MAX_DECLARED };
+
+	/**
+	 * @class DeclareTimer
+	 * @brief A named timer which any module can add without editing
+	 * EFastTimerType.
+	 *
+	 * Declare one at file scope and pass it to LLFastTimer:
+	 *   static LLFastTimer::DeclareTimer FTM_FETCH("Texture Fetch");
+	 *   ...
+	 *   LLFastTimer t(FTM_FETCH);
+	 * Declared timers are numbered after FTM_NUM_TYPES. Once
+	 * FTM_MAX_DECLARED are in use, further ones share FTM_OTHER.
+	 */
+	class DeclareTimer
+	{
+	public:
+		DeclareTimer(const char* name);
+		S32 getIndex() const { return mIndex; }
+	private:
+		S32 mIndex;
+	};
+
+	struct TraceBuffer;
+
+	/**
+	 * @brief Call stack and counters for one thread.
+	 *
+	 * Every thread which runs a timer gets its own, so timers in
+	 * worker threads neither corrupt the main thread stack nor need
+	 * a lock. Counters only ever grow; reset() folds the change since
+	 * the previous frame into the history. A worker's state is freed
+	 * when the thread exits, and what it spent that frame is kept for
+	 * the next reset().
+	 */
+	struct ThreadState
+	{
+		ThreadState();
+
+		int mCurDepth;
+		U64 mStart[FTM_MAX_DEPTH];
+		U64 mCounter[FTM_MAX_TIMERS];
+		U64 mCalls[FTM_MAX_TIMERS];
+		U64 mLastCounter[FTM_MAX_TIMERS];
+		U64 mLastCalls[FTM_MAX_TIMERS];
+		S32 mThreadID;
+		std::string mName;
+		TraceBuffer* mTrace;
+	};
+
 public:
 	static EFastTimerType sCurType;
 
 	LLFastTimer(EFastTimerType type)
 	{
 #if FAST_TIMER_ON
-		mType = type;
-		sCurType = type;
-		// These don't get counted, because they use CPU clockticks
-		//gTimerBins[gCurTimerBin]++;
-		//LLTimer::sNumTimerCalls++;
-
-		U64 cpu_clocks = get_cpu_clock_count();
-
-		sStart[sCurDepth] = cpu_clocks;
-		sCurDepth++;
+		start(type);
 #endif
-	};
+	}
+	LLFastTimer(const DeclareTimer& timer)
+	{
+#if FAST_TIMER_ON
+		start(timer.getIndex());
+#endif
+	}
 	~LLFastTimer()
 	{
 #if FAST_TIMER_ON
@@ -223,28 +272,64 @@ public:
 		//LLTimer::sNumTimerCalls++;
 		end = get_cpu_clock_count();
 
-		sCurDepth--;
-		delta = end - sStart[sCurDepth];
-		sCounter[mType] += delta;
-		sCalls[mType]++;
+		ThreadState* state = mState;
+		int depth = --state->mCurDepth;
+		delta = end - state->mStart[depth];
+		state->mCounter[mType] += delta;
+		state->mCalls[mType]++;
 		// Subtract delta from parents
-		for (i=0; i<sCurDepth; i++)
-			sStart[i] += delta;
+		for (i=0; i<depth; i++)
+			state->mStart[i] += delta;
+		if (sTracing)
+		{
+			recordTrace(state, mType, mStartTime, end);
+		}
 #endif
 	}
 
 	static void reset();
 	static U64 countsPerSecond();
 
+	/**
+	 * @brief Set up per-thread state. Called from LLCommon::initClass(),
+	 * which makes the calling thread the main thread.
+	 */
+	static void initClass();
+
+	/**
+	 * @brief Name the calling thread in trace captures.
+	 */
+	static void setThreadName(const std::string& name);
+
+	/**
+	 * @brief Number of threads with timer state, including the main
+	 * thread. A thread's state is freed when it exits.
+	 */
+	static S32 getThreadCount();
+
+	/**
+	 * @brief Set or get the display name of a timer. Declared timers
+	 * are named on construction.
+	 */
+	static void setTimerName(S32 index, const std::string& name);
+	static const std::string& getTimerName(S32 index);
+	static S32 getNumTimers();
+
+	/**
+	 * @brief Start writing every timer scope on every thread to
+	 * filename in the Chrome trace event format (load it in
+	 * chrome://tracing). Events are written out each reset().
+	 * @return Returns false if the file could not be opened.
+	 */
+	static bool beginTraceCapture(const std::string& filename);
+	static void endTraceCapture();
+	static bool isTraceCapturing() { return sTracing; }
+
 public:
-	static int sCurDepth;
-	static U64 sStart[FTM_MAX_DEPTH];
-	static U64 sCounter[FTM_NUM_TYPES];
-	static U64 sCalls[FTM_NUM_TYPES];
-	static U64 sCountAverage[FTM_NUM_TYPES];
-	static U64 sCallAverage[FTM_NUM_TYPES];
-	static U64 sCountHistory[FTM_HISTORY_NUM][FTM_NUM_TYPES];
-	static U64 sCallHistory[FTM_HISTORY_NUM][FTM_NUM_TYPES];
+	static U64 sCountAverage[FTM_MAX_TIMERS];
+	static U64 sCallAverage[FTM_MAX_TIMERS];
+	static U64 sCountHistory[FTM_HISTORY_NUM][FTM_MAX_TIMERS];
+	static U64 sCallHistory[FTM_HISTORY_NUM][FTM_MAX_TIMERS];
 	static S32 sCurFrameIndex;
 	static S32 sLastFrameIndex;
 	static int sPauseHistory;
@@ -253,7 +338,34 @@ public:
     static U64 sClockResolution;
 	
 private:
-	EFastTimerType mType;
+	void start(S32 type)
+	{
+		mType = type;
+		mState = getThreadState();
+		if (mState->mThreadID == 0)
+		{
+			sCurType = (EFastTimerType)type;
+		}
+		// These don't get counted, because they use CPU clockticks
+		//gTimerBins[gCurTimerBin]++;
+		//LLTimer::sNumTimerCalls++;
+
+		mStartTime = get_cpu_clock_count();
+		mState->mStart[mState->mCurDepth++] = mStartTime;
+	}
+
+	static ThreadState* getThreadState();
+	static void threadExited(void* state);
+	static void recordTrace(ThreadState* state, S32 type, U64 start, U64 end);
+	static void flushTrace();
+	static void writeTraceEvents(ThreadState* state);
+	static void writeThreadName(ThreadState* state);
+
+	static volatile bool sTracing;
+
+	S32 mType;
+	ThreadState* mState;
+	U64 mStartTime;
 };
 
 
@@ -35,6 +35,10 @@
 
 #if LL_WINDOWS
 #include <windows.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#include <errno.h>
 #endif
 
 #include "linden_common.h"
@@ -177,6 +181,75 @@ const char *LLFile::tmpdir()
 	return utf8path.c_str();
 }
 
+// static
+S32 LLFile::readAt(LLFILE* file, void* buffer, U32 offset, S32 length)
+{
+#if LL_WINDOWS
+	// Synchronous handles still take an offset through OVERLAPPED.
+	HANDLE handle = (HANDLE)_get_osfhandle(_fileno(file));
+	OVERLAPPED overlapped;
+	memset(&overlapped, 0, sizeof(overlapped));
+	overlapped.Offset = offset;
+	DWORD bytes_read = 0;
+	if (!ReadFile(handle, buffer, length, &bytes_read, &overlapped))
+	{
+		return 0;
+	}
+	return (S32)bytes_read;
+#else
+	S32 bytes_read = 0;
+	while (bytes_read < length)
+	{
+		ssize_t result = pread(fileno(file), (U8*)buffer + bytes_read,
+							   length - bytes_read, offset + bytes_read);
+		if (result < 0 && EINTR == errno)
+		{
+			continue;
+		}
+		if (result <= 0)
+		{
+			break;
+		}
+		bytes_read += (S32)result;
+	}
+	return bytes_read;
+#endif
+}
+
+// static
+S32 LLFile::writeAt(LLFILE* file, const void* buffer, U32 offset, S32 length)
+{
+#if LL_WINDOWS
+	HANDLE handle = (HANDLE)_get_osfhandle(_fileno(file));
+	OVERLAPPED overlapped;
+	memset(&overlapped, 0, sizeof(overlapped));
+	overlapped.Offset = offset;
+	DWORD bytes_written = 0;
+	if (!WriteFile(handle, buffer, length, &bytes_written, &overlapped))
+	{
+		return 0;
+	}
+	return (S32)bytes_written;
+#else
+	S32 bytes_written = 0;
+	while (bytes_written < length)
+	{
+		ssize_t result = pwrite(fileno(file), (const U8*)buffer + bytes_written,
+								length - bytes_written, offset + bytes_written);
+		if (result < 0 && EINTR == errno)
+		{
+			continue;
+		}
+		if (result <= 0)
+		{
+			break;
+		}
+		bytes_written += (S32)result;
+	}
+	return bytes_written;
+#endif
+}
+
 
 /***************** Modified file stream created to overcome the incorrect behaviour of posix fopen in windows *******************/
 
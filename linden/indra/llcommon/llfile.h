@@ -89,6 +89,11 @@ public:
 	static	bool	isfile(const std::string&	filename);
 	static	LLFILE *	_Fiopen(const std::string& filename, std::ios::openmode mode,int);	// protection currently unused
 
+	// Read or write at offset without moving the file position, so
+	// several threads can share one file. Return the bytes transferred.
+	static	S32		readAt(LLFILE* file, void* buffer, U32 offset, S32 length);
+	static	S32		writeAt(LLFILE* file, const void* buffer, U32 offset, S32 length);
+
 	static  const char * tmpdir();
 };
 
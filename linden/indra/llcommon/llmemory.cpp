@@ -45,6 +45,7 @@
 
 #include "llmemory.h"
 #include "llmemtype.h"
+#include "llmempool.h"
 
 //----------------------------------------------------------------------------
 
@@ -82,10 +83,12 @@ void LLMemory::freeReserve()
 S32 LLMemType::sCurDepth = 0;
 S32 LLMemType::sCurType = LLMemType::MTYPE_INIT;
 S32 LLMemType::sType[LLMemType::MTYPE_MAX_DEPTH];
+S32 LLMemType::sOverheadMem = 0;
+#endif
 S32 LLMemType::sMemCount[LLMemType::MTYPE_NUM_TYPES] = { 0 };
 S32 LLMemType::sMaxMemCount[LLMemType::MTYPE_NUM_TYPES] = { 0 };
 S32 LLMemType::sNewCount[LLMemType::MTYPE_NUM_TYPES] = { 0 };
-S32 LLMemType::sOverheadMem = 0;
+U32 LLMemType::sAllocCount[LLMemType::MTYPE_NUM_TYPES] = { 0 };
 
 const char* LLMemType::sTypeDesc[LLMemType::MTYPE_NUM_TYPES] =
 {
@@ -103,12 +106,18 @@ const char* LLMemType::sTypeDesc[LLMemType::MTYPE_NUM_TYPES] =
 	
 	"DRAWABLE",
 	"OBJECT",
+	"VERTEX_DATA",
+	"SPACE_PARTITION",
 	"PIPELINE",
 	"AVATAR",
+	"AVATAR_MESH",
 	"PARTICLES",
 	"REGIONS",
 	"INVENTORY",
 	"ANIMATION",
+	"VOLUME",
+	"PRIMITIVE",
+
 	"NETWORK",
 	"PHYSICS",
 	"INTERESTLIST",
@@ -120,7 +129,7 @@ const char* LLMemType::sTypeDesc[LLMemType::MTYPE_NUM_TYPES] =
 	"IO_PUMP",
 	"IO_TCP",
 	"IO_BUFFER",
-	"IO_HTTP_SERVER"
+	"IO_HTTP_SERVER",
 	"IO_SD_SERVER",
 	"IO_SD_CLIENT",
 	"IO_URL_REQUEST",
@@ -133,18 +142,47 @@ const char* LLMemType::sTypeDesc[LLMemType::MTYPE_NUM_TYPES] =
 	"TEMP6",
 	"TEMP7",
 	"TEMP8",
-	"TEMP9"
+	"TEMP9",
+
+	"OTHER"
 };
 
-#endif
 S32 LLMemType::sTotalMem = 0;
 S32 LLMemType::sMaxTotalMem = 0;
 
+static inline S32 mem_atomic_add(volatile S32* value, S32 delta)
+{
+#if LL_WINDOWS
+	return InterlockedExchangeAdd((volatile LONG*)value, delta) + delta;
+#else
+	return __sync_add_and_fetch(value, delta);
+#endif
+}
+
+//static
+void LLMemType::trackAlloc(EMemType type, size_t size)
+{
+	S32 bytes = mem_atomic_add(&sMemCount[type], (S32)size);
+	mem_atomic_add(&sNewCount[type], 1);
+	mem_atomic_add((volatile S32*)&sAllocCount[type], 1);
+	// The peak may lose a race with another thread; it is only a hint.
+	if (bytes > sMaxMemCount[type])
+	{
+		sMaxMemCount[type] = bytes;
+	}
+}
+
+//static
+void LLMemType::trackFree(EMemType type, size_t size)
+{
+	mem_atomic_add(&sMemCount[type], -(S32)size);
+	mem_atomic_add(&sNewCount[type], -1);
+}
+
 //static
 void LLMemType::printMem()
 {
 	S32 misc_mem = sTotalMem;
-#if MEM_TRACK_TYPE
 	for (S32 i=0; i<MTYPE_NUM_TYPES; i++)
 	{
 		if (sMemCount[i])
@@ -153,9 +191,29 @@ void LLMemType::printMem()
 		}
 		misc_mem -= sMemCount[i];
 	}
-#endif
+#if MEM_TRACK_MEM
 	llinfos << llformat("MEM: % 20s %03d MB","MISC",misc_mem>>20) << llendl;
 	llinfos << llformat("MEM: % 20s %03d MB (Max=%d MB)","TOTAL",sTotalMem>>20,sMaxTotalMem>>20) << llendl;
+#endif
+}
+
+//static
+void LLMemType::dumpStats(std::ostream& str)
+{
+	S32 tracked = 0;
+	str << llformat("%-20s %12s %12s %10s %12s", "TYPE", "BYTES", "PEAK", "LIVE", "ALLOCS") << "\n";
+	for (S32 i=0; i<MTYPE_NUM_TYPES; i++)
+	{
+		if (sMemCount[i] || sAllocCount[i])
+		{
+			str << llformat("%-20s %12d %12d %10d %12u", sTypeDesc[i],
+							sMemCount[i], sMaxMemCount[i], sNewCount[i], sAllocCount[i]) << "\n";
+			tracked += sMemCount[i];
+		}
+	}
+	str << llformat("%-20s %12d", "TRACKED", tracked) << "\n";
+	str << llformat("%-20s ", "RSS") << getCurrentRSS() << "\n\n";
+	LLMemPool::dumpStats(str);
 }
 
 #if MEM_TRACK_MEM
@@ -191,12 +249,7 @@ void* ll_allocate (size_t size)
 	LLMemType::sOverheadMem += 4;
 	*(S32*)p = LLMemType::sCurType;
 	p += 4;
-	LLMemType::sMemCount[LLMemType::sCurType] += size;
-	if (LLMemType::sMemCount[LLMemType::sCurType] > LLMemType::sMaxMemCount[LLMemType::sCurType])
-	{
-		LLMemType::sMaxMemCount[LLMemType::sCurType] = LLMemType::sMemCount[LLMemType::sCurType];
-	}
-	LLMemType::sNewCount[LLMemType::sCurType]++;
+	LLMemType::trackAlloc((LLMemType::EMemType)LLMemType::sCurType, size);
 #endif
 	return (void*)p;
 }
@@ -220,9 +273,8 @@ void ll_release (void *pin)
 	S32 size = *(size_t*)p;
 	LLMemType::sOverheadMem -= 4;
 #if MEM_TRACK_TYPE
-	LLMemType::sMemCount[type] -= size;
+	LLMemType::trackFree((LLMemType::EMemType)type, size);
 	LLMemType::sOverheadMem -= 4;
-	LLMemType::sNewCount[type]--;
 #endif
 	LLMemType::sTotalMem -= size;
 	free(p);
@@ -0,0 +1,220 @@
+/** 
+ * @file llmempool.cpp
+ * @brief Fixed size object pools accounted to an LLMemType.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ * 
+ * Copyright (c) 2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#if LL_WINDOWS
+# include <windows.h>
+#endif
+
+#include "llmempool.h"
+#include "llmemory.h"
+#include "llthread.h"
+
+//static
+LLMemPool* volatile LLMemPool::sPools = NULL;
+
+// Locks a pool's mutex if it was created thread safe.
+class LLMemPoolLock
+{
+public:
+	LLMemPoolLock(LLMutex* mutex) : mMutex(mutex)	{ if (mMutex) mMutex->lock(); }
+	~LLMemPoolLock()								{ if (mMutex) mMutex->unlock(); }
+private:
+	LLMutex* mMutex;
+};
+
+// Blocks are 16 byte aligned so pooled classes may hold SSE types. malloc()
+// only promises 8 on some platforms, so chunks and oversized blocks are
+// aligned by hand.
+static const size_t MEM_POOL_ALIGNMENT = 16;
+
+static char* mem_pool_align(char* p)
+{
+	return (char*)(((uintptr_t)p + MEM_POOL_ALIGNMENT - 1) & ~(uintptr_t)(MEM_POOL_ALIGNMENT - 1));
+}
+
+// Chunks and oversized blocks come straight from malloc. The pool counts
+// what it hands out against its own type; ll_allocate() would count it a
+// second time against the current type when MEM_TRACK_TYPE is on.
+static void* mem_pool_malloc(size_t size)
+{
+	void* p = malloc(size);
+	if (!p)
+	{
+		LLMemory::freeReserve();
+		llerrs << "Out of memory Error" << llendl;
+	}
+	return p;
+}
+
+LLMemPool::LLMemPool(const char* name, LLMemType::EMemType type, size_t block_size,
+					 U32 blocks_per_chunk, bool thread_safe)
+:	mName(name),
+	mType(type),
+	mBlockSize((llmax(block_size, sizeof(FreeBlock)) + MEM_POOL_ALIGNMENT - 1) & ~(MEM_POOL_ALIGNMENT - 1)),
+	mBlocksPerChunk(llmax(blocks_per_chunk, (U32)1)),
+	mFreeList(NULL),
+	mChunks(NULL),
+	mChunkCount(0),
+	mLiveCount(0),
+	mFreeCount(0),
+	mHeapCount(0),
+	mMutex(NULL),
+	mNextPool(NULL)
+{
+	if (thread_safe)
+	{
+		mMutex = new LLMutex(NULL);
+	}
+
+	// Register for dumpStats(). Pools can be created on any thread.
+	LLMemPool* head;
+	do
+	{
+		head = sPools;
+		mNextPool = head;
+	}
+#if LL_WINDOWS
+	while (InterlockedCompareExchangePointer((PVOID volatile*)&sPools, this, head) != head);
+#else
+	while (!__sync_bool_compare_and_swap(&sPools, head, this));
+#endif
+}
+
+LLMemPool::~LLMemPool()
+{
+	if (mLiveCount)
+	{
+		llwarns << "Destroying pool " << mName << " with " << mLiveCount
+				<< " live blocks" << llendl;
+	}
+	while (mChunks)
+	{
+		Chunk* next = mChunks->mNext;
+		free(mChunks);
+		mChunks = next;
+	}
+	delete mMutex;
+	mMutex = NULL;
+	// Pools are expected to live for the whole process, so this one is
+	// left on the registry list; it must not be destroyed before exit.
+}
+
+void LLMemPool::addChunk()
+{
+	// The chunk header goes first, the blocks start at the next aligned
+	// address after it.
+	char* chunk = (char*)mem_pool_malloc(sizeof(Chunk) + MEM_POOL_ALIGNMENT - 1 + mBlockSize * mBlocksPerChunk);
+	((Chunk*)chunk)->mNext = mChunks;
+	mChunks = (Chunk*)chunk;
+	mChunkCount++;
+
+	char* blocks = mem_pool_align(chunk + sizeof(Chunk));
+	for (U32 i = mBlocksPerChunk; i > 0; i--)
+	{
+		FreeBlock* block = (FreeBlock*)(blocks + (i - 1) * mBlockSize);
+		block->mNext = mFreeList;
+		mFreeList = block;
+	}
+	mFreeCount += mBlocksPerChunk;
+}
+
+void* LLMemPool::allocate(size_t size)
+{
+	if (size > mBlockSize)
+	{
+		LLMemType::trackAlloc(mType, size);
+		{
+			LLMemPoolLock lock(mMutex);
+			mHeapCount++;
+		}
+		// The pointer malloc() returned goes just before the aligned block
+		char* raw = (char*)mem_pool_malloc(size + sizeof(void*) + MEM_POOL_ALIGNMENT - 1);
+		char* block = mem_pool_align(raw + sizeof(void*));
+		((void**)block)[-1] = raw;
+		return block;
+	}
+
+	FreeBlock* block;
+	{
+		LLMemPoolLock lock(mMutex);
+		if (!mFreeList)
+		{
+			addChunk();
+		}
+		block = mFreeList;
+		mFreeList = block->mNext;
+		mFreeCount--;
+		mLiveCount++;
+	}
+	LLMemType::trackAlloc(mType, mBlockSize);
+	return block;
+}
+
+void LLMemPool::release(void* p, size_t size)
+{
+	if (!p)
+	{
+		return;
+	}
+
+	if (size > mBlockSize)
+	{
+		LLMemType::trackFree(mType, size);
+		{
+			LLMemPoolLock lock(mMutex);
+			mHeapCount--;
+		}
+		free(((void**)p)[-1]);
+		return;
+	}
+
+	LLMemType::trackFree(mType, mBlockSize);
+	LLMemPoolLock lock(mMutex);
+	FreeBlock* block = (FreeBlock*)p;
+	block->mNext = mFreeList;
+	mFreeList = block;
+	mFreeCount++;
+	mLiveCount--;
+}
+
+//static
+void LLMemPool::dumpStats(std::ostream& str)
+{
+	str << llformat("%-20s %8s %8s %10s %10s %10s", "POOL", "BLOCK", "CHUNKS", "LIVE", "FREE", "HEAP") << "\n";
+	for (LLMemPool* pool = sPools; pool; pool = pool->mNextPool)
+	{
+		str << llformat("%-20s %8u %8u %10u %10u %10u", pool->mName, (U32)pool->mBlockSize,
+						pool->mChunkCount, pool->mLiveCount, pool->mFreeCount, pool->mHeapCount) << "\n";
+	}
+}
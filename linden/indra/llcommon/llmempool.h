@@ -0,0 +1,127 @@
+/** 
+ * @file llmempool.h
+ * @brief Fixed size object pools accounted to an LLMemType.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ * 
+ * Copyright (c) 2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLMEMPOOL_H
+#define LL_LLMEMPOOL_H
+
+#include <iosfwd>
+
+#include "llmemtype.h"
+
+class LLMutex;
+
+//----------------------------------------------------------------------------
+// Hands out blocks of one size carved from larger chunks, so classes which
+// are created and destroyed thousands of times a second do not churn the
+// heap. Freed blocks go on a free list for reuse; chunks are only returned
+// when the pool is destroyed. Requests larger than the block size (derived
+// classes going through the base class operator new) fall back to the heap.
+// Every block, pooled or not, is 16 byte aligned, and is counted against
+// the pool's LLMemType.
+//----------------------------------------------------------------------------
+
+class LLMemPool
+{
+public:
+	LLMemPool(const char* name, LLMemType::EMemType type, size_t block_size,
+			  U32 blocks_per_chunk = 256, bool thread_safe = false);
+	~LLMemPool();
+
+	void* allocate(size_t size);
+	void release(void* p, size_t size);
+
+	const char* getName() const		{ return mName; }
+	size_t getBlockSize() const		{ return mBlockSize; }
+	U32 getChunkCount() const		{ return mChunkCount; }
+	U32 getLiveCount() const		{ return mLiveCount; }
+	U32 getFreeCount() const		{ return mFreeCount; }
+	U32 getHeapCount() const		{ return mHeapCount; }
+
+	// One line per pool with its block size, chunks, live and free blocks.
+	static void dumpStats(std::ostream& str);
+
+private:
+	LLMemPool(const LLMemPool&);			// not implemented
+	LLMemPool& operator=(const LLMemPool&);	// not implemented
+
+	struct FreeBlock
+	{
+		FreeBlock* mNext;
+	};
+
+	struct Chunk
+	{
+		Chunk* mNext;
+	};
+
+	void addChunk();
+
+	const char* mName;
+	LLMemType::EMemType mType;
+	size_t mBlockSize;
+	U32 mBlocksPerChunk;
+	FreeBlock* mFreeList;
+	Chunk* mChunks;
+	U32 mChunkCount;
+	U32 mLiveCount;
+	U32 mFreeCount;
+	U32 mHeapCount;
+	LLMutex* mMutex;
+	LLMemPool* mNextPool;
+
+	static LLMemPool* volatile sPools;
+};
+
+// Inside a class declaration: route its new and delete through a pool.
+// The pool is created on first use. A class whose instances are created
+// on more than one thread must call initMemPool() before any other
+// thread can create one.
+#define MEM_TYPE_POOL_NEW \
+static void initMemPool(); \
+static LLMemPool& getMemPool() { if (!sMemPool) initMemPool(); return *sMemPool; } \
+static void* operator new(size_t s) { return getMemPool().allocate(s); } \
+static void  operator delete(void* p, size_t s) { getMemPool().release(p, s); } \
+static LLMemPool* sMemPool
+
+// In the class's .cpp file. The pool is deliberately never destroyed, so
+// objects deleted during static destruction still have somewhere to go.
+#define MEM_TYPE_POOL_IMPL(CLASS, TYPE, BLOCKS_PER_CHUNK, THREAD_SAFE) \
+LLMemPool* CLASS::sMemPool = NULL; \
+void CLASS::initMemPool() \
+{ \
+	if (!sMemPool) \
+	{ \
+		sMemPool = new LLMemPool(#CLASS, TYPE, sizeof(CLASS), BLOCKS_PER_CHUNK, THREAD_SAFE); \
+	} \
+}
+
+#endif // LL_LLMEMPOOL_H
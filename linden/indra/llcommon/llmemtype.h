@@ -36,6 +36,10 @@
 //----------------------------------------------------------------------------
 //----------------------------------------------------------------------------
 
+#include <cstddef>
+#include <iosfwd>
+#include <new>
+
 class LLMemType;
 
 extern void* ll_allocate (size_t size);
@@ -51,7 +55,12 @@ static void* operator new(size_t s) { LLMemType mt(T); return ll_allocate(s); }
 static void  operator delete(void* p) { ll_release(p); }
 
 #else
-#define MEM_TYPE_NEW(T)
+// Without global tracking, classes which declare a type still have their
+// own allocations counted against it. The sized delete is passed the size
+// of the dynamic type when the class has a virtual destructor.
+#define MEM_TYPE_NEW(T) \
+static void* operator new(size_t s) { LLMemType::trackAlloc(T, s); return ll_allocate(s); } \
+static void  operator delete(void* p, size_t s) { LLMemType::trackFree(T, s); ll_release(p); }
 #endif // MEM_TRACK_TYPE
 
 
@@ -144,23 +153,82 @@ public:
 
 	static void reset();
 	static void printMem();
+
+	// Always available accounting, used by MEM_TYPE_NEW, LLMemPool and
+	// LLMemTypeAllocator. Safe to call from any thread.
+	static void trackAlloc(EMemType type, size_t size);
+	static void trackFree(EMemType type, size_t size);
+
+	// Writes one line per category with live bytes, peak bytes, live
+	// allocations and allocations made, followed by the pool summary.
+	static void dumpStats(std::ostream& str);
 	
 public:
 #if MEM_TRACK_TYPE
 	static S32 sCurDepth;
 	static S32 sCurType;
 	static S32 sType[MTYPE_MAX_DEPTH];
-	static S32 sMemCount[MTYPE_NUM_TYPES];
-	static S32 sMaxMemCount[MTYPE_NUM_TYPES];
-	static S32 sNewCount[MTYPE_NUM_TYPES];
 	static S32 sOverheadMem;
-	static const char* sTypeDesc[MTYPE_NUM_TYPES];
 #endif
+	static S32 sMemCount[MTYPE_NUM_TYPES];		// live bytes
+	static S32 sMaxMemCount[MTYPE_NUM_TYPES];	// peak live bytes
+	static S32 sNewCount[MTYPE_NUM_TYPES];		// live allocations
+	static U32 sAllocCount[MTYPE_NUM_TYPES];	// allocations ever made, wraps
+	static const char* sTypeDesc[MTYPE_NUM_TYPES];
 	static S32 sTotalMem;
 	static S32 sMaxTotalMem;
 };
 
 //----------------------------------------------------------------------------
 
+// STL allocator which counts a container's storage against a memory type:
+//   std::vector<U16, LLMemTypeAllocator<U16, LLMemType::MTYPE_VOLUME> >
+template <class T, LLMemType::EMemType TYPE>
+class LLMemTypeAllocator
+{
+public:
+	typedef T value_type;
+	typedef T* pointer;
+	typedef const T* const_pointer;
+	typedef T& reference;
+	typedef const T& const_reference;
+	typedef size_t size_type;
+	typedef ptrdiff_t difference_type;
+
+	template <class U> struct rebind { typedef LLMemTypeAllocator<U, TYPE> other; };
+
+	LLMemTypeAllocator() {}
+	LLMemTypeAllocator(const LLMemTypeAllocator&) {}
+	template <class U> LLMemTypeAllocator(const LLMemTypeAllocator<U, TYPE>&) {}
+
+	pointer address(reference x) const { return &x; }
+	const_pointer address(const_reference x) const { return &x; }
+
+	pointer allocate(size_type n, const void* = 0)
+	{
+		LLMemType::trackAlloc(TYPE, n * sizeof(T));
+		return (pointer)ll_allocate(n * sizeof(T));
+	}
+
+	void deallocate(pointer p, size_type n)
+	{
+		LLMemType::trackFree(TYPE, n * sizeof(T));
+		ll_release(p);
+	}
+
+	size_type max_size() const { return size_t(-1) / sizeof(T); }
+
+	void construct(pointer p, const T& val) { new((void*)p) T(val); }
+	void destroy(pointer p) { p->~T(); }
+};
+
+template <class T, class U, LLMemType::EMemType TYPE>
+inline bool operator==(const LLMemTypeAllocator<T, TYPE>&, const LLMemTypeAllocator<U, TYPE>&) { return true; }
+
+template <class T, class U, LLMemType::EMemType TYPE>
+inline bool operator!=(const LLMemTypeAllocator<T, TYPE>&, const LLMemTypeAllocator<U, TYPE>&) { return false; }
+
+//----------------------------------------------------------------------------
+
 #endif
 
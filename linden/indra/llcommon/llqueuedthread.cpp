@@ -90,6 +90,7 @@ void LLQueuedThread::shutdown()
 		{
 			++active_count;
 		}
+		mRequestQueue.erase(req);
 		req->deleteRequest();
 	}
 	if (active_count)
@@ -179,7 +180,7 @@ void LLQueuedThread::printQueueStats()
 	lockData();
 	if (!mRequestQueue.empty())
 	{
-		QueuedRequest *req = *mRequestQueue.begin();
+		QueuedRequest *req = mRequestQueue.front();
 		llinfos << llformat("Pending Requests:%d Current status:%d", mRequestQueue.size(), req->getStatus()) << llendl;
 	}
 	else
@@ -328,7 +329,7 @@ void LLQueuedThread::setPriority(handle_t handle, U32 priority)
 		else if(req->getStatus() == STATUS_QUEUED)
 		{
 			// remove from list then re-insert
-			llverify(mRequestQueue.erase(req) == 1);
+			llverify(mRequestQueue.erase(req));
 			req->setPriority(priority);
 			mRequestQueue.insert(req);
 		}
@@ -392,8 +393,7 @@ S32 LLQueuedThread::processNextRequest()
 		{
 			break;
 		}
-		req = *mRequestQueue.begin();
-		mRequestQueue.erase(mRequestQueue.begin());
+		req = mRequestQueue.pop();
 
 		if(req->getStatus() == STATUS_DELETE)
 		{
@@ -530,13 +530,16 @@ LLQueuedThread::QueuedRequest::QueuedRequest(LLQueuedThread::handle_t handle, U3
 	LLSimpleHashEntry<LLQueuedThread::handle_t>(handle),
 	mStatus(STATUS_UNKNOWN),
 	mPriority(priority),
-	mFlags(flags)
+	mFlags(flags),
+	mQueueBucket(-1),
+	mQueueIndex(0)
 {
 }
 
 LLQueuedThread::QueuedRequest::~QueuedRequest()
 {
 	llassert_always(mStatus == STATUS_DELETE);
+	llassert_always(mQueueBucket < 0);
 }
 
 //virtual
@@ -551,3 +554,156 @@ void LLQueuedThread::QueuedRequest::deleteRequest()
 	setStatus(STATUS_DELETE);
 	delete this;
 }
+
+//============================================================================
+
+LLQueuedThread::RequestQueue::RequestQueue() :
+	mSize(0)
+{
+	memset(mOccupied, 0, sizeof(mOccupied));
+}
+
+// static
+S32 LLQueuedThread::RequestQueue::getBucket(U32 priority)
+{
+	return (S32)llmin(priority >> BUCKET_SHIFT, (U32)(NUM_BUCKETS - 1));
+}
+
+S32 LLQueuedThread::RequestQueue::getTopBucket() const
+{
+	for (S32 word = BITMAP_WORDS - 1; word >= 0; --word)
+	{
+		U32 bits = mOccupied[word];
+		if (bits)
+		{
+			// index of the highest set bit
+			S32 bit = 0;
+			if (bits & 0xffff0000) { bits >>= 16; bit += 16; }
+			if (bits & 0xff00) { bits >>= 8; bit += 8; }
+			if (bits & 0xf0) { bits >>= 4; bit += 4; }
+			if (bits & 0xc) { bits >>= 2; bit += 2; }
+			if (bits & 0x2) { bit += 1; }
+			return word * 32 + bit;
+		}
+	}
+	return -1;
+}
+
+// static
+void LLQueuedThread::RequestQueue::siftUp(heap_t& heap, S32 index)
+{
+	QueuedRequest* req = heap[index];
+	while (index > 0)
+	{
+		S32 parent = (index - 1) / 2;
+		if (!req->higherPriority(*heap[parent]))
+		{
+			break;
+		}
+		heap[index] = heap[parent];
+		heap[index]->mQueueIndex = index;
+		index = parent;
+	}
+	heap[index] = req;
+	req->mQueueIndex = index;
+}
+
+// static
+void LLQueuedThread::RequestQueue::siftDown(heap_t& heap, S32 index)
+{
+	S32 size = (S32)heap.size();
+	QueuedRequest* req = heap[index];
+	while (true)
+	{
+		S32 child = index * 2 + 1;
+		if (child >= size)
+		{
+			break;
+		}
+		if (child + 1 < size && heap[child + 1]->higherPriority(*heap[child]))
+		{
+			++child;
+		}
+		if (!heap[child]->higherPriority(*req))
+		{
+			break;
+		}
+		heap[index] = heap[child];
+		heap[index]->mQueueIndex = index;
+		index = child;
+	}
+	heap[index] = req;
+	req->mQueueIndex = index;
+}
+
+void LLQueuedThread::RequestQueue::insert(QueuedRequest* req)
+{
+	llassert_always(req->mQueueBucket < 0);
+	S32 bucket = getBucket(req->getPriority());
+	heap_t& heap = mHeap[bucket];
+	if (heap.empty())
+	{
+		mOccupied[bucket >> 5] |= (1 << (bucket & 31));
+	}
+	req->mQueueBucket = bucket;
+	heap.push_back(req);
+	siftUp(heap, (S32)heap.size() - 1);
+	++mSize;
+}
+
+bool LLQueuedThread::RequestQueue::erase(QueuedRequest* req)
+{
+	S32 bucket = req->mQueueBucket;
+	if (bucket < 0)
+	{
+		return false;
+	}
+	heap_t& heap = mHeap[bucket];
+	S32 index = req->mQueueIndex;
+	llassert_always(heap[index] == req);
+	QueuedRequest* last = heap.back();
+	heap.pop_back();
+	if (last != req)
+	{
+		// move the last one into the hole, it may belong above or below it
+		heap[index] = last;
+		siftDown(heap, index);
+		siftUp(heap, last->mQueueIndex);
+	}
+	if (heap.empty())
+	{
+		mOccupied[bucket >> 5] &= ~(1 << (bucket & 31));
+	}
+	req->mQueueBucket = -1;
+	req->mQueueIndex = 0;
+	--mSize;
+	return true;
+}
+
+LLQueuedThread::QueuedRequest* LLQueuedThread::RequestQueue::front() const
+{
+	S32 bucket = getTopBucket();
+	return bucket >= 0 ? mHeap[bucket].front() : NULL;
+}
+
+LLQueuedThread::QueuedRequest* LLQueuedThread::RequestQueue::pop()
+{
+	QueuedRequest* req = front();
+	if (req)
+	{
+		erase(req);
+	}
+	return req;
+}
+
+void LLQueuedThread::RequestQueue::getRequests(std::vector<QueuedRequest*>& requests) const
+{
+	requests.clear();
+	requests.reserve(mSize);
+	for (S32 bucket = NUM_BUCKETS - 1; bucket >= 0; --bucket)
+	{
+		S32 first = requests.size();
+		requests.insert(requests.end(), mHeap[bucket].begin(), mHeap[bucket].end());
+		std::sort(requests.begin() + first, requests.end(), queued_request_less());
+	}
+}
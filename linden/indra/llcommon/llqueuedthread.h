@@ -33,10 +33,12 @@
 #ifndef LL_LLQUEUEDTHREAD_H
 #define LL_LLQUEUEDTHREAD_H
 
+#include <algorithm>
 #include <queue>
 #include <string>
 #include <map>
 #include <set>
+#include <vector>
 
 #include "llapr.h"
 
@@ -83,6 +85,7 @@ public:
 	class QueuedRequest : public LLSimpleHashEntry<handle_t>
 	{
 		friend class LLQueuedThread;
+		friend class RequestQueue;
 		
 	protected:
 		virtual ~QueuedRequest(); // use deleteRequest()
@@ -137,17 +140,62 @@ public:
 		LLAtomic32<status_t> mStatus;
 		U32 mPriority;
 		U32 mFlags;
+
+	private:
+		// RequestQueue position, only touched with the owning thread's data locked
+		S32 mQueueBucket; // -1 when not queued
+		S32 mQueueIndex; // in the bucket's heap
 	};
 
-protected:
 	struct queued_request_less
 	{
 		bool operator()(const QueuedRequest* lhs, const QueuedRequest* rhs) const
 		{
-			return lhs->higherPriority(*rhs); // higher priority in front of queue (set)
+			return lhs->higherPriority(*rhs); // higher priority in front of queue
 		}
 	};
 
+	// Priority queue of requests. Requests are bucketed on the high bits of
+	// their priority with an occupancy bitmap, and each bucket is a binary
+	// heap, so requests come out in exactly the order of higherPriority().
+	// Finding the top bucket is O(1), and insert, erase (and therefore
+	// reprioritisation) and pop only pay O(log N) within one bucket, which
+	// keeps the data lock held briefly.
+	class RequestQueue
+	{
+	public:
+		RequestQueue();
+
+		void insert(QueuedRequest* req);
+		bool erase(QueuedRequest* req); // returns false if req was not queued
+		QueuedRequest* front() const;
+		QueuedRequest* pop();
+
+		bool empty() const { return mSize == 0; }
+		S32 size() const { return mSize; }
+
+		// Copies the queue out in priority order. O(N), for debugging only.
+		void getRequests(std::vector<QueuedRequest*>& requests) const;
+
+	private:
+		enum
+		{
+			BUCKET_SHIFT = 23, // 31 bits of priority -> 256 buckets
+			NUM_BUCKETS = 256,
+			BITMAP_WORDS = NUM_BUCKETS / 32
+		};
+		typedef std::vector<QueuedRequest*> heap_t;
+
+		static S32 getBucket(U32 priority);
+		S32 getTopBucket() const;
+		static void siftUp(heap_t& heap, S32 index);
+		static void siftDown(heap_t& heap, S32 index);
+
+		heap_t mHeap[NUM_BUCKETS];
+		U32 mOccupied[BITMAP_WORDS];
+		S32 mSize;
+	};
+
 	//------------------------------------------------------------------------
 	
 public:
@@ -204,7 +252,7 @@ protected:
 	BOOL mThreaded;  // if false, run on main thread and do updates during update()
 	LLAtomic32<BOOL> mIdleThread; // request queue is empty (or we are quitting) and the thread is idle
 	
-	typedef std::set<QueuedRequest*, queued_request_less> request_queue_t;
+	typedef RequestQueue request_queue_t;
 	request_queue_t mRequestQueue;
 
 	enum { REQUEST_HASH_SIZE = 512 }; // must be power of 2
@@ -33,7 +33,9 @@
 #include "linden_common.h"
 #include "llsd.h"
 
+#include "llapr.h"
 #include "llerror.h"
+#include "llthread.h"
 #include "../llmath/llmath.h"
 #include "llformat.h"
 #include "llsdserialize.h"
@@ -66,6 +68,8 @@ class LLSD::Impl
 {
 private:
 	U32 mUseCount;
+
+	enum { IMMORTAL = 0xFFFFFFFF };
 	
 protected:
 	Impl();
@@ -81,8 +85,16 @@ protected:
 	bool shared() const							{ return mUseCount > 1; }
 	
 public:
+	static void* operator new(size_t size);
+	static void operator delete(void* ptr);
+		///< draw from the current LLSD::Arena, if any
+		
 	static void reset(Impl*& var, Impl* impl);
 		///< safely set var to refer to the new impl (possibly shared)
+
+	static void initInterned();
+		///< preallocate the values shared while an arena is active.  They
+		//	 are never deleted and always look shared, so never modified.
 		
 	static       Impl& safe(      Impl*);
 	static const Impl& safe(const Impl*);
@@ -159,6 +171,8 @@ namespace
 
 	public:
 		ImplBase(DataRef value) : mValue(value) { }
+		ImplBase(DataRef value, StaticAllocationMarker m)
+			: Impl(m), mValue(value) { }
 		
 		virtual LLSD::Type type() const { return T; }
 
@@ -180,6 +194,7 @@ namespace
 	{
 	public:
 		ImplBoolean(LLSD::Boolean v) : Base(v) { }
+		ImplBoolean(LLSD::Boolean v, StaticAllocationMarker m) : Base(v, m) { }
 		
 		virtual LLSD::Boolean	asBoolean() const	{ return mValue; }
 		virtual LLSD::Integer	asInteger() const	{ return mValue ? 1 : 0; }
@@ -201,6 +216,7 @@ namespace
 	{
 	public:
 		ImplInteger(LLSD::Integer v) : Base(v) { }
+		ImplInteger(LLSD::Integer v, StaticAllocationMarker m) : Base(v, m) { }
 		
 		virtual LLSD::Boolean	asBoolean() const	{ return mValue != 0; }
 		virtual LLSD::Integer	asInteger() const	{ return mValue; }
@@ -217,6 +233,7 @@ namespace
 	{
 	public:
 		ImplReal(LLSD::Real v) : Base(v) { }
+		ImplReal(LLSD::Real v, StaticAllocationMarker m) : Base(v, m) { }
 				
 		virtual LLSD::Boolean	asBoolean() const;
 		virtual LLSD::Integer	asInteger() const;
@@ -281,6 +298,7 @@ namespace
 	{
 	public:
 		ImplUUID(const LLSD::UUID& v) : Base(v) { }
+		ImplUUID(const LLSD::UUID& v, StaticAllocationMarker m) : Base(v, m) { }
 				
 		virtual LLSD::String	asString() const{ return mValue.asString(); }
 		virtual LLSD::UUID		asUUID() const	{ return mValue; }
@@ -557,6 +575,29 @@ namespace
 	}
 }
 
+#ifdef NAME_UNNAMED_NAMESPACE
+namespace LLSDUnnamedNamespace 
+#else
+namespace 
+#endif
+{
+	// Shared immutable values handed out while an arena is active,
+	// created by LLSD::Arena::initClass()
+	const LLSD::Integer INTERNED_INTEGER_MIN = -1;
+	const LLSD::Integer INTERNED_INTEGER_MAX = 255;
+
+	LLSD::Impl* sInternedBoolean[2] = { NULL, NULL };
+	LLSD::Impl* sInternedInteger[INTERNED_INTEGER_MAX - INTERNED_INTEGER_MIN + 1];
+	LLSD::Impl* sInternedRealZero = NULL;
+	LLSD::Impl* sInternedNullUUID = NULL;
+
+	apr_threadkey_t* sArenaKey = NULL;
+
+	// ArenaScopes open on any thread.  While there are none, values are
+	// allocated without looking up the thread's arena.
+	LLAtomicS32 sActiveScopes;
+}
+
 LLSD::Impl::Impl()
 	: mUseCount(0)
 {
@@ -576,8 +617,8 @@ LLSD::Impl::~Impl()
 
 void LLSD::Impl::reset(Impl*& var, Impl* impl)
 {
-	if (impl) ++impl->mUseCount;
-	if (var  &&  --var->mUseCount == 0)
+	if (impl  &&  impl->mUseCount != IMMORTAL) ++impl->mUseCount;
+	if (var  &&  var->mUseCount != IMMORTAL  &&  --var->mUseCount == 0)
 	{
 		delete var;
 	}
@@ -623,16 +664,36 @@ void LLSD::Impl::assignUndefined(Impl*& var)
 
 void LLSD::Impl::assign(Impl*& var, LLSD::Boolean v)
 {
+	if (sInternedBoolean[v ? 1 : 0]  &&  LLSD::Arena::current())
+	{
+		reset(var, sInternedBoolean[v ? 1 : 0]);
+		return;
+	}
 	reset(var, new ImplBoolean(v));
 }
 
 void LLSD::Impl::assign(Impl*& var, LLSD::Integer v)
 {
+	if (v >= INTERNED_INTEGER_MIN  &&  v <= INTERNED_INTEGER_MAX
+		&&  sInternedInteger[v - INTERNED_INTEGER_MIN]
+		&&  LLSD::Arena::current())
+	{
+		reset(var, sInternedInteger[v - INTERNED_INTEGER_MIN]);
+		return;
+	}
 	reset(var, new ImplInteger(v));
 }
 
 void LLSD::Impl::assign(Impl*& var, LLSD::Real v)
 {
+	// compare the bits, so -0.0 stays -0.0
+	static const LLSD::Real zero = 0.0;
+	if (sInternedRealZero  &&  memcmp(&v, &zero, sizeof(v)) == 0
+		&&  LLSD::Arena::current())
+	{
+		reset(var, sInternedRealZero);
+		return;
+	}
 	reset(var, new ImplReal(v));
 }
 
@@ -643,6 +704,11 @@ void LLSD::Impl::assign(Impl*& var, const LLSD::String& v)
 
 void LLSD::Impl::assign(Impl*& var, const LLSD::UUID& v)
 {
+	if (sInternedNullUUID  &&  v.isNull()  &&  LLSD::Arena::current())
+	{
+		reset(var, sInternedNullUUID);
+		return;
+	}
 	reset(var, new ImplUUID(v));
 }
 
@@ -662,6 +728,28 @@ void LLSD::Impl::assign(Impl*& var, const LLSD::Binary& v)
 }
 
 
+// static
+void LLSD::Impl::initInterned()
+{
+	sInternedBoolean[0] = new ImplBoolean(false, STATIC);
+	sInternedBoolean[1] = new ImplBoolean(true, STATIC);
+	for (LLSD::Integer i = INTERNED_INTEGER_MIN; i <= INTERNED_INTEGER_MAX; ++i)
+	{
+		sInternedInteger[i - INTERNED_INTEGER_MIN] = new ImplInteger(i, STATIC);
+	}
+	sInternedRealZero = new ImplReal(0.0, STATIC);
+	sInternedNullUUID = new ImplUUID(LLUUID::null, STATIC);
+
+	sInternedBoolean[0]->mUseCount = IMMORTAL;
+	sInternedBoolean[1]->mUseCount = IMMORTAL;
+	for (LLSD::Integer i = INTERNED_INTEGER_MIN; i <= INTERNED_INTEGER_MAX; ++i)
+	{
+		sInternedInteger[i - INTERNED_INTEGER_MIN]->mUseCount = IMMORTAL;
+	}
+	sInternedRealZero->mUseCount = IMMORTAL;
+	sInternedNullUUID->mUseCount = IMMORTAL;
+}
+
 const LLSD& LLSD::Impl::undef()
 {
 	static const LLSD immutableUndefined;
@@ -672,6 +760,207 @@ U32 LLSD::Impl::sAllocationCount = 0;
 U32 LLSD::Impl::sOutstandingCount = 0;
 
 
+struct LLSD::Arena::Blocks
+{
+	Blocks() : mOutstandingCount(0), mOrphaned(false) {}
+	~Blocks();
+
+	char* addBlock(size_t size);
+	static Blocks* find(void* ptr);
+
+	std::vector<char*> mBlocks;
+	std::vector<size_t> mBlockSizes;
+	U32 mOutstandingCount;
+	bool mOrphaned;		// the arena is gone, free on the last deallocate
+
+	// Every arena block, by the address just past its end, so deleting a
+	// value can tell arena storage from the heap without a header in
+	// front of each value.  Only searched while some arena storage exists.
+	typedef std::map<const char*, std::pair<const char*, Blocks*> > block_map_t;
+	static block_map_t sBlockMap;
+	static LLMutex* sBlockMapMutex;
+	static LLAtomicS32 sBlockCount;
+};
+
+LLSD::Arena::Blocks::block_map_t LLSD::Arena::Blocks::sBlockMap;
+LLMutex* LLSD::Arena::Blocks::sBlockMapMutex = NULL;
+LLAtomicS32 LLSD::Arena::Blocks::sBlockCount;
+
+LLSD::Arena::Blocks::~Blocks()
+{
+	if (!mBlocks.empty())
+	{
+		LLMutexLock lock(sBlockMapMutex);
+		for (U32 i = 0; i < mBlocks.size(); ++i)
+		{
+			sBlockMap.erase(mBlocks[i] + mBlockSizes[i]);
+			delete[] mBlocks[i];
+		}
+		sBlockCount -= (S32)mBlocks.size();
+	}
+}
+
+char* LLSD::Arena::Blocks::addBlock(size_t size)
+{
+	char* block = new char[size];
+	mBlocks.push_back(block);
+	mBlockSizes.push_back(size);
+	LLMutexLock lock(sBlockMapMutex);
+	sBlockMap[block + size] = std::make_pair((const char*)block, this);
+	sBlockCount++;
+	return block;
+}
+
+// static
+LLSD::Arena::Blocks* LLSD::Arena::Blocks::find(void* ptr)
+{
+	if (!sBlockCount)
+	{
+		return NULL;
+	}
+	const char* p = (const char*)ptr;
+	LLMutexLock lock(sBlockMapMutex);
+	block_map_t::iterator iter = sBlockMap.upper_bound(p);
+	if (iter != sBlockMap.end()  &&  iter->second.first <= p)
+	{
+		return iter->second.second;
+	}
+	return NULL;
+}
+
+void* LLSD::Impl::operator new(size_t size)
+{
+	LLSD::Arena* arena = LLSD::Arena::current();
+	return arena ? arena->allocate(size) : ::operator new(size);
+}
+
+void LLSD::Impl::operator delete(void* ptr)
+{
+	if (!ptr) return;
+	LLSD::Arena::Blocks* blocks = LLSD::Arena::Blocks::find(ptr);
+	if (blocks)
+	{
+		LLSD::Arena::deallocate(blocks);
+	}
+	else
+	{
+		::operator delete(ptr);
+	}
+}
+
+LLSD::Arena::Arena(size_t block_size)
+	: mBlocks(new Blocks),
+	  mBlockSize(block_size),
+	  mNext(NULL),
+	  mRemaining(0),
+	  mBytesAllocated(0),
+	  mAllocationCount(0)
+{
+}
+
+LLSD::Arena::~Arena()
+{
+	if (mBlocks->mOutstandingCount)
+	{
+		// Something still points into our blocks, keep them until the
+		// last value is deleted.
+		llwarns << "LLSD::Arena destroyed with " << mBlocks->mOutstandingCount
+				<< " values still alive, keeping " << mBytesAllocated
+				<< " bytes until they are gone" << llendl;
+		mBlocks->mOrphaned = true;
+		return;
+	}
+	delete mBlocks;
+}
+
+U32 LLSD::Arena::outstandingCount() const
+{
+	return mBlocks->mOutstandingCount;
+}
+
+void* LLSD::Arena::allocate(size_t size)
+{
+	size = (size + 7) & ~(size_t)7;
+	if (size > mRemaining)
+	{
+		size_t block_size = llmax(size, mBlockSize);
+		char* block = mBlocks->addBlock(block_size);
+		mBytesAllocated += block_size;
+		if (block_size > mBlockSize)
+		{
+			// oversized, give it a block of its own and keep filling
+			// the current one
+			++mAllocationCount;
+			++mBlocks->mOutstandingCount;
+			return block;
+		}
+		mNext = block;
+		mRemaining = block_size;
+	}
+	void* result = mNext;
+	mNext += size;
+	mRemaining -= size;
+	++mAllocationCount;
+	++mBlocks->mOutstandingCount;
+	return result;
+}
+
+// static
+void LLSD::Arena::deallocate(Blocks* blocks)
+{
+	// Storage is only handed back when the arena goes away, or after it
+	// is gone, when the last value is deleted
+	if (--blocks->mOutstandingCount == 0 && blocks->mOrphaned)
+	{
+		delete blocks;
+	}
+}
+
+// static
+LLSD::Arena* LLSD::Arena::current()
+{
+	if (!sArenaKey || !sActiveScopes)
+	{
+		return NULL;
+	}
+	void* arena = NULL;
+	apr_threadkey_private_get(&arena, sArenaKey);
+	return (Arena*)arena;
+}
+
+// static
+void LLSD::Arena::initClass()
+{
+	if (sArenaKey)
+	{
+		return;
+	}
+	Blocks::sBlockMapMutex = new LLMutex(NULL);
+	apr_threadkey_private_create(&sArenaKey, NULL, gAPRPoolp);
+
+	Impl::initInterned();
+}
+
+LLSD::ArenaScope::ArenaScope(Arena* arena)
+	: mPrevious(Arena::current())
+{
+	if (sArenaKey)
+	{
+		apr_threadkey_private_set(arena, sArenaKey);
+		sActiveScopes++;
+	}
+}
+
+LLSD::ArenaScope::~ArenaScope()
+{
+	if (sArenaKey)
+	{
+		sActiveScopes--;
+		apr_threadkey_private_set(mPrevious, sArenaKey);
+	}
+}
+
+
 
 #ifdef NAME_UNNAMED_NAMESPACE
 namespace LLSDUnnamedNamespace 
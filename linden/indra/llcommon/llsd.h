@@ -333,6 +333,64 @@ public:
 		static U32 outstandingCount();	///< how many Impls are still alive
 	//@}
 
+	/** @name Arena Allocation
+		While an ArenaScope is active on a thread, every value created on that
+		thread (for example by running a parser inside the scope) takes its
+		storage from the given Arena instead of the heap, and Booleans, small
+		Integers, zero Reals and the null UUID share preallocated immutable
+		values so they allocate nothing at all.  The arena hands its storage
+		back in one step when it is destroyed.
+
+		Every LLSD built inside an arena should be destroyed before the
+		arena is.  If some are still alive, the storage is kept until the
+		last of them goes away.  Map and array containers still use the
+		standard allocator for their elements; only the values themselves
+		come from the arena.
+		Arenas are not thread safe.  Use one per thread.
+	*/
+	//@{
+		class Arena
+		{
+		public:
+			Arena(size_t block_size = 16384);
+			~Arena();
+
+			size_t bytesAllocated() const	{ return mBytesAllocated; }
+			U32 allocationCount() const		{ return mAllocationCount; }
+			U32 outstandingCount() const;
+
+			static Arena* current();
+			static void initClass();	///< call once, from LLCommon::initClass()
+
+		private:
+			friend class LLSD::Impl;
+			// The storage, which outlives the arena while values use it
+			struct Blocks;
+			void* allocate(size_t size);
+			static void deallocate(Blocks* blocks);
+
+			// No copy constructor or copy assignment
+			Arena(const Arena&);
+			Arena& operator=(const Arena&);
+
+			Blocks* mBlocks;
+			size_t mBlockSize;
+			char* mNext;
+			size_t mRemaining;
+			size_t mBytesAllocated;
+			U32 mAllocationCount;
+		};
+
+		class ArenaScope
+		{
+		public:
+			ArenaScope(Arena* arena);
+			~ArenaScope();	///< restores the previously active arena
+		private:
+			Arena* mPrevious;
+		};
+	//@}
+
 private:
 	/** @name Debugging Interface */
 	//@{
@@ -35,6 +35,7 @@
 #include "linden_common.h"
 #include "llsdserialize.h"
 #include "llmemory.h"
+#include "llmemorystream.h"
 #include "llstreamtools.h" // for fullread
 
 #include <iostream>
@@ -305,7 +306,8 @@ static const char BINARY_FALSE_SERIAL = '0';
  * LLSDParser
  */
 LLSDParser::LLSDParser()
-	: mCheckLimits(true), mMaxBytesLeft(0), mParseLines(false)
+	: mCheckLimits(true), mMaxBytesLeft(0), mParseLines(false),
+	  mHandler(NULL)
 {
 }
 
@@ -320,6 +322,20 @@ S32 LLSDParser::parse(std::istream& istr, LLSD& data, S32 max_bytes)
 	return doParse(istr, data);
 }
 
+S32 LLSDParser::parse(
+	std::istream& istr,
+	LLSDParseHandler& handler,
+	S32 max_bytes)
+{
+	mCheckLimits = (LLSDSerialize::SIZE_UNLIMITED == max_bytes) ? false : true;
+	mMaxBytesLeft = max_bytes;
+	mHandler = &handler;
+	LLSD data;
+	S32 rv = doParse(istr, data);
+	mHandler = NULL;
+	return rv;
+}
+
 
 // Parse using routine to get() lines, faster than parse()
 S32 LLSDParser::parseLines(std::istream& istr, LLSD& data)
@@ -647,6 +663,11 @@ S32 LLSDNotationParser::doParse(std::istream& istr, LLSD& data) const
 			<< ")" << llendl;
 		break;
 	}
+	if((parse_count > 0) && !data.isMap() && !data.isArray()
+	   && !emitValue(data))
+	{
+		parse_count = PARSE_FAILURE;
+	}
 	if(PARSE_FAILURE == parse_count)
 	{
 		data.clear();
@@ -662,6 +683,8 @@ S32 LLSDNotationParser::parseMap(std::istream& istr, LLSD& map) const
 	char c = get(istr);
 	if(c == '{')
 	{
+		if(!emitBeginMap()) return PARSE_FAILURE;
+
 		// eat commas, white
 		bool found_name = false;
 		std::string name;
@@ -677,6 +700,7 @@ S32 LLSDNotationParser::parseMap(std::istream& istr, LLSD& map) const
 					int count = deserialize_string(istr, name, mMaxBytesLeft);
 					if(PARSE_FAILURE == count) return PARSE_FAILURE;
 					account(count);
+					if(!emitMapKey(name)) return PARSE_FAILURE;
 				}
 				c = get(istr);
 			}
@@ -695,7 +719,7 @@ S32 LLSDNotationParser::parseMap(std::istream& istr, LLSD& map) const
 					// There must be a value for every key, thus
 					// child_count must be greater than 0.
 					parse_count += count;
-					map.insert(name, child);
+					if(!mHandler) map.insert(name, child);
 				}
 				else
 				{
@@ -710,6 +734,7 @@ S32 LLSDNotationParser::parseMap(std::istream& istr, LLSD& map) const
 			map.clear();
 			return PARSE_FAILURE;
 		}
+		if(!emitEndMap()) return PARSE_FAILURE;
 	}
 	return parse_count;
 }
@@ -722,6 +747,8 @@ S32 LLSDNotationParser::parseArray(std::istream& istr, LLSD& array) const
 	char c = get(istr);
 	if(c == '[')
 	{
+		if(!emitBeginArray()) return PARSE_FAILURE;
+
 		// eat commas, white
 		c = get(istr);
 		while((c != ']') && istr.good())
@@ -741,7 +768,7 @@ S32 LLSDNotationParser::parseArray(std::istream& istr, LLSD& array) const
 			else
 			{
 				parse_count += count;
-				array.append(child);
+				if(!mHandler) array.append(child);
 			}
 			c = get(istr);
 		}
@@ -749,6 +776,7 @@ S32 LLSDNotationParser::parseArray(std::istream& istr, LLSD& array) const
 		{
 			return PARSE_FAILURE;
 		}
+		if(!emitEndArray()) return PARSE_FAILURE;
 	}
 	return parse_count;
 }
@@ -1087,6 +1115,11 @@ S32 LLSDBinaryParser::doParse(std::istream& istr, LLSD& data) const
 			<< ")" << llendl;
 		break;
 	}
+	if((parse_count > 0) && !data.isMap() && !data.isArray()
+	   && !emitValue(data))
+	{
+		parse_count = PARSE_FAILURE;
+	}
 	if(PARSE_FAILURE == parse_count)
 	{
 		data.clear();
@@ -1100,6 +1133,7 @@ S32 LLSDBinaryParser::parseMap(std::istream& istr, LLSD& map) const
 	U32 value_nbo = 0;
 	read(istr, (char*)&value_nbo, sizeof(U32));		 /*Flawfinder: ignore*/
 	S32 size = (S32)ntohl(value_nbo);
+	if(!emitBeginMap()) return PARSE_FAILURE;
 	S32 parse_count = 0;
 	S32 count = 0;
 	char c = get(istr);
@@ -1123,6 +1157,7 @@ S32 LLSDBinaryParser::parseMap(std::istream& istr, LLSD& map) const
 			break;
 		}
 		}
+		if(!emitMapKey(name)) return PARSE_FAILURE;
 		LLSD child;
 		S32 child_count = doParse(istr, child);
 		if(child_count > 0)
@@ -1130,7 +1165,7 @@ S32 LLSDBinaryParser::parseMap(std::istream& istr, LLSD& map) const
 			// There must be a value for every key, thus child_count
 			// must be greater than 0.
 			parse_count += child_count;
-			map.insert(name, child);
+			if(!mHandler) map.insert(name, child);
 		}
 		else
 		{
@@ -1145,6 +1180,7 @@ S32 LLSDBinaryParser::parseMap(std::istream& istr, LLSD& map) const
 		// as were said to be there.
 		return PARSE_FAILURE;
 	}
+	if(!emitEndMap()) return PARSE_FAILURE;
 	return parse_count;
 }
 
@@ -1158,6 +1194,7 @@ S32 LLSDBinaryParser::parseArray(std::istream& istr, LLSD& array) const
 	// *FIX: This would be a good place to reserve some space in the
 	// array...
 
+	if(!emitBeginArray()) return PARSE_FAILURE;
 	S32 parse_count = 0;
 	S32 count = 0;
 	char c = istr.peek();
@@ -1172,7 +1209,7 @@ S32 LLSDBinaryParser::parseArray(std::istream& istr, LLSD& array) const
 		if(child_count)
 		{
 			parse_count += child_count;
-			array.append(child);
+			if(!mHandler) array.append(child);
 		}
 		++count;
 		c = istr.peek();
@@ -1184,6 +1221,7 @@ S32 LLSDBinaryParser::parseArray(std::istream& istr, LLSD& array) const
 		// as were said to be there.
 		return PARSE_FAILURE;
 	}
+	if(!emitEndArray()) return PARSE_FAILURE;
 	return parse_count;
 }
 
@@ -1206,6 +1244,335 @@ bool LLSDBinaryParser::parseString(
 	return true;
 }
 
+/**
+ * LLSDBinaryBufferParser
+ */
+LLSDBinaryBufferParser::LLSDBinaryBufferParser() :
+	mStart(NULL),
+	mCurrent(NULL),
+	mEnd(NULL),
+	mHandler(NULL)
+{
+}
+
+S32 LLSDBinaryBufferParser::parse(const U8* buffer, S32 length, LLSD& data)
+{
+	mStart = mCurrent = buffer;
+	mEnd = buffer + llmax(length, 0);
+	mHandler = NULL;
+	return doParse(data);
+}
+
+S32 LLSDBinaryBufferParser::parse(
+	const U8* buffer,
+	S32 length,
+	LLSDParseHandler& handler)
+{
+	mStart = mCurrent = buffer;
+	mEnd = buffer + llmax(length, 0);
+	mHandler = &handler;
+	LLSD data;
+	S32 rv = doParse(data);
+	mHandler = NULL;
+	return rv;
+}
+
+S32 LLSDBinaryBufferParser::doParse(LLSD& data)
+{
+	// See LLSDBinaryParser::doParse() for the format.
+	if(mCurrent >= mEnd)
+	{
+		return 0;
+	}
+	char c = *mCurrent++;
+	S32 parse_count = 1;
+	switch(c)
+	{
+	case '{':
+	{
+		S32 child_count = parseMap(data);
+		if(child_count == LLSDParser::PARSE_FAILURE)
+		{
+			parse_count = LLSDParser::PARSE_FAILURE;
+		}
+		else
+		{
+			parse_count += child_count;
+		}
+		break;
+	}
+
+	case '[':
+	{
+		S32 child_count = parseArray(data);
+		if(child_count == LLSDParser::PARSE_FAILURE)
+		{
+			parse_count = LLSDParser::PARSE_FAILURE;
+		}
+		else
+		{
+			parse_count += child_count;
+		}
+		break;
+	}
+
+	case '!':
+		data.clear();
+		break;
+
+	case '0':
+		data = false;
+		break;
+
+	case '1':
+		data = true;
+		break;
+
+	case 'i':
+	{
+		U32 value_nbo = 0;
+		if(mEnd - mCurrent < (S32)sizeof(U32))
+		{
+			parse_count = LLSDParser::PARSE_FAILURE;
+			break;
+		}
+		memcpy(&value_nbo, mCurrent, sizeof(U32));	/*Flawfinder: ignore*/
+		mCurrent += sizeof(U32);
+		data = (S32)ntohl(value_nbo);
+		break;
+	}
+
+	case 'r':
+	{
+		F64 real_nbo = 0.0;
+		if(mEnd - mCurrent < (S32)sizeof(F64))
+		{
+			parse_count = LLSDParser::PARSE_FAILURE;
+			break;
+		}
+		memcpy(&real_nbo, mCurrent, sizeof(F64));	/*Flawfinder: ignore*/
+		mCurrent += sizeof(F64);
+		data = ll_ntohd(real_nbo);
+		break;
+	}
+
+	case 'u':
+	{
+		LLUUID id;
+		if(mEnd - mCurrent < UUID_BYTES)
+		{
+			parse_count = LLSDParser::PARSE_FAILURE;
+			break;
+		}
+		memcpy(id.mData, mCurrent, UUID_BYTES);	/*Flawfinder: ignore*/
+		mCurrent += UUID_BYTES;
+		data = id;
+		break;
+	}
+
+	case '\'':
+	case '"':
+	{
+		std::string value;
+		if(readDelimitedString(value, c))
+		{
+			data = value;
+		}
+		else
+		{
+			parse_count = LLSDParser::PARSE_FAILURE;
+		}
+		break;
+	}
+
+	case 's':
+	{
+		std::string value;
+		if(readString(value))
+		{
+			data = value;
+		}
+		else
+		{
+			parse_count = LLSDParser::PARSE_FAILURE;
+		}
+		break;
+	}
+
+	case 'l':
+	{
+		std::string value;
+		if(readString(value))
+		{
+			data = LLURI(value);
+		}
+		else
+		{
+			parse_count = LLSDParser::PARSE_FAILURE;
+		}
+		break;
+	}
+
+	case 'd':
+	{
+		F64 real = 0.0;
+		if(mEnd - mCurrent < (S32)sizeof(F64))
+		{
+			parse_count = LLSDParser::PARSE_FAILURE;
+			break;
+		}
+		memcpy(&real, mCurrent, sizeof(F64));	/*Flawfinder: ignore*/
+		mCurrent += sizeof(F64);
+		data = LLDate(real);
+		break;
+	}
+
+	case 'b':
+	{
+		S32 size = 0;
+		if(readSize(size))
+		{
+			data = std::vector<U8>(mCurrent, mCurrent + size);
+			mCurrent += size;
+		}
+		else
+		{
+			parse_count = LLSDParser::PARSE_FAILURE;
+		}
+		break;
+	}
+
+	default:
+		parse_count = LLSDParser::PARSE_FAILURE;
+		llinfos << "Unrecognized character while parsing: int(" << (int)c
+			<< ")" << llendl;
+		break;
+	}
+	if((parse_count > 0) && !data.isMap() && !data.isArray()
+	   && mHandler && !mHandler->value(data))
+	{
+		parse_count = LLSDParser::PARSE_FAILURE;
+	}
+	if(LLSDParser::PARSE_FAILURE == parse_count)
+	{
+		data.clear();
+	}
+	return parse_count;
+}
+
+S32 LLSDBinaryBufferParser::parseMap(LLSD& map)
+{
+	map = LLSD::emptyMap();
+	S32 size = 0;
+	if(!readSize(size)) return LLSDParser::PARSE_FAILURE;
+	if(mHandler && !mHandler->beginMap()) return LLSDParser::PARSE_FAILURE;
+	S32 parse_count = 0;
+	S32 count = 0;
+	std::string name;
+	while((count < size) && (mCurrent < mEnd) && (*mCurrent != '}'))
+	{
+		char c = *mCurrent++;
+		name.clear();
+		switch(c)
+		{
+		case 'k':
+			if(!readString(name)) return LLSDParser::PARSE_FAILURE;
+			break;
+		case '\'':
+		case '"':
+			if(!readDelimitedString(name, c)) return LLSDParser::PARSE_FAILURE;
+			break;
+		}
+		if(mHandler && !mHandler->mapKey(name)) return LLSDParser::PARSE_FAILURE;
+		if(mHandler)
+		{
+			LLSD child;
+			S32 child_count = doParse(child);
+			if(child_count <= 0) return LLSDParser::PARSE_FAILURE;
+			parse_count += child_count;
+		}
+		else
+		{
+			// Parse straight into the map to avoid copying the child.
+			S32 child_count = doParse(map[name]);
+			if(child_count <= 0)
+			{
+				// There must be a value for every key.
+				return LLSDParser::PARSE_FAILURE;
+			}
+			parse_count += child_count;
+		}
+		++count;
+	}
+	if((count < size) || (mCurrent >= mEnd) || (*mCurrent++ != '}'))
+	{
+		// Make sure it is correctly terminated and we parsed as many
+		// as were said to be there.
+		return LLSDParser::PARSE_FAILURE;
+	}
+	if(mHandler && !mHandler->endMap()) return LLSDParser::PARSE_FAILURE;
+	return parse_count;
+}
+
+S32 LLSDBinaryBufferParser::parseArray(LLSD& array)
+{
+	array = LLSD::emptyArray();
+	S32 size = 0;
+	if(!readSize(size)) return LLSDParser::PARSE_FAILURE;
+	if(mHandler && !mHandler->beginArray()) return LLSDParser::PARSE_FAILURE;
+	S32 parse_count = 0;
+	S32 count = 0;
+	while((count < size) && (mCurrent < mEnd) && (*mCurrent != ']'))
+	{
+		LLSD child;
+		S32 child_count = doParse(mHandler ? child : array[count]);
+		if(LLSDParser::PARSE_FAILURE == child_count)
+		{
+			return LLSDParser::PARSE_FAILURE;
+		}
+		parse_count += child_count;
+		++count;
+	}
+	if((count < size) || (mCurrent >= mEnd) || (*mCurrent++ != ']'))
+	{
+		// Make sure it is correctly terminated and we parsed as many
+		// as were said to be there.
+		return LLSDParser::PARSE_FAILURE;
+	}
+	if(mHandler && !mHandler->endArray()) return LLSDParser::PARSE_FAILURE;
+	return parse_count;
+}
+
+bool LLSDBinaryBufferParser::readSize(S32& size)
+{
+	U32 size_nbo = 0;
+	if(mEnd - mCurrent < (S32)sizeof(U32)) return false;
+	memcpy(&size_nbo, mCurrent, sizeof(U32));	/*Flawfinder: ignore*/
+	mCurrent += sizeof(U32);
+	size = (S32)ntohl(size_nbo);
+	return (size >= 0) && (size <= mEnd - mCurrent);
+}
+
+bool LLSDBinaryBufferParser::readString(std::string& value)
+{
+	S32 size = 0;
+	if(!readSize(size)) return false;
+	value.assign((const char*)mCurrent, size);
+	mCurrent += size;
+	return true;
+}
+
+bool LLSDBinaryBufferParser::readDelimitedString(std::string& value, char delim)
+{
+	// Notation style strings may contain escapes, so hand them to the
+	// stream parser. They are rare in binary documents.
+	LLMemoryStream istr(mCurrent, (S32)(mEnd - mCurrent));
+	int count = deserialize_string_delim(istr, value, delim);
+	if(LLSDParser::PARSE_FAILURE == count) return false;
+	mCurrent += count;
+	return true;
+}
+
 
 /**
  * LLSDFormatter
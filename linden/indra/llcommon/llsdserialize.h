@@ -39,6 +39,30 @@
 #include "llsd.h"
 #include "llmemory.h"
 
+/** 
+ * @class LLSDParseHandler
+ * @brief Receives a stream of events from an LLSD parser.
+ *
+ * Pass an instance of this class to LLSDParser::parse() to consume a
+ * document one element at a time instead of building the whole LLSD
+ * tree in memory. Containers are reported as begin/end pairs, map
+ * entries are preceded by mapKey(), and every other element is
+ * reported through value(). Any method may return false to abort the
+ * parse, which then returns PARSE_FAILURE.
+ */
+class LLSDParseHandler
+{
+public:
+	virtual ~LLSDParseHandler() {}
+
+	virtual bool beginMap()							{ return true; }
+	virtual bool mapKey(const std::string& key)		{ return true; }
+	virtual bool endMap()							{ return true; }
+	virtual bool beginArray()						{ return true; }
+	virtual bool endArray()							{ return true; }
+	virtual bool value(const LLSD& value) = 0;
+};
+
 /** 
  * @class LLSDParser
  * @brief Abstract base class for LLSD parsers.
@@ -84,6 +108,22 @@ public:
 	 */
 	S32 parse(std::istream& istr, LLSD& data, S32 max_bytes);
 
+	/** 
+	 * @brief Parse a stream, reporting each element to a handler.
+	 *
+	 * Unlike the other parse() this does not build the structured
+	 * data in memory, so the peak footprint is bounded by the depth
+	 * of the document rather than its size.
+	 * @param istr The input stream.
+	 * @param handler The handler which receives the parse events.
+	 * @param max_bytes The maximum number of bytes that will be in
+	 * the stream. Pass in LLSDSerialize::SIZE_UNLIMITED (-1) to set no
+	 * byte limit.
+	 * @return Returns the number of LLSD objects parsed. Returns
+	 * PARSE_FAILURE (-1) on parse failure or if the handler aborted.
+	 */
+	S32 parse(std::istream& istr, LLSDParseHandler& handler, S32 max_bytes);
+
 	/** Like parse(), but uses a different call (istream.getline()) to read by lines
 	 *  This API is better suited for XML, where the parse cannot tell
 	 *  where the document actually ends.
@@ -199,6 +239,20 @@ protected:
 	 */
 	void account(S32 bytes) const;
 
+	/* @name Event helpers
+	 *
+	 * Forward an event to mHandler when streaming. Each returns false
+	 * if the handler asked to stop the parse.
+	 */
+	//@{
+	bool emitBeginMap() const { return !mHandler || mHandler->beginMap(); }
+	bool emitMapKey(const std::string& key) const { return !mHandler || mHandler->mapKey(key); }
+	bool emitEndMap() const { return !mHandler || mHandler->endMap(); }
+	bool emitBeginArray() const { return !mHandler || mHandler->beginArray(); }
+	bool emitEndArray() const { return !mHandler || mHandler->endArray(); }
+	bool emitValue(const LLSD& value) const { return !mHandler || mHandler->value(value); }
+	//@}
+
 protected:
 	/**
 	 * @brief boolean to set if byte counts should be checked during parsing.
@@ -214,6 +268,11 @@ protected:
 	 * @brief Use line-based reading to get text
 	 */
 	bool mParseLines;
+
+	/**
+	 * @brief The event handler when streaming, otherwise NULL.
+	 */
+	LLSDParseHandler* mHandler;
 };
 
 /** 
@@ -401,6 +460,63 @@ private:
 	bool parseString(std::istream& istr, std::string& value) const;
 };
 
+/** 
+ * @class LLSDBinaryBufferParser
+ * @brief Parser which handles binary formatted LLSD held in memory.
+ *
+ * This reads the same format as LLSDBinaryParser, but walks a
+ * contiguous buffer with a pointer instead of pulling bytes one at a
+ * time through an istream. String and binary values are copied once,
+ * straight from the buffer into the result. The buffer is not owned
+ * by the parser and must stay valid for the duration of parse().
+ */
+class LLSDBinaryBufferParser
+{
+public:
+	/** 
+	 * @brief Constructor
+	 */
+	LLSDBinaryBufferParser();
+
+	/** 
+	 * @brief Parse one LLSD object out of a buffer.
+	 *
+	 * @param buffer The start of the binary LLSD data.
+	 * @param length The number of bytes available in buffer.
+	 * @param data[out] The newly parsed structured data.
+	 * @return Returns the number of LLSD objects parsed into
+	 * data. Returns LLSDParser::PARSE_FAILURE (-1) on parse failure.
+	 */
+	S32 parse(const U8* buffer, S32 length, LLSD& data);
+
+	/** 
+	 * @brief Parse one LLSD object out of a buffer, reporting each
+	 * element to a handler rather than building the structured data.
+	 */
+	S32 parse(const U8* buffer, S32 length, LLSDParseHandler& handler);
+
+	/** 
+	 * @brief The number of bytes consumed by the last parse().
+	 */
+	S32 bytesRead() const { return (S32)(mCurrent - mStart); }
+
+private:
+	S32 doParse(LLSD& data);
+	S32 parseMap(LLSD& map);
+	S32 parseArray(LLSD& array);
+
+	// Read a 4 byte network order length and check that it fits in
+	// the remaining buffer.
+	bool readSize(S32& size);
+	bool readString(std::string& value);
+	bool readDelimitedString(std::string& value, char delim);
+
+	const U8* mStart;
+	const U8* mCurrent;
+	const U8* mEnd;
+	LLSDParseHandler* mHandler;
+};
+
 
 /** 
  * @class LLSDFormatter
@@ -784,6 +900,11 @@ public:
 		(void)p->parse(str, sd, max_bytes);
 		return sd;
 	}
+	static S32 fromBinary(LLSD& sd, const U8* buffer, S32 length)
+	{
+		LLSDBinaryBufferParser p;
+		return p.parse(buffer, length, sd);
+	}
 };
 
 #endif // LL_LLSDSERIALIZE_H
@@ -269,6 +269,10 @@ public:
 	
 	void reset();
 
+	// Report elements to handler rather than building mResult. Pass
+	// NULL to go back to building the tree.
+	void setHandler(LLSDParseHandler* handler) { mHandler = handler; }
+
 private:
 	void startElementHandler(const XML_Char* name, const XML_Char** attributes);
 	void endElementHandler(const XML_Char* name);
@@ -282,6 +286,7 @@ private:
 		void* userData, const XML_Char* data, int length);
 
 	void startSkipping();
+	void stopStreaming();
 	
 	enum Element {
 		ELEMENT_LLSD,
@@ -318,6 +323,12 @@ private:
 	int mDepth;
 	bool mSkipping;
 	int mSkipThrough;
+
+	// When streaming, mStack points into mStreamStack, which holds
+	// only the elements currently open instead of the whole tree.
+	LLSDParseHandler* mHandler;
+	std::deque<LLSD> mStreamStack;
+	bool mHandlerStopped;			// true if mHandler aborted the parse
 	
 	std::string mCurrentKey;		// Current XML <tag>
 	std::string mCurrentContent;	// String data between <tag> and </tag>
@@ -325,6 +336,7 @@ private:
 
 
 LLSDXMLParser::Impl::Impl()
+	: mHandler(NULL)
 {
 	mParser = XML_ParserCreate(NULL);
 	reset();
@@ -402,6 +414,11 @@ S32 LLSDXMLParser::Impl::parse(std::istream& input, LLSD& data)
 	// preserved
 
 	status = XML_ParseBuffer(mParser, 0, true);
+	if (mHandlerStopped)
+	{
+		data = LLSD();
+		return LLSDParser::PARSE_FAILURE;
+	}
 	if (status == XML_STATUS_ERROR && !mGracefullStop)
 	{
 		if (buffer)
@@ -483,8 +500,8 @@ S32 LLSDXMLParser::Impl::parseLines(std::istream& input, LLSD& data)
 		status = XML_ParseBuffer(mParser, 0, true);
 	}
 	
-	if (status == XML_STATUS_ERROR  
-		&& !mGracefullStop)
+	if (mHandlerStopped
+		|| (status == XML_STATUS_ERROR && !mGracefullStop))
 	{
 		llinfos << "LLSDXMLParser::Impl::parseLines: XML_STATUS_ERROR" << llendl;
 		return LLSDParser::PARSE_FAILURE;
@@ -507,6 +524,8 @@ void LLSDXMLParser::Impl::reset()
 	mGracefullStop = false;
 
 	mStack.clear();
+	mStreamStack.clear();
+	mHandlerStopped = false;
 	
 	mSkipping = false;
 	
@@ -530,6 +549,14 @@ void LLSDXMLParser::Impl::startSkipping()
 	mSkipThrough = mDepth;
 }
 
+void LLSDXMLParser::Impl::stopStreaming()
+{
+	mHandlerStopped = true;
+	mSkipping = true;
+	mSkipThrough = -1;
+	XML_StopParser(mParser, false);
+}
+
 const XML_Char*
 LLSDXMLParser::Impl::findAttribute(const XML_Char* name, const XML_Char** pairs)
 {
@@ -631,7 +658,26 @@ void LLSDXMLParser::Impl::startElementHandler(const XML_Char* name, const XML_Ch
 
 	if (!mInLLSDElement) { return startSkipping(); }
 	
-	if (mStack.empty())
+	if (mHandler)
+	{
+		if (!mStack.empty())
+		{
+			if (mStack.back()->isMap())
+			{
+				if (mCurrentKey.empty()) { return startSkipping(); }
+				if (!mHandler->mapKey(mCurrentKey)) { return stopStreaming(); }
+				mCurrentKey.clear();
+			}
+			else if (!mStack.back()->isArray())
+			{
+				// improperly nested value in a non-structure
+				return startSkipping();
+			}
+		}
+		mStreamStack.push_back(LLSD());
+		mStack.push_back(&mStreamStack.back());
+	}
+	else if (mStack.empty())
 	{
 		mStack.push_back(&mResult);
 	}
@@ -666,10 +712,12 @@ void LLSDXMLParser::Impl::startElementHandler(const XML_Char* name, const XML_Ch
 	{
 		case ELEMENT_MAP:
 			*mStack.back() = LLSD::emptyMap();
+			if (mHandler && !mHandler->beginMap()) { return stopStreaming(); }
 			break;
 		
 		case ELEMENT_ARRAY:
 			*mStack.back() = LLSD::emptyArray();
+			if (mHandler && !mHandler->beginArray()) { return stopStreaming(); }
 			break;
 			
 		default:
@@ -795,6 +843,19 @@ void LLSDXMLParser::Impl::endElementHandler(const XML_Char* name)
 			break;
 	}
 
+	if (mHandler)
+	{
+		bool keep_going;
+		switch (element)
+		{
+			case ELEMENT_MAP:	keep_going = mHandler->endMap();		break;
+			case ELEMENT_ARRAY:	keep_going = mHandler->endArray();		break;
+			default:			keep_going = mHandler->value(value);	break;
+		}
+		mStreamStack.pop_back();
+		if (!keep_going) { return stopStreaming(); }
+	}
+
 	mCurrentContent.clear();
 }
 
@@ -921,13 +982,19 @@ S32 LLSDXMLParser::doParse(std::istream& input, LLSD& data) const
 	XML_Timer timer( &parseTime );
 	#endif	// XML_PARSER_PERFORMANCE_TESTS
 
+	impl.setHandler(mHandler);
+	S32 parse_count;
 	if (mParseLines)
 	{
 		// Use line-based reading (faster code)
-		return impl.parseLines(input, data);
+		parse_count = impl.parseLines(input, data);
 	}
-
-	return impl.parse(input, data);
+	else
+	{
+		parse_count = impl.parse(input, data);
+	}
+	impl.setHandler(NULL);
+	return parse_count;
 }
 
 //	virtual 
@@ -38,8 +38,36 @@
 
 LLStringTable gStringTable(32768);
 
-LLStringTable::LLStringTable(int tablesize)
-: mUniqueEntries(0)
+// Orders the slot hash before the entry pointer that publishes it, and
+// a filled slot array before the pointer that publishes it.
+#if LL_WINDOWS
+# include <intrin.h>
+# define LL_STRING_TABLE_PUBLISH() _ReadWriteBarrier()
+#else
+# define LL_STRING_TABLE_PUBLISH() __sync_synchronize()
+#endif
+
+// Marks a slot whose entry was removed. Probes continue past it and
+// inserts may reuse it.
+static LLStringTableEntry* const TOMBSTONE = (LLStringTableEntry*)1;
+
+// FNV-1a over the part of the string an entry actually stores.
+static U32 hash_my_string(const char *str)
+{
+	U32 retval = 2166136261U;
+	for (U32 i = 0; i < MAX_STRINGS_LENGTH - 1 && str[i]; i++)
+	{
+		retval = (retval ^ (U8)str[i]) * 16777619U;
+	}
+	return retval;
+}
+
+LLStringTable::LLStringTable(int tablesize, bool concurrent_reads)
+:	mMaxEntries(0),
+	mUniqueEntries(0),
+	mSlotArray(NULL),
+	mTombstones(0),
+	mConcurrentReads(concurrent_reads)
 {
 	S32 i;
 	if (!tablesize)
@@ -56,65 +84,123 @@ LLStringTable::LLStringTable(int tablesize)
 			break;
 		}
 	}
-	mMaxEntries = tablesize;
+	mSlotArray = allocateSlots(llmax(tablesize, 16));
+}
 
-#if !STRING_TABLE_HASH_MAP
-	// ALlocate strings
-	mStringList = new string_list_ptr_t[mMaxEntries];
-	// Clear strings
-	for (i = 0; i < mMaxEntries; i++)
+LLStringTable::~LLStringTable()
+{
+	SlotArray* slots = mSlotArray;
+	for (U32 i = 0; i <= slots->mMask; i++)
+	{
+		LLStringTableEntry* entry = slots->mSlots[i].mEntry;
+		if (entry && entry != TOMBSTONE)
+		{
+			delete entry;
+		}
+	}
+	while (slots)
 	{
-		mStringList[i] = NULL;
+		SlotArray* retired = slots->mRetired;
+		freeSlots(slots);
+		slots = retired;
 	}
-#endif
+	mSlotArray = NULL;
 }
 
-LLStringTable::~LLStringTable()
+LLStringTable::SlotArray* LLStringTable::allocateSlots(S32 size)
 {
-#if !STRING_TABLE_HASH_MAP
-	if (mStringList)
+	SlotArray* slots = new SlotArray;
+	slots->mMask = (U32)size - 1;
+	slots->mSlots = new Slot[size];
+	for (S32 i = 0; i < size; i++)
 	{
-		for (S32 i = 0; i < mMaxEntries; i++)
+		slots->mSlots[i].mHash = 0;
+		slots->mSlots[i].mEntry = NULL;
+	}
+	slots->mRetired = NULL;
+	mMaxEntries = size;
+	return slots;
+}
+
+void LLStringTable::freeSlots(SlotArray* slots)
+{
+	delete [] slots->mSlots;
+	delete slots;
+}
+
+LLStringTable::Slot* LLStringTable::findSlot(const char* str, U32 hash)
+{
+	// Read the array once; a concurrent rehash may replace it.
+	SlotArray* slots = mSlotArray;
+	// The load factor is kept below 3/4, so an empty slot ends every probe.
+	for (U32 i = hash & slots->mMask; ; i = (i + 1) & slots->mMask)
+	{
+		Slot* slot = &slots->mSlots[i];
+		LLStringTableEntry* entry = slot->mEntry;
+		if (!entry)
+		{
+			return NULL;
+		}
+		if (entry != TOMBSTONE
+			&& slot->mHash == hash
+			&& !strncmp(entry->mString, str, MAX_STRINGS_LENGTH - 1))
 		{
-			if (mStringList[i])
+			return slot;
+		}
+	}
+}
+
+void LLStringTable::insertSlot(SlotArray* slots, U32 hash, LLStringTableEntry* entry)
+{
+	for (U32 i = hash & slots->mMask; ; i = (i + 1) & slots->mMask)
+	{
+		Slot* slot = &slots->mSlots[i];
+		if (!slot->mEntry || slot->mEntry == TOMBSTONE)
+		{
+			if (slot->mEntry == TOMBSTONE)
 			{
-				string_list_t::iterator iter;
-				for (iter = mStringList[i]->begin(); iter != mStringList[i]->end(); iter++)
-					delete *iter; // *iter = (LLStringTableEntry*)
+				mTombstones--;
 			}
-			delete mStringList[i];
+			slot->mHash = hash;
+			LL_STRING_TABLE_PUBLISH();
+			slot->mEntry = entry;
+			return;
 		}
-		delete [] mStringList;
-		mStringList = NULL;
 	}
-#else
-	// Need to clean up the string hash
-	for_each(mStringHash.begin(), mStringHash.end(), DeletePairedPointer());
-	mStringHash.clear();
-#endif
 }
 
-
-static U32 hash_my_string(const char *str, int max_entries)
+void LLStringTable::rehash()
 {
-	U32 retval = 0;
-#if 0
-	while (*str)
+	// Double when live entries fill half the table, otherwise just
+	// rebuild at the same size to clear out tombstones.
+	SlotArray* old_slots = mSlotArray;
+	S32 size = mMaxEntries;
+	if ((mUniqueEntries + 1) * 2 > size)
 	{
-		retval <<= 1;
-		retval += *str++;
+		size *= 2;
 	}
-#else
-	while (*str)
+	SlotArray* new_slots = allocateSlots(size);
+	for (U32 i = 0; i <= old_slots->mMask; i++)
 	{
-		retval = (retval<<4) + *str;
-		U32 x = (retval & 0xf0000000);
-		if (x) retval = retval ^ (x>>24);
-		retval = retval & (~x);
-		str++;
+		LLStringTableEntry* entry = old_slots->mSlots[i].mEntry;
+		if (entry && entry != TOMBSTONE)
+		{
+			insertSlot(new_slots, old_slots->mSlots[i].mHash, entry);
+		}
+	}
+	mTombstones = 0;
+
+	if (mConcurrentReads)
+	{
+		new_slots->mRetired = old_slots;
+		LL_STRING_TABLE_PUBLISH();
+		mSlotArray = new_slots;
+	}
+	else
+	{
+		mSlotArray = new_slots;
+		freeSlots(old_slots);
 	}
-#endif
-	return (retval & (max_entries-1)); // max_entries is gauranteed to be power of 2
 }
 
 char* LLStringTable::checkString(const std::string& str)
@@ -144,43 +230,11 @@ LLStringTableEntry* LLStringTable::checkStringEntry(const char *str)
 {
 	if (str)
 	{
-		char *ret_val;
-		LLStringTableEntry	*entry;
-		U32					hash_value = hash_my_string(str, mMaxEntries);
-#if STRING_TABLE_HASH_MAP
-#if 1 // Microsoft
-		string_hash_t::iterator lower = mStringHash.lower_bound(hash_value);
-		string_hash_t::iterator upper = mStringHash.upper_bound(hash_value);
-#else // stlport
-		std::pair<string_hash_t::iterator, string_hash_t::iterator> P = mStringHash.equal_range(hash_value);
-		string_hash_t::iterator lower = P.first;
-		string_hash_t::iterator upper = P.second;
-#endif
-		for (string_hash_t::iterator iter = lower; iter != upper; iter++)
-		{
-			entry = iter->second;
-			ret_val = entry->mString;
-			if (!strncmp(ret_val, str, MAX_STRINGS_LENGTH))
-			{
-				return entry;
-			}
-		}
-#else
-		string_list_t		*strlist = mStringList[hash_value];
-		if (strlist)
+		Slot* slot = findSlot(str, hash_my_string(str));
+		if (slot)
 		{
-			string_list_t::iterator iter;
-			for (iter = strlist->begin(); iter != strlist->end(); iter++)
-			{
-				entry = *iter;
-				ret_val = entry->mString;
-				if (!strncmp(ret_val, str, MAX_STRINGS_LENGTH))
-				{
-					return entry;
-				}
-			}
+			return slot->mEntry;
 		}
-#endif
 	}
 	return NULL;
 }
@@ -214,61 +268,22 @@ LLStringTableEntry* LLStringTable::addStringEntry(const char *str)
 {
 	if (str)
 	{
-		char *ret_val = NULL;
-		LLStringTableEntry	*entry;
-		U32					hash_value = hash_my_string(str, mMaxEntries);
-#if STRING_TABLE_HASH_MAP
-#if 1 // Microsoft
-		string_hash_t::iterator lower = mStringHash.lower_bound(hash_value);
-		string_hash_t::iterator upper = mStringHash.upper_bound(hash_value);
-#else // stlport
-		std::pair<string_hash_t::iterator, string_hash_t::iterator> P = mStringHash.equal_range(hash_value);
-		string_hash_t::iterator lower = P.first;
-		string_hash_t::iterator upper = P.second;
-#endif
-		for (string_hash_t::iterator iter = lower; iter != upper; iter++)
+		U32 hash_value = hash_my_string(str);
+		Slot* slot = findSlot(str, hash_value);
+		if (slot)
 		{
-			entry = iter->second;
-			ret_val = entry->mString;
-			if (!strncmp(ret_val, str, MAX_STRINGS_LENGTH))
-			{
-				entry->incCount();
-				return entry;
-			}
+			LLStringTableEntry* entry = slot->mEntry;
+			entry->incCount();
+			return entry;
 		}
 
 		// not found, so add!
-		LLStringTableEntry* newentry = new LLStringTableEntry(str);
-		ret_val = newentry->mString;
-		mStringHash.insert(string_hash_t::value_type(hash_value, newentry));
-#else
-		string_list_t		*strlist = mStringList[hash_value];
-
-		if (strlist)
+		if ((mUniqueEntries + mTombstones + 1) * 4 > mMaxEntries * 3)
 		{
-			string_list_t::iterator iter;
-			for (iter = strlist->begin(); iter != strlist->end(); iter++)
-			{
-				entry = *iter;
-				ret_val = entry->mString;
-				if (!strncmp(ret_val, str, MAX_STRINGS_LENGTH))
-				{
-					entry->incCount();
-					return entry;
-				}
-			}
-		}
-		else
-		{
-			mStringList[hash_value] = new string_list_t;
-			strlist = mStringList[hash_value];
+			rehash();
 		}
-
-		// not found, so add!
-		LLStringTableEntry *newentry = new LLStringTableEntry(str);
-		//ret_val = newentry->mString;
-		strlist->push_front(newentry);
-#endif
+		LLStringTableEntry* newentry = new LLStringTableEntry(str);
+		insertSlot(mSlotArray, hash_value, newentry);
 		mUniqueEntries++;
 		return newentry;
 	}
@@ -282,66 +297,21 @@ void LLStringTable::removeString(const char *str)
 {
 	if (str)
 	{
-		char *ret_val;
-		LLStringTableEntry	*entry;
-		U32					hash_value = hash_my_string(str, mMaxEntries);
-#if STRING_TABLE_HASH_MAP
+		Slot* slot = findSlot(str, hash_my_string(str));
+		if (slot)
 		{
-#if 1 // Microsoft
-			string_hash_t::iterator lower = mStringHash.lower_bound(hash_value);
-			string_hash_t::iterator upper = mStringHash.upper_bound(hash_value);
-#else // stlport
-			std::pair<string_hash_t::iterator, string_hash_t::iterator> P = mStringHash.equal_range(hash_value);
-			string_hash_t::iterator lower = P.first;
-			string_hash_t::iterator upper = P.second;
-#endif
-			for (string_hash_t::iterator iter = lower; iter != upper; iter++)
+			LLStringTableEntry* entry = slot->mEntry;
+			if (!entry->decCount())
 			{
-				entry = iter->second;
-				ret_val = entry->mString;
-				if (!strncmp(ret_val, str, MAX_STRINGS_LENGTH))
+				mUniqueEntries--;
+				if (mUniqueEntries < 0)
 				{
-					if (!entry->decCount())
-					{
-						mUniqueEntries--;
-						if (mUniqueEntries < 0)
-						{
-							llerror("LLStringTable:removeString trying to remove too many strings!", 0);
-						}
-						delete iter->second;
-						mStringHash.erase(iter);
-					}
-					return;
+					llerror("LLStringTable:removeString trying to remove too many strings!", 0);
 				}
+				slot->mEntry = TOMBSTONE;
+				mTombstones++;
+				delete entry;
 			}
 		}
-#else
-		string_list_t		*strlist = mStringList[hash_value];
-
-		if (strlist)
-		{
-			string_list_t::iterator iter;
-			for (iter = strlist->begin(); iter != strlist->end(); iter++)
-			{
-				entry = *iter;
-				ret_val = entry->mString;
-				if (!strncmp(ret_val, str, MAX_STRINGS_LENGTH))
-				{
-					if (!entry->decCount())
-					{
-						mUniqueEntries--;
-						if (mUniqueEntries < 0)
-						{
-							llerror("LLStringTable:removeString trying to remove too many strings!", 0);
-						}
-						strlist->remove(entry);
-						delete entry;
-					}
-					return;
-				}
-			}
-		}
-#endif
 	}
 }
-
@@ -40,20 +40,6 @@
 #include <list>
 #include <set>
 
-#if LL_WINDOWS
-# if (_MSC_VER >= 1300 && _MSC_VER < 1400)
-#  define STRING_TABLE_HASH_MAP 1
-# endif
-#else
-//# define STRING_TABLE_HASH_MAP 1
-#endif
-
-#if LL_WINDOWS
-#include <hash_map>
-#else
-#include <ext/hash_map>
-#endif
-
 const U32 MAX_STRINGS_LENGTH = 256;
 
 class LLStringTableEntry
@@ -81,10 +67,23 @@ public:
 	S32  mCount;
 };
 
+// Interns C strings. Each unique string is stored once in a heap
+// allocated LLStringTableEntry; the returned char* stays valid until the
+// last matching removeString(). Lookups use an open addressing table of
+// (hash, entry) slots with linear probing, so a miss or a hit usually
+// touches one cache line before the single string compare.
+//
+// All writes (addString, removeString) must come from one thread at a
+// time. Tables constructed with concurrent_reads = true also allow
+// checkString() from other threads while that writer adds strings:
+// slots are published after they are filled and slot arrays replaced
+// by a resize are kept until the table is destroyed. Readers may miss
+// a string whose add is still in progress. Strings must not be removed
+// from such a table while other threads read it.
 class LLStringTable
 {
 public:
-	LLStringTable(int tablesize);
+	LLStringTable(int tablesize, bool concurrent_reads = false);
 	~LLStringTable();
 
 	char *checkString(const char *str);
@@ -98,21 +97,32 @@ public:
 	LLStringTableEntry *addStringEntry(const std::string& str);
 	void  removeString(const char *str);
 
-	S32 mMaxEntries;
+	S32 mMaxEntries;	// number of slots, always a power of 2
 	S32 mUniqueEntries;
-	
-#if STRING_TABLE_HASH_MAP
-#if LL_WINDOWS
-	typedef std::hash_multimap<U32, LLStringTableEntry *> string_hash_t;
-#else
-	typedef __gnu_cxx::hash_multimap<U32, LLStringTableEntry *> string_hash_t;
-#endif
-	string_hash_t mStringHash;
-#else
-	typedef std::list<LLStringTableEntry *> string_list_t;
-	typedef string_list_t * string_list_ptr_t;
-	string_list_ptr_t	*mStringList;
-#endif	
+
+private:
+	struct Slot
+	{
+		U32 mHash;
+		LLStringTableEntry* volatile mEntry; // NULL if never used
+	};
+
+	struct SlotArray
+	{
+		U32 mMask;
+		Slot* mSlots;
+		SlotArray* mRetired; // replaced arrays kept for concurrent readers
+	};
+
+	SlotArray* allocateSlots(S32 size);
+	void freeSlots(SlotArray* slots);
+	Slot* findSlot(const char* str, U32 hash);
+	void insertSlot(SlotArray* slots, U32 hash, LLStringTableEntry* entry);
+	void rehash();
+
+	SlotArray* volatile mSlotArray;
+	S32 mTombstones;
+	bool mConcurrentReads;
 };
 
 extern LLStringTable gStringTable;
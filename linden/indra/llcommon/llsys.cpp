@@ -433,6 +433,26 @@ LLCPUInfo::LLCPUInfo()
 	mFamily.assign( info->strFamily );
 	mCPUString = "Unknown";
 
+#if LL_WINDOWS
+	SYSTEM_INFO sys_info;
+	GetSystemInfo(&sys_info);
+	mCoreCount = (S32)sys_info.dwNumberOfProcessors;
+#elif LL_DARWIN
+	int ncpu = 0;
+	size_t len = sizeof(ncpu);
+	if (sysctlbyname("hw.ncpu", &ncpu, &len, NULL, 0) != 0)
+	{
+		ncpu = 0;
+	}
+	mCoreCount = ncpu;
+#else
+	mCoreCount = (S32)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+	if (mCoreCount < 1)
+	{
+		mCoreCount = 1;
+	}
+
 #if LL_WINDOWS || LL_DARWIN || LL_SOLARIS
 	out << proc.strCPUName;
 	if (200 < mCPUMhz && mCPUMhz < 10000)           // *NOTE: cpu speed is often way wrong, do a sanity check
@@ -510,6 +530,11 @@ S32 LLCPUInfo::getMhz() const
 	return mCPUMhz;
 }
 
+S32 LLCPUInfo::getCoreCount() const
+{
+	return mCoreCount;
+}
+
 std::string LLCPUInfo::getCPUString() const
 {
 	return mCPUString;
@@ -555,6 +580,7 @@ void LLCPUInfo::stream(std::ostream& s) const
 	s << "->mHasSSE2:    " << (U32)mHasSSE2 << std::endl;
 	s << "->mHasAltivec: " << (U32)mHasAltivec << std::endl;
 	s << "->mCPUMhz:     " << mCPUMhz << std::endl;
+	s << "->mCoreCount:  " << mCoreCount << std::endl;
 	s << "->mCPUString:  " << mCPUString << std::endl;
 }
 
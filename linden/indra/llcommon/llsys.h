@@ -82,6 +82,8 @@ public:
 	bool hasSSE() const;
 	bool hasSSE2() const;
 	S32	 getMhz() const;
+	// Number of logical processors online, always at least 1
+	S32	 getCoreCount() const;
 
 	// Family is "AMD Duron" or "Intel Pentium Pro"
 	const std::string& getFamily() const { return mFamily; }
@@ -91,6 +93,7 @@ private:
 	bool mHasSSE2;
 	bool mHasAltivec;
 	S32 mCPUMhz;
+	S32 mCoreCount;
 	std::string mFamily;
 	std::string mCPUString;
 };
@@ -36,6 +36,7 @@
 
 #include "llthread.h"
 
+#include "llfasttimer.h"
 #include "lltimer.h"
 
 #if LL_LINUX || LL_SOLARIS
@@ -75,6 +76,9 @@ void *APR_THREAD_FUNC LLThread::staticRun(apr_thread_t *apr_threadp, void *datap
 	// Create a thread local APRFile pool.
 	LLVolatileAPRPool::createLocalAPRFilePool();
 
+	// Label this thread in fast timer captures.
+	LLFastTimer::setThreadName(threadp->mName);
+
 	// Run the user supplied function
 	threadp->run();
 
@@ -34,14 +34,72 @@
 
 #include "llimageworker.h"
 #include "llimagedxt.h"
+#include "llfasttimer.h"
 
 //----------------------------------------------------------------------------
 
 // MAIN THREAD
-LLImageDecodeThread::LLImageDecodeThread(bool threaded)
-	: LLQueuedThread("imagedecode", threaded)
+LLImageDecodeThread::LLImageDecodeThread(bool threaded, S32 num_threads)
+	: LLQueuedThread("imagedecode", threaded),
+	  mDecodeCount(0),
+	  mDecodeFailCount(0)
 {
 	mCreationMutex = new LLMutex(getAPRPool());
+	mStatsMutex = new LLMutex(getAPRPool());
+	mDecodeTimes.reserve(DECODE_TIME_SAMPLES);
+	mStatsStartTime = LLTimer::getTotalSeconds();
+
+	if (threaded)
+	{
+		for (S32 i = 1; i < num_threads; ++i)
+		{
+			DecodeWorker* worker = new DecodeWorker(llformat("imagedecode%d", i), this);
+			mWorkers.push_back(worker);
+			worker->start();
+		}
+	}
+	llinfos << "Image decode threads: " << getNumThreads() << llendl;
+}
+
+// MAIN THREAD
+LLImageDecodeThread::~LLImageDecodeThread()
+{
+	shutdown();
+	delete mCreationMutex;
+	mCreationMutex = NULL;
+	delete mStatsMutex;
+	mStatsMutex = NULL;
+}
+
+// MAIN THREAD
+// virtual
+void LLImageDecodeThread::shutdown()
+{
+	// Stop the workers first, LLQueuedThread::shutdown() deletes any
+	// requests still in the queue.
+	for (worker_list_t::iterator iter = mWorkers.begin();
+		 iter != mWorkers.end(); ++iter)
+	{
+		delete *iter; // ~LLThread() waits for the thread to exit
+	}
+	mWorkers.clear();
+	LLQueuedThread::shutdown();
+}
+
+// static
+S32 LLImageDecodeThread::getDefaultNumThreads()
+{
+	const S32 MAX_DEFAULT_THREADS = 8;
+	return llclamp(gSysCPU.getCoreCount() - 1, 1, MAX_DEFAULT_THREADS);
+}
+
+void LLImageDecodeThread::wakeWorkers()
+{
+	for (worker_list_t::iterator iter = mWorkers.begin();
+		 iter != mWorkers.end(); ++iter)
+	{
+		(*iter)->wake();
+	}
 }
 
 // MAIN THREAD
@@ -55,7 +113,7 @@ S32 LLImageDecodeThread::update(U32 max_time_ms)
 		creation_info& info = *iter;
 		ImageRequest* req = new ImageRequest(info.handle, info.image,
 						     info.priority, info.discard, info.needs_aux,
-						     info.responder);
+						     info.responder, this, info.queued_time);
 
 		bool res = addRequest(req);
 		if (!res)
@@ -63,8 +121,13 @@ S32 LLImageDecodeThread::update(U32 max_time_ms)
 			llerrs << "request added after LLLFSThread::cleanupClass()" << llendl;
 		}
 	}
+	bool added = !mCreationList.empty();
 	mCreationList.clear();
 	S32 res = LLQueuedThread::update(max_time_ms);
+	if (added)
+	{
+		wakeWorkers();
+	}
 	return res;
 }
 
@@ -73,10 +136,71 @@ LLImageDecodeThread::handle_t LLImageDecodeThread::decodeImage(LLImageFormatted*
 {
 	LLMutexLock lock(mCreationMutex);
 	handle_t handle = generateHandle();
-	mCreationList.push_back(creation_info(handle, image, priority, discard, needs_aux, responder));
+	mCreationList.push_back(creation_info(handle, image, priority, discard, needs_aux, responder,
+										  LLTimer::getTotalSeconds()));
 	return handle;
 }
 
+// ANY THREAD
+void LLImageDecodeThread::recordDecode(bool success, F64 queued_time)
+{
+	F32 decode_time = (F32)(LLTimer::getTotalSeconds() - queued_time);
+	LLMutexLock lock(mStatsMutex);
+	if (!success)
+	{
+		++mDecodeFailCount;
+		return;
+	}
+	if (mDecodeTimes.size() < DECODE_TIME_SAMPLES)
+	{
+		mDecodeTimes.push_back(decode_time);
+	}
+	else
+	{
+		mDecodeTimes[mDecodeCount % DECODE_TIME_SAMPLES] = decode_time;
+	}
+	++mDecodeCount;
+}
+
+// ANY THREAD
+void LLImageDecodeThread::getDecodeStats(F32& images_per_sec, F32& p50_secs, F32& p99_secs)
+{
+	std::vector<F32> times;
+	U32 count;
+	F64 elapsed = LLTimer::getTotalSeconds() - mStatsStartTime;
+	{
+		LLMutexLock lock(mStatsMutex);
+		times = mDecodeTimes;
+		count = mDecodeCount;
+	}
+	images_per_sec = elapsed > 0.0 ? (F32)(count / elapsed) : 0.f;
+	p50_secs = 0.f;
+	p99_secs = 0.f;
+	if (!times.empty())
+	{
+		std::sort(times.begin(), times.end());
+		S32 last = (S32)times.size() - 1;
+		p50_secs = times[last / 2];
+		p99_secs = times[(last * 99) / 100];
+	}
+}
+
+void LLImageDecodeThread::dumpDecodeStats()
+{
+	F32 images_per_sec, p50, p99;
+	getDecodeStats(images_per_sec, p50, p99);
+	U32 decode_count, fail_count;
+	{
+		// The workers may still be recording decodes.
+		LLMutexLock lock(mStatsMutex);
+		decode_count = mDecodeCount;
+		fail_count = mDecodeFailCount;
+	}
+	llinfos << llformat("Image decode: %d threads, %u decoded, %u failed, %.1f images/sec, p50 %.1f ms, p99 %.1f ms",
+						getNumThreads(), decode_count, fail_count,
+						images_per_sec, p50 * 1000.f, p99 * 1000.f) << llendl;
+}
+
 // Used by unit test only
 // Returns the size of the mutex guarded list as an indication of sanity
 S32 LLImageDecodeThread::tut_size()
@@ -92,16 +216,52 @@ LLImageDecodeThread::Responder::~Responder()
 
 //----------------------------------------------------------------------------
 
+LLImageDecodeThread::DecodeWorker::DecodeWorker(const std::string& name, LLImageDecodeThread* owner)
+	: LLThread(name),
+	  mOwner(owner)
+{
+}
+
+// virtual
+bool LLImageDecodeThread::DecodeWorker::runCondition()
+{
+	// mRunCondition must be locked here
+	return mOwner->getPending() > 0;
+}
+
+// virtual
+void LLImageDecodeThread::DecodeWorker::run()
+{
+	while (1)
+	{
+		// Blocks until the owner has queued requests or we are asked to quit
+		checkPause();
+
+		if (isQuitting())
+		{
+			break;
+		}
+
+		mOwner->processNextRequest();
+	}
+	llinfos << "LLImageDecodeThread::DecodeWorker " << mName << " EXITING." << llendl;
+}
+
+//----------------------------------------------------------------------------
+
 LLImageDecodeThread::ImageRequest::ImageRequest(handle_t handle, LLImageFormatted* image, 
 												U32 priority, S32 discard, BOOL needs_aux,
-												LLImageDecodeThread::Responder* responder)
+												LLImageDecodeThread::Responder* responder,
+												LLImageDecodeThread* owner, F64 queued_time)
 	: LLQueuedThread::QueuedRequest(handle, priority, FLAG_AUTO_COMPLETE),
 	  mFormattedImage(image),
 	  mDiscardLevel(discard),
 	  mNeedsAux(needs_aux),
 	  mDecodedRaw(FALSE),
 	  mDecodedAux(FALSE),
-	  mResponder(responder)
+	  mResponder(responder),
+	  mOwner(owner),
+	  mQueuedTime(queued_time)
 {
 }
 
@@ -115,9 +275,12 @@ LLImageDecodeThread::ImageRequest::~ImageRequest()
 //----------------------------------------------------------------------------
 
 
+static LLFastTimer::DeclareTimer FTM_IMAGE_DECODE_REQUEST("Image Decode Request");
+
 // Returns true when done, whether or not decode was successful.
 bool LLImageDecodeThread::ImageRequest::processRequest()
 {
+	LLFastTimer t(FTM_IMAGE_DECODE_REQUEST);
 	const F32 decode_time_slice = .1f;
 	bool done = true;
 	if (!mDecodedRaw && mFormattedImage.notNull())
@@ -163,9 +326,13 @@ bool LLImageDecodeThread::ImageRequest::processRequest()
 
 void LLImageDecodeThread::ImageRequest::finishRequest(bool completed)
 {
+	bool success = completed && mDecodedRaw && (!mNeedsAux || mDecodedAux);
+	if (mOwner)
+	{
+		mOwner->recordDecode(success, mQueuedTime);
+	}
 	if (mResponder.notNull())
 	{
-		bool success = completed && mDecodedRaw && (!mNeedsAux || mDecodedAux);
 		mResponder->completed(success, mDecodedImageRaw, mDecodedImageAux);
 	}
 	// Will automatically be deleted
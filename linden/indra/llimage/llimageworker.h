@@ -55,7 +55,8 @@ public:
 	public:
 		ImageRequest(handle_t handle, LLImageFormatted* image,
 					 U32 priority, S32 discard, BOOL needs_aux,
-					 LLImageDecodeThread::Responder* responder);
+					 LLImageDecodeThread::Responder* responder,
+					 LLImageDecodeThread* owner = NULL, F64 queued_time = 0.0);
 
 		/*virtual*/ bool processRequest();
 		/*virtual*/ void finishRequest(bool completed);
@@ -74,19 +75,64 @@ public:
 		BOOL mDecodedRaw;
 		BOOL mDecodedAux;
 		LLPointer<LLImageDecodeThread::Responder> mResponder;
+		// stats
+		LLImageDecodeThread* mOwner;
+		F64 mQueuedTime;
+	};
+
+	// Additional decode thread. Workers pull requests from the owning
+	// LLImageDecodeThread's priority queue, so the highest priority image
+	// is always decoded next by whichever thread is free.
+	class DecodeWorker : public LLThread
+	{
+	public:
+		DecodeWorker(const std::string& name, LLImageDecodeThread* owner);
+
+	private:
+		/*virtual*/ bool runCondition();
+		/*virtual*/ void run();
+
+		LLImageDecodeThread* mOwner;
 	};
 	
 public:
-	LLImageDecodeThread(bool threaded = true);
+	// num_threads is the total number of decode threads, including this one.
+	// Ignored when not threaded.
+	LLImageDecodeThread(bool threaded = true, S32 num_threads = 1);
+	virtual ~LLImageDecodeThread();
+	/*virtual*/ void shutdown();
 	handle_t decodeImage(LLImageFormatted* image,
 						 U32 priority, S32 discard, BOOL needs_aux,
 						 Responder* responder);
 	S32 update(U32 max_time_ms);
 
+	S32 getNumThreads() const { return (S32)mWorkers.size() + 1; }
+	// One thread per core, leaving one for the main thread
+	static S32 getDefaultNumThreads();
+
+	// Decode statistics. Times are from decodeImage() to completion.
+	// May be called from any thread.
+	void recordDecode(bool success, F64 queued_time);
+	void getDecodeStats(F32& images_per_sec, F32& p50_secs, F32& p99_secs);
+	void dumpDecodeStats();
+
 	// Used by unit tests to check the consistency of the thread instance
 	S32 tut_size();
 	
 private:
+	void wakeWorkers();
+
+	typedef std::vector<DecodeWorker*> worker_list_t;
+	worker_list_t mWorkers;
+
+	enum { DECODE_TIME_SAMPLES = 1024 };
+	LLMutex* mStatsMutex;
+	std::vector<F32> mDecodeTimes; // ring buffer of recent decode times
+	U32 mDecodeCount;
+	U32 mDecodeFailCount;
+	F64 mStatsStartTime;
+
+
 	struct creation_info
 	{
 		handle_t handle;
@@ -95,8 +141,9 @@ private:
 		S32 discard;
 		BOOL needs_aux;
 		LLPointer<Responder> responder;
-		creation_info(handle_t h, LLImageFormatted* i, U32 p, S32 d, BOOL aux, Responder* r)
-			: handle(h), image(i), priority(p), discard(d), needs_aux(aux), responder(r)
+		F64 queued_time;
+		creation_info(handle_t h, LLImageFormatted* i, U32 p, S32 d, BOOL aux, Responder* r, F64 t)
+			: handle(h), image(i), priority(p), discard(d), needs_aux(aux), responder(r), queued_time(t)
 		{}
 	};
 	typedef std::list<creation_info> creation_list_t;
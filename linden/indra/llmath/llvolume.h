@@ -53,6 +53,7 @@ class LLVolume;
 #include "llstrider.h"
 #include "v4coloru.h"
 #include "llmemory.h"
+#include "llmemtype.h"
 #include "llfile.h"
 
 //============================================================================
@@ -837,9 +838,11 @@ public:
 
 	LLVector3 mExtents[2]; //minimum and maximum point of face
 
-	std::vector<VertexData> mVertices;
-	std::vector<U16>	mIndices;
-	std::vector<S32>	mEdge;
+	// Counted against MTYPE_VOLUME so volume geometry shows up in the
+	// memory view on its own.
+	std::vector<VertexData, LLMemTypeAllocator<VertexData, LLMemType::MTYPE_VOLUME> > mVertices;
+	std::vector<U16, LLMemTypeAllocator<U16, LLMemType::MTYPE_VOLUME> >	mIndices;
+	std::vector<S32, LLMemTypeAllocator<S32, LLMemType::MTYPE_VOLUME> >	mEdge;
 
 private:
 	BOOL createUnCutCubeCap(LLVolume* volume, BOOL partial_build = FALSE);
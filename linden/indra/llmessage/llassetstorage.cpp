@@ -60,6 +60,9 @@
 LLAssetStorage *gAssetStorage = NULL;
 LLMetrics *LLAssetStorage::metric_recipient = NULL;
 
+// asset downloads in progress at once, unless set otherwise
+const S32 LL_DEFAULT_MAX_RUNNING_ASSET_DOWNLOADS = 16;
+
 const LLUUID CATEGORIZE_LOST_AND_FOUND_ID(std::string("00000000-0000-0000-0000-000000000010"));
 
 const U64 TOXIC_ASSET_LIFETIME = (120 * 1000000);		// microseconds
@@ -270,6 +273,153 @@ LLEstateAssetRequest::~LLEstateAssetRequest()
 }
 
 
+///----------------------------------------------------------------------------
+/// LLAssetRequestScheduler
+///----------------------------------------------------------------------------
+
+LLAssetRequestScheduler::LLAssetRequestScheduler()
+:	mMaxRunning(LL_DEFAULT_MAX_RUNNING_ASSET_DOWNLOADS),
+	mNextSequence(0),
+	mNextDownloadID(1),
+	mPeakQueuedCount(0),
+	mStartedCount(0),
+	mTotalWaitTime(0.0),
+	mMaxWaitTime(0.0)
+{
+	for (S32 i = 0; i < ASSET_PRIORITY_COUNT; ++i)
+	{
+		mQueuedCount[i] = 0;
+	}
+}
+
+bool LLAssetRequestScheduler::queue(const LLUUID& uuid, LLAssetType::EType type,
+									EAssetPriority priority, F64 now)
+{
+	asset_key_t key(uuid, type);
+	if (mRunning.count(key))
+	{
+		return false;
+	}
+	entry_map_t::iterator iter = mQueued.find(key);
+	if (iter != mQueued.end())
+	{
+		// another caller wants it too - never lower it on their account
+		if (priority > -iter->second.mOrder.first)
+		{
+			setPriority(uuid, type, priority);
+		}
+		return false;
+	}
+
+	Entry& entry = mQueued[key];
+	entry.mOrder = order_t(-priority, mNextSequence++);
+	entry.mQueueTime = now;
+	mOrder.insert(std::make_pair(entry.mOrder, key));
+	++mQueuedCount[priority];
+	mPeakQueuedCount = llmax(mPeakQueuedCount, (S32)mQueued.size());
+	return true;
+}
+
+bool LLAssetRequestScheduler::setPriority(const LLUUID& uuid, LLAssetType::EType type,
+										  EAssetPriority priority)
+{
+	asset_key_t key(uuid, type);
+	entry_map_t::iterator iter = mQueued.find(key);
+	if (iter == mQueued.end())
+	{
+		return false;
+	}
+	Entry& entry = iter->second;
+	mOrder.erase(std::make_pair(entry.mOrder, key));
+	--mQueuedCount[-entry.mOrder.first];
+	// keep the place in line among requests of the new priority
+	entry.mOrder.first = -priority;
+	mOrder.insert(std::make_pair(entry.mOrder, key));
+	++mQueuedCount[priority];
+	return true;
+}
+
+bool LLAssetRequestScheduler::remove(const LLUUID& uuid, LLAssetType::EType type)
+{
+	asset_key_t key(uuid, type);
+	if (mRunning.erase(key))
+	{
+		return true;
+	}
+	entry_map_t::iterator iter = mQueued.find(key);
+	if (iter == mQueued.end())
+	{
+		return false;
+	}
+	mOrder.erase(std::make_pair(iter->second.mOrder, key));
+	--mQueuedCount[-iter->second.mOrder.first];
+	mQueued.erase(iter);
+	return true;
+}
+
+U32 LLAssetRequestScheduler::startNext(LLUUID& uuid, LLAssetType::EType& type,
+										EAssetPriority& priority, F64 now)
+{
+	if (mOrder.empty() || ((S32)mRunning.size() >= mMaxRunning))
+	{
+		return 0;
+	}
+	asset_key_t key = mOrder.begin()->second;
+	mOrder.erase(mOrder.begin());
+	entry_map_t::iterator iter = mQueued.find(key);
+	priority = (EAssetPriority)-iter->second.mOrder.first;
+	--mQueuedCount[priority];
+	F64 wait_time = now - iter->second.mQueueTime;
+	mQueued.erase(iter);
+
+	U32 download_id = mNextDownloadID++;
+	if (!mNextDownloadID)
+	{
+		// 0 means nothing started
+		mNextDownloadID = 1;
+	}
+	mRunning[key] = download_id;
+
+	++mStartedCount;
+	mTotalWaitTime += wait_time;
+	mMaxWaitTime = llmax(mMaxWaitTime, wait_time);
+
+	uuid = key.first;
+	type = key.second;
+	return download_id;
+}
+
+bool LLAssetRequestScheduler::finished(const LLUUID& uuid, LLAssetType::EType type, U32 download_id)
+{
+	std::map<asset_key_t, U32>::iterator iter = mRunning.find(asset_key_t(uuid, type));
+	if ((iter == mRunning.end()) || (iter->second != download_id))
+	{
+		return false;
+	}
+	mRunning.erase(iter);
+	return true;
+}
+
+bool LLAssetRequestScheduler::isQueued(const LLUUID& uuid, LLAssetType::EType type) const
+{
+	return mQueued.count(asset_key_t(uuid, type)) > 0;
+}
+
+bool LLAssetRequestScheduler::isRunning(const LLUUID& uuid, LLAssetType::EType type) const
+{
+	return mRunning.count(asset_key_t(uuid, type)) > 0;
+}
+
+S32 LLAssetRequestScheduler::getQueuedCount(EAssetPriority priority) const
+{
+	return mQueuedCount[priority];
+}
+
+F64 LLAssetRequestScheduler::getMeanWaitTime() const
+{
+	return mStartedCount ? (mTotalWaitTime / mStartedCount) : 0.0;
+}
+
 ///----------------------------------------------------------------------------
 /// LLAssetStorage
 ///----------------------------------------------------------------------------
@@ -355,9 +505,11 @@ void LLAssetStorage::_cleanupRequests(BOOL all, S32 error)
 			LLAssetRequest* tmp = *curiter;
 			// if all is true, we want to clean up everything
 			// otherwise just check for timed out requests
-			// EXCEPT for upload timeouts
+			// EXCEPT for upload timeouts, and downloads which are
+			// still queued, since their timeout starts with them
 			if (all 
 				|| ((RT_DOWNLOAD == rt)
+					&& !mDownloadScheduler.isQueued(tmp->getUUID(), tmp->getType())
 					&& LL_ASSET_STORAGE_TIMEOUT < (mt_secs - tmp->mTime)))
 			{
 				llwarns << "Asset " << getRequestName((ERequestType)rt) << " request "
@@ -367,6 +519,12 @@ void LLAssetStorage::_cleanupRequests(BOOL all, S32 error)
 
 				timed_out.push_front(tmp);
 				iter = requests->erase(curiter);
+				if ((RT_DOWNLOAD == rt)
+					&& !findRequest(requests, tmp->getType(), tmp->getUUID()))
+				{
+					// nobody is left waiting, free the slot or queue entry
+					mDownloadScheduler.remove(tmp->getUUID(), tmp->getType());
+				}
 			}
 		}
 	}
@@ -392,6 +550,7 @@ void LLAssetStorage::_cleanupRequests(BOOL all, S32 error)
 		delete tmp;
 	}
 
+	_startQueuedDownloads();
 }
 
 BOOL LLAssetStorage::hasLocalAsset(const LLUUID &uuid, const LLAssetType::EType type)
@@ -405,6 +564,12 @@ BOOL LLAssetStorage::hasLocalAsset(const LLUUID &uuid, const LLAssetType::EType
 
 // IW - uuid is passed by value to avoid side effects, please don't re-add &    
 void LLAssetStorage::getAssetData(const LLUUID uuid, LLAssetType::EType type, void (*callback)(LLVFS *vfs, const LLUUID&, LLAssetType::EType, void *, S32, LLExtStat), void *user_data, BOOL is_priority)
+{
+	getAssetData(uuid, type, callback, user_data,
+				 is_priority ? ASSET_PRIORITY_URGENT : ASSET_PRIORITY_NORMAL);
+}
+
+void LLAssetStorage::getAssetData(const LLUUID uuid, LLAssetType::EType type, LLGetAssetCallback callback, void *user_data, EAssetPriority priority)
 {
 	lldebugs << "LLAssetStorage::getAssetData() - " << uuid << "," << LLAssetType::lookup(type) << llendl;
 
@@ -464,7 +629,7 @@ void LLAssetStorage::getAssetData(const LLUUID uuid, LLAssetType::EType type, vo
 		}
 		
 		// This can be overridden by subclasses
-		_queueDataRequest(uuid, type, callback, user_data, duplicate, is_priority);	
+		_queueDataRequest(uuid, type, callback, user_data, duplicate, priority);	
 	}
 	else
 	{
@@ -481,7 +646,7 @@ void LLAssetStorage::getAssetData(const LLUUID uuid, LLAssetType::EType type, vo
 void LLAssetStorage::_queueDataRequest(const LLUUID& uuid, LLAssetType::EType atype,
 									   LLGetAssetCallback callback,
 									   void *user_data, BOOL duplicate,
-									   BOOL is_priority)
+									   EAssetPriority priority)
 {
 	if (mUpstreamHost.isOk())
 	{
@@ -489,26 +654,14 @@ void LLAssetStorage::_queueDataRequest(const LLUUID& uuid, LLAssetType::EType at
 		LLAssetRequest *req = new LLAssetRequest(uuid, atype);
 		req->mDownCallback = callback;
 		req->mUserData = user_data;
-		req->mIsPriority = is_priority;
+		req->mIsPriority = (priority >= ASSET_PRIORITY_URGENT);
 	
 		mPendingDownloads.push_back(req);
-	
-		if (!duplicate)
-		{
-			// send request message to our upstream data provider
-			// Create a new asset transfer.
-			LLTransferSourceParamsAsset spa;
-			spa.setAsset(uuid, atype);
 
-			// Set our destination file, and the completion callback.
-			LLTransferTargetParamsVFile tpvf;
-			tpvf.setAsset(uuid, atype);
-			tpvf.setCallback(downloadCompleteCallback, req);
-
-			llinfos << "Starting transfer for " << uuid << llendl;
-			LLTransferTargetChannel *ttcp = gTransferManager.getTargetChannel(mUpstreamHost, LLTCT_ASSET);
-			ttcp->requestTransfer(spa, tpvf, 100.f + (is_priority ? 1.f : 0.f));
-		}
+		// Duplicates only ever raise the priority of the queued
+		// download, the transfer is requested once when it starts.
+		mDownloadScheduler.queue(uuid, atype, priority, LLMessageSystem::getMessageTimeSeconds());
+		_startQueuedDownloads();
 	}
 	else
 	{
@@ -521,6 +674,98 @@ void LLAssetStorage::_queueDataRequest(const LLUUID& uuid, LLAssetType::EType at
 	}
 }
 
+void LLAssetStorage::_startQueuedDownloads()
+{
+	LLUUID uuid;
+	LLAssetType::EType atype;
+	EAssetPriority priority;
+	U32 download_id;
+	F64 mt_secs = LLMessageSystem::getMessageTimeSeconds();
+	while (!mShutDown
+		   && (download_id = mDownloadScheduler.startNext(uuid, atype, priority, mt_secs)))
+	{
+		BOOL wanted = FALSE;
+		for (request_list_t::iterator iter = mPendingDownloads.begin();
+			 iter != mPendingDownloads.end(); ++iter)
+		{
+			LLAssetRequest* tmp = *iter;
+			if ((tmp->getType() == atype) && (tmp->getUUID() == uuid))
+			{
+				wanted = TRUE;
+				// the timeout runs from when the download starts, not
+				// from when it was queued.
+				tmp->mTime = mt_secs;
+			}
+		}
+		if (!wanted)
+		{
+			// everyone who wanted it gave up while it was queued
+			mDownloadScheduler.finished(uuid, atype, download_id);
+			continue;
+		}
+
+		// send request message to our upstream data provider
+		// Create a new asset transfer.
+		LLTransferSourceParamsAsset spa;
+		spa.setAsset(uuid, atype);
+
+		// Set our destination file, and the completion callback.
+		LLTransferTargetParamsVFile tpvf;
+		tpvf.setAsset(uuid, atype);
+		// The requests may be gone by the time it completes, so the
+		// callback gets the download id to check it is still wanted.
+		tpvf.setCallback(transferCompleteCallback, (void*)(intptr_t)download_id);
+
+		llinfos << "Starting transfer for " << uuid << llendl;
+		LLTransferTargetChannel *ttcp = gTransferManager.getTargetChannel(mUpstreamHost, LLTCT_ASSET);
+		// normal downloads go at 100 and urgent ones at 101, as before
+		ttcp->requestTransfer(spa, tpvf, 100.f + 0.5f * (F32)(priority - ASSET_PRIORITY_NORMAL));
+	}
+}
+
+bool LLAssetStorage::setAssetPriority(const LLUUID& uuid, LLAssetType::EType atype, EAssetPriority priority)
+{
+	return mDownloadScheduler.setPriority(uuid, atype, priority);
+}
+
+void LLAssetStorage::cancelAssetRequest(const LLUUID& uuid, LLAssetType::EType atype,
+										LLGetAssetCallback callback, void *user_data)
+{
+	BOOL still_wanted = FALSE;
+	for (request_list_t::iterator iter = mPendingDownloads.begin();
+		 iter != mPendingDownloads.end(); )
+	{
+		request_list_t::iterator curiter = iter++;
+		LLAssetRequest* tmp = *curiter;
+		if ((tmp->getType() != atype) || (tmp->getUUID() != uuid))
+		{
+			continue;
+		}
+		if ((tmp->mDownCallback == callback) && (tmp->mUserData == user_data))
+		{
+			mPendingDownloads.erase(curiter);
+			delete tmp;
+		}
+		else
+		{
+			still_wanted = TRUE;
+		}
+	}
+
+	// A running download is left to finish into the cache, but a
+	// queued one nobody wants is dropped.
+	if (!still_wanted && mDownloadScheduler.isQueued(uuid, atype))
+	{
+		mDownloadScheduler.remove(uuid, atype);
+	}
+}
+
+void LLAssetStorage::setMaxRunningDownloads(S32 max_running)
+{
+	mDownloadScheduler.setMaxRunning(max_running);
+	_startQueuedDownloads();
+}
+
 
 void LLAssetStorage::downloadCompleteCallback(
 	S32 result,
@@ -543,26 +788,55 @@ void LLAssetStorage::downloadCompleteCallback(
 		return;
 	}
 
-	// Inefficient since we're doing a find through a list that may have thousands of elements.
-	// This is due for refactoring; we will probably change mPendingDownloads into a set.
-	request_list_t::iterator download_iter = std::find(gAssetStorage->mPendingDownloads.begin(), 
-													   gAssetStorage->mPendingDownloads.end(),
-													   req);
-	// If the LLAssetRequest doesn't exist in the downloads queue, then it either has already been deleted
-	// by _cleanupRequests, or it's a transfer.
-	if (download_iter != gAssetStorage->mPendingDownloads.end())
+	gAssetStorage->_finishDownload(result, file_id, file_type, ext_status);
+}
+
+// static
+void LLAssetStorage::transferCompleteCallback(
+	S32 result,
+	const LLUUID& file_id,
+	LLAssetType::EType file_type,
+	void* user_data, LLExtStat ext_status)
+{
+	lldebugs << "LLAssetStorage::transferCompleteCallback() for " << file_id
+		 << "," << LLAssetType::lookup(file_type) << llendl;
+	U32 download_id = (U32)(intptr_t)user_data;
+	if(!download_id)
+	{
+		llwarns << "LLAssetStorage::transferCompleteCallback called without"
+			"a valid download." << llendl;
+		return;
+	}
+	if (!gAssetStorage)
+	{
+		llwarns << "LLAssetStorage::transferCompleteCallback called without any asset system, aborting!" << llendl;
+		return;
+	}
+
+	// Every request for it timed out while the transfer ran, and the
+	// asset may have been asked for again since. Leave any newer
+	// download and its requests alone.
+	if (!gAssetStorage->mDownloadScheduler.finished(file_id, file_type, download_id))
 	{
-		req->setUUID(file_id);
-		req->setType(file_type);
+		llinfos << "Ignoring late download of " << file_id << "."
+				<< LLAssetType::lookup(file_type) << llendl;
+		return;
 	}
 
+	gAssetStorage->_finishDownload(result, file_id, file_type, ext_status);
+	gAssetStorage->_startQueuedDownloads();
+}
+
+void LLAssetStorage::_finishDownload(S32 result, const LLUUID& file_id,
+									 LLAssetType::EType file_type, LLExtStat ext_status)
+{
 	if (LL_ERR_NOERR == result)
 	{
 		// we might have gotten a zero-size file
-		LLVFile vfile(gAssetStorage->mVFS, req->getUUID(), req->getType());
+		LLVFile vfile(mVFS, file_id, file_type);
 		if (vfile.getSize() <= 0)
 		{
-			llwarns << "downloadCompleteCallback has non-existent or zero-size asset " << req->getUUID() << llendl;
+			llwarns << "downloadCompleteCallback has non-existent or zero-size asset " << file_id << llendl;
 			
 			result = LL_ERR_ASSET_REQUEST_NOT_IN_DATABASE;
 			vfile.remove();
@@ -573,15 +847,15 @@ void LLAssetStorage::downloadCompleteCallback(
 	// SJB: We process the callbacks in reverse order, I do not know if this is important,
 	//      but I didn't want to mess with it.
 	request_list_t requests;
-	for (request_list_t::iterator iter = gAssetStorage->mPendingDownloads.begin();
-		 iter != gAssetStorage->mPendingDownloads.end();  )
+	for (request_list_t::iterator iter = mPendingDownloads.begin();
+		 iter != mPendingDownloads.end();  )
 	{
 		request_list_t::iterator curiter = iter++;
 		LLAssetRequest* tmp = *curiter;
 		if ((tmp->getUUID() == file_id) && (tmp->getType()== file_type))
 		{
 			requests.push_front(tmp);
-			iter = gAssetStorage->mPendingDownloads.erase(curiter);
+			iter = mPendingDownloads.erase(curiter);
 		}
 	}
 	for (request_list_t::iterator iter = requests.begin();
@@ -591,7 +865,7 @@ void LLAssetStorage::downloadCompleteCallback(
 		LLAssetRequest* tmp = *curiter;
 		if (tmp->mDownCallback)
 		{
-			tmp->mDownCallback(gAssetStorage->mVFS, req->getUUID(), req->getType(), tmp->mUserData, result, ext_status);
+			tmp->mDownCallback(mVFS, file_id, file_type, tmp->mUserData, result, ext_status);
 		}
 		delete tmp;
 	}
@@ -34,6 +34,8 @@
 #ifndef LL_LLASSETSTORAGE_H
 #define LL_LLASSETSTORAGE_H
 
+#include <map>
+#include <set>
 #include <string>
 
 #include "lluuid.h"
@@ -201,6 +203,92 @@ public:
 // Map of known bad assets
 typedef std::map<LLUUID,U64,lluuid_less> toxic_asset_map_t;
 
+// How soon an asset download is wanted. Queued downloads start highest
+// priority first, and oldest first within a priority.
+enum EAssetPriority
+{
+	ASSET_PRIORITY_BACKGROUND = 0,	// prefetch, nothing is showing it yet
+	ASSET_PRIORITY_NORMAL,
+	ASSET_PRIORITY_VISIBLE,			// the user can see whatever needs it
+	ASSET_PRIORITY_URGENT,			// the user is waiting on it
+	ASSET_PRIORITY_COUNT
+};
+
+// Schedules asset downloads. There is one entry per asset and type, no
+// matter how many callers asked for it, and at most a set number of
+// downloads run at once. Times are passed in, in seconds.
+class LLAssetRequestScheduler
+{
+public:
+	LLAssetRequestScheduler();
+
+	void setMaxRunning(S32 max_running) { mMaxRunning = max_running; }
+	S32 getMaxRunning() const { return mMaxRunning; }
+
+	// Queues a download. If it is already queued its priority is
+	// raised to priority if that is higher. Returns true if the asset
+	// was not already queued or running.
+	bool queue(const LLUUID& uuid, LLAssetType::EType type, EAssetPriority priority, F64 now);
+
+	// Changes the priority of a queued download, up or down. Returns
+	// false if it is not queued.
+	bool setPriority(const LLUUID& uuid, LLAssetType::EType type, EAssetPriority priority);
+
+	// Drops a download whether queued or running. Returns false if it
+	// was neither.
+	bool remove(const LLUUID& uuid, LLAssetType::EType type);
+
+	// Moves the next queued download to running, if there is a free
+	// slot. Returns an id for the download, or 0 if nothing was started.
+	U32 startNext(LLUUID& uuid, LLAssetType::EType& type, EAssetPriority& priority, F64 now);
+
+	// Frees the slot of a finished download. Returns false if download_id
+	// is not the one running for the asset, eg because it was removed
+	// and the asset asked for again.
+	bool finished(const LLUUID& uuid, LLAssetType::EType type, U32 download_id);
+
+	bool isQueued(const LLUUID& uuid, LLAssetType::EType type) const;
+	bool isRunning(const LLUUID& uuid, LLAssetType::EType type) const;
+
+	S32 getQueuedCount() const { return (S32)mQueued.size(); }
+	S32 getRunningCount() const { return (S32)mRunning.size(); }
+	S32 getQueuedCount(EAssetPriority priority) const;
+
+	// statistics since construction
+	S32 getPeakQueuedCount() const { return mPeakQueuedCount; }
+	U32 getStartedCount() const { return mStartedCount; }
+	F64 getMeanWaitTime() const;
+	F64 getMaxWaitTime() const { return mMaxWaitTime; }
+
+private:
+	typedef std::pair<LLUUID, LLAssetType::EType> asset_key_t;
+	// (-priority, sequence) so the highest priority, oldest entry sorts first
+	typedef std::pair<S32, U32> order_t;
+
+	struct Entry
+	{
+		order_t mOrder;
+		F64 mQueueTime;
+	};
+
+	typedef std::map<asset_key_t, Entry> entry_map_t;
+	typedef std::set<std::pair<order_t, asset_key_t> > order_set_t;
+
+	entry_map_t mQueued;
+	order_set_t mOrder;
+	std::map<asset_key_t, U32> mRunning;	// download ids
+
+	S32 mMaxRunning;
+	U32 mNextSequence;
+	U32 mNextDownloadID;
+	S32 mQueuedCount[ASSET_PRIORITY_COUNT];
+
+	S32 mPeakQueuedCount;
+	U32 mStartedCount;
+	F64 mTotalWaitTime;
+	F64 mMaxWaitTime;
+};
+
 typedef void (*LLGetAssetCallback)(LLVFS *vfs, const LLUUID &asset_id,
 										 LLAssetType::EType asset_type, void *user_data, S32 status, LLExtStat ext_status);
 
@@ -241,6 +329,10 @@ protected:
 	request_list_t mPendingDownloads;
 	request_list_t mPendingUploads;
 	request_list_t mPendingLocalUploads;
+
+	// Which downloads in mPendingDownloads are running, and the order
+	// the rest start in.
+	LLAssetRequestScheduler mDownloadScheduler;
 	
 	// Map of toxic assets - these caused problems when recently rezzed, so avoid them
 	toxic_asset_map_t	mToxicAssetMap;		// Objects in this list are known to cause problems and are not loaded
@@ -262,6 +354,23 @@ public:
 
 	virtual void getAssetData(const LLUUID uuid, LLAssetType::EType atype, LLGetAssetCallback cb, void *user_data, BOOL is_priority = FALSE);
 
+	// As above, but scheduled at the given priority rather than normal
+	// or, for is_priority, urgent.
+	virtual void getAssetData(const LLUUID uuid, LLAssetType::EType atype, LLGetAssetCallback cb, void *user_data, EAssetPriority priority);
+
+	// Raise or lower a download which has not started yet, eg when
+	// what needs it scrolls into or out of view. Returns false if the
+	// download is not queued.
+	bool setAssetPriority(const LLUUID& uuid, LLAssetType::EType atype, EAssetPriority priority);
+
+	// Forget a request without calling its callback. The download is
+	// dropped as well if it has not started and no one else wants it.
+	void cancelAssetRequest(const LLUUID& uuid, LLAssetType::EType atype, LLGetAssetCallback cb, void *user_data);
+
+	// Most asset downloads to have in progress at once.
+	void setMaxRunningDownloads(S32 max_running);
+	const LLAssetRequestScheduler& getDownloadScheduler() const { return mDownloadScheduler; }
+
 	/*
 	 * TransactionID version
 	 * Viewer needs the store_local
@@ -363,6 +472,12 @@ public:
 		const LLUUID& file_id,
 		LLAssetType::EType file_type,
 		void* user_data, LLExtStat ext_status);
+	// Scheduled transfers, user_data is the download id from the scheduler
+	static void transferCompleteCallback(
+		S32 result,
+		const LLUUID& file_id,
+		LLAssetType::EType file_type,
+		void* user_data, LLExtStat ext_status);
 	static void downloadEstateAssetCompleteCallback(
 		S32 result,
 		const LLUUID& file_id,
@@ -436,7 +551,14 @@ protected:
 	virtual void _queueDataRequest(const LLUUID& uuid, LLAssetType::EType type,
 								   void (*callback)(LLVFS *vfs, const LLUUID&, LLAssetType::EType, void *, S32, LLExtStat),
 								   void *user_data, BOOL duplicate,
-								   BOOL is_priority);
+								   EAssetPriority priority);
+
+	// Start scheduled downloads while there are free slots.
+	void _startQueuedDownloads();
+
+	// Calls back and deletes every pending request for the asset.
+	void _finishDownload(S32 result, const LLUUID& file_id,
+						 LLAssetType::EType file_type, LLExtStat ext_status);
 
 private:
 	void _init(LLMessageSystem *msg,
@@ -35,9 +35,93 @@
 #include "linden_common.h"
 #include "llbuffer.h"
 
+#include "llapr.h"
 #include "llmath.h"
 #include "llmemtype.h"
 #include "llstl.h"
+#include "llthread.h"
+
+// Heap buffers are sized 16k unless asked otherwise, and buffer arrays
+// grow theirs by doubling up to 1M.
+static const S32 DEFAULT_HEAP_BUFFER_SIZE = 16384;
+static const S32 MAX_GROWN_HEAP_BUFFER_SIZE = 1024 * 1024;
+
+// Heap buffer memory is pooled in power of two size classes from 1k
+// to 1M. Buffers under 512 bytes or over 1M go straight to the heap.
+// Each class keeps at most MAX_POOLED_BYTES_PER_CLASS of free blocks.
+static const S32 MIN_POOLED_BLOCK_SHIFT = 10;
+static const S32 MAX_POOLED_BLOCK_SHIFT = 20;
+static const S32 POOLED_BLOCK_CLASSES =
+	MAX_POOLED_BLOCK_SHIFT - MIN_POOLED_BLOCK_SHIFT + 1;
+static const S32 MAX_POOLED_BYTES_PER_CLASS = 2 * 1024 * 1024;
+
+// The mutex is never deleted, since threads may still be releasing
+// buffers when the pool is turned off. sBlockPoolEnabled is checked
+// once without the lock to skip it when pooling is off, and again
+// under the lock before touching the free lists.
+static LLMutex* sBlockPoolMutex = NULL;
+static LLAtomicU32 sBlockPoolEnabled;
+static std::vector<U8*> sFreeBlocks[POOLED_BLOCK_CLASSES];
+static LLAtomicU32 sHeapAllocationCount;
+
+// Returns the size class for a block of at least size bytes, or -1 if
+// the block is not pooled.
+static S32 ll_block_class(S32 size)
+{
+	if((size < (1 << (MIN_POOLED_BLOCK_SHIFT - 1)))
+	   || (size > (1 << MAX_POOLED_BLOCK_SHIFT)))
+	{
+		return -1;
+	}
+	S32 block_class = 0;
+	while((1 << (block_class + MIN_POOLED_BLOCK_SHIFT)) < size)
+	{
+		++block_class;
+	}
+	return block_class;
+}
+
+static U8* ll_allocate_block(S32 size)
+{
+	S32 block_class = ll_block_class(size);
+	if(block_class >= 0)
+	{
+		if(sBlockPoolEnabled)
+		{
+			LLMutexLock lock(sBlockPoolMutex);
+			std::vector<U8*>& blocks = sFreeBlocks[block_class];
+			if(sBlockPoolEnabled && !blocks.empty())
+			{
+				U8* block = blocks.back();
+				blocks.pop_back();
+				return block;
+			}
+		}
+		// always allocate the whole class, since the block may be
+		// released after pooling is turned on.
+		size = 1 << (block_class + MIN_POOLED_BLOCK_SHIFT);
+	}
+	sHeapAllocationCount++;
+	return new U8[size];
+}
+
+static void ll_release_block(U8* block, S32 size)
+{
+	S32 block_class = sBlockPoolEnabled ? ll_block_class(size) : -1;
+	if(block_class >= 0)
+	{
+		LLMutexLock lock(sBlockPoolMutex);
+		std::vector<U8*>& blocks = sFreeBlocks[block_class];
+		S32 block_size = 1 << (block_class + MIN_POOLED_BLOCK_SHIFT);
+		if(sBlockPoolEnabled
+		   && (S32)blocks.size() * block_size < MAX_POOLED_BYTES_PER_CLASS)
+		{
+			blocks.push_back(block);
+			return;
+		}
+	}
+	delete[] block;
+}
 
 /** 
  * LLSegment
@@ -108,7 +192,6 @@ LLHeapBuffer::LLHeapBuffer() :
 	mReclaimedBytes(0)
 {
 	LLMemType m1(LLMemType::MTYPE_IO_BUFFER);
-	const S32 DEFAULT_HEAP_BUFFER_SIZE = 16384;
 	allocate(DEFAULT_HEAP_BUFFER_SIZE);
 }
 
@@ -143,7 +226,10 @@ LLHeapBuffer::LLHeapBuffer(const U8* src, S32 len) :
 LLHeapBuffer::~LLHeapBuffer()
 {
 	LLMemType m1(LLMemType::MTYPE_IO_BUFFER);
-	delete[] mBuffer;
+	if(mBuffer)
+	{
+		ll_release_block(mBuffer, mSize);
+	}
 	mBuffer = NULL;
 	mSize = 0;
 	mNextFree = NULL;
@@ -217,7 +303,7 @@ void LLHeapBuffer::allocate(S32 size)
 {
 	LLMemType m1(LLMemType::MTYPE_IO_BUFFER);
 	mReclaimedBytes = 0;	
-	mBuffer = new U8[size];
+	mBuffer = ll_allocate_block(size);
 	if(mBuffer)
 	{
 		mSize = size;
@@ -225,6 +311,64 @@ void LLHeapBuffer::allocate(S32 size)
 	}
 }
 
+// static
+void LLHeapBuffer::initClass()
+{
+	if(!sBlockPoolMutex)
+	{
+		sBlockPoolMutex = new LLMutex(NULL);
+	}
+	sBlockPoolEnabled = 1;
+}
+
+// static
+void LLHeapBuffer::cleanupClass()
+{
+	if(!sBlockPoolMutex)
+	{
+		return;
+	}
+	LLMutexLock lock(sBlockPoolMutex);
+	sBlockPoolEnabled = 0;
+	for(S32 i = 0; i < POOLED_BLOCK_CLASSES; ++i)
+	{
+		std::for_each(
+			sFreeBlocks[i].begin(),
+			sFreeBlocks[i].end(),
+			DeleteArrayFunctor<U8>());
+		sFreeBlocks[i].clear();
+	}
+}
+
+// static
+U32 LLHeapBuffer::getHeapAllocationCount()
+{
+	return sHeapAllocationCount;
+}
+
+
+// Orders segment index entries by start address.
+struct ll_segment_index_less
+{
+	bool operator()(
+		const std::pair<U8*, LLBufferArray::segment_iterator_t>& lhs,
+		const std::pair<U8*, LLBufferArray::segment_iterator_t>& rhs) const
+	{
+		return lhs.first < rhs.first;
+	}
+	bool operator()(
+		const std::pair<U8*, LLBufferArray::segment_iterator_t>& lhs,
+		const U8* rhs) const
+	{
+		return lhs.first < rhs;
+	}
+	bool operator()(
+		const U8* lhs,
+		const std::pair<U8*, LLBufferArray::segment_iterator_t>& rhs) const
+	{
+		return lhs < rhs.first;
+	}
+};
 
 /** 
  * LLBufferArray
@@ -273,7 +417,31 @@ bool LLBufferArray::append(S32 channel, const U8* src, S32 len)
 	std::vector<LLSegment> segments;
 	if(copyIntoBuffers(channel, src, len, segments))
 	{
-		mSegments.insert(mSegments.end(), segments.begin(), segments.end());
+		std::vector<LLSegment>::iterator first = segments.begin();
+		if(!mSegments.empty())
+		{
+			// Grow the last segment instead of adding one when the new
+			// data continues it, which is the usual case for a body
+			// arriving a chunk at a time.
+			LLSegment& last = mSegments.back();
+			if(last.isOnChannel(channel)
+			   && ((last.data() + last.size()) == (*first).data()))
+			{
+				LLSegment merged(
+					channel,
+					last.data(),
+					last.size() + (*first).size());
+				if(getBufferContaining(merged))
+				{
+					last = merged;
+					++first;
+				}
+			}
+		}
+		for(; first != segments.end(); ++first)
+		{
+			indexSegment(mSegments.insert(mSegments.end(), *first));
+		}
 		return true;
 	}
 	return false;
@@ -285,7 +453,12 @@ bool LLBufferArray::prepend(S32 channel, const U8* src, S32 len)
 	std::vector<LLSegment> segments;
 	if(copyIntoBuffers(channel, src, len, segments))
 	{
-		mSegments.insert(mSegments.begin(), segments.begin(), segments.end());
+		segment_iterator_t pos = mSegments.begin();
+		std::vector<LLSegment>::iterator it = segments.begin();
+		for(; it != segments.end(); ++it)
+		{
+			indexSegment(mSegments.insert(pos, *it));
+		}
 		return true;
 	}
 	return false;
@@ -305,7 +478,11 @@ bool LLBufferArray::insertAfter(
 	}
 	if(copyIntoBuffers(channel, src, len, segments))
 	{
-		mSegments.insert(segment, segments.begin(), segments.end());
+		std::vector<LLSegment>::iterator it = segments.begin();
+		for(; it != segments.end(); ++it)
+		{
+			indexSegment(mSegments.insert(segment, *it));
+		}
 		return true;
 	}
 	return false;
@@ -337,7 +514,7 @@ LLBufferArray::segment_iterator_t LLBufferArray::splitAfter(U8* address)
 	segment_iterator_t rv = it;
 	++it;
 	LLSegment segment2(channel, address + 1, size - (address - base) - 1);
-	mSegments.insert(it, segment2);
+	indexSegment(mSegments.insert(it, segment2));
 	return rv;
 }
 							   
@@ -368,29 +545,25 @@ LLBufferArray::segment_iterator_t LLBufferArray::constructSegmentAfter(
 	else
 	{
 		// we have an address - find the segment it is in.
-		for( ; rv != end; ++rv)
+		rv = getSegment(address);
+		if(rv != end)
 		{
-			if((address >= (*rv).data())
-			   && (address < ((*rv).data() + (*rv).size())))
+			if((++address) < ((*rv).data() + (*rv).size()))
 			{
-				if((++address) < ((*rv).data() + (*rv).size()))
-				{
-					// it's in this segment - construct an appropriate
-					// sub-segment.
-					segment = LLSegment(
-						(*rv).getChannel(),
-						address,
-						(*rv).size() - (address - (*rv).data()));
-				}
-				else
+				// it's in this segment - construct an appropriate
+				// sub-segment.
+				segment = LLSegment(
+					(*rv).getChannel(),
+					address,
+					(*rv).size() - (address - (*rv).data()));
+			}
+			else
+			{
+				++rv;
+				if(rv != end)
 				{
-					++rv;
-					if(rv != end)
-					{
-						segment = (*rv);
-					}
+					segment = (*rv);
 				}
-				break;
 			}
 		}
 	}
@@ -403,42 +576,23 @@ LLBufferArray::segment_iterator_t LLBufferArray::constructSegmentAfter(
 
 LLBufferArray::segment_iterator_t LLBufferArray::getSegment(U8* address)
 {
-	segment_iterator_t end = mSegments.end();
-	if(!address)
-	{
-		return end;
-	}
-	segment_iterator_t it = mSegments.begin();
-	for( ; it != end; ++it)
+	segment_index_t::const_iterator entry = findIndexEntry(address);
+	if(entry == mSegmentIndex.end())
 	{
-		if((address >= (*it).data())&&(address < (*it).data() + (*it).size()))
-		{
-			// found it.
-			return it;
-		}
+		return mSegments.end();
 	}
-	return end;
+	return (*entry).second;
 }
 
 LLBufferArray::const_segment_iterator_t LLBufferArray::getSegment(
 	U8* address) const
 {
-	const_segment_iterator_t end = mSegments.end();
-	if(!address)
+	segment_index_t::const_iterator entry = findIndexEntry(address);
+	if(entry == mSegmentIndex.end())
 	{
-		return end;
+		return mSegments.end();
 	}
-	const_segment_iterator_t it = mSegments.begin();
-	for( ; it != end; ++it)
-	{
-		if((address >= (*it).data())
-		   && (address < (*it).data() + (*it).size()))
-		{
-			// found it.
-			return it;
-		}
-	}
-	return end;
+	return (*entry).second;
 }
 
 /*
@@ -723,11 +877,13 @@ bool LLBufferArray::takeContents(LLBufferArray& source)
 		source.mBuffers.end(),
 		std::back_insert_iterator<buffer_list_t>(mBuffers));
 	source.mBuffers.clear();
-	std::copy(
-		source.mSegments.begin(),
-		source.mSegments.end(),
-		std::back_insert_iterator<segment_list_t>(mSegments));
+	segment_iterator_t it = source.mSegments.begin();
+	for(; it != source.mSegments.end(); ++it)
+	{
+		indexSegment(mSegments.insert(mSegments.end(), *it));
+	}
 	source.mSegments.clear();
+	source.mSegmentIndex.clear();
 	source.mNextBaseChannel = 0;
 	return true;
 }
@@ -754,8 +910,7 @@ LLBufferArray::segment_iterator_t LLBufferArray::makeSegment(
 	segment_iterator_t send = mSegments.end();
 	if(!made_segment)
 	{
-		LLBuffer* buf = new LLHeapBuffer;
-		mBuffers.push_back(buf);
+		LLBuffer* buf = addBuffer();
 		if(!buf->createSegment(channel, len, segment))
 		{
 			// failed. this should never happen.
@@ -764,10 +919,8 @@ LLBufferArray::segment_iterator_t LLBufferArray::makeSegment(
 	}
 
 	// store and return the newly made segment
-	mSegments.insert(send, segment);
-	std::list<LLSegment>::reverse_iterator rv = mSegments.rbegin();
-	++rv;
-	send = rv.base();
+	send = mSegments.insert(send, segment);
+	indexSegment(send);
 	return send;
 }
 
@@ -794,6 +947,7 @@ bool LLBufferArray::eraseSegment(const segment_iterator_t& erase_iter)
 
 	// No need to get the return value since we are not interested in
 	// the interator retured by the call.
+	unindexSegment(erase_iter);
 	(void)mSegments.erase(erase_iter);
 	return rv;
 }
@@ -830,8 +984,7 @@ bool LLBufferArray::copyIntoBuffers(
 	}
 	while(len)
 	{
-		LLBuffer* buf = new LLHeapBuffer;
-		mBuffers.push_back(buf);
+		LLBuffer* buf = addBuffer();
 		if(!buf->createSegment(channel, len, segment))
 		{
 			// this totally failed - bail. This is the weird corner
@@ -848,3 +1001,171 @@ bool LLBufferArray::copyIntoBuffers(
 	}
 	return true;
 }
+
+LLBuffer* LLBufferArray::addBuffer()
+{
+	LLMemType m1(LLMemType::MTYPE_IO_BUFFER);
+	S32 size = llclamp(
+		capacity(),
+		DEFAULT_HEAP_BUFFER_SIZE,
+		MAX_GROWN_HEAP_BUFFER_SIZE);
+	LLBuffer* buf = new LLHeapBuffer(size);
+	mBuffers.push_back(buf);
+	return buf;
+}
+
+LLBuffer* LLBufferArray::getBufferContaining(const LLSegment& segment) const
+{
+	// the newest buffers are the most likely to hold recent segments.
+	buffer_list_t::const_reverse_iterator it = mBuffers.rbegin();
+	buffer_list_t::const_reverse_iterator end = mBuffers.rend();
+	for(; it != end; ++it)
+	{
+		if((*it)->containsSegment(segment))
+		{
+			return *it;
+		}
+	}
+	return NULL;
+}
+
+U8* LLBufferArray::makeContiguous(S32 channel, S32& len)
+{
+	LLMemType m1(LLMemType::MTYPE_IO_BUFFER);
+	len = 0;
+	U8* start = NULL;
+	bool contiguous = true;
+	segment_iterator_t first = mSegments.end();
+	segment_iterator_t it = mSegments.begin();
+	segment_iterator_t end = mSegments.end();
+	for(; it != end; ++it)
+	{
+		if(!(*it).isOnChannel(channel))
+		{
+			continue;
+		}
+		if(first == end)
+		{
+			first = it;
+			start = (*it).data();
+		}
+		else if((start + len) != (*it).data())
+		{
+			contiguous = false;
+		}
+		len += (*it).size();
+	}
+	if(!len)
+	{
+		return NULL;
+	}
+	if(contiguous && getBufferContaining(LLSegment(channel, start, len)))
+	{
+		return start;
+	}
+
+	// Copy the channel into one buffer sized to fit, and swap its
+	// segments for a single segment where the first one was.
+	LLBuffer* buf = new LLHeapBuffer(len);
+	mBuffers.push_back(buf);
+	LLSegment segment;
+	if(!buf->createSegment(channel, len, segment))
+	{
+		// this should never happen.
+		len = 0;
+		return NULL;
+	}
+	U8* dest = segment.data();
+	it = first;
+	while(it != end)
+	{
+		if(!(*it).isOnChannel(channel))
+		{
+			++it;
+			continue;
+		}
+		memcpy(dest, (*it).data(), (*it).size());	/*Flawfinder: ignore*/
+		dest += (*it).size();
+		if(it == first)
+		{
+			// keep the list position of the first segment.
+			++it;
+			continue;
+		}
+		eraseSegment(it++);
+	}
+	LLSegment old_first(*first);
+	for(buffer_iterator_t bit = mBuffers.begin(); bit != mBuffers.end(); ++bit)
+	{
+		if((*bit)->reclaimSegment(old_first))
+		{
+			break;
+		}
+	}
+	unindexSegment(first);
+	*first = segment;
+	indexSegment(first);
+	return segment.data();
+}
+
+void LLBufferArray::indexSegment(const segment_iterator_t& iter)
+{
+	segment_index_entry_t entry((*iter).data(), iter);
+	mSegmentIndex.insert(
+		std::upper_bound(
+			mSegmentIndex.begin(),
+			mSegmentIndex.end(),
+			entry,
+			ll_segment_index_less()),
+		entry);
+}
+
+void LLBufferArray::unindexSegment(const segment_iterator_t& iter)
+{
+	segment_index_t::iterator it = std::lower_bound(
+		mSegmentIndex.begin(),
+		mSegmentIndex.end(),
+		(*iter).data(),
+		ll_segment_index_less());
+	for(; (it != mSegmentIndex.end()) && ((*it).first == (*iter).data()); ++it)
+	{
+		if((*it).second == iter)
+		{
+			mSegmentIndex.erase(it);
+			return;
+		}
+	}
+	llwarns << "Segment missing from the buffer array index." << llendl;
+}
+
+LLBufferArray::segment_index_t::const_iterator LLBufferArray::findIndexEntry(
+	U8* address) const
+{
+	if(!address)
+	{
+		return mSegmentIndex.end();
+	}
+
+	// Step back from the first segment starting after address. Empty
+	// segments can share a start address with the one holding it, but
+	// a non-empty segment that ends first means no segment holds it.
+	segment_index_t::const_iterator it = std::upper_bound(
+		mSegmentIndex.begin(),
+		mSegmentIndex.end(),
+		address,
+		ll_segment_index_less());
+	while(it != mSegmentIndex.begin())
+	{
+		--it;
+		const LLSegment& segment = *((*it).second);
+		if(address < (segment.data() + segment.size()))
+		{
+			return it;
+		}
+		if(segment.size())
+		{
+			break;
+		}
+	}
+	return mSegmentIndex.end();
+}
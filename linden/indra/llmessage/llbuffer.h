@@ -199,6 +199,11 @@ public:
  * This class is a simple buffer implementation which allocates chunks
  * off the heap. Once a buffer is constructed, it's buffer has a fixed
  * length.
+ *
+ * After <code>initClass()</code>, the memory comes from a shared pool
+ * of blocks in power of two size classes, and goes back to it when the
+ * buffer is destroyed, so short lived buffer arrays stop hitting the
+ * heap for every buffer.
  */
 class LLHeapBuffer : public LLBuffer
 {
@@ -281,6 +286,26 @@ public:
 	 */
 	virtual S32 capacity() const { return mSize; }
 
+	/** 
+	 * @brief Set up the pool heap buffers take their memory from.
+	 *
+	 * Until this is called, and after <code>cleanupClass()</code>,
+	 * buffers allocate and free straight from the heap.
+	 */
+	static void initClass();
+
+	/** 
+	 * @brief Free the pooled blocks and stop pooling.
+	 */
+	static void cleanupClass();
+
+	/** 
+	 * @brief Get the number of blocks allocated from the heap so far.
+	 *
+	 * Blocks reused from the pool are not counted.
+	 */
+	static U32 getHeapAllocationCount();
+
 protected:
 	U8* mBuffer;
 	S32 mSize;
@@ -361,7 +386,9 @@ public:
 	 * @brief Put data on a channel at the end of this buffer array.
 	 *
 	 * The data is copied from src into the buffer array. At least one
-	 * new segment is created and put on the end of the array. This
+	 * new segment is created and put on the end of the array, unless
+	 * the data lands right after the last segment on the same channel
+	 * in the same buffer, in which case that segment just grows. This
 	 * object will internally allocate new buffers if necessary.
 	 * @param channel The channel for this data
 	 * @param src The start of memory for the data to be copied
@@ -442,6 +469,22 @@ public:
 	 * @return Returns the address of the last read byte.
 	 */
 	U8* readAfter(S32 channel, U8* start, U8* dest, S32& len) const;
+
+	/** 
+	 * @brief Get all the bytes on a channel as one piece of memory.
+	 *
+	 * This is for handing a whole body to a parser. If the channel is
+	 * already contiguous in one buffer, nothing is copied. Otherwise
+	 * the channel data is copied once into a new buffer and the
+	 * channel's segments are replaced with a single segment, so the
+	 * next call is free. The memory stays valid until the segment is
+	 * erased or the buffer array is destroyed.
+	 * @param channel The channel to read.
+	 * @param len[out] The number of bytes on the channel.
+	 * @return Returns the first byte on the channel, or NULL if the
+	 * channel is empty.
+	 */
+	U8* makeContiguous(S32 channel, S32& len);
  
 	/** 
 	 * @brief Find an address in a buffer array
@@ -597,10 +640,56 @@ protected:
 		S32 len,
 		std::vector<LLSegment>& segments);
 
+	/** 
+	 * @brief Add a heap buffer sized for the growth of this array.
+	 *
+	 * New buffers double with the capacity of the array up to a
+	 * ceiling, so a large body ends up in a handful of big buffers
+	 * rather than one per default sized chunk.
+	 * @return Returns the new buffer, already in the buffer list.
+	 */
+	LLBuffer* addBuffer();
+
+	/** 
+	 * @brief Find the buffer which holds an entire segment.
+	 *
+	 * @return Returns the buffer or NULL if no single buffer does.
+	 */
+	LLBuffer* getBufferContaining(const LLSegment& segment) const;
+
+	/** 
+	 * @brief The segments sorted by start address.
+	 *
+	 * Segments never overlap, so the one holding an address is found
+	 * with a binary search instead of a walk along the list.
+	 */
+	typedef std::pair<U8*, segment_iterator_t> segment_index_entry_t;
+	typedef std::vector<segment_index_entry_t> segment_index_t;
+
+	/** 
+	 * @brief Add a segment already in the list to the index.
+	 */
+	void indexSegment(const segment_iterator_t& iter);
+
+	/** 
+	 * @brief Remove a segment from the index before it leaves the list
+	 * or changes its start address.
+	 */
+	void unindexSegment(const segment_iterator_t& iter);
+
+	/** 
+	 * @brief Find the index entry for the segment which holds address.
+	 *
+	 * @return Returns the entry or mSegmentIndex.end() if no segment
+	 * holds it.
+	 */
+	segment_index_t::const_iterator findIndexEntry(U8* address) const;
+
 protected:
 	S32 mNextBaseChannel;
 	buffer_list_t mBuffers;
 	segment_list_t mSegments;
+	segment_index_t mSegmentIndex;
 };
 
 #endif // LL_LLBUFFER_H
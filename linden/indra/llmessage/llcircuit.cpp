@@ -69,6 +69,7 @@ const S32 PING_RELEASE_BLOCK = 2;	// How many pings behind we have to be to cons
 const F32 TARGET_PERIOD_LENGTH = 5.f;	// seconds
 const F32 LL_DUPLICATE_SUPPRESSION_TIMEOUT = 60.f; //seconds - this can be long, as time-based cleanup is
 													// only done when wrapping packetids, now...
+const U32 LL_MAX_RECEIVED_PACKET_SPAN = 65536;	// packet IDs of incoming packets we keep track of
 
 LLCircuitData::LLCircuitData(const LLHost &host, TPACKETID in_id, 
 							 const F32 circuit_heartbeat_interval, const F32 circuit_timeout)
@@ -89,6 +90,8 @@ LLCircuitData::LLCircuitData(const LLHost &host, TPACKETID in_id,
 	mLastPingID(0),
 	mPingDelay(INITIAL_PING_VALUE_MSEC), 
 	mPingDelayAveraged((F32)INITIAL_PING_VALUE_MSEC), 
+	mPotentialLostPackets(LL_MAX_RECEIVED_PACKET_SPAN),
+	mRecentlyReceivedReliablePackets(LL_MAX_RECEIVED_PACKET_SPAN),
 	mUnackedPacketCount(0),
 	mUnackedPacketBytes(0),
 	mLocalEndPointID(),
@@ -137,11 +140,12 @@ LLCircuitData::~LLCircuitData()
 
 	// remove all pending reliable messages on this circuit
 	std::vector<TPACKETID> doomed;
-	reliable_iter iter;
-	reliable_iter end = mUnackedPackets.end();
-	for(iter = mUnackedPackets.begin(); iter != end; ++iter)
+	LLReliablePacket **packetpp;
+	TPACKETID id = mUnackedPackets.oldest();
+	while ((packetpp = mUnackedPackets.findFrom(id)))
 	{
-		packetp = iter->second;
+		packetp = *packetpp;
+		id = ll_next_packet_id(id);
 		gMessageSystem->mFailedResendPackets++;
 		if(gMessageSystem->mVerboseLog)
 		{
@@ -159,11 +163,14 @@ LLCircuitData::~LLCircuitData()
 		delete packetp;
 	}
 
+	mUnackedPackets.clear();
+
 	// remove all pending final retry reliable messages on this circuit
-	end = mFinalRetryPackets.end();
-	for(iter = mFinalRetryPackets.begin(); iter != end; ++iter)
+	id = mFinalRetryPackets.oldest();
+	while ((packetpp = mFinalRetryPackets.findFrom(id)))
 	{
-		packetp = iter->second;
+		packetp = *packetpp;
+		id = ll_next_packet_id(id);
 		gMessageSystem->mFailedResendPackets++;
 		if(gMessageSystem->mVerboseLog)
 		{
@@ -180,6 +187,7 @@ LLCircuitData::~LLCircuitData()
 
 		delete packetp;
 	}
+	mFinalRetryPackets.clear();
 
 	// log aborted reliable packets for this circuit.
 	if(gMessageSystem->mVerboseLog && !doomed.empty())
@@ -195,13 +203,15 @@ LLCircuitData::~LLCircuitData()
 
 void LLCircuitData::ackReliablePacket(TPACKETID packet_num)
 {
-	reliable_iter iter;
+	LLReliablePacket **packetpp;
 	LLReliablePacket *packetp;
 
-	iter = mUnackedPackets.find(packet_num);
-	if (iter != mUnackedPackets.end())
+	packetpp = mUnackedPackets.find(packet_num);
+	if (packetpp)
 	{
-		packetp = iter->second;
+		// Take it off the list first, the callback may send more.
+		packetp = *packetpp;
+		mUnackedPackets.erase(packet_num);
 
 		if(gMessageSystem->mVerboseLog)
 		{
@@ -228,14 +238,14 @@ void LLCircuitData::ackReliablePacket(TPACKETID packet_num)
 
 		// Cleanup
 		delete packetp;
-		mUnackedPackets.erase(iter);
 		return;
 	}
 
-	iter = mFinalRetryPackets.find(packet_num);
-	if (iter != mFinalRetryPackets.end())
+	packetpp = mFinalRetryPackets.find(packet_num);
+	if (packetpp)
 	{
-		packetp = iter->second;
+		packetp = *packetpp;
+		mFinalRetryPackets.erase(packet_num);
 		// llinfos << "Packet " << packet_num << " removed from the pending list" << llendl;
 		if(gMessageSystem->mVerboseLog)
 		{
@@ -262,7 +272,6 @@ void LLCircuitData::ackReliablePacket(TPACKETID packet_num)
 
 		// Cleanup
 		delete packetp;
-		mFinalRetryPackets.erase(iter);
 	}
 	else
 	{
@@ -279,18 +288,14 @@ S32 LLCircuitData::resendUnackedPackets(const F64 now)
 	LLReliablePacket *packetp;
 
 
-	//
-	// Theoretically we should search through the list for the packet with the oldest
-	// packet ID, as otherwise when we WRAP we will resend reliable packets out of order.
-	// Since resends are ALREADY out of order, and wrapping is highly rare (16+million packets),
-	// I'm not going to worry about this for now - djs
-	//
-
-	reliable_iter iter;
+	// Walk the unacked packets oldest first, which the window keeps
+	// straight even when packet IDs wrap.
+	LLReliablePacket **packetpp;
+	TPACKETID id = mUnackedPackets.oldest();
 	BOOL have_resend_overflow = FALSE;
-	for (iter = mUnackedPackets.begin(); iter != mUnackedPackets.end();)
+	for (; (packetpp = mUnackedPackets.findFrom(id)); id = ll_next_packet_id(id))
 	{
-		packetp = iter->second;
+		packetp = *packetpp;
 
 		// Only check overflow if we haven't had one yet.
 		if (!have_resend_overflow)
@@ -311,12 +316,8 @@ S32 LLCircuitData::resendUnackedPackets(const F64 now)
 					// This circuit has overflowed.  Do not retry.  Do not pass go.
 					packetp->mRetries = 0;
 					// Remove it from this list and add it to the final list.
-					mUnackedPackets.erase(iter++);
-					mFinalRetryPackets[packetp->mPacketID] = packetp;
-				}
-				else
-				{
-					++iter;
+					mUnackedPackets.erase(id);
+					mFinalRetryPackets.insert(id, packetp);
 				}
 				// Move on to the next unacked packet.
 				continue;
@@ -371,27 +372,19 @@ S32 LLCircuitData::resendUnackedPackets(const F64 now)
 			if (!packetp->mRetries)
 			{
 				// Last resend, remove it from this list and add it to the final list.
-				mUnackedPackets.erase(iter++);
-				mFinalRetryPackets[packetp->mPacketID] = packetp;
-			}
-			else
-			{
-				// Don't remove it yet, it still gets to try to resend at least once.
-				++iter;
+				// Otherwise it still gets to try to resend at least once.
+				mUnackedPackets.erase(id);
+				mFinalRetryPackets.insert(id, packetp);
 			}
 			resent_packets++;
 		}
-		else
-		{
-			// Don't need to do anything with this packet, keep iterating.
-			++iter;
-		}
 	}
 
 
-	for (iter = mFinalRetryPackets.begin(); iter != mFinalRetryPackets.end();)
+	id = mFinalRetryPackets.oldest();
+	for (; (packetpp = mFinalRetryPackets.findFrom(id)); id = ll_next_packet_id(id))
 	{
-		packetp = iter->second;
+		packetp = *packetpp;
 		if (now > packetp->mExpirationTime)
 		{
 			// fail (too many retries)
@@ -419,13 +412,9 @@ S32 LLCircuitData::resendUnackedPackets(const F64 now)
 			mUnackedPacketCount--;
 			mUnackedPacketBytes -= packetp->mBufferLength;
 
-			mFinalRetryPackets.erase(iter++);
+			mFinalRetryPackets.erase(id);
 			delete packetp;
 		}
-		else
-		{
-			++iter;
-		}
 	}
 
 	return mUnackedPacketCount;
@@ -578,11 +567,11 @@ void LLCircuitData::addReliablePacket(S32 mSocket, U8 *buf_ptr, S32 buf_len, LLR
 
 	if (params && params->mRetries)
 	{
-		mUnackedPackets[packet_info->mPacketID] = packet_info;
+		mUnackedPackets.insert(packet_info->mPacketID, packet_info);
 	}
 	else
 	{
-		mFinalRetryPackets[packet_info->mPacketID] = packet_info;
+		mFinalRetryPackets.insert(packet_info->mPacketID, packet_info);
 	}
 }
 
@@ -606,7 +595,7 @@ void LLCircuit::resendUnackedPackets(S32& unacked_list_length, S32& unacked_list
 
 BOOL LLCircuitData::isDuplicateResend(TPACKETID packetnum)
 {
-	return (mRecentlyReceivedReliablePackets.find(packetnum) != mRecentlyReceivedReliablePackets.end());
+	return (mRecentlyReceivedReliablePackets.find(packetnum) != NULL);
 }
 
 
@@ -717,7 +706,7 @@ void LLCircuitData::checkPacketInID(TPACKETID id, BOOL receive_resent)
 		const U8 width = 24;
 		gap = LLModularMath::subtract<width>(mPacketsInID, id);
 
-		if (mPotentialLostPackets.find(id) != mPotentialLostPackets.end())
+		if (mPotentialLostPackets.find(id))
 		{
 			if(gMessageSystem->mVerboseLog)
 			{
@@ -746,7 +735,7 @@ void LLCircuitData::checkPacketInID(TPACKETID id, BOOL receive_resent)
 					}
 
 //						llinfos << "adding potential lost: " << index << llendl;
-					mPotentialLostPackets[index] = time;
+					mPotentialLostPackets.insert(index, time);
 					index++;
 					index = index % LL_MAX_OUT_PACKET_ID;
 					gap_count++;
@@ -867,93 +856,24 @@ BOOL LLCircuitData::updateWatchDogTimers(LLMessageSystem *msgsys)
 	// for the packet that it was out of order with was received BEFORE
 	// the ping was sent.
 
-	// Find the current oldest reliable packetID
-	// This is to handle the case if we actually manage to wrap our
-	// packet IDs - the oldest will actually have a higher packet ID
-	// than the current.
-	BOOL wrapped = FALSE;
-	reliable_iter iter;
-	iter = mUnackedPackets.upper_bound(getPacketOutID());
-	if (iter == mUnackedPackets.end())
+	// Find the current oldest reliable packetID.  Each window knows
+	// its own oldest even across a wrap, so we only need to pick the one
+	// further behind the current packet ID.
+	TPACKETID packet_id = getPacketOutID();
+	U32 oldest_age = 0;
+	if (!mUnackedPackets.empty())
 	{
-		// Nothing AFTER this one, so we want the lowest packet ID
-		// then.
-		iter = mUnackedPackets.begin();
-		wrapped = TRUE;
+		packet_id = mUnackedPackets.oldest();
+		oldest_age = (getPacketOutID() - packet_id) & LL_PACKET_ID_MASK;
 	}
-
-	TPACKETID packet_id = 0;
-
-	// Check against the "final" packets
-	BOOL wrapped_final = FALSE;
-	reliable_iter iter_final;
-	iter_final = mFinalRetryPackets.upper_bound(getPacketOutID());
-	if (iter_final == mFinalRetryPackets.end())
+	if (!mFinalRetryPackets.empty()
+		&& (((getPacketOutID() - mFinalRetryPackets.oldest()) & LL_PACKET_ID_MASK) >= oldest_age))
 	{
-		iter_final = mFinalRetryPackets.begin();
-		wrapped_final = TRUE;
-	}
-
-	//llinfos << mHost << " - unacked count " << mUnackedPackets.size() << llendl;
-	//llinfos << mHost << " - final count " << mFinalRetryPackets.size() << llendl;
-	if (wrapped != wrapped_final)
-	{
-		// One of the "unacked" or "final" lists hasn't wrapped.  Whichever one
-		// hasn't has the oldest packet.
-		if (!wrapped)
-		{
-			// Hasn't wrapped, so the one on the
-			// unacked packet list is older
-			packet_id = iter->first;
-			//llinfos << mHost << ": nowrapped unacked" << llendl;
-		}
-		else
-		{
-			packet_id = iter_final->first;
-			//llinfos << mHost << ": nowrapped final" << llendl;
-		}
-	}
-	else
-	{
-		// They both wrapped, we can just use the minimum of the two.
-		if ((iter == mUnackedPackets.end()) && (iter_final == mFinalRetryPackets.end()))
-		{
-			// Wow!  No unacked packets at all!
-			// Send the ID of the last packet we sent out.
-			// This will flush all of the destination's
-			// unacked packets, theoretically.
-			//llinfos << mHost << ": No unacked!" << llendl;
-			packet_id = getPacketOutID();
-		}
-		else
-		{
-			BOOL had_unacked = FALSE;
-			if (iter != mUnackedPackets.end())
-			{
-				// Unacked list has the lowest so far
-				packet_id = iter->first;
-				had_unacked = TRUE;
-				//llinfos << mHost << ": Unacked" << llendl;
-			}
-
-			if (iter_final != mFinalRetryPackets.end())
-			{
-				// Use the lowest of the unacked list and the final list
-				if (had_unacked)
-				{
-					// Both had a packet, use the lowest.
-					packet_id = llmin(packet_id, iter_final->first);
-					//llinfos << mHost << ": Min of unacked/final" << llendl;
-				}
-				else
-				{
-					// Only the final had a packet, use it.
-					packet_id = iter_final->first;
-					//llinfos << mHost << ": Final!" << llendl;
-				}
-			}
-		}
+		packet_id = mFinalRetryPackets.oldest();
 	}
+	// With no unacked packets at all, send the ID of the last packet we
+	// sent out.  This will flush all of the destination's unacked
+	// packets, theoretically.
 
 	// Send off the another ping.
 	pingTimerStart();
@@ -967,13 +887,14 @@ BOOL LLCircuitData::updateWatchDogTimers(LLMessageSystem *msgsys)
 	// Check to see if anything on our lost list is old enough to
 	// be considered lost
 
-	LLCircuitData::packet_time_map::iterator it;
 	U64 timeout = (U64)(1000000.0*llmin(LL_MAX_LOST_TIMEOUT, getPingDelayAveraged() * LL_LOST_TIMEOUT_FACTOR));
 
 	U64 mt_usec = LLMessageSystem::getMessageTimeUsecs();
-	for (it = mPotentialLostPackets.begin(); it != mPotentialLostPackets.end(); )
+	U64 *timep;
+	TPACKETID id = mPotentialLostPackets.oldest();
+	for (; (timep = mPotentialLostPackets.findFrom(id)); id = ll_next_packet_id(id))
 	{
-		U64 delta_t_usec = mt_usec - (*it).second;
+		U64 delta_t_usec = mt_usec - *timep;
 		if (delta_t_usec > timeout)
 		{
 			// let's call this one a loss!
@@ -983,14 +904,10 @@ BOOL LLCircuitData::updateWatchDogTimers(LLMessageSystem *msgsys)
 			{
 				std::ostringstream str;
 				str << "MSG: <- " << mHost << "\tLOST PACKET:\t"
-					<< (*it).first;
+					<< id;
 				llinfos << str.str() << llendl;
 			}
-			mPotentialLostPackets.erase(it++);
-		}
-		else
-		{
-			++it;
+			mPotentialLostPackets.erase(id);
 		}
 	}
 
@@ -1006,41 +923,33 @@ void LLCircuitData::clearDuplicateList(TPACKETID oldest_id)
 
 	//llinfos << mHost << ": clearing before oldest " << oldest_id << llendl;
 	//llinfos << "Recent list before: " << mRecentlyReceivedReliablePackets.size() << llendl;
-	if (oldest_id < mHighestPacketID)
+	if (ll_packet_id_before(oldest_id, mHighestPacketID))
 	{
-		// Clean up everything with a packet ID less than oldest_id.
-		packet_time_map::iterator pit_start;
-		packet_time_map::iterator pit_end;
-		pit_start = mRecentlyReceivedReliablePackets.begin();
-		pit_end = mRecentlyReceivedReliablePackets.lower_bound(oldest_id);
-		mRecentlyReceivedReliablePackets.erase(pit_start, pit_end);
+		// Clean up everything with a packet ID before oldest_id.
+		mRecentlyReceivedReliablePackets.eraseBefore(oldest_id);
 	}
 
-	// Do timeout checks on everything with an ID > mHighestPacketID.
+	// Do timeout checks on everything with an ID after mHighestPacketID.
 	// This should be empty except for wrapping IDs.  Thus, this should be
 	// highly rare.
 	U64 mt_usec = LLMessageSystem::getMessageTimeUsecs();
 
-	packet_time_map::iterator pit;
-	for(pit = mRecentlyReceivedReliablePackets.upper_bound(mHighestPacketID);
-		pit != mRecentlyReceivedReliablePackets.end(); )
+	U64 *timep;
+	TPACKETID id = ll_next_packet_id(mHighestPacketID);
+	for (; (timep = mRecentlyReceivedReliablePackets.findFrom(id)); id = ll_next_packet_id(id))
 	{
 		// Validate that the packet ID seems far enough away
-		if ((pit->first - mHighestPacketID) < 100)
+		if (((id - mHighestPacketID) & LL_PACKET_ID_MASK) < 100)
 		{
 			llwarns << "Probably incorrectly timing out non-wrapped packets!" << llendl;
 		}
-		U64 delta_t_usec = mt_usec - (*pit).second;
+		U64 delta_t_usec = mt_usec - *timep;
 		F64 delta_t_sec = delta_t_usec * SEC_PER_USEC;
 		if (delta_t_sec > LL_DUPLICATE_SUPPRESSION_TIMEOUT)
 		{
 			// enough time has elapsed we're not likely to get a duplicate on this one
-			llinfos << "Clearing " << pit->first << " from recent list" << llendl;
-			mRecentlyReceivedReliablePackets.erase(pit++);
-		}
-		else
-		{
-			++pit;
+			llinfos << "Clearing " << id << " from recent list" << llendl;
+			mRecentlyReceivedReliablePackets.erase(id);
 		}
 	}
 	//llinfos << "Recent list after: " << mRecentlyReceivedReliablePackets.size() << llendl;
@@ -1081,7 +990,7 @@ BOOL LLCircuitData::collectRAck(TPACKETID packet_num)
 		gMessageSystem->mCircuitInfo.mSendAckMap[mHost] = this;
 	}
 
-	mAcks.push_back(packet_num);
+	mAcks.push(packet_num);
 	return TRUE;
 }
 
@@ -1124,8 +1033,10 @@ void LLCircuit::sendAcks()
 			{
 				std::ostringstream str;
 				str << "MSG: -> " << cd->mHost << "\tPACKET ACKS:\t";
-				std::ostream_iterator<TPACKETID> append(str, " ");
-				std::copy(cd->mAcks.begin(), cd->mAcks.end(), append);
+				for(S32 i = 0; i < count; ++i)
+				{
+					str << cd->mAcks[i] << " ";
+				}
 				llinfos << str.str() << llendl;
 			}
 
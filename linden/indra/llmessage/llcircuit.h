@@ -44,6 +44,7 @@
 #include "net.h"
 #include "llhost.h"
 #include "llpacketack.h"
+#include "llpacketwindow.h"
 #include "lluuid.h"
 #include "llthrottle.h"
 #include "llstat.h"
@@ -239,17 +240,17 @@ protected:
 	U32		mPingDelay;             // raw ping delay
 	F32		mPingDelayAveraged;     // averaged ping delay (fast attack/slow decay)
 
-	typedef std::map<TPACKETID, U64> packet_time_map;
+	// All keyed by packet ID, see llpacketwindow.h.
+	typedef LLPacketWindow<U64> packet_time_window;
 
-	packet_time_map							mPotentialLostPackets;
-	packet_time_map							mRecentlyReceivedReliablePackets;
-	std::vector<TPACKETID> mAcks;
+	packet_time_window						mPotentialLostPackets;
+	packet_time_window						mRecentlyReceivedReliablePackets;
+	LLPacketIDQueue							mAcks;
 
-	typedef std::map<TPACKETID, LLReliablePacket *> reliable_map;
-	typedef reliable_map::iterator					reliable_iter;
+	typedef LLPacketWindow<LLReliablePacket *> reliable_window;
 
-	reliable_map							mUnackedPackets;
-	reliable_map							mFinalRetryPackets;
+	reliable_window							mUnackedPackets;
+	reliable_window							mFinalRetryPackets;
 
 	S32										mUnackedPacketCount;
 	S32										mUnackedPacketBytes;
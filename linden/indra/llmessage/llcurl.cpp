@@ -45,13 +45,16 @@
 #include "llcurl.h"
 
 #include <algorithm>
+#include <deque>
 #include <iomanip>
+#include <map>
+#include <set>
 #include <curl/curl.h>
 #if SAFE_SSL
 #include <openssl/crypto.h>
 #endif
 
-#include "llbufferstream.h"
+#include "llmemorystream.h"
 #include "llstl.h"
 #include "llsdserialize.h"
 #include "llthread.h"
@@ -66,22 +69,32 @@
 	rather than create and destroy them with each request.  This
 	code does this.
 
-	Furthermore, it would behoove us to keep track of which
-	hosts an easy handle was used for and pick an easy handle
-	that matches the next request.  This code does not current
-	do this.
+	Furthermore, it behooves us to keep track of which hosts
+	an easy handle was used for and pick an easy handle that
+	matches the next request.  LLCurl::Multi keeps its idle
+	easy handles by host for this, and caps the number of
+	requests running against any one host so that the rest
+	queue up for the connections which are already open.
+
+	LLCurlRequest runs its requests on a multi of its own.  Every
+	LLCurlEasyRequest made on a thread (caps, event polls and
+	XML-RPC calls) shares that thread's one multi, so they get
+	the same caps, priorities and idle handles.
  */
 
 //////////////////////////////////////////////////////////////////////////////
 
-static const S32 EASY_HANDLE_POOL_SIZE		= 5;
+static const S32 MAX_IDLE_EASY_HANDLES		= 32;
 static const S32 MULTI_PERFORM_CALL_REPEAT	= 5;
 static const S32 CURL_REQUEST_TIMEOUT = 30; // seconds
 static const S32 MAX_ACTIVE_REQUEST_COUNT = 100;
+static const S32 DEFAULT_MAX_CONNECTIONS_PER_HOST = 8;
 
 // DEBUG //
 S32 gCurlEasyCount = 0;
 S32 gCurlMultiCount = 0;
+S32 gCurlConnectCount = 0; // connections opened
+S32 gCurlTransferCount = 0; // requests completed
 
 //////////////////////////////////////////////////////////////////////////////
 
@@ -147,7 +160,10 @@ void LLCurl::Responder::completedRaw(
 	const LLIOPipe::buffer_ptr_t& buffer)
 {
 	LLSD content;
-	LLBufferStream istr(channels, buffer.get());
+	// parse the body in place rather than through a segment stream.
+	S32 len = 0;
+	U8* data = buffer->makeContiguous(channels.in(), len);
+	LLMemoryStream istr(data, len);
 	LLSDSerialize::fromXML(content, istr);
 	completed(status, reason, content);
 }
@@ -204,6 +220,11 @@ public:
 
 	CURL* getCurlHandle() const { return mCurlEasyHandle; }
 
+	// scheme, host and port of the last url this handle was prepped
+	// for. Idle handles are kept by host.
+	const std::string& getHost() const { return mHost; }
+	void setHost(const std::string& url);
+
 	void setErrorBuffer();
 	void setCA();
 	
@@ -219,6 +240,7 @@ public:
 	
 	U32 report(CURLcode);
 	void getTransferInfo(LLCurl::TransferInfo* info);
+	void countTransfer();
 
 	void prepRequest(const std::string& url, const std::vector<std::string>& headers, ResponderPtr, bool post = false);
 	
@@ -231,6 +253,17 @@ public:
 	
 	void resetState();
 
+	// Handles owned by an LLCurlEasyRequest keep the result of their
+	// transfer for it to collect, rather than reporting to a responder.
+	void setPolled() { mPolled = true; }
+	bool isPolled() const { return mPolled; }
+	void finish(CURLcode result);
+	bool isDone() const { return mDone; }
+	CURLcode getResult() const { return mResult; }
+
+	// scheme, host and port of url, eg "https://host:port"
+	static std::string getHostOf(const std::string& url);
+
 private:	
 	CURL*				mCurlEasyHandle;
 	struct curl_slist*	mHeaders;
@@ -246,11 +279,19 @@ private:
 	std::vector<char*>	mStrings;
 	
 	ResponderPtr		mResponder;
+	std::string			mHost;
+
+	bool				mPolled;
+	bool				mDone;
+	CURLcode			mResult;
 };
 
 LLCurl::Easy::Easy()
 	: mHeaders(NULL),
-	  mCurlEasyHandle(NULL)
+	  mCurlEasyHandle(NULL),
+	  mPolled(false),
+	  mDone(false),
+	  mResult(CURLE_OK)
 {
 	mErrorBuffer[0] = 0;
 }
@@ -274,6 +315,20 @@ LLCurl::Easy* LLCurl::Easy::getEasy()
 	return easy;
 }
 
+//static
+std::string LLCurl::Easy::getHostOf(const std::string& url)
+{
+	// everything up to the path
+	std::string::size_type pos = url.find("://");
+	pos = (pos == std::string::npos) ? 0 : pos + 3;
+	return url.substr(0, url.find('/', pos));
+}
+
+void LLCurl::Easy::setHost(const std::string& url)
+{
+	mHost = getHostOf(url);
+}
+
 LLCurl::Easy::~Easy()
 {
 	curl_easy_cleanup(mCurlEasyHandle);
@@ -285,6 +340,12 @@ LLCurl::Easy::~Easy()
 void LLCurl::Easy::resetState()
 {
  	curl_easy_reset(mCurlEasyHandle);
+	// curl_easy_reset() forgets this along with everything else.
+	curl_easy_setopt(mCurlEasyHandle, CURLOPT_DNS_CACHE_TIMEOUT, 0);
+
+	// the reset also dropped curl's pointers to our strings.
+	for_each(mStrings.begin(), mStrings.end(), DeletePointerArray());
+	mStrings.clear();
 
 	if (mHeaders)
 	{
@@ -304,6 +365,17 @@ void LLCurl::Easy::resetState()
 	
 	mHeaderOutput.str("");
 	mHeaderOutput.clear();
+
+	mPolled = false;
+	mDone = false;
+	mResult = CURLE_OK;
+}
+
+void LLCurl::Easy::finish(CURLcode result)
+{
+	countTransfer();
+	mResult = result;
+	mDone = true;
 }
 
 void LLCurl::Easy::setErrorBuffer()
@@ -340,11 +412,23 @@ void LLCurl::Easy::getTransferInfo(LLCurl::TransferInfo* info)
 	curl_easy_getinfo(mCurlEasyHandle, CURLINFO_SPEED_DOWNLOAD, &info->mSpeedDownload);
 }
 
+void LLCurl::Easy::countTransfer()
+{
+	long connects = 0;
+	if (CURLE_OK == curl_easy_getinfo(mCurlEasyHandle, CURLINFO_NUM_CONNECTS, &connects))
+	{
+		gCurlConnectCount += connects;
+	}
+	++gCurlTransferCount;
+}
+
 U32 LLCurl::Easy::report(CURLcode code)
 {
 	U32 responseCode = 0;	
 	std::string responseReason;
 	
+	countTransfer();
+
 	if (code == CURLE_OK)
 	{
 		curl_easy_getinfo(mCurlEasyHandle, CURLINFO_RESPONSE_CODE, &responseCode);
@@ -460,6 +544,7 @@ void LLCurl::Easy::prepRequest(const std::string& url,
 	setopt(CURLOPT_TIMEOUT, CURL_REQUEST_TIMEOUT);
 
 	setoptString(CURLOPT_URL, url);
+	setHost(url);
 
 	mResponder = responder;
 
@@ -486,21 +571,40 @@ public:
 	Multi();
 	~Multi();
 
-	Easy* allocEasy();
-	bool addEasy(Easy* easy);
+	// Prefers an idle easy handle which last talked to host, since
+	// it may still have a connection open there.
+	Easy* allocEasy(const std::string& host = std::string());
+	bool addEasy(Easy* easy, EPriority priority = PRIORITY_CAPS);
 	
-	void removeEasy(Easy* easy);
+	// Pass reuse = false to throw the handle away rather than keep it
+	// for the next request.
+	void removeEasy(Easy* easy, bool reuse = true);
 
 	S32 process();
 	S32 perform();
 	
 	CURLMsg* info_read(S32* msgs_in_queue);
 
+	void setMaxConnectionsPerHost(S32 count) { mMaxConnectionsPerHost = count; }
+	S32 getMaxConnectionsPerHost() const { return mMaxConnectionsPerHost; }
+	S32 getPendingCount() const;
+
+	// The multi shared by every LLCurlEasyRequest on the calling
+	// thread. Curl multis are not thread safe, so each thread has its own.
+	static Multi* getShared();
+	static void initShared();
+	static void cleanupShared();
+
 	S32 mQueued;
 	S32 mErrorCount;
 	
 private:
-	void easyFree(Easy*);
+	void easyFree(Easy*, bool reuse);
+	bool canStart(const std::string& host);
+	bool startEasy(Easy* easy);
+	bool stopEasy(Easy* easy);
+	void startPending();
+	void failPending(Easy* easy);
 	
 	CURLM* mCurlMultiHandle;
 
@@ -508,13 +612,37 @@ private:
 	easy_active_list_t mEasyActiveList;
 	typedef std::map<CURL*, Easy*> easy_active_map_t;
 	easy_active_map_t mEasyActiveMap;
-	typedef std::set<Easy*> easy_free_list_t;
-	easy_free_list_t mEasyFreeList;
+
+	// idle easy handles by the host they last talked to.
+	typedef std::map<std::string, std::vector<Easy*> > easy_free_map_t;
+	easy_free_map_t mEasyFreeMap;
+	S32 mEasyFreeCount;
+
+	// easy handles which have been handed to curl, and how many of
+	// them are talking to each host.
+	typedef std::set<Easy*> easy_running_list_t;
+	easy_running_list_t mEasyRunningList;
+	typedef std::map<std::string, S32> host_count_t;
+	host_count_t mHostRunningCount;
+	S32 mMaxConnectionsPerHost;
+
+	// easy handles waiting for a free connection to their host.
+	typedef std::deque<Easy*> easy_pending_list_t;
+	easy_pending_list_t mEasyPendingList[PRIORITY_COUNT];
+
+	typedef std::map<U32, Multi*> shared_map_t;
+	static LLMutex* sSharedMutex;
+	static shared_map_t sShared;
 };
 
+LLMutex* LLCurl::Multi::sSharedMutex = NULL;
+LLCurl::Multi::shared_map_t LLCurl::Multi::sShared;
+
 LLCurl::Multi::Multi()
 	: mQueued(0),
-	  mErrorCount(0)
+	  mErrorCount(0),
+	  mEasyFreeCount(0),
+	  mMaxConnectionsPerHost(DEFAULT_MAX_CONNECTIONS_PER_HOST)
 {
 	mCurlMultiHandle = curl_multi_init();
 	if (!mCurlMultiHandle)
@@ -533,15 +661,24 @@ LLCurl::Multi::~Multi()
 		iter != mEasyActiveList.end(); ++iter)
 	{
 		Easy* easy = *iter;
-		curl_multi_remove_handle(mCurlMultiHandle, easy->getCurlHandle());
+		if (mEasyRunningList.count(easy))
+		{
+			curl_multi_remove_handle(mCurlMultiHandle, easy->getCurlHandle());
+		}
 		delete easy;
 	}
 	mEasyActiveList.clear();
 	mEasyActiveMap.clear();
+	mEasyRunningList.clear();
 	
 	// Clean up freed
-	for_each(mEasyFreeList.begin(), mEasyFreeList.end(), DeletePointer());	
-	mEasyFreeList.clear();
+	for(easy_free_map_t::iterator iter = mEasyFreeMap.begin();
+		iter != mEasyFreeMap.end(); ++iter)
+	{
+		for_each(iter->second.begin(), iter->second.end(), DeletePointer());
+	}
+	mEasyFreeMap.clear();
+	mEasyFreeCount = 0;
 
 	curl_multi_cleanup(mCurlMultiHandle);
 	--gCurlMultiCount;
@@ -586,40 +723,64 @@ S32 LLCurl::Multi::process()
 		{
 			U32 response = 0;
 			easy_active_map_t::iterator iter = mEasyActiveMap.find(msg->easy_handle);
+			if (iter != mEasyActiveMap.end() && iter->second->isPolled())
+			{
+				// its request may have been dropped and the handle
+				// handed out again since.
+				Easy* easy = iter->second;
+				if (stopEasy(easy))
+				{
+					easy->finish(msg->data.result);
+				}
+				continue;
+			}
 			if (iter != mEasyActiveMap.end())
 			{
 				Easy* easy = iter->second;
-				response = easy->report(msg->data.result);
-				removeEasy(easy);
+				CURLcode result = msg->data.result;
+				response = easy->report(result);
+				// don't keep a handle whose connection may be bad.
+				removeEasy(easy, CURLE_OK == result);
 			}
 			else
 			{
+				// an LLCurlEasyRequest dropped it while it finished
 				response = 499;
-				//*TODO: change to llwarns
-				llerrs << "cleaned up curl request completed!" << llendl;
+				llwarns << "cleaned up curl request completed!" << llendl;
 			}
 			if (response >= 400)
 			{
-				// failure of some sort, inc mErrorCount for debugging and flagging multi for destruction
+				// failure of some sort, inc mErrorCount for debugging
 				++mErrorCount;
 			}
 		}
 	}
+
+	// finished requests may have made room for waiting ones.
+	startPending();
 	return processed;
 }
 
-LLCurl::Easy* LLCurl::Multi::allocEasy()
+LLCurl::Easy* LLCurl::Multi::allocEasy(const std::string& host)
 {
 	Easy* easy = 0;
 
-	if (mEasyFreeList.empty())
+	// Without a host any idle handle will do. Otherwise leave the
+	// handles for other hosts alone so their connections survive.
+	easy_free_map_t::iterator iter = host.empty() ? mEasyFreeMap.begin() : mEasyFreeMap.find(host);
+	if (iter == mEasyFreeMap.end())
 	{
 		easy = Easy::getEasy();
 	}
 	else
 	{
-		easy = *(mEasyFreeList.begin());
-		mEasyFreeList.erase(easy);
+		easy = iter->second.back();
+		iter->second.pop_back();
+		--mEasyFreeCount;
+		if (iter->second.empty())
+		{
+			mEasyFreeMap.erase(iter);
+		}
 	}
 	if (easy)
 	{
@@ -629,7 +790,38 @@ LLCurl::Easy* LLCurl::Multi::allocEasy()
 	return easy;
 }
 
-bool LLCurl::Multi::addEasy(Easy* easy)
+bool LLCurl::Multi::addEasy(Easy* easy, EPriority priority)
+{
+	if (canStart(easy->getHost()))
+	{
+		return startEasy(easy);
+	}
+	mEasyPendingList[priority].push_back(easy);
+	return true;
+}
+
+S32 LLCurl::Multi::getPendingCount() const
+{
+	S32 count = 0;
+	for (S32 i = 0; i < PRIORITY_COUNT; ++i)
+	{
+		count += mEasyPendingList[i].size();
+	}
+	return count;
+}
+
+bool LLCurl::Multi::canStart(const std::string& host)
+{
+	if ((S32)mEasyRunningList.size() >= MAX_ACTIVE_REQUEST_COUNT)
+	{
+		return false;
+	}
+	host_count_t::iterator iter = mHostRunningCount.find(host);
+	return (iter == mHostRunningCount.end()
+			|| iter->second < mMaxConnectionsPerHost);
+}
+
+bool LLCurl::Multi::startEasy(Easy* easy)
 {
 	CURLMcode mcode = curl_multi_add_handle(mCurlMultiHandle, easy->getCurlHandle());
 	if (mcode != CURLM_OK)
@@ -637,28 +829,142 @@ bool LLCurl::Multi::addEasy(Easy* easy)
 		llwarns << "Curl Error: " << curl_multi_strerror(mcode) << llendl;
 		return false;
 	}
+	mEasyRunningList.insert(easy);
+	++mHostRunningCount[easy->getHost()];
 	return true;
 }
 
-void LLCurl::Multi::easyFree(Easy* easy)
+// Takes a running handle back from curl, freeing its connection slot.
+bool LLCurl::Multi::stopEasy(Easy* easy)
+{
+	if (!mEasyRunningList.erase(easy))
+	{
+		return false;
+	}
+	curl_multi_remove_handle(mCurlMultiHandle, easy->getCurlHandle());
+	host_count_t::iterator iter = mHostRunningCount.find(easy->getHost());
+	if (iter != mHostRunningCount.end() && 0 == --(iter->second))
+	{
+		mHostRunningCount.erase(iter);
+	}
+	return true;
+}
+
+void LLCurl::Multi::failPending(Easy* easy)
+{
+	if (easy->isPolled())
+	{
+		// its LLCurlEasyRequest still holds it
+		easy->finish(CURLE_FAILED_INIT);
+	}
+	else
+	{
+		easy->report(CURLE_FAILED_INIT);
+		removeEasy(easy, false);
+	}
+}
+
+void LLCurl::Multi::startPending()
+{
+	for (S32 i = 0; i < PRIORITY_COUNT; ++i)
+	{
+		easy_pending_list_t& pending = mEasyPendingList[i];
+		easy_pending_list_t::iterator iter = pending.begin();
+		while (iter != pending.end())
+		{
+			Easy* easy = *iter;
+			if (!canStart(easy->getHost()))
+			{
+				++iter;
+				continue;
+			}
+			iter = pending.erase(iter);
+			if (!startEasy(easy))
+			{
+				failPending(easy);
+			}
+		}
+	}
+}
+
+void LLCurl::Multi::easyFree(Easy* easy, bool reuse)
 {
 	mEasyActiveList.erase(easy);
 	mEasyActiveMap.erase(easy->getCurlHandle());
-	if (mEasyFreeList.size() < EASY_HANDLE_POOL_SIZE)
+	// One idle handle per connection we would ever run at once is
+	// enough to keep those connections alive.
+	if (reuse && mEasyFreeCount < MAX_IDLE_EASY_HANDLES)
 	{
-		easy->resetState();
-		mEasyFreeList.insert(easy);
+		std::vector<Easy*>& free_list = mEasyFreeMap[easy->getHost()];
+		if ((S32)free_list.size() < mMaxConnectionsPerHost)
+		{
+			easy->resetState();
+			free_list.push_back(easy);
+			++mEasyFreeCount;
+			return;
+		}
 	}
-	else
+	delete easy;
+}
+
+void LLCurl::Multi::removeEasy(Easy* easy, bool reuse)
+{
+	if (!mEasyActiveList.count(easy))
 	{
-		delete easy;
+		// already removed.
+		return;
+	}
+	if (!stopEasy(easy))
+	{
+		for (S32 i = 0; i < PRIORITY_COUNT; ++i)
+		{
+			easy_pending_list_t& pending = mEasyPendingList[i];
+			pending.erase(std::remove(pending.begin(), pending.end(), easy), pending.end());
+		}
 	}
+	easyFree(easy, reuse);
 }
 
-void LLCurl::Multi::removeEasy(Easy* easy)
+//static
+LLCurl::Multi* LLCurl::Multi::getShared()
 {
-	curl_multi_remove_handle(mCurlMultiHandle, easy->getCurlHandle());
-	easyFree(easy);
+	U32 thread_id = LLThread::currentID();
+	if (sSharedMutex)
+	{
+		sSharedMutex->lock();
+	}
+	Multi*& multi = sShared[thread_id];
+	if (!multi)
+	{
+		multi = new Multi();
+	}
+	Multi* result = multi;
+	if (sSharedMutex)
+	{
+		sSharedMutex->unlock();
+	}
+	return result;
+}
+
+//static
+void LLCurl::Multi::initShared()
+{
+	if (!sSharedMutex)
+	{
+		sSharedMutex = new LLMutex(NULL);
+	}
+}
+
+//static
+void LLCurl::Multi::cleanupShared()
+{
+	for (shared_map_t::iterator iter = sShared.begin(); iter != sShared.end(); ++iter)
+	{
+		delete iter->second;
+	}
+	sShared.clear();
+	delete sSharedMutex;
+	sSharedMutex = NULL;
 }
 
 //static
@@ -677,62 +983,56 @@ std::string LLCurl::strerror(CURLcode errorcode)
 
 ////////////////////////////////////////////////////////////////////////////
 // For generating a simple request for data
-// using one multi and one easy per request 
+// using one multi and an easy per running request
 
 LLCurlRequest::LLCurlRequest() :
-	mActiveMulti(NULL),
-	mActiveRequestCount(0)
+	mMulti(NULL)
 {
 	mThreadID = LLThread::currentID();
+	mMulti = new LLCurl::Multi();
 }
 
 LLCurlRequest::~LLCurlRequest()
 {
 	llassert_always(mThreadID == LLThread::currentID());
-	for_each(mMultiSet.begin(), mMultiSet.end(), DeletePointer());
+	delete mMulti;
 }
 
-void LLCurlRequest::addMulti()
+void LLCurlRequest::setMaxConnectionsPerHost(S32 count)
 {
 	llassert_always(mThreadID == LLThread::currentID());
-	LLCurl::Multi* multi = new LLCurl::Multi();
-	mMultiSet.insert(multi);
-	mActiveMulti = multi;
-	mActiveRequestCount = 0;
+	mMulti->setMaxConnectionsPerHost(llmax(count, 1));
 }
 
-LLCurl::Easy* LLCurlRequest::allocEasy()
+LLCurl::Easy* LLCurlRequest::allocEasy(const std::string& url)
 {
-	if (!mActiveMulti ||
-		mActiveRequestCount	>= MAX_ACTIVE_REQUEST_COUNT ||
-		mActiveMulti->mErrorCount > 0)
-	{
-		addMulti();
-	}
-	llassert_always(mActiveMulti);
-	++mActiveRequestCount;
-	LLCurl::Easy* easy = mActiveMulti->allocEasy();
+	llassert_always(mThreadID == LLThread::currentID());
+	LLCurl::Easy* easy = mMulti->allocEasy(LLCurl::Easy::getHostOf(url));
 	return easy;
 }
 
-bool LLCurlRequest::addEasy(LLCurl::Easy* easy)
+bool LLCurlRequest::addEasy(LLCurl::Easy* easy, LLCurl::EPriority priority)
 {
-	llassert_always(mActiveMulti);
-	bool res = mActiveMulti->addEasy(easy);
+	bool res = mMulti->addEasy(easy, priority);
+	if (!res)
+	{
+		mMulti->removeEasy(easy, false);
+	}
 	return res;
 }
 
-void LLCurlRequest::get(const std::string& url, LLCurl::ResponderPtr responder)
+void LLCurlRequest::get(const std::string& url, LLCurl::ResponderPtr responder, LLCurl::EPriority priority)
 {
-	getByteRange(url, headers_t(), 0, -1, responder);
+	getByteRange(url, headers_t(), 0, -1, responder, priority);
 }
 	
 bool LLCurlRequest::getByteRange(const std::string& url,
 								 const headers_t& headers,
 								 S32 offset, S32 length,
-								 LLCurl::ResponderPtr responder)
+								 LLCurl::ResponderPtr responder,
+								 LLCurl::EPriority priority)
 {
-	LLCurl::Easy* easy = allocEasy();
+	LLCurl::Easy* easy = allocEasy(url);
 	if (!easy)
 	{
 		return false;
@@ -745,16 +1045,17 @@ bool LLCurlRequest::getByteRange(const std::string& url,
 		easy->slist_append(range.c_str());
 	}
 	easy->setHeaders();
-	bool res = addEasy(easy);
+	bool res = addEasy(easy, priority);
 	return res;
 }
 
 bool LLCurlRequest::post(const std::string& url,
 						 const headers_t& headers,
 						 const LLSD& data,
-						 LLCurl::ResponderPtr responder)
+						 LLCurl::ResponderPtr responder,
+						 LLCurl::EPriority priority)
 {
-	LLCurl::Easy* easy = allocEasy();
+	LLCurl::Easy* easy = allocEasy(url);
 	if (!easy)
 	{
 		return false;
@@ -772,7 +1073,7 @@ bool LLCurlRequest::post(const std::string& url,
 	easy->setHeaders();
 
 	lldebugs << "POSTING: " << bytes << " bytes." << llendl;
-	bool res = addEasy(easy);
+	bool res = addEasy(easy, priority);
 	return res;
 }
 	
@@ -780,49 +1081,32 @@ bool LLCurlRequest::post(const std::string& url,
 S32 LLCurlRequest::process()
 {
 	llassert_always(mThreadID == LLThread::currentID());
-	S32 res = 0;
-	for (curlmulti_set_t::iterator iter = mMultiSet.begin();
-		 iter != mMultiSet.end(); )
-	{
-		curlmulti_set_t::iterator curiter = iter++;
-		LLCurl::Multi* multi = *curiter;
-		S32 tres = multi->process();
-		res += tres;
-		if (multi != mActiveMulti && tres == 0 && multi->mQueued == 0)
-		{
-			mMultiSet.erase(curiter);
-			delete multi;
-		}
-	}
-	return res;
+	return mMulti->process();
 }
 
 S32 LLCurlRequest::getQueued()
 {
 	llassert_always(mThreadID == LLThread::currentID());
-	S32 queued = 0;
-	for (curlmulti_set_t::iterator iter = mMultiSet.begin();
-		 iter != mMultiSet.end(); )
-	{
-		curlmulti_set_t::iterator curiter = iter++;
-		LLCurl::Multi* multi = *curiter;
-		queued += multi->mQueued;
-	}
-	return queued;
+	return mMulti->mQueued + mMulti->getPendingCount();
 }
 
 ////////////////////////////////////////////////////////////////////////////
 // For generating one easy request
-// associated with a single multi request
+// on the multi shared by the requests of this thread
 
-LLCurlEasyRequest::LLCurlEasyRequest()
+LLCurlEasyRequest::LLCurlEasyRequest(const std::string& url)
 	: mRequestSent(false),
 	  mResultReturned(false)
 {
-	mMulti = new LLCurl::Multi();
-	mEasy = mMulti->allocEasy();
+	mThreadID = LLThread::currentID();
+	mMulti = LLCurl::Multi::getShared();
+	// An idle handle which last talked to the same host may still
+	// have a connection open there.
+	mEasy = mMulti->allocEasy(LLCurl::Easy::getHostOf(url));
 	if (mEasy)
 	{
+		mEasy->resetState();
+		mEasy->setPolled();
 		mEasy->setErrorBuffer();
 		mEasy->setCA();
 	}
@@ -830,7 +1114,26 @@ LLCurlEasyRequest::LLCurlEasyRequest()
 
 LLCurlEasyRequest::~LLCurlEasyRequest()
 {
-	delete mMulti;
+	llassert_always(mThreadID == LLThread::currentID());
+	if (mEasy)
+	{
+		// a transfer which failed or never finished takes its handle
+		// with it.
+		bool reuse = !mRequestSent || (mEasy->isDone() && CURLE_OK == mEasy->getResult());
+		mMulti->removeEasy(mEasy, reuse);
+	}
+}
+
+//static
+void LLCurlEasyRequest::setMaxConnectionsPerHost(S32 count)
+{
+	LLCurl::Multi::getShared()->setMaxConnectionsPerHost(llmax(count, 1));
+}
+
+//static
+S32 LLCurlEasyRequest::getMaxConnectionsPerHost()
+{
+	return LLCurl::Multi::getShared()->getMaxConnectionsPerHost();
 }
 	
 void LLCurlEasyRequest::setopt(CURLoption option, S32 value)
@@ -894,8 +1197,9 @@ void LLCurlEasyRequest::slist_append(const char* str)
 	}
 }
 
-void LLCurlEasyRequest::sendRequest(const std::string& url)
+void LLCurlEasyRequest::sendRequest(const std::string& url, LLCurl::EPriority priority)
 {
+	llassert_always(mThreadID == LLThread::currentID());
 	llassert_always(!mRequestSent);
 	mRequestSent = true;
 	lldebugs << url << llendl;
@@ -903,7 +1207,11 @@ void LLCurlEasyRequest::sendRequest(const std::string& url)
 	{
 		mEasy->setHeaders();
 		mEasy->setoptString(CURLOPT_URL, url);
-		mMulti->addEasy(mEasy);
+		mEasy->setHost(url);
+		if (!mMulti->addEasy(mEasy, priority))
+		{
+			mEasy->finish(CURLE_FAILED_INIT);
+		}
 	}
 }
 
@@ -914,12 +1222,17 @@ void LLCurlEasyRequest::requestComplete()
 	if (mEasy)
 	{
 		mMulti->removeEasy(mEasy);
+		mEasy = NULL;
 	}
 }
 
+// Runs every transfer on the shared multi. Returns 1 while this
+// request is waiting or running and 0 once it is done.
 S32 LLCurlEasyRequest::perform()
 {
-	return mMulti->perform();
+	llassert_always(mThreadID == LLThread::currentID());
+	mMulti->process();
+	return (mEasy && mRequestSent && !mEasy->isDone()) ? 1 : 0;
 }
 
 // Usage: Call getRestult until it returns false (no more messages)
@@ -940,45 +1253,19 @@ bool LLCurlEasyRequest::getResult(CURLcode* result, LLCurl::TransferInfo* info)
 			return true;
 		}
 	}
-	// In theory, info_read might return a message with a status other than CURLMSG_DONE
-	// In practice for all messages returned, msg == CURLMSG_DONE
-	// Ignore other messages just in case
-	while(1)
+	// perform() collects the results of the shared multi's
+	// transfers into their handles.
+	if (mResultReturned || !mEasy->isDone())
 	{
-		S32 q;
-		CURLMsg* curlmsg = info_read(&q, info);
-		if (curlmsg)
-		{
-			if (curlmsg->msg == CURLMSG_DONE)
-			{
-				*result = curlmsg->data.result;			
-				return true;
-			}
-			// else continue
-		}
-		else
-		{
-			return false;
-		}
+		return false;
 	}
-}
-
-// private
-CURLMsg* LLCurlEasyRequest::info_read(S32* q, LLCurl::TransferInfo* info)
-{
-	if (mEasy)
+	*result = mEasy->getResult();
+	if (info)
 	{
-		CURLMsg* curlmsg = mMulti->info_read(q);
-		if (curlmsg && curlmsg->msg == CURLMSG_DONE)
-		{
-			if (info)
-			{
-				mEasy->getTransferInfo(info);
-			}
-		}
-		return curlmsg;
+		mEasy->getTransferInfo(info);
 	}
-	return NULL;
+	mResultReturned = true;
+	return true;
 }
 
 std::string LLCurlEasyRequest::getErrorString()
@@ -1025,10 +1312,15 @@ void LLCurl::initClass()
 	CRYPTO_set_id_callback(&LLCurl::ssl_thread_id);
 	CRYPTO_set_locking_callback(&LLCurl::ssl_locking_callback);
 #endif
+
+	Multi::initShared();
+	LLHeapBuffer::initClass();
 }
 
 void LLCurl::cleanupClass()
 {
+	Multi::cleanupShared();
+	LLHeapBuffer::cleanupClass();
 #if SAFE_SSL
 	CRYPTO_set_locking_callback(NULL);
 	for_each(sSSLMutex.begin(), sSSLMutex.end(), DeletePointer());
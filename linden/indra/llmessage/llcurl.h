@@ -61,6 +61,17 @@ public:
 	class Easy;
 	class Multi;
 
+	/**
+	 * @brief Request classes, in the order queued requests are started.
+	 */
+	enum EPriority
+	{
+		PRIORITY_EVENT_POLL,
+		PRIORITY_CAPS,
+		PRIORITY_TEXTURE,
+		PRIORITY_COUNT
+	};
+
 	struct TransferInfo
 	{
 		TransferInfo() : mSizeDownload(0.0), mTotalTime(0.0), mSpeedDownload(0.0) {}
@@ -193,30 +204,46 @@ public:
 	LLCurlRequest();
 	~LLCurlRequest();
 
-	void get(const std::string& url, LLCurl::ResponderPtr responder);
-	bool getByteRange(const std::string& url, const headers_t& headers, S32 offset, S32 length, LLCurl::ResponderPtr responder);
-	bool post(const std::string& url, const headers_t& headers, const LLSD& data, LLCurl::ResponderPtr responder);
+	void get(const std::string& url, LLCurl::ResponderPtr responder, LLCurl::EPriority priority = LLCurl::PRIORITY_CAPS);
+	bool getByteRange(const std::string& url, const headers_t& headers, S32 offset, S32 length, LLCurl::ResponderPtr responder, LLCurl::EPriority priority = LLCurl::PRIORITY_CAPS);
+	bool post(const std::string& url, const headers_t& headers, const LLSD& data, LLCurl::ResponderPtr responder, LLCurl::EPriority priority = LLCurl::PRIORITY_CAPS);
 	S32  process();
 	S32  getQueued();
 
+	/**
+	 * @brief Limit the number of requests running against any one host.
+	 *
+	 * Requests past the limit wait, highest priority first, for a
+	 * running request to that host to finish.
+	 */
+	void setMaxConnectionsPerHost(S32 count);
+
 private:
-	void addMulti();
-	LLCurl::Easy* allocEasy();
-	bool addEasy(LLCurl::Easy* easy);
+	LLCurl::Easy* allocEasy(const std::string& url);
+	bool addEasy(LLCurl::Easy* easy, LLCurl::EPriority priority);
 	
 private:
-	typedef std::set<LLCurl::Multi*> curlmulti_set_t;
-	curlmulti_set_t mMultiSet;
-	LLCurl::Multi* mActiveMulti;
-	S32 mActiveRequestCount;
+	// All requests share one multi handle so that keep-alive
+	// connections are reused between them.
+	LLCurl::Multi* mMulti;
 	U32 mThreadID; // debug
 };
 
 class LLCurlEasyRequest
 {
 public:
-	LLCurlEasyRequest();
+	// url picks an idle handle which last talked to the same host,
+	// if it is known this early.
+	LLCurlEasyRequest(const std::string& url = std::string());
 	~LLCurlEasyRequest();
+
+	/**
+	 * @brief Limit the requests running against any one host, for all
+	 * the easy requests made on the calling thread.
+	 */
+	static void setMaxConnectionsPerHost(S32 count);
+	static S32 getMaxConnectionsPerHost();
+
 	void setopt(CURLoption option, S32 value);
 	void setoptString(CURLoption option, const std::string& value);
 	void setPost(char* postdata, S32 size);
@@ -224,20 +251,18 @@ public:
 	void setWriteCallback(curl_write_callback callback, void* userdata);
 	void setReadCallback(curl_read_callback callback, void* userdata);
 	void slist_append(const char* str);
-	void sendRequest(const std::string& url);
+	void sendRequest(const std::string& url, LLCurl::EPriority priority = LLCurl::PRIORITY_CAPS);
 	void requestComplete();
 	S32 perform();
 	bool getResult(CURLcode* result, LLCurl::TransferInfo* info = NULL);
 	std::string getErrorString();
 
-private:
-	CURLMsg* info_read(S32* queue, LLCurl::TransferInfo* info);
-	
 private:
 	LLCurl::Multi* mMulti;
 	LLCurl::Easy* mEasy;
 	bool mRequestSent;
 	bool mResultReturned;
+	U32 mThreadID; // debug
 };
 
 #endif // LL_LLCURL_H
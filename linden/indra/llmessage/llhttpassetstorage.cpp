@@ -704,13 +704,13 @@ bool LLHTTPAssetStorage::deletePendingRequest(LLAssetStorage::ERequestType rt,
 void LLHTTPAssetStorage::_queueDataRequest(const LLUUID& uuid, LLAssetType::EType type,
 										  void (*callback)(LLVFS *vfs, const LLUUID&, LLAssetType::EType, void *, S32, LLExtStat),
 										  void *user_data, BOOL duplicate,
-										   BOOL is_priority)
+										   EAssetPriority priority)
 {
 	// stash the callback info so we can find it after we get the response message
 	LLAssetRequest *req = new LLAssetRequest(uuid, type);
 	req->mDownCallback = callback;
 	req->mUserData = user_data;
-	req->mIsPriority = is_priority;
+	req->mIsPriority = (priority >= ASSET_PRIORITY_URGENT);
 
 	// this will get picked up and downloaded in checkForTimeouts
 
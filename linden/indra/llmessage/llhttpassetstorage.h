@@ -133,7 +133,7 @@ public:
 protected:
 	void _queueDataRequest(const LLUUID& uuid, LLAssetType::EType type,
 						   void (*callback)(LLVFS *vfs, const LLUUID&, LLAssetType::EType, void *, S32, LLExtStat),
-						   void *user_data, BOOL duplicate, BOOL is_priority);
+						   void *user_data, BOOL duplicate, EAssetPriority priority);
 
 private:
 	void _init(const std::string& web_host, const std::string& local_web_host, const std::string& host_name);
@@ -211,7 +211,8 @@ static void request(
 	Injector* body_injector,
 	LLCurl::ResponderPtr responder,
 	const F32 timeout = HTTP_REQUEST_EXPIRY_SECS,
-	const LLSD& headers = LLSD())
+	const LLSD& headers = LLSD(),
+	LLCurl::EPriority priority = LLCurl::PRIORITY_CAPS)
 {
 	if (!LLHTTPClient::hasPump())
 	{
@@ -222,6 +223,7 @@ static void request(
 
 	LLURLRequest* req = new LLURLRequest(method, url);
 	req->checkRootCertificate(true);
+	req->setPriority(priority);
 
     // Insert custom headers is the caller sent any
     if (headers.isMap())
@@ -455,9 +457,10 @@ void LLHTTPClient::post(
 	const LLSD& body,
 	ResponderPtr responder,
 	const LLSD& headers,
-	const F32 timeout)
+	const F32 timeout,
+	LLCurl::EPriority priority)
 {
-	request(url, LLURLRequest::HTTP_POST, new LLSDInjector(body), responder, timeout, headers);
+	request(url, LLURLRequest::HTTP_POST, new LLSDInjector(body), responder, timeout, headers, priority);
 }
 
 void LLHTTPClient::postRaw(
@@ -86,7 +86,8 @@ public:
 		const LLSD& body,
 		ResponderPtr,
 		const LLSD& headers = LLSD(),
-		const F32 timeout=HTTP_REQUEST_EXPIRY_SECS);
+		const F32 timeout=HTTP_REQUEST_EXPIRY_SECS,
+		LLCurl::EPriority priority = LLCurl::PRIORITY_CAPS);
 	/** Takes ownership of data and deletes it when sent */
 	static void postRaw(
 		const std::string& url,
@@ -40,7 +40,12 @@
 
 ///////////////////////////////////////////////////////////
 
-LLPacketBuffer::LLPacketBuffer(const LLHost &host, const char *datap, const S32 size) : mHost(host)
+// Every packet sent or received through the ring gets one of these. The
+// ring only makes and deletes them on the thread that owns it, so the
+// pool needs no lock.
+MEM_TYPE_POOL_IMPL(LLPacketBuffer, LLMemType::MTYPE_NETWORK, 16, false)
+
+LLPacketBuffer::LLPacketBuffer(const LLHost &host, const char *datap, const S32 size, const LLHost &receiving_if) : mHost(host), mReceivingIF(receiving_if)
 {
 	if (size > NET_BUFFER_SIZE)
 	{
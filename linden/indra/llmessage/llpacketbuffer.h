@@ -36,13 +36,15 @@
 
 #include "net.h"		// for NET_BUFFER_SIZE
 #include "llhost.h"
+#include "llmempool.h"
 
 class LLPacketBuffer
 {
 public:
-	LLPacketBuffer(const LLHost &host, const char *datap, const S32 size);
+	LLPacketBuffer(const LLHost &host, const char *datap, const S32 size, const LLHost &receiving_if = LLHost());
 	LLPacketBuffer(S32 hSocket);           // receive a packet
 	~LLPacketBuffer();
+	MEM_TYPE_POOL_NEW;
 
 	S32			getSize() const					{ return mSize; }
 	const char	*getData() const				{ return mData; }
@@ -0,0 +1,213 @@
+/** 
+ * @file llpacketcapture.cpp
+ * @brief Recording received UDP packets and playing them back
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ * 
+ * Copyright (c) 2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llpacketcapture.h"
+
+#include <set>
+
+#include "net.h"
+#include "timing.h"
+
+static const char CAPTURE_MAGIC[6] = { 'L', 'L', 'P', 'C', 'A', 'P' };
+static const U16 CAPTURE_VERSION = 1;
+
+LLPacketCapture::LLPacketCapture()
+:	mFile(NULL),
+	mPacketCount(0)
+{
+}
+
+LLPacketCapture::~LLPacketCapture()
+{
+	close();
+}
+
+BOOL LLPacketCapture::open(const std::string& filename)
+{
+	close();
+	mFile = LLFile::fopen(filename, "wb");	/* Flawfinder: ignore */
+	if (!mFile)
+	{
+		llwarns << "Unable to open packet capture " << filename << llendl;
+		return FALSE;
+	}
+	fwrite(CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC), 1, mFile);
+	fwrite(&CAPTURE_VERSION, sizeof(CAPTURE_VERSION), 1, mFile);
+	mPacketCount = 0;
+	llinfos << "Capturing received packets to " << filename << llendl;
+	return TRUE;
+}
+
+void LLPacketCapture::close()
+{
+	if (mFile)
+	{
+		fclose(mFile);
+		mFile = NULL;
+		llinfos << "Captured " << mPacketCount << " packets" << llendl;
+	}
+}
+
+void LLPacketCapture::writePacket(U64 receive_time, const LLHost& sender, const char* datap, S32 size)
+{
+	if (!mFile || size <= 0)
+	{
+		return;
+	}
+	U32 ip = sender.getAddress();
+	U32 port = sender.getPort();
+	U32 data_size = size;
+	fwrite(&receive_time, sizeof(receive_time), 1, mFile);
+	fwrite(&ip, sizeof(ip), 1, mFile);
+	fwrite(&port, sizeof(port), 1, mFile);
+	fwrite(&data_size, sizeof(data_size), 1, mFile);
+	if (fwrite(datap, 1, size, mFile) != (size_t)size)
+	{
+		llwarns << "Packet capture write failed, closing it" << llendl;
+		close();
+		return;
+	}
+	mPacketCount++;
+}
+
+LLPacketReplay::LLPacketReplay()
+:	mNextPacket(0),
+	mRealtime(false),
+	mStartTime(0)
+{
+}
+
+BOOL LLPacketReplay::load(const std::string& filename)
+{
+	mPackets.clear();
+	mData.clear();
+	rewind();
+
+	LLFILE* fp = LLFile::fopen(filename, "rb");	/* Flawfinder: ignore */
+	if (!fp)
+	{
+		llwarns << "Unable to open packet capture " << filename << llendl;
+		return FALSE;
+	}
+
+	char magic[sizeof(CAPTURE_MAGIC)];
+	U16 version = 0;
+	if (fread(magic, sizeof(magic), 1, fp) != 1
+		|| fread(&version, sizeof(version), 1, fp) != 1
+		|| memcmp(magic, CAPTURE_MAGIC, sizeof(magic))
+		|| version != CAPTURE_VERSION)
+	{
+		llwarns << filename << " is not a version " << CAPTURE_VERSION
+				<< " packet capture" << llendl;
+		fclose(fp);
+		return FALSE;
+	}
+
+	while (true)
+	{
+		Packet packet;
+		U32 ip = 0;
+		U32 port = 0;
+		U32 size = 0;
+		if (fread(&packet.mReceiveTime, sizeof(packet.mReceiveTime), 1, fp) != 1)
+		{
+			break;
+		}
+		if (fread(&ip, sizeof(ip), 1, fp) != 1
+			|| fread(&port, sizeof(port), 1, fp) != 1
+			|| fread(&size, sizeof(size), 1, fp) != 1
+			|| size > (U32)NET_BUFFER_SIZE)
+		{
+			llwarns << "Truncated or corrupt record after " << mPackets.size()
+					<< " packets in " << filename << llendl;
+			break;
+		}
+		packet.mSender.set(ip, port);
+		packet.mOffset = mData.size();
+		packet.mSize = size;
+		mData.resize(mData.size() + size);
+		if (size && fread(&mData[packet.mOffset], 1, size, fp) != size)
+		{
+			llwarns << "Truncated record after " << mPackets.size()
+					<< " packets in " << filename << llendl;
+			mData.resize(packet.mOffset);
+			break;
+		}
+		mPackets.push_back(packet);
+	}
+	fclose(fp);
+
+	llinfos << "Loaded " << mPackets.size() << " packets from " << filename << llendl;
+	return TRUE;
+}
+
+S32 LLPacketReplay::receivePacket(char* datap, LLHost& sender)
+{
+	if (isDone())
+	{
+		return 0;
+	}
+
+	const Packet& packet = mPackets[mNextPacket];
+	if (mRealtime)
+	{
+		U64 now = totalTime();
+		if (!mStartTime)
+		{
+			mStartTime = now;
+		}
+		if (now - mStartTime < packet.mReceiveTime - mPackets[0].mReceiveTime)
+		{
+			return 0;
+		}
+	}
+
+	if (packet.mSize)
+	{
+		memcpy(datap, &mData[packet.mOffset], packet.mSize);	/* Flawfinder: ignore */
+	}
+	sender = packet.mSender;
+	mNextPacket++;
+	return packet.mSize;
+}
+
+void LLPacketReplay::getSenders(std::vector<LLHost>& senders) const
+{
+	std::set<LLHost> unique;
+	for (std::vector<Packet>::const_iterator it = mPackets.begin(); it != mPackets.end(); ++it)
+	{
+		unique.insert(it->mSender);
+	}
+	senders.assign(unique.begin(), unique.end());
+}
@@ -0,0 +1,113 @@
+/** 
+ * @file llpacketcapture.h
+ * @brief Recording received UDP packets and playing them back
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ * 
+ * Copyright (c) 2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLPACKETCAPTURE_H
+#define LL_LLPACKETCAPTURE_H
+
+#include <vector>
+
+#include "llfile.h"
+#include "llhost.h"
+
+//----------------------------------------------------------------------------
+// A capture file is an 8 byte header ("LLPCAP" and a U16 version)
+// followed by one record per received packet:
+//
+//   U64 receive time, usec from totalTime()
+//   U32 sender IP, network byte order as in LLHost
+//   U32 sender port
+//   U32 size
+//   size bytes of packet, exactly as read off the socket
+//
+// Integers are written in the capturing machine's byte order.
+//----------------------------------------------------------------------------
+
+class LLPacketCapture
+{
+public:
+	LLPacketCapture();
+	~LLPacketCapture();
+
+	BOOL open(const std::string& filename);
+	void close();
+	BOOL isOpen() const				{ return mFile != NULL; }
+
+	void writePacket(U64 receive_time, const LLHost& sender, const char* datap, S32 size);
+
+	U32 getPacketCount() const		{ return mPacketCount; }
+
+private:
+	LLFILE* mFile;
+	U32 mPacketCount;
+};
+
+class LLPacketReplay
+{
+public:
+	LLPacketReplay();
+
+	// Reads the whole capture into memory, so replay never waits on disk.
+	BOOL load(const std::string& filename);
+
+	// With realtime set, packets come out with the spacing they were
+	// captured with, starting from the first receivePacket() call.
+	// Otherwise each call returns the next packet.
+	void setRealtime(bool realtime)	{ mRealtime = realtime; }
+
+	// Copies the next packet that is due into datap, which must hold
+	// NET_BUFFER_SIZE bytes, and returns its size, or 0 if none is due.
+	S32 receivePacket(char* datap, LLHost& sender);
+
+	BOOL isDone() const				{ return mNextPacket >= mPackets.size(); }
+	void rewind()					{ mNextPacket = 0; mStartTime = 0; }
+
+	U32 getPacketCount() const		{ return mPackets.size(); }
+	U32 getPacketsReplayed() const	{ return mNextPacket; }
+	void getSenders(std::vector<LLHost>& senders) const;
+
+private:
+	struct Packet
+	{
+		U64		mReceiveTime;
+		LLHost	mSender;
+		U32		mOffset;	// into mData
+		S32		mSize;
+	};
+
+	std::vector<Packet> mPackets;
+	std::vector<char> mData;
+	U32 mNextPacket;
+	bool mRealtime;
+	U64 mStartTime;
+};
+
+#endif // LL_LLPACKETCAPTURE_H
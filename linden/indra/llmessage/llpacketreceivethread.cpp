@@ -0,0 +1,157 @@
+/** 
+ * @file llpacketreceivethread.cpp
+ * @brief Thread that drains the message socket into a ring of packet buffers.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ * 
+ * Copyright (c) 2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llpacketreceivethread.h"
+
+#include "llmath.h"
+#include "timing.h"
+
+// How long the thread waits on the socket before checking whether it
+// should stop.
+static const S32 RECEIVE_WAIT_MS = 10;
+
+// Packets asked for per receive call.
+static const U32 RECEIVE_BATCH = 32;
+
+LLPacketReceiveThread::LLPacketReceiveThread(S32 socket, U32 ring_size)
+:	LLThread("Packet Receive"),
+	mSocket(socket),
+	mSlots(NULL),
+	mRingMask(0),
+	mWriteCount(0),
+	mReadCount(0),
+	mPacketsReceived(0),
+	mBatchesReceived(0),
+	mRingFullCount(0),
+	mStop(false),
+	mExited(false)
+{
+	// Round up to a power of two so the counters can wrap freely.
+	U32 size = RECEIVE_BATCH;
+	while (size < ring_size)
+	{
+		size <<= 1;
+	}
+	mSlots = new Slot[size];
+	mRingMask = size - 1;
+}
+
+LLPacketReceiveThread::~LLPacketReceiveThread()
+{
+	if (mAPRThreadp)
+	{
+		// Wait for run() to return before the ring goes away.
+		mStop = true;
+		while (!mExited)
+		{
+			ms_sleep(1);
+		}
+	}
+	delete[] mSlots;
+	mSlots = NULL;
+	// ~LLThread() will be called here
+}
+
+void LLPacketReceiveThread::run()
+{
+	LLNetPacket packets[RECEIVE_BATCH];
+	U32 ring_size = mRingMask + 1;
+
+	while (!mStop)
+	{
+		U32 write_count = mWriteCount;
+		U32 free_slots = ring_size - (write_count - (U32)mReadCount);
+		if (!free_slots)
+		{
+			// The main thread has fallen behind; leave the rest in the
+			// socket buffer until it catches up.
+			mRingFullCount++;
+			ms_sleep(1);
+			continue;
+		}
+
+		if (!wait_for_packet(mSocket, RECEIVE_WAIT_MS))
+		{
+			continue;
+		}
+
+		U32 batch = llmin(free_slots, RECEIVE_BATCH);
+		for (U32 i = 0; i < batch; i++)
+		{
+			packets[i].mData = mSlots[(write_count + i) & mRingMask].mData;
+		}
+
+		S32 count = receive_packets(mSocket, packets, batch);
+		if (count <= 0)
+		{
+			continue;
+		}
+
+		U64 now = totalTime();
+		for (S32 i = 0; i < count; i++)
+		{
+			Slot& slot = mSlots[(write_count + i) & mRingMask];
+			slot.mSize = packets[i].mSize;
+			slot.mSender.set(packets[i].mSenderIP, packets[i].mSenderPort);
+			slot.mReceivingIF.set(packets[i].mReceivingIP, INVALID_PORT);
+			slot.mReceiveTime = now;
+		}
+
+		// Publishing the new count hands the slots to the consumer.
+		mWriteCount = write_count + count;
+		mPacketsReceived += count;
+		mBatchesReceived++;
+	}
+
+	mExited = true;
+}
+
+S32 LLPacketReceiveThread::receivePacket(char* datap, LLHost& sender, LLHost& receiving_if, U64& receive_time)
+{
+	U32 read_count = mReadCount;
+	if (read_count == (U32)mWriteCount)
+	{
+		return 0;
+	}
+
+	const Slot& slot = mSlots[read_count & mRingMask];
+	memcpy(datap, slot.mData, slot.mSize);		/* Flawfinder: ignore */
+	sender = slot.mSender;
+	receiving_if = slot.mReceivingIF;
+	receive_time = slot.mReceiveTime;
+
+	// Only now may the thread reuse the slot.
+	mReadCount = read_count + 1;
+	return slot.mSize;
+}
@@ -0,0 +1,92 @@
+/** 
+ * @file llpacketreceivethread.h
+ * @brief Thread that drains the message socket into a ring of packet buffers.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ * 
+ * Copyright (c) 2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLPACKETRECEIVETHREAD_H
+#define LL_LLPACKETRECEIVETHREAD_H
+
+#include "llapr.h"
+#include "llhost.h"
+#include "llthread.h"
+#include "net.h"
+
+//----------------------------------------------------------------------------
+// Reads the message system's socket on a thread of its own, a batch of
+// datagrams per system call, into a ring of preallocated buffers. The main
+// thread takes packets out of the ring with receivePacket() instead of
+// making a syscall per packet in the middle of the frame.
+//
+// The ring has one producer (this thread) and one consumer (the thread
+// calling receivePacket()), so the two only share a pair of counters.
+// When the ring is full the thread stops reading and lets the kernel's
+// socket buffer absorb the burst.
+//----------------------------------------------------------------------------
+
+class LLPacketReceiveThread : public LLThread
+{
+public:
+	LLPacketReceiveThread(S32 socket, U32 ring_size = 1024);
+	virtual ~LLPacketReceiveThread();
+
+	// Consumer side. Copies the oldest packet into datap, which must hold
+	// NET_BUFFER_SIZE bytes, and returns its size, or 0 if none is waiting.
+	// receive_time is when the packet came off the socket, from totalTime().
+	S32 receivePacket(char* datap, LLHost& sender, LLHost& receiving_if, U64& receive_time);
+
+	U32 getPacketsReceived()	{ return mPacketsReceived; }
+	U32 getBatchesReceived()	{ return mBatchesReceived; }	// receive calls that returned packets
+	U32 getRingFullCount()		{ return mRingFullCount; }		// times the reader waited on the ring
+
+private:
+	/*virtual*/ void run();
+
+	struct Slot
+	{
+		char	mData[NET_BUFFER_SIZE];		/* Flawfinder: ignore */
+		S32		mSize;
+		LLHost	mSender;
+		LLHost	mReceivingIF;
+		U64		mReceiveTime;
+	};
+
+	S32 mSocket;
+	Slot* mSlots;
+	U32 mRingMask;
+	LLAtomicU32 mWriteCount;	// packets put in the ring, only written by the thread
+	LLAtomicU32 mReadCount;		// packets taken out, only written by the consumer
+	LLAtomicU32 mPacketsReceived;
+	LLAtomicU32 mBatchesReceived;
+	LLAtomicU32 mRingFullCount;
+	volatile bool mStop;
+	volatile bool mExited;
+};
+
+#endif // LL_LLPACKETRECEIVETHREAD_H
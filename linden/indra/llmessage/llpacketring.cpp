@@ -36,6 +36,8 @@
 
 // linden library includes
 #include "llerror.h"
+#include "llpacketcapture.h"
+#include "llpacketreceivethread.h"
 #include "lltimer.h"
 #include "timing.h"
 #include "llrand.h"
@@ -53,7 +55,11 @@ LLPacketRing::LLPacketRing () :
 	mInBufferLength(0),
 	mOutBufferLength(0),
 	mDropPercentage(0.0f),
-	mPacketsToDrop(0x0)
+	mPacketsToDrop(0x0),
+	mLastReceiveTime(0),
+	mReceiveThread(NULL),
+	mCapture(NULL),
+	mReplay(NULL)
 {
 }
 
@@ -66,6 +72,10 @@ LLPacketRing::~LLPacketRing ()
 ///////////////////////////////////////////////////////////
 void LLPacketRing::cleanup ()
 {
+	stopReceiveThread();
+	stopCapture();
+	stopReplay();
+
 	LLPacketBuffer *packetp;
 
 	while (!mReceiveQueue.empty())
@@ -114,6 +124,87 @@ void LLPacketRing::setOutBandwidth(const F32 bps)
 {
 	mOutThrottle.setRate(bps);
 }
+
+void LLPacketRing::startReceiveThread(S32 socket)
+{
+	if (!mReceiveThread)
+	{
+		mReceiveThread = new LLPacketReceiveThread(socket);
+		mReceiveThread->start();
+	}
+}
+
+void LLPacketRing::stopReceiveThread()
+{
+	if (mReceiveThread)
+	{
+		llinfos << "Packet receive thread read " << mReceiveThread->getPacketsReceived()
+				<< " packets in " << mReceiveThread->getBatchesReceived() << " batches, ring full "
+				<< mReceiveThread->getRingFullCount() << " times" << llendl;
+		delete mReceiveThread;
+		mReceiveThread = NULL;
+	}
+}
+
+BOOL LLPacketRing::startCapture(const std::string& filename)
+{
+	stopCapture();
+	mCapture = new LLPacketCapture;
+	if (!mCapture->open(filename))
+	{
+		stopCapture();
+		return FALSE;
+	}
+	return TRUE;
+}
+
+void LLPacketRing::stopCapture()
+{
+	delete mCapture;
+	mCapture = NULL;
+}
+
+void LLPacketRing::startReplay(LLPacketReplay* replay)
+{
+	stopReplay();
+	mReplay = replay;
+}
+
+void LLPacketRing::stopReplay()
+{
+	delete mReplay;
+	mReplay = NULL;
+}
+
+// One packet straight from the socket, from the receive thread's ring, or
+// from a capture being replayed.
+S32 LLPacketRing::receiveFromNet(S32 socket, char* datap)
+{
+	S32 packet_size = 0;
+	if (mReplay)
+	{
+		packet_size = mReplay->receivePacket(datap, mLastSender);
+		mLastReceivingIF.invalidate();
+		mLastReceiveTime = totalTime();
+	}
+	else if (mReceiveThread)
+	{
+		packet_size = mReceiveThread->receivePacket(datap, mLastSender, mLastReceivingIF, mLastReceiveTime);
+	}
+	else
+	{
+		packet_size = receive_packet(socket, datap);
+		mLastSender = ::get_sender();
+		mLastReceivingIF = ::get_receiving_interface();
+		mLastReceiveTime = totalTime();
+	}
+
+	if (mCapture && packet_size)
+	{
+		mCapture->writePacket(mLastReceiveTime, mLastSender, datap, packet_size);
+	}
+	return packet_size;
+}
 ///////////////////////////////////////////////////////////
 S32 LLPacketRing::receiveFromRing (S32 socket, char *datap)
 {
@@ -165,7 +256,16 @@ S32 LLPacketRing::receivePacket (S32 socket, char *datap)
 		while (!done)
 		{
 			LLPacketBuffer *packetp;
-			packetp = new LLPacketBuffer(socket);
+			if (mReceiveThread || mReplay || mCapture)
+			{
+				char buffer[NET_BUFFER_SIZE];	/* Flawfinder: ignore */
+				S32 size = receiveFromNet(socket, buffer);
+				packetp = new LLPacketBuffer(mLastSender, buffer, size, mLastReceivingIF);
+			}
+			else
+			{
+				packetp = new LLPacketBuffer(socket);
+			}
 
 			if (packetp->getSize())
 			{
@@ -222,9 +322,7 @@ S32 LLPacketRing::receivePacket (S32 socket, char *datap)
 	else
 	{
 		// no delay, pull straight from net
-		packet_size = receive_packet(socket, datap);		
-		mLastSender = ::get_sender();
-		mLastReceivingIF = ::get_receiving_interface();
+		packet_size = receiveFromNet(socket, datap);
 
 		if (packet_size)  // did we actually get a packet?
 		{
@@ -247,6 +345,12 @@ S32 LLPacketRing::receivePacket (S32 socket, char *datap)
 BOOL LLPacketRing::sendPacket(int h_socket, char * send_buffer, S32 buf_size, LLHost host)
 {
 	BOOL status = TRUE;
+	if (mReplay)
+	{
+		// replayed circuits have nobody on the other end
+		return TRUE;
+	}
+
 	if (!mUseOutThrottle)
 	{
 		return send_packet(h_socket, send_buffer, buf_size, host.getAddress(), host.getPort() );
@@ -41,6 +41,9 @@
 #include "net.h"
 #include "llthrottle.h"
 
+class LLPacketCapture;
+class LLPacketReceiveThread;
+class LLPacketReplay;
 
 class LLPacketRing
 {
@@ -61,8 +64,25 @@ public:
 
 	BOOL sendPacket(int h_socket, char * send_buffer, S32 buf_size, LLHost host);
 
+	// Receive on a separate thread from now on, instead of reading the
+	// socket directly in receivePacket().
+	void startReceiveThread(S32 socket);
+	void stopReceiveThread();
+	LLPacketReceiveThread* getReceiveThread()	{ return mReceiveThread; }
+
+	// Write every packet received from now on to a capture file.
+	BOOL startCapture(const std::string& filename);
+	void stopCapture();
+
+	// Receive from a loaded capture instead of the network, and drop
+	// everything sent, until stopReplay(). Takes ownership of replay.
+	void startReplay(LLPacketReplay* replay);
+	void stopReplay();
+	LLPacketReplay* getReplay()					{ return mReplay; }
+
 	inline LLHost getLastSender();
 	inline LLHost getLastReceivingInterface();
+	U64 getLastReceiveTime() const				{ return mLastReceiveTime; }	// from totalTime()
 
 	S32 getAndResetActualInBits()				{ S32 bits = mActualBitsIn; mActualBitsIn = 0; return bits;}
 	S32 getAndResetActualOutBits()				{ S32 bits = mActualBitsOut; mActualBitsOut = 0; return bits;}
@@ -88,6 +108,14 @@ protected:
 
 	LLHost mLastSender;
 	LLHost mLastReceivingIF;
+	U64 mLastReceiveTime;
+
+	LLPacketReceiveThread* mReceiveThread;
+	LLPacketCapture* mCapture;
+	LLPacketReplay* mReplay;
+
+private:
+	S32 receiveFromNet(S32 socket, char* datap);
 };
 
 
@@ -0,0 +1,328 @@
+/** 
+ * @file llpacketwindow.h
+ * @brief Sequence-indexed rings for tracking packets by circuit packet ID
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ * 
+ * Copyright (c) 2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLPACKETWINDOW_H
+#define LL_LLPACKETWINDOW_H
+
+#include <vector>
+
+// Circuit packet IDs are 24 bits and wrap, see LL_MAX_OUT_PACKET_ID.
+const TPACKETID LL_PACKET_ID_MASK = 0x00FFFFFF;
+const TPACKETID LL_PACKET_ID_HALF_RANGE = 0x00800000;
+
+// TRUE if a comes before b in sequence, allowing for wrap.
+inline bool ll_packet_id_before(TPACKETID a, TPACKETID b)
+{
+	TPACKETID delta = (b - a) & LL_PACKET_ID_MASK;
+	return (delta != 0) && (delta < LL_PACKET_ID_HALF_RANGE);
+}
+
+inline TPACKETID ll_next_packet_id(TPACKETID id)
+{
+	return (id + 1) & LL_PACKET_ID_MASK;
+}
+
+//----------------------------------------------------------------------------
+// LLPacketWindow maps packet IDs to values over a window of IDs that
+// moves forward as packets are sent or received.  Slots are indexed by
+// the low bits of the ID, so find, insert and erase are O(1), and walking
+// forward from oldest() visits entries in sequence order, even across a
+// wrap.  The ring doubles whenever the window outgrows it.
+//
+// With max_span set, an insert past the end of a window that long drops
+// the oldest entries to make room, and an insert before its start is
+// refused.
+//----------------------------------------------------------------------------
+
+template <class T>
+class LLPacketWindow
+{
+public:
+	LLPacketWindow(U32 max_span = 0)
+	:	mMask(0),
+		mOldest(0),
+		mNewest(0),
+		mCount(0),
+		mMaxSpan(max_span)
+	{
+	}
+
+	bool empty() const				{ return mCount == 0; }
+	U32 size() const				{ return mCount; }
+
+	// Only meaningful when not empty.
+	TPACKETID oldest() const		{ return mOldest; }
+	TPACKETID newest() const		{ return mNewest; }
+
+	T* find(TPACKETID id)
+	{
+		if (!mCount)
+		{
+			return NULL;
+		}
+		Slot& slot = mSlots[id & mMask];
+		return (slot.mUsed && (slot.mID == id)) ? &slot.mValue : NULL;
+	}
+
+	// Returns the first entry at or after id, and moves id to it, or
+	// NULL if there is nothing between id and newest().  Entries may be
+	// erased while walking, but pointers do not survive an insert.
+	T* findFrom(TPACKETID& id)
+	{
+		if (!mCount)
+		{
+			return NULL;
+		}
+		if (ll_packet_id_before(id, mOldest))
+		{
+			id = mOldest;
+		}
+		while (!ll_packet_id_before(mNewest, id))
+		{
+			T* valuep = find(id);
+			if (valuep)
+			{
+				return valuep;
+			}
+			id = ll_next_packet_id(id);
+		}
+		return NULL;
+	}
+
+	// Adds or replaces the value for id.  Returns false if id was
+	// refused for being too far behind the window.
+	bool insert(TPACKETID id, const T& value)
+	{
+		id &= LL_PACKET_ID_MASK;
+		if (!mCount)
+		{
+			reserve(1);
+			mOldest = mNewest = id;
+		}
+		else if (ll_packet_id_before(id, mOldest))
+		{
+			U32 span = getSpan(id, mNewest);
+			if (mMaxSpan && (span > mMaxSpan))
+			{
+				return false;
+			}
+			reserve(span);
+			mOldest = id;
+		}
+		else if (ll_packet_id_before(mNewest, id))
+		{
+			while (mMaxSpan && mCount && (getSpan(mOldest, id) > mMaxSpan))
+			{
+				erase(mOldest);
+			}
+			if (!mCount)
+			{
+				mOldest = id;
+			}
+			reserve(getSpan(mOldest, id));
+			mNewest = id;
+		}
+
+		Slot& slot = mSlots[id & mMask];
+		if (!slot.mUsed)
+		{
+			slot.mUsed = true;
+			slot.mID = id;
+			++mCount;
+		}
+		slot.mValue = value;
+		return true;
+	}
+
+	bool erase(TPACKETID id)
+	{
+		if (!find(id))
+		{
+			return false;
+		}
+		Slot& slot = mSlots[id & mMask];
+		slot.mUsed = false;
+		slot.mValue = T();
+		if (!--mCount)
+		{
+			return true;
+		}
+
+		// Pull the ends of the window in to the nearest live entries.
+		if (id == mOldest)
+		{
+			do
+			{
+				mOldest = ll_next_packet_id(mOldest);
+			} while (!find(mOldest));
+		}
+		else if (id == mNewest)
+		{
+			do
+			{
+				mNewest = (mNewest - 1) & LL_PACKET_ID_MASK;
+			} while (!find(mNewest));
+		}
+		return true;
+	}
+
+	// Erases every entry that comes before id.
+	void eraseBefore(TPACKETID id)
+	{
+		while (mCount && ll_packet_id_before(mOldest, id))
+		{
+			erase(mOldest);
+		}
+	}
+
+	void clear()
+	{
+		mSlots.clear();
+		mMask = 0;
+		mCount = 0;
+	}
+
+private:
+	struct Slot
+	{
+		Slot() : mValue(), mID(0), mUsed(false) {}
+
+		T			mValue;
+		TPACKETID	mID;
+		bool		mUsed;
+	};
+
+	static U32 getSpan(TPACKETID first, TPACKETID last)
+	{
+		return ((last - first) & LL_PACKET_ID_MASK) + 1;
+	}
+
+	void reserve(U32 span)
+	{
+		if (span <= mSlots.size())
+		{
+			return;
+		}
+		U32 capacity = mSlots.empty() ? MIN_SLOTS : mSlots.size();
+		while (capacity < span)
+		{
+			capacity <<= 1;
+		}
+
+		std::vector<Slot> slots(capacity);
+		for (U32 i = 0; i < mSlots.size(); ++i)
+		{
+			if (mSlots[i].mUsed)
+			{
+				slots[mSlots[i].mID & (capacity - 1)] = mSlots[i];
+			}
+		}
+		mSlots.swap(slots);
+		mMask = capacity - 1;
+	}
+
+	enum { MIN_SLOTS = 32 };
+
+	std::vector<Slot> mSlots;
+	U32 mMask;
+	TPACKETID mOldest;
+	TPACKETID mNewest;
+	U32 mCount;
+	U32 mMaxSpan;
+};
+
+//----------------------------------------------------------------------------
+// LLPacketIDQueue is a FIFO of packet IDs waiting to be acked.  Acks are
+// taken off the front in batches as they are piggybacked on outgoing
+// packets, which only moves the head instead of shifting the rest down.
+//----------------------------------------------------------------------------
+
+class LLPacketIDQueue
+{
+public:
+	LLPacketIDQueue() : mHead(0), mCount(0) {}
+
+	bool empty() const				{ return mCount == 0; }
+	U32 size() const				{ return mCount; }
+
+	TPACKETID operator[](U32 i) const
+	{
+		return mIDs[(mHead + i) & (mIDs.size() - 1)];
+	}
+
+	void push(TPACKETID id)
+	{
+		if (mCount == mIDs.size())
+		{
+			grow();
+		}
+		mIDs[(mHead + mCount) & (mIDs.size() - 1)] = id;
+		++mCount;
+	}
+
+	// Drops count IDs from the front.
+	void pop(U32 count)
+	{
+		if (count >= mCount)
+		{
+			clear();
+			return;
+		}
+		mHead = (mHead + count) & (mIDs.size() - 1);
+		mCount -= count;
+	}
+
+	// Keeps the storage, the queue refills at about the same rate.
+	void clear()
+	{
+		mHead = 0;
+		mCount = 0;
+	}
+
+private:
+	void grow()
+	{
+		std::vector<TPACKETID> ids(mIDs.empty() ? 64 : mIDs.size() * 2);
+		for (U32 i = 0; i < mCount; ++i)
+		{
+			ids[i] = (*this)[i];
+		}
+		mIDs.swap(ids);
+		mHead = 0;
+	}
+
+	std::vector<TPACKETID> mIDs;
+	U32 mHead;
+	U32 mCount;
+};
+
+#endif // LL_LLPACKETWINDOW_H
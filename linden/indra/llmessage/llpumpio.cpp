@@ -59,6 +59,13 @@
 #include <typeinfo>
 #endif
 
+#if LL_PUMPIO_EPOLL
+#include <errno.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#include "apr_portable.h"
+#endif
+
 // constants for poll timeout. if we are threading, we want to have a
 // longer poll timeout.
 #if LL_THREADS_APR
@@ -67,6 +74,12 @@ static const S32 DEFAULT_POLL_TIMEOUT = 1000;
 static const S32 DEFAULT_POLL_TIMEOUT = 0;
 #endif
 
+#if LL_PUMPIO_EPOLL
+// The most events we will pull out of the kernel in one poll. Anything
+// left over is still ready on the next pump.
+static const S32 EPOLL_MAX_EVENTS = 256;
+#endif
+
 // The default (and fallback) expiration time for chains
 const F32 DEFAULT_CHAIN_EXPIRY_SECS = 30.0f;
 extern const F32 SHORT_CHAIN_EXPIRY_SECS = 1.0f;
@@ -127,6 +140,49 @@ void ll_debug_poll_fd(const char* msg, const apr_pollfd_t* poll)
 #endif	
 }
 
+#if LL_PUMPIO_EPOLL
+int ll_pollfd_os_descriptor(const apr_pollfd_t& poll)
+{
+	if((APR_POLL_SOCKET == poll.desc_type) && poll.desc.s)
+	{
+		apr_os_sock_t os_sock;
+		if(APR_SUCCESS == apr_os_sock_get(&os_sock, poll.desc.s))
+		{
+			return os_sock;
+		}
+	}
+	else if((APR_POLL_FILE == poll.desc_type) && poll.desc.f)
+	{
+		apr_os_file_t os_file;
+		if(APR_SUCCESS == apr_os_file_get(&os_file, poll.desc.f))
+		{
+			return os_file;
+		}
+	}
+	return -1;
+}
+
+U32 ll_apr_to_epoll_events(apr_int16_t events)
+{
+	U32 rv = 0;
+	if(events & APR_POLLIN) rv |= EPOLLIN;
+	if(events & APR_POLLPRI) rv |= EPOLLPRI;
+	if(events & APR_POLLOUT) rv |= EPOLLOUT;
+	return rv;
+}
+
+apr_int16_t ll_epoll_to_apr_events(U32 events)
+{
+	apr_int16_t rv = 0;
+	if(events & EPOLLIN) rv |= APR_POLLIN;
+	if(events & EPOLLPRI) rv |= APR_POLLPRI;
+	if(events & EPOLLOUT) rv |= APR_POLLOUT;
+	if(events & EPOLLERR) rv |= APR_POLLERR;
+	if(events & EPOLLHUP) rv |= APR_POLLHUP;
+	return rv;
+}
+#endif
+
 /**
  * @class
  */
@@ -173,6 +229,9 @@ LLPumpIO::LLPumpIO(apr_pool_t* pool) :
 	mRebuildPollset(false),
 	mPollset(NULL),
 	mPollsetClientID(0),
+#if LL_PUMPIO_EPOLL
+	mEpollFD(-1),
+#endif
 	mNextLock(0),
 	mPool(NULL),
 	mCurrentPool(NULL),
@@ -335,9 +394,8 @@ bool LLPumpIO::setConditional(LLIOPipe* pipe, const apr_pollfd_t* poll)
 		LLChainInfo::pipe_conditional_t& value = (*it);
 		if(pipe_ptr == value.first)
 		{
-			ll_delete_apr_pollset_fd_client_data()(value);
+			removeConditional(value);
 			it = (*mCurrentChain).mDescriptors.erase(it);
-			mRebuildPollset = true;
 		}
 		else
 		{
@@ -345,11 +403,7 @@ bool LLPumpIO::setConditional(LLIOPipe* pipe, const apr_pollfd_t* poll)
 		}
 	}
 
-	if(!poll)
-	{
-		mRebuildPollset = true;
-		return true;
-	}
+	if(!poll) return true;
 	LLChainInfo::pipe_conditional_t value;
 	value.first = pipe_ptr;
 	value.second = *poll;
@@ -363,7 +417,7 @@ bool LLPumpIO::setConditional(LLIOPipe* pipe, const apr_pollfd_t* poll)
 	}
 	value.second.client_data = new S32(++mPollsetClientID);
 	(*mCurrentChain).mDescriptors.push_back(value);
-	mRebuildPollset = true;
+	addConditional(value);
 	return true;
 }
 
@@ -519,15 +573,60 @@ void LLPumpIO::pump(const S32& poll_timeout)
 	// *TODO: may want to pass in a poll timeout so it works correctly
 	// in single and multi threaded processes.
 	PUMP_DEBUG;
-	typedef std::map<S32, S32> signal_client_t;
+	typedef std::map<S32, apr_int16_t> signal_client_t;
 	signal_client_t signalled_client;
-	const apr_pollfd_t* poll_fd = NULL;
+#if LL_PUMPIO_EPOLL
+	if(mEpollFD >= 0)
+	{
+		if(!mEpollClients.empty())
+		{
+			PUMP_DEBUG;
+			// epoll wants milliseconds, so round up anything shorter
+			// rather than turning a short wait into a busy loop.
+			int timeout_ms = -1;
+			if(poll_timeout >= 0) timeout_ms = (poll_timeout + 999) / 1000;
+			struct epoll_event events[EPOLL_MAX_EVENTS];
+			S32 count = 0;
+			{
+				LLPerfBlock polltime("pump_poll");
+				count = epoll_wait(
+					mEpollFD,
+					events,
+					EPOLL_MAX_EVENTS,
+					timeout_ms);
+			}
+			PUMP_DEBUG;
+			epoll_clients_t::const_iterator watch;
+			epoll_watchers_t::const_iterator client;
+			for(S32 ii = 0; ii < count; ++ii)
+			{
+				watch = mEpollClients.find(events[ii].data.fd);
+				if(watch == mEpollClients.end()) continue;
+				apr_int16_t rtnevents =
+					ll_epoll_to_apr_events(events[ii].events);
+
+				// Every client on the descriptor hears about errors,
+				// but only about the i/o events it asked for.
+				client = (*watch).second.begin();
+				for(; client != (*watch).second.end(); ++client)
+				{
+					apr_int16_t signal = rtnevents
+						& ((*client).second | APR_POLLERR | APR_POLLHUP);
+					if(signal) signalled_client[(*client).first] = signal;
+				}
+			}
+			PUMP_DEBUG;
+		}
+	}
+	else
+#endif
 	if(mPollset)
 	{
 		PUMP_DEBUG;
 		//llinfos << "polling" << llendl;
 		S32 count = 0;
 		S32 client_id = 0;
+		const apr_pollfd_t* poll_fd = NULL;
         {
             LLPerfBlock polltime("pump_poll");
             apr_pollset_poll(mPollset, poll_timeout, &count, &poll_fd);
@@ -537,7 +636,7 @@ void LLPumpIO::pump(const S32& poll_timeout)
 		{
 			ll_debug_poll_fd("Signalled pipe", &poll_fd[ii]);
 			client_id = *((S32*)poll_fd[ii].client_data);
-			signalled_client[client_id] = ii;
+			signalled_client[client_id] = poll_fd[ii].rtnevents;
 		}
 		PUMP_DEBUG;
 	}
@@ -589,6 +688,7 @@ void LLPumpIO::pump(const S32& poll_timeout)
 //						<< (*run_chain).mChainLinks[0].mPipe
 //						<< " because we reached the end." << llendl;
 #endif
+				clearConditionals(*run_chain);
 				run_chain = mRunningChains.erase(run_chain);
 				continue;
 			}
@@ -633,8 +733,8 @@ void LLPumpIO::pump(const S32& poll_timeout)
 					if (signal == not_signalled) continue;
 					static const apr_int16_t POLL_CHAIN_ERROR =
 						APR_POLLHUP | APR_POLLNVAL | APR_POLLERR;
-					const apr_pollfd_t* poll = &(poll_fd[(*signal).second]);
-					if(poll->rtnevents & POLL_CHAIN_ERROR)
+					apr_int16_t rtnevents = (*signal).second;
+					if(rtnevents & POLL_CHAIN_ERROR)
 					{
 						// Potential eror condition has been
 						// returned. If HUP was one of them, we pass
@@ -645,12 +745,12 @@ void LLPumpIO::pump(const S32& poll_timeout)
 						// the logic here gets no more strained than
 						// it already is.
 						LLIOPipe::EStatus error_status;
-						if(poll->rtnevents & APR_POLLHUP)
+						if(rtnevents & APR_POLLHUP)
 							error_status = LLIOPipe::STATUS_LOST_CONNECTION;
 						else
 							error_status = LLIOPipe::STATUS_ERROR;
 						if(handleChainError(*run_chain, error_status)) break;
-						ll_debug_poll_fd("Removing pipe", poll);
+						ll_debug_poll_fd("Removing pipe", &((*it).second));
 						llwarns << "Removing pipe "
 							<< (*run_chain).mChainLinks[0].mPipe
 							<< " '"
@@ -659,7 +759,7 @@ void LLPumpIO::pump(const S32& poll_timeout)
 								*((*run_chain).mChainLinks[0].mPipe)).name()
 #endif
 							<< "' because: "
-							<< events_2_string(poll->rtnevents)
+							<< events_2_string(rtnevents)
 							<< llendl;
 						(*run_chain).mHead = (*run_chain).mChainLinks.end();
 						break;
@@ -700,14 +800,8 @@ void LLPumpIO::pump(const S32& poll_timeout)
 			PUMP_DEBUG;
 			// This chain is done. Clean up any allocated memory and
 			// erase the chain info.
-			std::for_each(
-				(*run_chain).mDescriptors.begin(),
-				(*run_chain).mDescriptors.end(),
-				ll_delete_apr_pollset_fd_client_data());
+			clearConditionals(*run_chain);
 			run_chain = mRunningChains.erase(run_chain);
-
-			// *NOTE: may not always need to rebuild the pollset.
-			mRebuildPollset = true;
 		}
 		else
 		{
@@ -836,6 +930,18 @@ void LLPumpIO::initialize(apr_pool_t* pool)
 	apr_thread_mutex_create(&mCallbackMutex, APR_THREAD_MUTEX_UNNESTED, pool);
 #endif
 	mPool = pool;
+#if LL_PUMPIO_EPOLL
+	// the size is only a hint to the kernel.
+	mEpollFD = epoll_create(EPOLL_MAX_EVENTS);
+	if(mEpollFD < 0)
+	{
+		llwarns << "Unable to create epoll descriptor: " << strerror(errno)
+				<< ". Falling back to apr pollset." << llendl;
+	}
+#endif
+
+	// Watch anything which was set on chains before we were (re)primed.
+	mRebuildPollset = true;
 }
 
 void LLPumpIO::cleanup()
@@ -847,6 +953,14 @@ void LLPumpIO::cleanup()
 #endif
 	mChainsMutex = NULL;
 	mCallbackMutex = NULL;
+#if LL_PUMPIO_EPOLL
+	if(mEpollFD >= 0)
+	{
+		close(mEpollFD);
+		mEpollFD = -1;
+	}
+	mEpollClients.clear();
+#endif
 	if(mPollset)
 	{
 //		lldebugs << "cleaning up pollset" << llendl;
@@ -865,6 +979,36 @@ void LLPumpIO::rebuildPollset()
 {
 	LLMemType m1(LLMemType::MTYPE_IO_PUMP);
 //	lldebugs << "LLPumpIO::rebuildPollset()" << llendl;
+#if LL_PUMPIO_EPOLL
+	if(mEpollFD >= 0)
+	{
+		// Drop whatever we were watching and register every
+		// conditional again from scratch.
+		epoll_clients_t::iterator it = mEpollClients.begin();
+		epoll_clients_t::iterator end = mEpollClients.end();
+		struct epoll_event event;
+		memset(&event, 0, sizeof(event));
+		for(; it != end; ++it)
+		{
+			epoll_ctl(mEpollFD, EPOLL_CTL_DEL, (*it).first, &event);
+		}
+		mEpollClients.clear();
+		running_chains_t::iterator run_it = mRunningChains.begin();
+		running_chains_t::iterator run_end = mRunningChains.end();
+		LLChainInfo::conditionals_t::iterator fd_it;
+		LLChainInfo::conditionals_t::iterator fd_end;
+		for(; run_it != run_end; ++run_it)
+		{
+			fd_it = (*run_it).mDescriptors.begin();
+			fd_end = (*run_it).mDescriptors.end();
+			for(; fd_it != fd_end; ++fd_it)
+			{
+				addConditional(*fd_it);
+			}
+		}
+		return;
+	}
+#endif
 	if(mPollset)
 	{
 		//lldebugs << "destroying pollset" << llendl;
@@ -913,6 +1057,136 @@ void LLPumpIO::rebuildPollset()
 	}
 }
 
+void LLPumpIO::addConditional(const LLChainInfo::pipe_conditional_t& value)
+{
+	LLMemType m1(LLMemType::MTYPE_IO_PUMP);
+#if LL_PUMPIO_EPOLL
+	if(mEpollFD >= 0)
+	{
+		int fd = ll_pollfd_os_descriptor(value.second);
+		if(fd < 0)
+		{
+			llwarns << "Unable to find descriptor for conditional." << llendl;
+			return;
+		}
+		S32 client_id = *((S32*)value.second.client_data);
+		epoll_clients_t::iterator it = mEpollClients.find(fd);
+		int op = EPOLL_CTL_ADD;
+		if(it == mEpollClients.end())
+		{
+			it = mEpollClients.insert(
+				epoll_clients_t::value_type(fd, epoll_watchers_t())).first;
+		}
+		else
+		{
+			// Another conditional is already watching the descriptor,
+			// so widen the registration to cover both of them.
+			op = EPOLL_CTL_MOD;
+		}
+		(*it).second[client_id] = value.second.reqevents;
+		int rv = updateEpollDescriptor(fd, op, (*it).second);
+		if(rv && (EPOLL_CTL_MOD == op) && (ENOENT == errno))
+		{
+			// The old watchers' descriptor was closed and the number
+			// reused, so the kernel has already forgotten it.
+			rv = updateEpollDescriptor(fd, EPOLL_CTL_ADD, (*it).second);
+		}
+		if(rv)
+		{
+			llwarns << "Unable to watch fd " << fd << ": " << strerror(errno)
+					<< llendl;
+			(*it).second.erase(client_id);
+			if((*it).second.empty()) mEpollClients.erase(it);
+		}
+		return;
+	}
+#endif
+	mRebuildPollset = true;
+}
+
+void LLPumpIO::removeConditional(const LLChainInfo::pipe_conditional_t& value)
+{
+	LLMemType m1(LLMemType::MTYPE_IO_PUMP);
+#if LL_PUMPIO_EPOLL
+	if(mEpollFD >= 0)
+	{
+		S32 client_id = *((S32*)value.second.client_data);
+		int fd = ll_pollfd_os_descriptor(value.second);
+		epoll_clients_t::iterator it = mEpollClients.find(fd);
+		if((it == mEpollClients.end())
+		   || ((*it).second.find(client_id) == (*it).second.end()))
+		{
+			// The descriptor may have been closed out from under
+			// us. Go looking for whatever this client was watching.
+			for(it = mEpollClients.begin(); it != mEpollClients.end(); ++it)
+			{
+				if((*it).second.count(client_id)) break;
+			}
+		}
+		if(it != mEpollClients.end())
+		{
+			// If the descriptor was already closed the kernel dropped
+			// it for us, so there is no point checking the results.
+			(*it).second.erase(client_id);
+			if((*it).second.empty())
+			{
+				updateEpollDescriptor(
+					(*it).first,
+					EPOLL_CTL_DEL,
+					(*it).second);
+				mEpollClients.erase(it);
+			}
+			else
+			{
+				// Other chains still want this descriptor, so only
+				// narrow the registration to what they asked for.
+				updateEpollDescriptor(
+					(*it).first,
+					EPOLL_CTL_MOD,
+					(*it).second);
+			}
+		}
+	}
+	else
+#endif
+	{
+		mRebuildPollset = true;
+	}
+	ll_delete_apr_pollset_fd_client_data()(value);
+}
+
+#if LL_PUMPIO_EPOLL
+int LLPumpIO::updateEpollDescriptor(
+	int fd,
+	int op,
+	const epoll_watchers_t& watchers)
+{
+	apr_int16_t reqevents = 0;
+	epoll_watchers_t::const_iterator it = watchers.begin();
+	epoll_watchers_t::const_iterator end = watchers.end();
+	for(; it != end; ++it)
+	{
+		reqevents |= (*it).second;
+	}
+	struct epoll_event event;
+	memset(&event, 0, sizeof(event));
+	event.events = ll_apr_to_epoll_events(reqevents);
+	event.data.fd = fd;
+	return epoll_ctl(mEpollFD, op, fd, &event);
+}
+#endif
+
+void LLPumpIO::clearConditionals(LLChainInfo& chain)
+{
+	LLChainInfo::conditionals_t::iterator it = chain.mDescriptors.begin();
+	LLChainInfo::conditionals_t::iterator end = chain.mDescriptors.end();
+	for(; it != end; ++it)
+	{
+		removeConditional(*it);
+	}
+	chain.mDescriptors.clear();
+}
+
 void LLPumpIO::processChain(LLChainInfo& chain)
 {
 	PUMP_DEBUG;
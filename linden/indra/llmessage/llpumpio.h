@@ -35,6 +35,7 @@
 #ifndef LL_LLPUMPIO_H
 #define LL_LLPUMPIO_H
 
+#include <map>
 #include <set>
 #if LL_LINUX  // needed for PATH_MAX in APR.
 #include <sys/param.h>
@@ -49,6 +50,13 @@
 // Define this to enable use with the APR thread library.
 //#define LL_THREADS_APR 1
 
+// On linux, the pump talks to epoll directly so that conditionals can
+// be added and removed one at a time rather than rebuilding the
+// pollset from every running chain.
+#if LL_LINUX
+#define LL_PUMPIO_EPOLL 1
+#endif
+
 // some simple constants to help with timeouts
 extern const F32 DEFAULT_CHAIN_EXPIRY_SECS;
 extern const F32 SHORT_CHAIN_EXPIRY_SECS;
@@ -179,15 +187,14 @@ public:
 	 * @see rebuildPollset()
 	 *
 	 * There is currently a limit of one conditional per pipe.
-	 * *NOTE: The internal mechanism for building a pollset based on
-	 * pipe/pollfd/chain generates an epoll error on linux (and
-	 * probably behaves similarly on other platforms) because the
-	 * pollset rebuilder will add each apr_pollfd_t serially. This
-	 * does not matter for pipes on the same chain, since any
-	 * signalled pipe will eventually invoke a call to process(), but
-	 * is a problem if the same apr_pollfd_t is on different
-	 * chains. Once we have more than just network i/o on the pump,
-	 * this might matter.
+	 * *NOTE: A descriptor can only be watched once. This does not
+	 * matter for pipes on the same chain, since any signalled pipe
+	 * will eventually invoke a call to process(), but is a problem if
+	 * the same apr_pollfd_t is on different chains. The epoll backend
+	 * shares the descriptor and signals every chain watching it, but
+	 * with the apr pollset the rebuilder adds each apr_pollfd_t
+	 * serially and the first one wins. Once we have more than just
+	 * network i/o on the pump, this might matter.
 	 * *FIX: Given the structure of the pump and pipe relationship,
 	 * this should probably go through a different mechanism than the
 	 * pump. I think it would be best if the pipe had some kind of
@@ -345,6 +352,16 @@ protected:
 	bool mRebuildPollset;
 	apr_pollset_t* mPollset;
 	S32 mPollsetClientID;
+#if LL_PUMPIO_EPOLL
+	// The epoll descriptor, or -1 if we fell back to the apr pollset,
+	// and the events each client id wants from every watched
+	// descriptor. A descriptor is registered once for the union of
+	// those events, and a wakeup signals every client on it.
+	int mEpollFD;
+	typedef std::map<S32, apr_int16_t> epoll_watchers_t;
+	typedef std::map<int, epoll_watchers_t> epoll_clients_t;
+	epoll_clients_t mEpollClients;
+#endif
 	S32 mNextLock;
 	std::set<S32> mClearLocks;
 
@@ -415,6 +432,39 @@ protected:
 	 */
 	void rebuildPollset();
 
+	/** 
+	 * @brief Start watching a conditional which was added to a chain.
+	 */
+	void addConditional(const LLChainInfo::pipe_conditional_t& value);
+
+	/** 
+	 * @brief Stop watching a conditional and free its client data.
+	 *
+	 * The caller is still responsible for erasing it from the chain.
+	 */
+	void removeConditional(const LLChainInfo::pipe_conditional_t& value);
+
+#if LL_PUMPIO_EPOLL
+	/** 
+	 * @brief Register, update or drop a descriptor with epoll so it
+	 * matches the clients still watching it.
+	 *
+	 * @param fd The descriptor to update.
+	 * @param op The epoll_ctl() operation to use.
+	 * @param watchers The clients still watching fd.
+	 * @return Returns the epoll_ctl() result.
+	 */
+	int updateEpollDescriptor(
+		int fd,
+		int op,
+		const epoll_watchers_t& watchers);
+#endif
+
+	/** 
+	 * @brief Remove every conditional on a chain which is going away.
+	 */
+	void clearConditionals(LLChainInfo& chain);
+
 	/** 
 	 * @brief Process the chain passed in.
 	 *
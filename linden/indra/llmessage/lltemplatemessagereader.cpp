@@ -43,13 +43,19 @@
 #include "v3math.h"
 #include "v4math.h"
 
+static BOOL sLazyDecode = TRUE;
+
 LLTemplateMessageReader::LLTemplateMessageReader(message_template_number_map_t&
 												 number_template_map) :
 	mReceiveSize(0),
 	mCurrentRMessageTemplate(NULL),
 	mCurrentRMessageData(NULL),
-	mMessageNumbers(number_template_map)
+	mMessageNumbers(number_template_map),
+	mOffsetsValid(false),
+	mLastBlock(0),
+	mLastVariable(0)
 {
+	mReceiveBuffer.reserve(MAX_BUFFER_SIZE);
 }
 
 //virtual 
@@ -66,6 +72,65 @@ void LLTemplateMessageReader::clearMessage()
 	mCurrentRMessageTemplate = NULL;
 	delete mCurrentRMessageData;
 	mCurrentRMessageData = NULL;
+	mOffsetsValid = false;
+	mBlockOffsets.clear();
+	mVarOffsets.clear();
+}
+
+//static
+void LLTemplateMessageReader::setLazyDecode(BOOL b)
+{
+	sLazyDecode = b;
+}
+
+//static
+BOOL LLTemplateMessageReader::getLazyDecode()
+{
+	return sLazyDecode;
+}
+
+S32 LLTemplateMessageReader::findVariable(const char* blockname, S32 blocknum,
+										  const char* varname, S32& var_index,
+										  const LLMessageVariable*& var)
+{
+	// Handlers mostly read blocks and variables in template order, so
+	// start each search where the last one left off. Names are prehashed,
+	// so comparing pointers is enough.
+	const S32 num_blocks = (S32)mBlockOffsets.size();
+	S32 block = -1;
+	for (S32 i = 0; i < num_blocks; i++)
+	{
+		S32 b = (mLastBlock + i) % num_blocks;
+		if (mCurrentRMessageTemplate->mMemberBlocks.begin()[b]->mName == blockname)
+		{
+			block = b;
+			break;
+		}
+	}
+	if (block < 0 || blocknum < 0 || blocknum >= mBlockOffsets[block].mNumber)
+	{
+		return LL_BLOCK_NOT_IN_MESSAGE;
+	}
+	if (block != mLastBlock)
+	{
+		mLastBlock = block;
+		mLastVariable = 0;
+	}
+
+	const LLMessageBlock* mbci = mCurrentRMessageTemplate->mMemberBlocks.begin()[block];
+	const S32 num_vars = (S32)mbci->mMemberVariables.size();
+	for (S32 i = 0; i < num_vars; i++)
+	{
+		S32 v = (mLastVariable + i) % num_vars;
+		if (mbci->mMemberVariables.begin()[v]->getName() == varname)
+		{
+			mLastVariable = (v + 1) % num_vars;
+			var_index = mBlockOffsets[block].mFirstVar + blocknum * num_vars + v;
+			var = mbci->mMemberVariables.begin()[v];
+			return 0;
+		}
+	}
+	return LL_VARIABLE_NOT_IN_BLOCK;
 }
 
 void LLTemplateMessageReader::getData(const char *blockname, const char *varname, void *datap, S32 size, S32 blocknum, S32 max_size)
@@ -77,6 +142,62 @@ void LLTemplateMessageReader::getData(const char *blockname, const char *varname
 		return;
 	}
 
+	if (mOffsetsValid)
+	{
+		S32 var_index = 0;
+		const LLMessageVariable* var = NULL;
+		S32 result = findVariable(blockname, blocknum, varname, var_index, var);
+		if (result == LL_BLOCK_NOT_IN_MESSAGE)
+		{
+			llerrs << "Block " << blockname << " #" << blocknum
+				<< " not in message " << mCurrentRMessageTemplate->mName << llendl;
+			return;
+		}
+		if (result == LL_VARIABLE_NOT_IN_BLOCK)
+		{
+			llerrs << "Variable "<< varname << " not in message "
+				<< mCurrentRMessageTemplate->mName << " block " << blockname << llendl;
+			return;
+		}
+
+		const LLMsgVarOffset& offset = mVarOffsets[var_index];
+		if (size && size != offset.mSize)
+		{
+			llerrs << "Msg " << mCurrentRMessageTemplate->mName 
+				<< " variable " << varname
+				<< " is size " << offset.mSize
+				<< " but copying into buffer of size " << size
+				<< llendl;
+			return;
+		}
+
+		S32 copy_size = offset.mSize;
+		if (max_size < copy_size)
+		{
+			llwarns << "Msg " << mCurrentRMessageTemplate->mName 
+				<< " variable " << varname
+				<< " is size " << offset.mSize
+				<< " but truncated to max size of " << max_size
+				<< llendl;
+			copy_size = max_size;
+		}
+
+		if (offset.mOffset < 0)
+		{
+			// empty, or ran off the end of the packet; reads as zeros
+			memset(datap, 0, copy_size);
+		}
+		else if (copy_size == offset.mSize)
+		{
+			htonmemcpy(datap, &mReceiveBuffer[offset.mOffset], var->getType(), copy_size);
+		}
+		else
+		{
+			memcpy(datap, &mReceiveBuffer[offset.mOffset], copy_size);
+		}
+		return;
+	}
+
 	if (!mCurrentRMessageData)
 	{
 		llerrs << "Invalid mCurrentMessageData in getData!" << llendl;
@@ -160,6 +281,19 @@ S32 LLTemplateMessageReader::getNumberOfBlocks(const char *blockname)
 		return -1;
 	}
 
+	if (mOffsetsValid)
+	{
+		const S32 num_blocks = (S32)mBlockOffsets.size();
+		for (S32 b = 0; b < num_blocks; b++)
+		{
+			if (mCurrentRMessageTemplate->mMemberBlocks.begin()[b]->mName == blockname)
+			{
+				return mBlockOffsets[b].mNumber;
+			}
+		}
+		return 0;
+	}
+
 	if (!mCurrentRMessageData)
 	{
 		llerrs << "Invalid mCurrentRMessageData in getData!" << llendl;
@@ -187,6 +321,32 @@ S32 LLTemplateMessageReader::getSize(const char *blockname, const char *varname)
 		return LL_MESSAGE_ERROR;
 	}
 
+	if (mOffsetsValid)
+	{
+		S32 var_index = 0;
+		const LLMessageVariable* var = NULL;
+		S32 result = findVariable(blockname, 0, varname, var_index, var);
+		if (result == LL_BLOCK_NOT_IN_MESSAGE)
+		{	// don't crash
+			llinfos << "Block " << blockname << " not in message "
+				<< mCurrentRMessageTemplate->mName << llendl;
+			return result;
+		}
+		if (result == LL_VARIABLE_NOT_IN_BLOCK)
+		{	// don't crash
+			llinfos << "Variable " << varname << " not in message "
+				<< mCurrentRMessageTemplate->mName << " block " << blockname << llendl;
+			return result;
+		}
+		if (mCurrentRMessageTemplate->mMemberBlocks.begin()[mLastBlock]->mType != MBT_SINGLE)
+		{	// This is a serious error - crash
+			llerrs << "Block " << blockname << " isn't type MBT_SINGLE,"
+				" use getSize with blocknum argument!" << llendl;
+			return LL_MESSAGE_ERROR;
+		}
+		return mVarOffsets[var_index].mSize;
+	}
+
 	if (!mCurrentRMessageData)
 	{	// This is a serious error - crash
 		llerrs << "Invalid mCurrentRMessageData in getData!" << llendl;
@@ -235,6 +395,26 @@ S32 LLTemplateMessageReader::getSize(const char *blockname, S32 blocknum, const
 		return LL_MESSAGE_ERROR;
 	}
 
+	if (mOffsetsValid)
+	{
+		S32 var_index = 0;
+		const LLMessageVariable* var = NULL;
+		S32 result = findVariable(blockname, blocknum, varname, var_index, var);
+		if (result == LL_BLOCK_NOT_IN_MESSAGE)
+		{	// don't crash
+			llinfos << "Block " << blockname << " #" << blocknum << " not in message "
+				<< mCurrentRMessageTemplate->mName << llendl;
+			return result;
+		}
+		if (result == LL_VARIABLE_NOT_IN_BLOCK)
+		{	// don't crash
+			llinfos << "Variable " << varname << " not in message "
+				<< mCurrentRMessageTemplate->mName << " block " << blockname << llendl;
+			return result;
+		}
+		return mVarOffsets[var_index].mSize;
+	}
+
 	if (!mCurrentRMessageData)
 	{	// This is a serious error - crash
 		llerrs << "Invalid mCurrentRMessageData in getData!" << llendl;
@@ -531,18 +711,9 @@ void LLTemplateMessageReader::logRanOffEndOfPacket( const LLHost& host, const S3
 	gMessageSystem->callExceptionFunc(MX_RAN_OFF_END_OF_PACKET);
 }
 
-// decode a given message
-BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender )
+// decode a given message into an LLMsgData
+BOOL LLTemplateMessageReader::decodeMessageData(const U8* buffer, const LLHost& sender )
 {
-	llassert( mReceiveSize >= 0 );
-	llassert( mCurrentRMessageTemplate);
-	llassert( !mCurrentRMessageData );
-	if (mCurrentRMessageData) {
-		// just to make sure
-		delete mCurrentRMessageData;
-		mCurrentRMessageData = 0;
-	}
-
 	// The offset tells us how may bytes to skip after the end of the
 	// message name.
 	U8 offset = buffer[PHL_OFFSET];
@@ -703,6 +874,161 @@ BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender
 		lldebugs << "Empty message '" << mCurrentRMessageTemplate->mName << "' (no blocks)" << llendl;
 		return FALSE;
 	}
+	return TRUE;
+}
+
+// record where each variable of a given message sits, without copying
+// anything out of the packet
+BOOL LLTemplateMessageReader::decodeOffsets(const U8* buffer, const LLHost& sender)
+{
+	mReceiveBuffer.assign(buffer, buffer + mReceiveSize);
+	mBlockOffsets.resize(mCurrentRMessageTemplate->mMemberBlocks.size());
+	mVarOffsets.clear();
+	mLastBlock = 0;
+	mLastVariable = 0;
+
+	// The offset tells us how may bytes to skip after the end of the
+	// message name.
+	U8 offset = buffer[PHL_OFFSET];
+	S32 decode_pos = LL_PACKET_ID_SIZE + (S32)(mCurrentRMessageTemplate->mFrequency) + offset;
+	S32 total_blocks = 0;
+
+	S32 block_index = 0;
+	LLMessageTemplate::message_block_map_t::const_iterator iter;
+	for(iter = mCurrentRMessageTemplate->mMemberBlocks.begin();
+		iter != mCurrentRMessageTemplate->mMemberBlocks.end();
+		++iter, ++block_index)
+	{
+		LLMessageBlock* mbci = *iter;
+		S32 repeat_number = 0;
+
+		if (mbci->mType == MBT_SINGLE)
+		{
+			repeat_number = 1;
+		}
+		else if (mbci->mType == MBT_MULTIPLE)
+		{
+			repeat_number = mbci->mNumber;
+		}
+		else if (mbci->mType == MBT_VARIABLE)
+		{
+			// missing variable blocks at the end of a message are legal
+			if (decode_pos < mReceiveSize)
+			{
+				repeat_number = buffer[decode_pos];
+				decode_pos++;
+			}
+		}
+		else
+		{
+			llerrs << "Unknown block type" << llendl;
+			return FALSE;
+		}
+
+		LLMsgBlockOffsets& block_offsets = mBlockOffsets[block_index];
+		block_offsets.mFirstVar = (S32)mVarOffsets.size();
+		block_offsets.mNumber = repeat_number;
+		total_blocks += repeat_number;
+
+		for (S32 i = 0; i < repeat_number; i++)
+		{
+			for (LLMessageBlock::message_variable_map_t::const_iterator var_iter = 
+					 mbci->mMemberVariables.begin();
+				 var_iter != mbci->mMemberVariables.end(); var_iter++)
+			{
+				const LLMessageVariable& mvci = **var_iter;
+				LLMsgVarOffset var_offset;
+
+				if (mvci.getType() == MVT_VARIABLE)
+				{
+					// the template gives the number of bytes of size info
+					S32 data_size = mvci.getSize();
+					U8 tsizeb = 0;
+					U16 tsizeh = 0;
+					U32 tsize = 0;
+
+					if ((decode_pos + data_size) > mReceiveSize)
+					{
+						logRanOffEndOfPacket(sender, decode_pos, data_size);
+					}
+					else
+					{
+						switch(data_size)
+						{
+						case 1:
+							htonmemcpy(&tsizeb, &buffer[decode_pos], MVT_U8, 1);
+							tsize = tsizeb;
+							break;
+						case 2:
+							htonmemcpy(&tsizeh, &buffer[decode_pos], MVT_U16, 2);
+							tsize = tsizeh;
+							break;
+						case 4:
+							htonmemcpy(&tsize, &buffer[decode_pos], MVT_U32, 4);
+							break;
+						default:
+							llerrs << "Attempting to read variable field with unknown size of " << data_size << llendl;
+							break;
+						}
+					}
+					decode_pos += data_size;
+
+					if (tsize && (decode_pos + (S32)tsize) > mReceiveSize)
+					{
+						// the size info claims more than we were sent
+						logRanOffEndOfPacket(sender, decode_pos, tsize);
+						tsize = 0;
+					}
+					var_offset.mOffset = tsize ? decode_pos : -1;
+					var_offset.mSize = tsize;
+					decode_pos += tsize;
+				}
+				else
+				{
+					var_offset.mSize = mvci.getSize();
+					if ((decode_pos + mvci.getSize()) > mReceiveSize)
+					{
+						logRanOffEndOfPacket(sender, decode_pos, mvci.getSize());
+						var_offset.mOffset = -1;
+					}
+					else
+					{
+						var_offset.mOffset = decode_pos;
+					}
+					decode_pos += mvci.getSize();
+				}
+				mVarOffsets.push_back(var_offset);
+			}
+		}
+	}
+
+	mOffsetsValid = true;
+
+	if (!total_blocks && !mCurrentRMessageTemplate->mMemberBlocks.empty())
+	{
+		lldebugs << "Empty message '" << mCurrentRMessageTemplate->mName << "' (no blocks)" << llendl;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender )
+{
+	llassert( mReceiveSize >= 0 );
+	llassert( mCurrentRMessageTemplate);
+	llassert( !mCurrentRMessageData && !mOffsetsValid );
+	if (mCurrentRMessageData) {
+		// just to make sure
+		delete mCurrentRMessageData;
+		mCurrentRMessageData = 0;
+	}
+	mOffsetsValid = false;
+
+	BOOL decoded = sLazyDecode ? decodeOffsets(buffer, sender) : decodeMessageData(buffer, sender);
+	if (!decoded)
+	{
+		return FALSE;
+	}
 
 	{
 		static LLTimer decode_timer;
@@ -825,6 +1151,49 @@ bool LLTemplateMessageReader::isUdpBanned() const
 	return mCurrentRMessageTemplate->isUdpBanned();
 }
 
+void LLTemplateMessageReader::buildMessageData(LLMsgData& data) const
+{
+	S32 block_index = 0;
+	LLMessageTemplate::message_block_map_t::const_iterator iter;
+	for(iter = mCurrentRMessageTemplate->mMemberBlocks.begin();
+		iter != mCurrentRMessageTemplate->mMemberBlocks.end();
+		++iter, ++block_index)
+	{
+		LLMessageBlock* mbci = *iter;
+		const LLMsgBlockOffsets& block_offsets = mBlockOffsets[block_index];
+		S32 var_index = block_offsets.mFirstVar;
+		for (S32 i = 0; i < block_offsets.mNumber; i++)
+		{
+			LLMsgBlkData* block_data = new LLMsgBlkData(mbci->mName, block_offsets.mNumber);
+			block_data->mName = mbci->mName + i;
+			data.addBlock(block_data);
+
+			for (LLMessageBlock::message_variable_map_t::const_iterator var_iter = 
+					 mbci->mMemberVariables.begin();
+				 var_iter != mbci->mMemberVariables.end(); var_iter++, var_index++)
+			{
+				const LLMessageVariable& mvci = **var_iter;
+				const LLMsgVarOffset& var_offset = mVarOffsets[var_index];
+				block_data->addVariable(mvci.getName(), mvci.getType());
+				if (var_offset.mOffset >= 0)
+				{
+					block_data->addData(mvci.getName(), &mReceiveBuffer[var_offset.mOffset],
+										var_offset.mSize, mvci.getType());
+				}
+				else if (var_offset.mSize)
+				{
+					std::vector<U8> zeros(var_offset.mSize, 0);
+					block_data->addData(mvci.getName(), &zeros[0], var_offset.mSize, mvci.getType());
+				}
+				else
+				{
+					block_data->addData(mvci.getName(), NULL, 0, mvci.getType());
+				}
+			}
+		}
+	}
+}
+
 //virtual 
 void LLTemplateMessageReader::copyToBuilder(LLMessageBuilder& builder) const
 {
@@ -832,5 +1201,13 @@ void LLTemplateMessageReader::copyToBuilder(LLMessageBuilder& builder) const
     {
         return;
     }
+	if (mOffsetsValid)
+	{
+		// only messages that get forwarded pay for building the data
+		LLMsgData data(mCurrentRMessageTemplate->mName);
+		buildMessageData(data);
+		builder.copyFromMessageData(data);
+		return;
+	}
 	builder.copyFromMessageData(*mCurrentRMessageData);
 }
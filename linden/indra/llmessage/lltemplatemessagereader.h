@@ -36,8 +36,10 @@
 #include "llmessagereader.h"
 
 #include <map>
+#include <vector>
 
 class LLMessageTemplate;
+class LLMessageVariable;
 class LLMsgData;
 
 class LLTemplateMessageReader : public LLMessageReader
@@ -111,6 +113,13 @@ public:
 	bool isTrusted() const;
 	bool isBanned(bool trusted_source) const;
 	bool isUdpBanned() const;
+
+	// When lazy decoding is on (the default) readMessage() only records
+	// where each block and variable sits in the packet, and the get*
+	// methods copy straight out of it. Turn it off to decode into an
+	// LLMsgData the old way.
+	static void setLazyDecode(BOOL b);
+	static BOOL getLazyDecode();
 	
 private:
 
@@ -123,11 +132,40 @@ private:
 	void logRanOffEndOfPacket( const LLHost& host, const S32 where, const S32 wanted );
 
 	BOOL decodeData(const U8* buffer, const LLHost& sender );
+	BOOL decodeMessageData(const U8* buffer, const LLHost& sender);
+	BOOL decodeOffsets(const U8* buffer, const LLHost& sender);
+
+	// Returns 0 and sets var_index/var on success, otherwise
+	// LL_BLOCK_NOT_IN_MESSAGE or LL_VARIABLE_NOT_IN_BLOCK.
+	S32 findVariable(const char* blockname, S32 blocknum, const char* varname,
+					 S32& var_index, const LLMessageVariable*& var);
+	void buildMessageData(LLMsgData& data) const;
+
+	struct LLMsgVarOffset
+	{
+		S32 mOffset;	// into mReceiveBuffer, -1 if empty or past the end of the packet
+		S32 mSize;
+	};
+
+	struct LLMsgBlockOffsets
+	{
+		S32 mFirstVar;	// into mVarOffsets, variables follow in template order
+		S32 mNumber;	// how many of this block arrived
+	};
 
 	S32	mReceiveSize;
 	LLMessageTemplate* mCurrentRMessageTemplate;
 	LLMsgData* mCurrentRMessageData;
 	message_template_number_map_t& mMessageNumbers;
+
+	// Lazy decode state, indexed by template position. Cleared, not
+	// freed, between messages.
+	bool mOffsetsValid;
+	std::vector<U8> mReceiveBuffer;
+	std::vector<LLMsgBlockOffsets> mBlockOffsets;
+	std::vector<LLMsgVarOffset> mVarOffsets;
+	S32 mLastBlock;
+	S32 mLastVariable;
 };
 
 #endif // LL_LLTEMPLATEMESSAGEREADER_H
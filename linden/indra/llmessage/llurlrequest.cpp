@@ -61,10 +61,11 @@ static size_t headerCallback(void* data, size_t size, size_t nmemb, void* user);
 class LLURLRequestDetail
 {
 public:
-	LLURLRequestDetail();
+	LLURLRequestDetail(const std::string& url);
 	~LLURLRequestDetail();
 	std::string mURL;
 	LLCurlEasyRequest* mCurlRequest;
+	LLCurl::EPriority mPriority;
 	LLBufferArray* mResponseBuffer;
 	LLChannelDescriptors mChannels;
 	U8* mLastRead;
@@ -73,8 +74,10 @@ public:
 	bool mIsBodyLimitSet;
 };
 
-LLURLRequestDetail::LLURLRequestDetail() :
+LLURLRequestDetail::LLURLRequestDetail(const std::string& url) :
+	mURL(url),
 	mCurlRequest(NULL),
+	mPriority(LLCurl::PRIORITY_CAPS),
 	mResponseBuffer(NULL),
 	mLastRead(NULL),
 	mBodyLimit(0),
@@ -82,7 +85,7 @@ LLURLRequestDetail::LLURLRequestDetail() :
 	mIsBodyLimitSet(false)
 {
 	LLMemType m1(LLMemType::MTYPE_IO_URL_REQUEST);
-	mCurlRequest = new LLCurlEasyRequest();
+	mCurlRequest = new LLCurlEasyRequest(url);
 }
 
 LLURLRequestDetail::~LLURLRequestDetail()
@@ -111,8 +114,7 @@ LLURLRequest::LLURLRequest(
 	mAction(action)
 {
 	LLMemType m1(LLMemType::MTYPE_IO_URL_REQUEST);
-	initialize();
-	setURL(url);
+	initialize(url);
 }
 
 LLURLRequest::~LLURLRequest()
@@ -145,6 +147,11 @@ void LLURLRequest::checkRootCertificate(bool check)
 	mDetail->mCurlRequest->setoptString(CURLOPT_ENCODING, "");
 }
 
+void LLURLRequest::setPriority(LLCurl::EPriority priority)
+{
+	mDetail->mPriority = priority;
+}
+
 void LLURLRequest::setCallback(LLURLRequestComplete* callback)
 {
 	LLMemType m1(LLMemType::MTYPE_IO_URL_REQUEST);
@@ -341,11 +348,11 @@ LLIOPipe::EStatus LLURLRequest::process_impl(
 	}
 }
 
-void LLURLRequest::initialize()
+void LLURLRequest::initialize(const std::string& url)
 {
 	LLMemType m1(LLMemType::MTYPE_IO_URL_REQUEST);
 	mState = STATE_INITIALIZED;
-	mDetail = new LLURLRequestDetail;
+	mDetail = new LLURLRequestDetail(url);
 	mDetail->mCurlRequest->setopt(CURLOPT_NOSIGNAL, 1);
 	mDetail->mCurlRequest->setWriteCallback(&downCallback, (void*)this);
 	mDetail->mCurlRequest->setReadCallback(&upCallback, (void*)this);
@@ -415,7 +422,7 @@ bool LLURLRequest::configure()
 	}
 	if(rv)
 	{
-		mDetail->mCurlRequest->sendRequest(mDetail->mURL);
+		mDetail->mCurlRequest->sendRequest(mDetail->mURL, mDetail->mPriority);
 	}
 	return rv;
 }
@@ -43,6 +43,7 @@
 #include <string>
 #include "lliopipe.h"
 #include "llchainio.h"
+#include "llcurl.h"
 #include "llerror.h"
 
 class LLURLRequestDetail;
@@ -134,6 +135,12 @@ public:
 	 */
 	void checkRootCertificate(bool check);
 
+	/**
+	 * @brief Set the class the request waits in when its host already
+	 * has as many requests running as it is allowed.
+	 */
+	void setPriority(LLCurl::EPriority priority);
+
 	/**
 	 * @brief Return at most size bytes of body.
 	 *
@@ -208,7 +215,7 @@ private:
 	/** 
 	 * @brief Initialize the object. Called during construction.
 	 */
-	void initialize();
+	void initialize(const std::string& url = std::string());
 
 	/** 
 	 * @brief Handle action specific url request configuration.
@@ -41,6 +41,9 @@
 //number of bytes sent in each message
 const U32 LL_XFER_CHUNK_SIZE = 1000;
 
+// confirms for later packets before a missing one is resent early
+const S32 LL_XFER_DUP_ACK_LIMIT = 3;
+
 const U32 LLXfer::XFER_FILE = 1;
 const U32 LLXfer::XFER_VFILE = 2;
 const U32 LLXfer::XFER_MEM = 3;
@@ -82,6 +85,13 @@ void LLXfer::init (S32 chunk_size)
 
 	mRetries = 0;
 
+	mWindowSize = 1;
+	mAckedPacketNum = -1;
+	mAckedAhead.clear();
+	mDupAcks = 0;
+	mFastResendPacketNum = -1;
+	mEarlyPackets.clear();
+
 	if (chunk_size < 1)
 	{
 		chunk_size = LL_XFER_CHUNK_SIZE;
@@ -98,6 +108,7 @@ void LLXfer::cleanup ()
 		delete[] mBuffer;
 		mBuffer = NULL;
 	}
+	mEarlyPackets.clear();
 }
 
 ///////////////////////////////////////////////////////////
@@ -262,8 +273,9 @@ void LLXfer::sendPacket(S32 packet_num)
 	{
 		mStatus = e_LL_XFER_COMPLETE;	
 	}
-	else
+	else if (mStatus != e_LL_XFER_COMPLETE)
 	{
+		// resending an earlier packet does not reopen a finished send
 		mStatus = e_LL_XFER_IN_PROGRESS;
 	}
 }
@@ -278,10 +290,71 @@ void LLXfer::sendNextPacket()
 
 ///////////////////////////////////////////////////////////
 
+void LLXfer::sendWindow()
+{
+	while ((mStatus == e_LL_XFER_IN_PROGRESS)
+		   && ((mPacketNum - mAckedPacketNum) < mWindowSize))
+	{
+		sendPacket(++mPacketNum);
+	}
+}
+
+///////////////////////////////////////////////////////////
+
+BOOL LLXfer::confirmPacket(S32 packet_num)
+{
+	if ((packet_num > mPacketNum) || (packet_num <= mAckedPacketNum))
+	{
+		// never sent, or a repeat of a confirm we already have
+		return FALSE;
+	}
+
+	mAckedAhead.insert(packet_num);
+	BOOL window_moved = FALSE;
+	while (!mAckedAhead.empty() && (*mAckedAhead.begin() == mAckedPacketNum + 1))
+	{
+		mAckedAhead.erase(mAckedAhead.begin());
+		++mAckedPacketNum;
+		window_moved = TRUE;
+	}
+
+	S32 missing_packet = mAckedPacketNum + 1;
+	if (window_moved)
+	{
+		mRetries = 0;
+		mDupAcks = 0;
+		if (!mAckedAhead.empty() && (missing_packet != mFastResendPacketNum))
+		{
+			// later packets made it, so this one is most likely lost
+			mFastResendPacketNum = missing_packet;
+			sendPacket(missing_packet);
+		}
+	}
+	else if ((++mDupAcks >= LL_XFER_DUP_ACK_LIMIT)
+			 && (missing_packet != mFastResendPacketNum))
+	{
+		mDupAcks = 0;
+		mFastResendPacketNum = missing_packet;
+		sendPacket(missing_packet);
+	}
+
+	mWaitingForACK = (mAckedPacketNum < mPacketNum);
+	if ((mStatus == e_LL_XFER_COMPLETE) && !mWaitingForACK)
+	{
+		return TRUE;
+	}
+	sendWindow();
+	return FALSE;
+}
+
+///////////////////////////////////////////////////////////
+
 void LLXfer::resendLastPacket()
 {
 	mRetries++;
-	sendPacket(mPacketNum);
+	// the oldest unconfirmed packet, which is the only one in flight
+	// when sending a packet at a time.
+	sendPacket(mAckedPacketNum + 1);
 }
 
 ///////////////////////////////////////////////////////////
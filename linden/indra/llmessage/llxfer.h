@@ -33,11 +33,19 @@
 #ifndef LL_LLXFER_H
 #define LL_LLXFER_H
 
+#include <map>
+#include <set>
+#include <vector>
+
 #include "message.h"
 #include "lltimer.h"
 
 const S32 LL_XFER_LARGE_PAYLOAD = 7680;
 
+// Most packets a sender keeps in flight, and a receiver holds ahead of
+// the next one it expects.
+const S32 LL_XFER_MAX_WINDOW = 64;
+
 typedef enum ELLXferStatus {
 	e_LL_XFER_UNINITIALIZED,
 	e_LL_XFER_REGISTERED,         // a buffer which has been registered as available for a request
@@ -78,6 +86,19 @@ class LLXfer
 	LLTimer ACKTimer;
 	S32 mRetries;
 
+	// Sliding window send state. mPacketNum is the highest packet
+	// sent, and everything up to mAckedPacketNum is confirmed.
+	S32 mWindowSize;
+	S32 mAckedPacketNum;
+	std::set<S32> mAckedAhead;	// confirmed packets past mAckedPacketNum
+	S32 mDupAcks;				// confirms since the window last moved
+	S32 mFastResendPacketNum;	// last packet resent without a timeout
+
+	// Packets received ahead of mPacketNum, keyed by packet number
+	// and holding the number as sent, EOF bit and all, and the data.
+	typedef std::map<S32, std::pair<S32, std::vector<char> > > packet_map_t;
+	packet_map_t mEarlyPackets;
+
 	static const U32 XFER_FILE;
 	static const U32 XFER_VFILE;
 	static const U32 XFER_MEM;
@@ -94,6 +115,8 @@ class LLXfer
 	virtual S32 startSend (U64 xfer_id, const LLHost &remote_host);
 	virtual void sendPacket(S32 packet_num);
 	virtual void sendNextPacket();
+	virtual void sendWindow();
+	virtual BOOL confirmPacket(S32 packet_num);
 	virtual void resendLastPacket();
 	virtual S32 processEOF();
 	virtual S32 startDownload();
@@ -49,6 +49,10 @@ const S32 LL_PACKET_RETRY_LIMIT = 10;            // packet retransmission limit
 
 const S32 LL_DEFAULT_MAX_SIMULTANEOUS_XFERS = 10;
 const S32 LL_DEFAULT_MAX_REQUEST_FIFO_XFERS = 1000;
+const S32 LL_DEFAULT_XFER_WINDOW = 16;			// packets in flight per xfer
+
+// set on confirmations by receivers which hold out of order packets
+const S32 LL_XFER_WINDOW_ACK = 0x40000000;
 
 #define LL_XFER_PROGRESS_MESSAGES 0
 #define LL_XFER_TEST_REXMIT       0
@@ -77,6 +81,7 @@ void LLXferManager::init (LLVFS *vfs)
 
 	setMaxOutgoingXfersPerCircuit(LL_DEFAULT_MAX_SIMULTANEOUS_XFERS);
 	setMaxIncomingXfers(LL_DEFAULT_MAX_REQUEST_FIFO_XFERS);
+	setXferWindowSize(LL_DEFAULT_XFER_WINDOW);
 
 	mVFS = vfs;
 
@@ -128,6 +133,13 @@ void LLXferManager::setMaxOutgoingXfersPerCircuit(S32 max_num)
 	mMaxOutgoingXfersPerCircuit = max_num;
 }
 
+///////////////////////////////////////////////////////////
+
+void LLXferManager::setXferWindowSize(S32 num_packets)
+{
+	mXferWindowSize = llclamp(num_packets, 1, LL_XFER_MAX_WINDOW);
+}
+
 void LLXferManager::setUseAckThrottling(const BOOL use)
 {
 	mUseAckThrottling = use;
@@ -628,14 +640,34 @@ void LLXferManager::processReceiveData (LLMessageSystem *mesgsys, void ** /*user
 		return;
 	}
 
-	S32 xfer_size;
+	receiveXferPacket(mesgsys, xferp, packetnum, fdata_buf, fdata_size);
+}
+
+///////////////////////////////////////////////////////////
 
-	if (decodePacketNum(packetnum) != xferp->mPacketNum) // is the packet different from what we were expecting?
+void LLXferManager::receiveXferPacket(LLMessageSystem* mesgsys, LLXfer* xferp, S32 packetnum, char* fdata_buf, S32 fdata_size)
+{
+	U64 id = xferp->mID;
+	S32 packet = decodePacketNum(packetnum);
+	if (packet != xferp->mPacketNum) // is the packet different from what we were expecting?
 	{
-		// confirm it if it was a resend of the last one, since the confirmation might have gotten dropped
-		if (decodePacketNum(packetnum) == (xferp->mPacketNum - 1))
+		if (packet < xferp->mPacketNum)
+		{
+			// confirm it if it was a resend, since the confirmation might have gotten dropped
+			llinfos << "Reconfirming xfer " << xferp->mRemoteHost << ":" << xferp->getFileName() << " packet " << packetnum << llendl;
+			sendConfirmPacket(mesgsys, id, packet, mesgsys->getSender());
+		}
+		else if (packet < xferp->mPacketNum + LL_XFER_MAX_WINDOW)
 		{
-			llinfos << "Reconfirming xfer " << xferp->mRemoteHost << ":" << xferp->getFileName() << " packet " << packetnum << llendl; 			sendConfirmPacket(mesgsys, id, decodePacketNum(packetnum), mesgsys->getSender());
+			// A windowed sender got past a lost packet. Hold this one
+			// until the gap is filled, and confirm it so it is not resent.
+			if (!xferp->mEarlyPackets.count(packet))
+			{
+				std::pair<S32, std::vector<char> >& early = xferp->mEarlyPackets[packet];
+				early.first = packetnum;
+				early.second.assign(fdata_buf, fdata_buf + fdata_size);
+			}
+			acknowledgePacket(mesgsys, id, packet);
 		}
 		else
 		{
@@ -644,54 +676,89 @@ void LLXferManager::processReceiveData (LLMessageSystem *mesgsys, void ** /*user
 		return;		
 	}
 
+	S32 result = receivePacket(xferp, fdata_buf, fdata_size);
+	if (result != LL_ERR_CANNOT_OPEN_FILE)
+	{
+		acknowledgePacket(mesgsys, id, packet);
+	}
+
+	// hand over any held packets this one was blocking, in order
+	BOOL is_last = isLastPacket(packetnum);
+	while ((result != LL_ERR_CANNOT_OPEN_FILE) && !is_last)
+	{
+		LLXfer::packet_map_t::iterator early = xferp->mEarlyPackets.find(xferp->mPacketNum);
+		if (early == xferp->mEarlyPackets.end())
+		{
+			break;
+		}
+		is_last = isLastPacket(early->second.first);
+		result = receivePacket(xferp, &early->second.second[0], (S32)early->second.second.size());
+		xferp->mEarlyPackets.erase(early);
+	}
+	
+	if (result == LL_ERR_CANNOT_OPEN_FILE)
+	{
+			xferp->abort(LL_ERR_CANNOT_OPEN_FILE);
+			removeXfer(xferp,&mReceiveList);
+			startPendingDownloads();
+			return;		
+	}
+
+	if (is_last)
+	{
+		xferp->processEOF();
+		removeXfer(xferp,&mReceiveList);
+		startPendingDownloads();
+	}
+}
+
+///////////////////////////////////////////////////////////
+
+S32 LLXferManager::receivePacket(LLXfer* xferp, char* datap, S32 data_size)
+{
 	S32 result = 0;
 
 	if (xferp->mPacketNum == 0) // first packet has size encoded as additional S32 at beginning of data
 	{
-		ntohmemcpy(&xfer_size,fdata_buf,MVT_S32,sizeof(S32));
+		S32 xfer_size;
+		ntohmemcpy(&xfer_size,datap,MVT_S32,sizeof(S32));
 		
 // do any necessary things on first packet ie. allocate memory
 		xferp->setXferSize(xfer_size);
 
 		// adjust buffer start and size
-		result = xferp->receiveData(&(fdata_buf[sizeof(S32)]),fdata_size-(sizeof(S32)));
+		result = xferp->receiveData(&(datap[sizeof(S32)]),data_size-(sizeof(S32)));
 	}
 	else
 	{
-		result = xferp->receiveData(fdata_buf,fdata_size);
+		result = xferp->receiveData(datap,data_size);
 	}
-	
-	if (result == LL_ERR_CANNOT_OPEN_FILE)
+
+	if (result != LL_ERR_CANNOT_OPEN_FILE)
 	{
-			xferp->abort(LL_ERR_CANNOT_OPEN_FILE);
-			removeXfer(xferp,&mReceiveList);
-			startPendingDownloads();
-			return;		
+		xferp->mPacketNum++;  // expect next packet
 	}
+	return result;
+}
 
-	xferp->mPacketNum++;  // expect next packet
+///////////////////////////////////////////////////////////
 
+void LLXferManager::acknowledgePacket(LLMessageSystem *mesgsys, U64 id, S32 packetnum)
+{
 	if (!mUseAckThrottling)
 	{
 		// No throttling, confirm right away
-		sendConfirmPacket(mesgsys, id, decodePacketNum(packetnum), mesgsys->getSender());
+		sendConfirmPacket(mesgsys, id, packetnum, mesgsys->getSender());
 	}
 	else
 	{
 		// Throttling, put on queue to be confirmed later.
 		LLXferAckInfo ack_info;
 		ack_info.mID = id;
-		ack_info.mPacketNum = decodePacketNum(packetnum);
+		ack_info.mPacketNum = packetnum;
 		ack_info.mRemoteHost = mesgsys->getSender();
 		mXferAckQueue.push(ack_info);
 	}
-
-	if (isLastPacket(packetnum))
-	{
-		xferp->processEOF();
-		removeXfer(xferp,&mReceiveList);
-		startPendingDownloads();
-	}
 }
 
 ///////////////////////////////////////////////////////////
@@ -707,7 +774,9 @@ void LLXferManager::sendConfirmPacket (LLMessageSystem *mesgsys, U64 id, S32 pac
 	mesgsys->newMessageFast(_PREHASH_ConfirmXferPacket);
 	mesgsys->nextBlockFast(_PREHASH_XferID);
 	mesgsys->addU64Fast(_PREHASH_ID, id);
-	mesgsys->addU32Fast(_PREHASH_Packet, packetnum);
+	// flag that we take packets out of order, so a windowed sender
+	// can keep several in flight. Older senders ignore the number.
+	mesgsys->addU32Fast(_PREHASH_Packet, packetnum | LL_XFER_WINDOW_ACK);
 
 	mesgsys->sendMessage(remote_host);
 }
@@ -981,12 +1050,16 @@ void LLXferManager::processConfirmation (LLMessageSystem *mesgsys, void ** /*use
 	if (xferp)
 	{
 //		cout << "confirmed packet #" << packetNum << " ping: "<< xferp->ACKTimer.getElapsedTimeF32() <<  endl;
-		xferp->mWaitingForACK = FALSE;
-		if (xferp->mStatus == e_LL_XFER_IN_PROGRESS)
+		if (packetNum & LL_XFER_WINDOW_ACK)
 		{
-			xferp->sendNextPacket();
+			xferp->mWindowSize = mXferWindowSize;
 		}
-		else
+		if ((xferp->mStatus != e_LL_XFER_IN_PROGRESS)
+			&& (xferp->mStatus != e_LL_XFER_COMPLETE))
+		{
+			removeXfer(xferp, &mSendList);
+		}
+		else if (xferp->confirmPacket(decodePacketNum(packetNum)))
 		{
 			removeXfer(xferp, &mSendList);
 		}
@@ -1037,7 +1110,7 @@ void LLXferManager::retransmitUnackedPackets ()
 			}
 			else
 			{
-				llinfos << "resending xfer " << xferp->mRemoteHost << ":" << xferp->getFileName() << " packet unconfirmed after: "<< et << " sec, packet " << xferp->mPacketNum << llendl;
+				llinfos << "resending xfer " << xferp->mRemoteHost << ":" << xferp->getFileName() << " packet unconfirmed after: "<< et << " sec, packet " << (xferp->mAckedPacketNum + 1) << llendl;
 				xferp->resendLastPacket();
 				xferp = xferp->mNext;
 			}
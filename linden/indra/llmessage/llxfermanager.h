@@ -84,6 +84,7 @@ class LLXferManager
  protected:
 	S32    mMaxOutgoingXfersPerCircuit;
 	S32    mMaxIncomingXfers;
+	S32    mXferWindowSize;	// packets in flight per xfer to receivers that can take them
 
 	BOOL	mUseAckThrottling; // Use ack throttling to cap file xfer bandwidth
 	LLLinkedQueue<LLXferAckInfo> mXferAckQueue;
@@ -109,6 +110,10 @@ class LLXferManager
 	// implementation methods
 	virtual void startPendingDownloads();
 	virtual void addToList(LLXfer* xferp, LLXfer*& head, BOOL is_priority);
+	virtual S32 receivePacket(LLXfer* xferp, char* datap, S32 data_size);
+	// Handles one data packet for xferp, holding it if it is early.
+	virtual void receiveXferPacket(LLMessageSystem* mesgsys, LLXfer* xferp, S32 packetnum, char* fdata_buf, S32 fdata_size);
+	virtual void acknowledgePacket(LLMessageSystem *mesgsys, U64 id, S32 packetnum);
 	std::multiset<std::string> mExpectedTransfers; // files that are authorized to transfer out
 	std::multiset<std::string> mExpectedRequests;  // files that are authorized to be downloaded on top of
 
@@ -132,6 +137,7 @@ class LLXferManager
 
 	virtual void setMaxOutgoingXfersPerCircuit (S32 max_num);
 	virtual void setMaxIncomingXfers(S32 max_num);
+	virtual void setXferWindowSize(S32 num_packets);
 	virtual void updateHostStatus();
 	virtual void printHostStatus();
 
@@ -0,0 +1,208 @@
+/** 
+ * @file llzerocode.cpp
+ * @brief Zero coding of message system packets
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ * 
+ * Copyright (c) 2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llzerocode.h"
+
+#include "llsys.h"
+
+// Runs longer than this are split up.
+const U32 MAX_ZERO_RUN = 255;
+
+//static
+bool LLZeroCode::sUseSSE2 = false;
+//static
+U32 (*LLZeroCode::sFindZero)(const U8* data, U32 size) = &LLZeroCode::findZeroGeneric;
+//static
+U32 (*LLZeroCode::sFindNonZero)(const U8* data, U32 size) = &LLZeroCode::findNonZeroGeneric;
+
+//static
+void LLZeroCode::initClass()
+{
+	setUseSSE2(gSysCPU.hasSSE2());
+	llinfos << "Zero coding using " << (sUseSSE2 ? "SSE2" : "generic code") << llendl;
+}
+
+//static
+void LLZeroCode::setUseSSE2(bool use_sse2)
+{
+	sUseSSE2 = use_sse2 && builtWithSSE2() && gSysCPU.hasSSE2();
+	if (sUseSSE2)
+	{
+		sFindZero = &findZeroSSE2;
+		sFindNonZero = &findNonZeroSSE2;
+	}
+	else
+	{
+		sFindZero = &findZeroGeneric;
+		sFindNonZero = &findNonZeroGeneric;
+	}
+}
+
+//static
+S32 LLZeroCode::encode(const U8* in, S32 size, U8* out)
+{
+	const U8* inptr = in;
+	const U8* end = in + size;
+	U8* outptr = out;
+	while (inptr < end)
+	{
+		U32 literal = sFindZero(inptr, end - inptr);
+		memcpy(outptr, inptr, literal);		/* Flawfinder: ignore */
+		outptr += literal;
+		inptr += literal;
+		if (inptr == end)
+		{
+			break;
+		}
+
+		U32 zeroes = sFindNonZero(inptr, end - inptr);
+		inptr += zeroes;
+		while (zeroes >= MAX_ZERO_RUN)
+		{
+			*outptr++ = 0;
+			*outptr++ = (U8)MAX_ZERO_RUN;
+			zeroes -= MAX_ZERO_RUN;
+		}
+		if (zeroes)
+		{
+			*outptr++ = 0;
+			*outptr++ = (U8)zeroes;
+		}
+	}
+	return (S32)(outptr - out) - size;
+}
+
+//static
+S32 LLZeroCode::getNetGain(const U8* in, S32 size)
+{
+	const U8* inptr = in;
+	const U8* end = in + size;
+	S32 net_gain = 0;
+	while (inptr < end)
+	{
+		inptr += sFindZero(inptr, end - inptr);
+		if (inptr == end)
+		{
+			break;
+		}
+
+		// Two bytes for every run of up to MAX_ZERO_RUN zeroes.
+		U32 zeroes = sFindNonZero(inptr, end - inptr);
+		inptr += zeroes;
+		net_gain += 2 * ((zeroes + MAX_ZERO_RUN - 1) / MAX_ZERO_RUN) - zeroes;
+	}
+	return net_gain;
+}
+
+//static
+S32 LLZeroCode::decode(const U8* in, S32 size, U8* out, S32 out_size)
+{
+	// The space checks are the ones the byte at a time decoder made,
+	// which keep a little more slack than they strictly need to.
+	const U8* inptr = in;
+	const U8* end = in + size;
+	S32 out_pos = 0;
+	while (inptr < end)
+	{
+		U32 literal = sFindZero(inptr, end - inptr);
+		if (literal)
+		{
+			if ((S32)literal > out_size - out_pos)
+			{
+				return -1;
+			}
+			memcpy(out + out_pos, inptr, literal);		/* Flawfinder: ignore */
+			out_pos += literal;
+			inptr += literal;
+			continue;
+		}
+
+		// A zero, then any number of zeroes standing for 256 more
+		// each, then the length of the rest of the run.
+		if (out_pos >= out_size)
+		{
+			return -1;
+		}
+		out[out_pos++] = 0;
+		++inptr;
+
+		S32 wraps = (S32)sFindNonZero(inptr, end - inptr);
+		if (wraps)
+		{
+			if (out_pos + 256 * wraps - 255 > out_size - 256)
+			{
+				return -1;
+			}
+			memset(out + out_pos, 0, 256 * wraps);
+			out_pos += 256 * wraps;
+			inptr += wraps;
+		}
+		if (inptr == end)
+		{
+			// Packet ended mid run.
+			break;
+		}
+
+		S32 run = *inptr++;
+		if (out_pos > out_size - run)
+		{
+			return -1;
+		}
+		memset(out + out_pos, 0, run - 1);
+		out_pos += run - 1;
+	}
+	return out_pos;
+}
+
+//static
+U32 LLZeroCode::findZeroGeneric(const U8* data, U32 size)
+{
+	U32 i = 0;
+	while ((i < size) && data[i])
+	{
+		++i;
+	}
+	return i;
+}
+
+//static
+U32 LLZeroCode::findNonZeroGeneric(const U8* data, U32 size)
+{
+	U32 i = 0;
+	while ((i < size) && !data[i])
+	{
+		++i;
+	}
+	return i;
+}
@@ -0,0 +1,89 @@
+/** 
+ * @file llzerocode.h
+ * @brief Zero coding of message system packets
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ * 
+ * Copyright (c) 2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLZEROCODE_H
+#define LL_LLZEROCODE_H
+
+//----------------------------------------------------------------------------
+// Zero coding squeezes the runs of zero bytes that fill most template
+// messages.  Each run is sent as a 0 followed by a U8 run length, with
+// runs longer than 255 split into several.  The packet header is never
+// zero coded, so these work on the bytes after it.
+//
+// The encoder and decoder work a run at a time.  Finding where a run
+// ends is the hot loop, and uses SSE2 where the CPU has it.
+//----------------------------------------------------------------------------
+
+class LLZeroCode
+{
+public:
+	// Picks the run scanners for this CPU.  Called when the message
+	// system starts up, until then the plain versions are used.
+	static void initClass();
+
+	// For testing, SSE2 is only turned on if the CPU has it.
+	static void setUseSSE2(bool use_sse2);
+	static bool getUseSSE2()			{ return sUseSSE2; }
+
+	// Encodes size bytes from in into out, which must hold 2 * size
+	// bytes.  Returns the change in size, which is only worth sending
+	// if negative.
+	static S32 encode(const U8* in, S32 size, U8* out);
+
+	// The change in size encode() would return, without encoding.
+	static S32 getNetGain(const U8* in, S32 size);
+
+	// Decodes size bytes from in into out.  Returns the decoded size,
+	// or -1 if it would not fit in out_size bytes.
+	static S32 decode(const U8* in, S32 size, U8* out, S32 out_size);
+
+	// Offset of the first zero byte, or size if there is none.
+	static U32 findZero(const U8* data, U32 size)		{ return sFindZero(data, size); }
+	// Offset of the first non-zero byte, or size if there is none.
+	static U32 findNonZero(const U8* data, U32 size)	{ return sFindNonZero(data, size); }
+
+private:
+	static U32 findZeroGeneric(const U8* data, U32 size);
+	static U32 findNonZeroGeneric(const U8* data, U32 size);
+
+	// These require compiler options for SSE2, and live in
+	// llzerocode_sse2.cpp.
+	static bool builtWithSSE2();
+	static U32 findZeroSSE2(const U8* data, U32 size);
+	static U32 findNonZeroSSE2(const U8* data, U32 size);
+
+	static bool sUseSSE2;
+	static U32 (*sFindZero)(const U8* data, U32 size);
+	static U32 (*sFindNonZero)(const U8* data, U32 size);
+};
+
+#endif // LL_LLZEROCODE_H
@@ -0,0 +1,123 @@
+/** 
+ * @file llzerocode_sse2.cpp
+ * @brief SSE2 run scanning for zero coding
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ * 
+ * Copyright (c) 2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+// Visual Studio required settings for this file:
+// Precompiled Headers OFF
+// Code Generation: SSE2
+
+#include "linden_common.h"
+
+#include "llzerocode.h"
+
+// Only functions in this file, no globals.  Anything initialized here
+// before main() could be run with SSE2 instructions on a CPU without it.
+
+#if (LL_GNUC && defined(__SSE2__)) || (LL_MSVC && (defined(_M_X64) || (defined(_M_IX86) && _M_IX86_FP >= 2)))
+
+#include <emmintrin.h>
+#if LL_MSVC
+#include <intrin.h>
+#endif
+
+// Index of the lowest set bit, mask must not be 0.
+inline U32 lowest_bit(U32 mask)
+{
+#if LL_MSVC
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return index;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+//static
+bool LLZeroCode::builtWithSSE2()
+{
+	return true;
+}
+
+//static
+U32 LLZeroCode::findZeroSSE2(const U8* data, U32 size)
+{
+	const __m128i zero = _mm_setzero_si128();
+	U32 i = 0;
+	for ( ; i + 16 <= size; i += 16)
+	{
+		__m128i bytes = _mm_loadu_si128((const __m128i*)(data + i));
+		U32 mask = _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, zero));
+		if (mask)
+		{
+			return i + lowest_bit(mask);
+		}
+	}
+	return i + findZeroGeneric(data + i, size - i);
+}
+
+//static
+U32 LLZeroCode::findNonZeroSSE2(const U8* data, U32 size)
+{
+	const __m128i zero = _mm_setzero_si128();
+	U32 i = 0;
+	for ( ; i + 16 <= size; i += 16)
+	{
+		__m128i bytes = _mm_loadu_si128((const __m128i*)(data + i));
+		U32 mask = _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, zero)) ^ 0xFFFF;
+		if (mask)
+		{
+			return i + lowest_bit(mask);
+		}
+	}
+	return i + findNonZeroGeneric(data + i, size - i);
+}
+
+#else
+
+//static
+bool LLZeroCode::builtWithSSE2()
+{
+	return false;
+}
+
+//static
+U32 LLZeroCode::findZeroSSE2(const U8* data, U32 size)
+{
+	return findZeroGeneric(data, size);
+}
+
+//static
+U32 LLZeroCode::findNonZeroSSE2(const U8* data, U32 size)
+{
+	return findNonZeroGeneric(data, size);
+}
+
+#endif
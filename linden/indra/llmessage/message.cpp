@@ -64,6 +64,7 @@
 #include "llmd5.h"
 #include "llmessagebuilder.h"
 #include "llmessageconfig.h"
+#include "llpacketcapture.h"
 #include "lltemplatemessagedispatcher.h"
 #include "llpumpio.h"
 #include "lltemplatemessagebuilder.h"
@@ -79,6 +80,7 @@
 #include "lltransfermanager.h"
 #include "lluuid.h"
 #include "llxfermanager.h"
+#include "llzerocode.h"
 #include "timing.h"
 #include "llquaternion.h"
 #include "u64.h"
@@ -251,6 +253,7 @@ LLMessageSystem::LLMessageSystem(const std::string& filename, U32 port,
 	mLastMessageFromTrustedMessageService(false)
 {
 	init();
+	LLZeroCode::initClass();
 
 	mSystemVersionMajor = version_major;
 	mSystemVersionMinor = version_minor;
@@ -368,6 +371,8 @@ LLMessageSystem::~LLMessageSystem()
 	
 	if (!mbError)
 	{
+		// The receive thread must be done with the socket before it closes.
+		mPacketRing.stopReceiveThread();
 		end_net(mSocket);
 	}
 	mSocket = 0;
@@ -741,7 +746,7 @@ BOOL LLMessageSystem::checkMessages( S64 frame_count )
 				if (cdp && recv_reliable)
 				{
 					// Add to the recently received list for duplicate suppression
-					cdp->mRecentlyReceivedReliablePackets[mCurrentRecvPacketID] = getMessageTimeUsecs();
+					cdp->mRecentlyReceivedReliablePackets.insert(mCurrentRecvPacketID, getMessageTimeUsecs());
 
 					// Put it onto the list of packets to be acked
 					cdp->collectRAck(mCurrentRecvPacketID);
@@ -1287,14 +1292,11 @@ S32 LLMessageSystem::sendMessage(const LLHost &host)
 		S32 append_ack_count = llmin(space_left, ack_count);
 		const S32 MAX_ACKS = 250;
 		append_ack_count = llmin(append_ack_count, MAX_ACKS);
-		std::vector<TPACKETID>::iterator iter = cdp->mAcks.begin();
-		std::vector<TPACKETID>::iterator last = cdp->mAcks.begin();
-		last += append_ack_count;
 		TPACKETID packet_id;
-		for( ; iter != last ; ++iter)
+		for(S32 i = 0; i < append_ack_count; ++i)
 		{
 			// grab the next packet id.
-			packet_id = (*iter);
+			packet_id = cdp->mAcks[i];
 			if(mVerboseLog)
 			{
 				acks.push_back(packet_id);
@@ -1324,7 +1326,7 @@ S32 LLMessageSystem::sendMessage(const LLHost &host)
 		}
 
 		// clean up the source
-		cdp->mAcks.erase(cdp->mAcks.begin(), last);
+		cdp->mAcks.pop(append_ack_count);
 
 		// tack the count in the final byte
 		U8 count = (U8)append_ack_count;
@@ -2421,6 +2423,7 @@ void process_deny_trusted_circuit(LLMessageSystem *msg, void **)
 void dump_prehash_files()
 {
 	U32 i;
+	const std::vector<char*>& names = LLMessageStringTable::getInstance()->mNames;
 	std::string filename("../../indra/llmessage/message_prehash.h");
 	LLFILE* fp = LLFile::fopen(filename, "w");	/* Flawfinder: ignore */
 	if (fp)
@@ -2442,11 +2445,11 @@ void dump_prehash_files()
 			" */\n",
 			gMessageSystem->mMessageFileVersionNumber);
 		fprintf(fp, "\n\nextern F32 gPrehashVersionNumber;\n\n");
-		for (i = 0; i < MESSAGE_NUMBER_OF_HASH_BUCKETS; i++)
+		for (i = 0; i < names.size(); i++)
 		{
-			if (!LLMessageStringTable::getInstance()->mEmpty[i] && LLMessageStringTable::getInstance()->mString[i][0] != '.')
+			if (names[i][0] != '.')
 			{
-				fprintf(fp, "extern char * _PREHASH_%s;\n", LLMessageStringTable::getInstance()->mString[i]);
+				fprintf(fp, "extern char * _PREHASH_%s;\n", names[i]);
 			}
 		}
 		fprintf(fp, "\n\n#endif\n");
@@ -2472,11 +2475,11 @@ void dump_prehash_files()
 		fprintf(fp, "#include \"linden_common.h\"\n");
 		fprintf(fp, "#include \"message.h\"\n\n");
 		fprintf(fp, "\n\nF32 gPrehashVersionNumber = %.3ff;\n\n", gMessageSystem->mMessageFileVersionNumber);
-		for (i = 0; i < MESSAGE_NUMBER_OF_HASH_BUCKETS; i++)
+		for (i = 0; i < names.size(); i++)
 		{
-			if (!LLMessageStringTable::getInstance()->mEmpty[i] && LLMessageStringTable::getInstance()->mString[i][0] != '.')
+			if (names[i][0] != '.')
 			{
-				fprintf(fp, "char * _PREHASH_%s = LLMessageStringTable::getInstance()->getString(\"%s\");\n", LLMessageStringTable::getInstance()->mString[i], LLMessageStringTable::getInstance()->mString[i]);
+				fprintf(fp, "char * _PREHASH_%s = LLMessageStringTable::getInstance()->getString(\"%s\");\n", names[i], names[i]);
 			}
 		}
 		fclose(fp);
@@ -2570,6 +2573,76 @@ bool start_messaging_system(
 	return TRUE;
 }
 
+void LLMessageSystem::startReceiveThread()
+{
+	if (!mbError)
+	{
+		mPacketRing.startReceiveThread(mSocket);
+	}
+}
+
+BOOL LLMessageSystem::startPacketCapture(const std::string& filename)
+{
+	return mPacketRing.startCapture(filename);
+}
+
+void LLMessageSystem::stopPacketCapture()
+{
+	mPacketRing.stopCapture();
+}
+
+S32 LLMessageSystem::replayPackets(const std::string& filename, bool realtime)
+{
+	LLPacketReplay* replay = new LLPacketReplay;
+	if (!replay->load(filename))
+	{
+		delete replay;
+		return -1;
+	}
+	replay->setRealtime(realtime);
+
+	std::vector<LLHost> senders;
+	replay->getSenders(senders);
+	for (std::vector<LLHost>::iterator it = senders.begin(); it != senders.end(); ++it)
+	{
+		if (!mCircuitInfo.findCircuit(*it))
+		{
+			enableCircuit(*it, TRUE);
+		}
+	}
+
+	mPacketRing.startReplay(replay);
+
+	LLTimer timer;
+	S64 frame_count = 0;
+	while (!replay->isDone())
+	{
+		while (checkMessages(frame_count))
+		{
+			// keep going
+		}
+		processAcks();
+		frame_count++;
+		if (realtime && !replay->isDone())
+		{
+			ms_sleep(1);
+		}
+	}
+
+	S32 replayed = replay->getPacketsReplayed();
+	F32 elapsed = timer.getElapsedTimeF32();
+	llinfos << "Replayed " << replayed << " packets from " << filename
+			<< " in " << elapsed << " seconds, " << frame_count << " frames";
+	if (elapsed > 0.f)
+	{
+		llcont << ", " << (replayed / elapsed) << " packets/sec";
+	}
+	llcont << llendl;
+
+	mPacketRing.stopReplay();
+	return replayed;
+}
+
 void LLMessageSystem::startLogging()
 {
 	mVerboseLog = TRUE;
@@ -2809,54 +2882,9 @@ S32 LLMessageSystem::zeroCodeAdjustCurrentSendTotal()
 	// TODO: babbage: remove this horror
 	mMessageBuilder->setBuilt(FALSE);
 
-	S32 count = mSendSize;
-	
-	S32 net_gain = 0;
-	U8 num_zeroes = 0;
-	
-	U8 *inptr = (U8 *)mSendBuffer;
-
-// skip the packet id field
-
-	for (U32 ii = 0; ii < LL_PACKET_ID_SIZE; ++ii)
-	{
-		count--;
-		inptr++;
-	}
-
-// don't actually build, just test
-
-// sequential zero bytes are encoded as 0 [U8 count] 
-// with 0 0 [count] representing wrap (>256 zeroes)
-
-	while (count--)
-	{
-		if (!(*inptr))   // in a zero count
-		{
-			if (num_zeroes)
-			{
-				if (++num_zeroes > 254)
-				{
-					num_zeroes = 0;
-				}
-				net_gain--;   // subseqent zeroes save one
-			}
-			else
-			{
-				net_gain++;  // starting a zero count adds one
-				num_zeroes = 1;
-			}
-			inptr++;
-		}
-		else
-		{
-			if (num_zeroes)
-			{
-				num_zeroes = 0;
-			}
-			inptr++;
-		}
-	}
+	// skip the packet id field, and don't actually build, just test
+	S32 net_gain = LLZeroCode::getNetGain(mSendBuffer + LL_PACKET_ID_SIZE,
+										  mSendSize - LL_PACKET_ID_SIZE);
 	if (net_gain < 0)
 	{
 		return net_gain;
@@ -2891,72 +2919,21 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
 	
 	*data[0] &= (~LL_ZERO_CODE_FLAG);
 
-	S32 count = (*data_size);  
-	
-	U8 *inptr = (U8 *)*data;
-	U8 *outptr = (U8 *)mEncodedRecvBuffer;
-
-// skip the packet id field
-
-	for (U32 ii = 0; ii < LL_PACKET_ID_SIZE; ++ii)
+	// skip the packet id field
+	memcpy(mEncodedRecvBuffer, *data, LL_PACKET_ID_SIZE);		/* Flawfinder: ignore */
+	S32 out_size = LLZeroCode::decode(*data + LL_PACKET_ID_SIZE,
+									  *data_size - LL_PACKET_ID_SIZE,
+									  mEncodedRecvBuffer + LL_PACKET_ID_SIZE,
+									  MAX_BUFFER_SIZE - LL_PACKET_ID_SIZE);
+	if (out_size < 0)
 	{
-		count--;
-		*outptr++ = *inptr++;
+		LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size" << llendl;
+		callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
+		out_size = 0;
 	}
 
-// reconstruct encoded packet, keeping track of net size gain
-
-// sequential zero bytes are encoded as 0 [U8 count] 
-// with 0 0 [count] representing wrap (>256 zeroes)
-
-	while (count--)
-	{
-		if (outptr > (&mEncodedRecvBuffer[MAX_BUFFER_SIZE-1]))
-		{
-			LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size 1" << llendl;
-			callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
-			outptr = mEncodedRecvBuffer;					
-			break;
-		}
-		if (!((*outptr++ = *inptr++)))
-		{
-			while (((count--)) && (!(*inptr)))
-			{
-				*outptr++ = *inptr++;
-  				if (outptr > (&mEncodedRecvBuffer[MAX_BUFFER_SIZE-256]))
-  				{
-  					LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size 2" << llendl;
-					callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
-					outptr = mEncodedRecvBuffer;
-					count = -1;
-					break;
-  				}
-				memset(outptr,0,255);
-				outptr += 255;
-			}
-			
-			if (count < 0)
-			{
-				break;
-			}
-
-			else
-			{
-  				if (outptr > (&mEncodedRecvBuffer[MAX_BUFFER_SIZE-(*inptr)]))
-				{
-  					LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size 3" << llendl;
-					callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
-					outptr = mEncodedRecvBuffer;					
-				}
-				memset(outptr,0,(*inptr) - 1);
-				outptr += ((*inptr) - 1);
-				inptr++;
-			}
-		}		
-	}
-	
 	*data = mEncodedRecvBuffer;
-	*data_size = (S32)(outptr - mEncodedRecvBuffer);
+	*data_size = LL_PACKET_ID_SIZE + out_size;
 	mUncompressedBytesIn += *data_size;
 
 	return(in_size);
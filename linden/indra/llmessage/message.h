@@ -35,6 +35,7 @@
 
 #include <cstring>
 #include <set>
+#include <vector>
 
 #if LL_LINUX
 #include <endian.h>
@@ -68,7 +69,7 @@
 #include "llstoredmessage.h"
 
 const U32 MESSAGE_MAX_STRINGS_LENGTH = 64;
-const U32 MESSAGE_NUMBER_OF_HASH_BUCKETS = 8192;
+const U32 MESSAGE_NUMBER_OF_HASH_BUCKETS = 8192; // initial size, grows as needed
 
 const S32 MESSAGE_MAX_PER_FRAME = 400;
 
@@ -78,11 +79,17 @@ public:
 	LLMessageStringTable();
 	~LLMessageStringTable();
 
+	// Returns the interned copy of str, adding it on first use. The
+	// pointer is stable for the life of the process, so it can be
+	// compared by address. Safe to call from other threads for names
+	// which are already interned (the prehashed names always are).
 	char *getString(const char *str);
 
 	U32	 mUsed;
-	BOOL mEmpty[MESSAGE_NUMBER_OF_HASH_BUCKETS];
-	char mString[MESSAGE_NUMBER_OF_HASH_BUCKETS][MESSAGE_MAX_STRINGS_LENGTH];	/* Flawfinder: ignore */
+	std::vector<char*> mNames;	// in the order they were first interned
+
+private:
+	LLStringTable mTable;
 };
 
 
@@ -655,6 +662,18 @@ public:
 
 	U32		getListenPort( void ) const;
 
+	void	startReceiveThread();				// read the socket on its own thread, in batches
+
+	BOOL	startPacketCapture(const std::string& filename);	// record received packets for replayPackets()
+	void	stopPacketCapture();
+
+	// Feeds a capture through checkMessages() and processAcks() as if it
+	// were arriving from the network, at the captured pace if realtime
+	// is set or as fast as possible otherwise. Circuits are opened for
+	// every sender and nothing is sent while it runs. Returns the number
+	// of packets replayed, or -1 if the capture could not be read.
+	S32		replayPackets(const std::string& filename, bool realtime);
+
 	void startLogging();					// start verbose  logging
 	void stopLogging();						// flush and close file
 	void summarizeLogs(std::ostream& str);	// log statistics
@@ -35,27 +35,10 @@
 #include "llerror.h"
 #include "message.h"
 
-inline U32	message_hash_my_string(const char *str)
-{
-	U32 retval = 0;
-	while (*str++)
-	{
-		retval += *str;
-		retval <<= 1;
-	}
-	return (retval % MESSAGE_NUMBER_OF_HASH_BUCKETS);
-}
-
-
-
 LLMessageStringTable::LLMessageStringTable()
-:	mUsed(0)
+:	mUsed(0),
+	mTable(MESSAGE_NUMBER_OF_HASH_BUCKETS, true)
 {
-	for (U32 i = 0; i < MESSAGE_NUMBER_OF_HASH_BUCKETS; i++)
-	{
-		mEmpty[i] = TRUE;
-		mString[i][0] = 0;
-	}
 }
 
 
@@ -65,33 +48,22 @@ LLMessageStringTable::~LLMessageStringTable()
 
 char* LLMessageStringTable::getString(const char *str)
 {
-	U32 hash_value = message_hash_my_string(str);
-	while (!mEmpty[hash_value])
-	{
-		if (!strncmp(str, mString[hash_value], MESSAGE_MAX_STRINGS_LENGTH))
-		{
-			return mString[hash_value];
-		}
-		else
-		{
-			hash_value++;
-			hash_value %= MESSAGE_NUMBER_OF_HASH_BUCKETS;
-		}
-	}
-	// not found, so add!
-	strncpy(mString[hash_value], str, MESSAGE_MAX_STRINGS_LENGTH);	/* Flawfinder: ignore */
-	mString[hash_value][MESSAGE_MAX_STRINGS_LENGTH - 1] = 0;
-	mEmpty[hash_value] = FALSE;
-	mUsed++;
-	if (mUsed >= MESSAGE_NUMBER_OF_HASH_BUCKETS - 1)
+	char* interned = mTable.checkString(str);
+	if (!interned)
 	{
-		U32 i;
-		llinfos << "Dumping string table before crashing on HashTable full!" << llendl;
-		for (i = 0; i < MESSAGE_NUMBER_OF_HASH_BUCKETS; i++)
+		// not found, so add! Long names are cut to the old fixed slot
+		// length, so callers keep seeing the strings they always did.
+		char truncated[MESSAGE_MAX_STRINGS_LENGTH];	/* Flawfinder: ignore */
+		strncpy(truncated, str, MESSAGE_MAX_STRINGS_LENGTH);	/* Flawfinder: ignore */
+		truncated[MESSAGE_MAX_STRINGS_LENGTH - 1] = 0;
+		interned = mTable.checkString(truncated);
+		if (!interned)
 		{
-			llinfos << "Entry #" << i << ": " << mString[i] << llendl;
+			// Names are never removed, so this lives as long as the table.
+			interned = mTable.addString(truncated);
+			mNames.push_back(interned);
+			mUsed++;
 		}
 	}
-	return mString[hash_value];
+	return interned;
 }
-
@@ -43,6 +43,7 @@
 	#include <windows.h>
 #else
 	#include <sys/types.h>
+	#include <sys/select.h>
 	#include <sys/socket.h>
 	#include <netinet/in.h>
 	#include <arpa/inet.h>
@@ -333,6 +334,40 @@ S32 receive_packet(int hSocket, char * receiveBuffer)
 	return nRet;
 }
 
+BOOL wait_for_packet(int hSocket, S32 timeout_ms)
+{
+	fd_set read_fds;
+	FD_ZERO(&read_fds);
+	FD_SET((SOCKET)hSocket, &read_fds);
+	struct timeval timeout;
+	timeout.tv_sec = timeout_ms / 1000;
+	timeout.tv_usec = (timeout_ms % 1000) * 1000;
+	return select(0, &read_fds, NULL, NULL, &timeout) > 0;
+}
+
+S32 receive_packets(int hSocket, LLNetPacket* packets, S32 max_packets)
+{
+	S32 count = 0;
+	while (count < max_packets)
+	{
+		SOCKADDR_IN from;
+		int addr_size = sizeof(from);
+		int size = recvfrom(hSocket, packets[count].mData, NET_BUFFER_SIZE, 0, (struct sockaddr*)&from, &addr_size);
+		if (size == SOCKET_ERROR)
+		{
+			// WSAEWOULDBLOCK means we have them all; anything else will
+			// show up again on the next call.
+			break;
+		}
+		packets[count].mSize = size;
+		packets[count].mSenderIP = from.sin_addr.s_addr;
+		packets[count].mSenderPort = ntohs(from.sin_port);
+		packets[count].mReceivingIP = INVALID_HOST_IP_ADDRESS;
+		count++;
+	}
+	return count;
+}
+
 // Returns TRUE on success.
 BOOL send_packet(int hSocket, const char *sendBuffer, int size, U32 recipient, int nPort)
 {
@@ -518,12 +553,31 @@ void end_net(S32& socket_out)
 }
 
 #if LL_LINUX
+// The address a datagram was sent to, from its IP_PKTINFO.
+static void get_destip( struct msghdr *msg, U32 *dstip )
+{
+	struct cmsghdr *cmsgptr;
+	for( cmsgptr = CMSG_FIRSTHDR(msg); cmsgptr != NULL; cmsgptr = CMSG_NXTHDR( msg, cmsgptr ) )
+	{
+		if( cmsgptr->cmsg_level == SOL_IP && cmsgptr->cmsg_type == IP_PKTINFO )
+		{
+			in_pktinfo *pktinfo = (in_pktinfo *)CMSG_DATA(cmsgptr);
+			if( pktinfo )
+			{
+				// Two choices. routed and specified. ipi_addr is routed, ipi_spec_dst is
+				// routed. We should stay with specified until we go to multiple
+				// interfaces
+				*dstip = pktinfo->ipi_spec_dst.s_addr;
+			}
+		}
+	}
+}
+
 static int recvfrom_destip( int socket, void *buf, int len, struct sockaddr *from, socklen_t *fromlen, U32 *dstip )
 {
 	int size;
 	struct iovec iov[1];
 	char cmsg[CMSG_SPACE(sizeof(struct in_pktinfo))];
-	struct cmsghdr *cmsgptr;
 	struct msghdr msg = {0};
 
 	iov[0].iov_base = buf;
@@ -544,24 +598,91 @@ static int recvfrom_destip( int socket, void *buf, int len, struct sockaddr *fro
 		return -1;
 	}
 
-	for( cmsgptr = CMSG_FIRSTHDR(&msg); cmsgptr != NULL; cmsgptr = CMSG_NXTHDR( &msg, cmsgptr ) )
+	get_destip( &msg, dstip );
+
+	return size;
+}
+
+// recvmmsg() arrived in glibc 2.12, alongside MSG_WAITFORONE.
+#if defined(MSG_WAITFORONE)
+#define LL_RECVMMSG 1
+#endif
+#endif
+
+BOOL wait_for_packet(int hSocket, S32 timeout_ms)
+{
+	fd_set read_fds;
+	FD_ZERO(&read_fds);
+	FD_SET(hSocket, &read_fds);
+	struct timeval timeout;
+	timeout.tv_sec = timeout_ms / 1000;
+	timeout.tv_usec = (timeout_ms % 1000) * 1000;
+	return select(hSocket + 1, &read_fds, NULL, NULL, &timeout) > 0;
+}
+
+S32 receive_packets(int hSocket, LLNetPacket* packets, S32 max_packets)
+{
+#if LL_RECVMMSG
+	const S32 MAX_BATCH = 64;
+	struct mmsghdr msgs[MAX_BATCH];
+	struct iovec iovs[MAX_BATCH];
+	struct sockaddr_in from[MAX_BATCH];
+	char cmsgs[MAX_BATCH][CMSG_SPACE(sizeof(struct in_pktinfo))];
+
+	S32 batch = max_packets < MAX_BATCH ? max_packets : MAX_BATCH;
+	memset(msgs, 0, batch * sizeof(msgs[0]));
+	for (S32 i = 0; i < batch; i++)
 	{
-		if( cmsgptr->cmsg_level == SOL_IP && cmsgptr->cmsg_type == IP_PKTINFO )
+		iovs[i].iov_base = packets[i].mData;
+		iovs[i].iov_len = NET_BUFFER_SIZE;
+		msgs[i].msg_hdr.msg_name = &from[i];
+		msgs[i].msg_hdr.msg_namelen = sizeof(from[i]);
+		msgs[i].msg_hdr.msg_iov = &iovs[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+		msgs[i].msg_hdr.msg_control = cmsgs[i];
+		msgs[i].msg_hdr.msg_controllen = sizeof(cmsgs[i]);
+	}
+
+	int count = recvmmsg(hSocket, msgs, batch, MSG_DONTWAIT, NULL);
+	if (count <= 0)
+	{
+		return 0;
+	}
+
+	for (int i = 0; i < count; i++)
+	{
+		packets[i].mSize = msgs[i].msg_len;
+		packets[i].mSenderIP = from[i].sin_addr.s_addr;
+		packets[i].mSenderPort = ntohs(from[i].sin_port);
+		packets[i].mReceivingIP = INVALID_HOST_IP_ADDRESS;
+		get_destip(&msgs[i].msg_hdr, &packets[i].mReceivingIP);
+	}
+	return count;
+#else
+	S32 count = 0;
+	while (count < max_packets)
+	{
+		struct sockaddr_in from;
+		socklen_t addr_size = sizeof(from);
+		U32 receiving_ip = INVALID_HOST_IP_ADDRESS;
+#if LL_LINUX
+		int size = recvfrom_destip(hSocket, packets[count].mData, NET_BUFFER_SIZE, (struct sockaddr*)&from, &addr_size, &receiving_ip);
+#else
+		int size = recvfrom(hSocket, packets[count].mData, NET_BUFFER_SIZE, 0, (struct sockaddr*)&from, &addr_size);
+#endif
+		if (size == -1)
 		{
-			in_pktinfo *pktinfo = (in_pktinfo *)CMSG_DATA(cmsgptr);
-			if( pktinfo )
-			{
-				// Two choices. routed and specified. ipi_addr is routed, ipi_spec_dst is
-				// routed. We should stay with specified until we go to multiple
-				// interfaces
-				*dstip = pktinfo->ipi_spec_dst.s_addr;
-			}
+			break;
 		}
+		packets[count].mSize = size;
+		packets[count].mSenderIP = from.sin_addr.s_addr;
+		packets[count].mSenderPort = ntohs(from.sin_port);
+		packets[count].mReceivingIP = receiving_ip;
+		count++;
 	}
-
-	return size;
-}
+	return count;
 #endif
+}
 
 int receive_packet(int hSocket, char * receiveBuffer)
 {
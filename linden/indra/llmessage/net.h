@@ -51,6 +51,25 @@ S32		receive_packet(int hSocket, char * receiveBuffer);
 
 BOOL	send_packet(int hSocket, const char *sendBuffer, int size, U32 recipient, int nPort);	// Returns TRUE on success.
 
+// One datagram filled in by receive_packets().
+struct LLNetPacket
+{
+	char*	mData;			// at least NET_BUFFER_SIZE bytes, supplied by the caller
+	S32		mSize;
+	U32		mSenderIP;
+	U32		mSenderPort;	// host byte order
+	U32		mReceivingIP;	// INVALID_HOST_IP_ADDRESS if unknown
+};
+
+// Returns TRUE once a datagram is waiting, FALSE if none arrives within timeout_ms.
+BOOL	wait_for_packet(int hSocket, S32 timeout_ms);
+
+// Receives up to max_packets waiting datagrams, in one recvmmsg() call
+// where the platform has it.  Returns how many arrived, zero if none were
+// waiting.  Unlike receive_packet() it touches no globals, so it may run
+// on a thread of its own.
+S32		receive_packets(int hSocket, LLNetPacket* packets, S32 max_packets);
+
 //void	get_sender(char * tmp);
 LLHost  get_sender();
 U32		get_sender_port();
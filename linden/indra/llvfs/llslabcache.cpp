@@ -0,0 +1,763 @@
+/**
+ * @file llslabcache.cpp
+ * @brief Cache of UUID keyed blobs stored in a few large slab files
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include <algorithm>
+#include <sstream>
+
+#include "llslabcache.h"
+
+const U32 SLAB_MAGIC = 0x42414c53;			// "SLAB"
+const U32 SLAB_INDEX_MAGIC = 0x58444e49;	// "INDX"
+const U32 SLAB_VERSION = 1;
+const U32 SLAB_MIN_TABLE_SIZE = 256;
+const S32 SLAB_READ_RETRIES = 3;
+const U32 SLAB_COMPACT_MAX_MOVE = 1024 * 1024;	// bytes copied per compaction
+
+// On disk layouts, native byte order like the texture entries file
+struct LLSlabFileHeader
+{
+	U32 mMagic;
+	U32 mVersion;
+	U32 mSlab;
+	U32 mEpoch;
+};
+
+struct LLSlabIndexHeader
+{
+	U32 mMagic;
+	U32 mVersion;
+	U32 mSlabCount;
+	U32 mSlabSize;
+	U32 mActiveSlab;
+	U32 mEntryCount;
+};
+
+struct LLSlabIndexSlab
+{
+	U32 mEpoch;
+	U32 mHead;
+};
+
+struct LLSlabIndexEntry
+{
+	U8 mID[UUID_BYTES];
+	U32 mSlab;
+	U32 mLocation;
+	S32 mSize;
+	U32 mFlags;
+};
+
+LLSlabCache::LLSlabCache()
+	: mMutex(NULL),
+	  mReadOnly(FALSE),
+	  mSlabSize(0),
+	  mActiveSlab(0),
+	  mTableMask(0),
+	  mEntryCount(0),
+	  mCompactCount(0),
+	  mEvictCount(0),
+	  mCompactMoveBytes(0),
+	  mMissedReads(0)
+{
+}
+
+LLSlabCache::~LLSlabCache()
+{
+	close();
+}
+
+BOOL LLSlabCache::open(const std::string& basename, U32 slab_count, U32 slab_size, BOOL read_only)
+{
+	close();
+
+	LLMutexLock lock(&mMutex);
+	if (slab_count < 2 || slab_count > 0xffff || slab_size < 2 * SLAB_HEADER_SIZE)
+	{
+		llwarns << "Bad slab cache layout: " << slab_count << " x " << slab_size << llendl;
+		return FALSE;
+	}
+
+	mBasename = basename;
+	mReadOnly = read_only;
+	mSlabSize = slab_size;
+	mSlabs.resize(slab_count);
+	for (U32 i = 0; i < slab_count; ++i)
+	{
+		std::string filename = getSlabFilename(i);
+		LLFILE* fp = LLFile::fopen(filename, read_only ? "rb" : "r+b");	/* Flawfinder: ignore */
+		if (!fp && !read_only)
+		{
+			fp = LLFile::fopen(filename, "w+b");	/* Flawfinder: ignore */
+		}
+		if (!fp)
+		{
+			llwarns << "Can't open slab file " << filename << llendl;
+			for (U32 j = 0; j < i; ++j)
+			{
+				fclose(mSlabs[j].mFP);
+			}
+			mSlabs.clear();
+			return FALSE;
+		}
+		mSlabs[i].mFP = fp;
+
+		if (!read_only)
+		{
+			// Preallocate the whole slab up front
+			fseek(fp, 0, SEEK_END);
+			if ((U32)ftell(fp) < mSlabSize)
+			{
+				U8 zero = 0;
+				writeData(i, &zero, mSlabSize - 1, 1);
+			}
+		}
+	}
+
+	mTable.assign(SLAB_MIN_TABLE_SIZE, Slot());
+	mTableMask = SLAB_MIN_TABLE_SIZE - 1;
+	mEntryCount = 0;
+	mActiveSlab = 0;
+	if (!loadIndex())
+	{
+		resetSlabs();
+	}
+
+	llinfos << "Slab cache " << mBasename << ": " << mEntryCount << " entries in "
+			<< slab_count << " slabs of " << mSlabSize / (1024 * 1024) << " MB" << llendl;
+	return TRUE;
+}
+
+void LLSlabCache::close()
+{
+	LLMutexLock lock(&mMutex);
+	if (mSlabs.empty())
+	{
+		return;
+	}
+	if (!mReadOnly)
+	{
+		saveIndexLocked();
+	}
+	for (U32 i = 0; i < mSlabs.size(); ++i)
+	{
+		fclose(mSlabs[i].mFP);
+	}
+	mSlabs.clear();
+	mTable.clear();
+	mTableMask = 0;
+	mEntryCount = 0;
+}
+
+S32 LLSlabCache::getSize(const LLUUID& id)
+{
+	LLMutexLock lock(&mMutex);
+	Slot* slot = lookup(id);
+	return slot ? slot->mSize : 0;
+}
+
+S32 LLSlabCache::read(const LLUUID& id, U8* buffer, S32 offset, S32 length)
+{
+	for (S32 attempt = 0; attempt < SLAB_READ_RETRIES; ++attempt)
+	{
+		mMutex.lock();
+		Slot* slot = lookup(id);
+		if (!slot || offset >= slot->mSize || offset < 0)
+		{
+			mMutex.unlock();
+			return 0;
+		}
+		slot->mFlags |= SLOT_READ;
+		U32 slab = slot->mSlab;
+		U32 location = slot->mLocation + offset;
+		S32 size = llmin(length, slot->mSize - offset);
+		U32 epoch = mSlabs[slab].mEpoch;
+		mMutex.unlock();
+
+		S32 bytes_read = readData(slab, buffer, location, size);
+
+		// Data never moves within an epoch, so if the slab wasn't rewound
+		// while we read, what we have is good.
+		LLMutexLock lock(&mMutex);
+		if (mSlabs[slab].mEpoch == epoch)
+		{
+			return bytes_read;
+		}
+		++mMissedReads;
+	}
+	return 0;
+}
+
+S32 LLSlabCache::write(const LLUUID& id, const U8* buffer, S32 length, std::vector<LLUUID>* evicted)
+{
+	if (mReadOnly || length <= 0)
+	{
+		return 0;
+	}
+
+	mMutex.lock();
+	U32 slab, location;
+	if (mSlabs.empty() || !allocate(length, slab, location, evicted))
+	{
+		mMutex.unlock();
+		return 0;
+	}
+	U32 epoch = mSlabs[slab].mEpoch;
+	++mSlabs[slab].mWriters;
+	mMutex.unlock();
+
+	S32 bytes_written = writeData(slab, buffer, location, length);
+
+	LLMutexLock lock(&mMutex);
+	--mSlabs[slab].mWriters;
+	if (bytes_written != length || mSlabs[slab].mEpoch != epoch)
+	{
+		return 0;
+	}
+	Slot new_slot;
+	new_slot.mID = id;
+	new_slot.mLocation = location;
+	new_slot.mSize = length;
+	new_slot.mSlab = (U16)slab;
+	new_slot.mFlags = SLOT_USED;
+	insertSlot(new_slot);
+	return length;
+}
+
+BOOL LLSlabCache::remove(const LLUUID& id)
+{
+	LLMutexLock lock(&mMutex);
+	if (mTable.empty())
+	{
+		return FALSE;
+	}
+	U32 index = findSlot(id);
+	if (!(mTable[index].mFlags & SLOT_USED))
+	{
+		return FALSE;
+	}
+	eraseSlot(index);
+	return TRUE;
+}
+
+void LLSlabCache::clear()
+{
+	LLMutexLock lock(&mMutex);
+	if (mSlabs.empty() || mReadOnly)
+	{
+		return;
+	}
+	mTable.assign(SLAB_MIN_TABLE_SIZE, Slot());
+	mTableMask = SLAB_MIN_TABLE_SIZE - 1;
+	mEntryCount = 0;
+	resetSlabs();
+	saveIndexLocked();
+}
+
+BOOL LLSlabCache::saveIndex()
+{
+	LLMutexLock lock(&mMutex);
+	if (mSlabs.empty() || mReadOnly)
+	{
+		return FALSE;
+	}
+	return saveIndexLocked();
+}
+
+U32 LLSlabCache::getEntryCount()
+{
+	LLMutexLock lock(&mMutex);
+	return mEntryCount;
+}
+
+S64 LLSlabCache::getUsedBytes()
+{
+	LLMutexLock lock(&mMutex);
+	S64 used = 0;
+	for (U32 i = 0; i < mSlabs.size(); ++i)
+	{
+		used += mSlabs[i].mLiveBytes;
+	}
+	return used;
+}
+
+void LLSlabCache::dumpStatistics()
+{
+	LLMutexLock lock(&mMutex);
+	S64 used = 0;
+	S64 appended = 0;
+	for (U32 i = 0; i < mSlabs.size(); ++i)
+	{
+		used += mSlabs[i].mLiveBytes;
+		appended += mSlabs[i].mHead - SLAB_HEADER_SIZE;
+	}
+	llinfos << "Slab cache " << mBasename << ": " << mEntryCount << " entries, "
+			<< used / 1024 << " KB live of " << appended / 1024 << " KB written, "
+			<< "table " << mTable.size() << " slots" << llendl;
+	llinfos << "Compactions: " << mCompactCount << " evicted: " << mEvictCount
+			<< " moved: " << mCompactMoveBytes / 1024 << " KB"
+			<< " retried reads: " << mMissedReads << llendl;
+}
+
+//static
+void LLSlabCache::removeFiles(const std::string& basename, U32 slab_count)
+{
+	for (U32 i = 0; i < slab_count; ++i)
+	{
+		std::ostringstream filename;
+		filename << basename << "." << i << ".slab";
+		LLFile::remove(filename.str());
+	}
+	LLFile::remove(basename + ".index");
+}
+
+//----------------------------------------------------------------------------
+// mMutex must be LOCKED for the following functions
+
+//static
+U32 LLSlabCache::hashID(const LLUUID& id)
+{
+	U32 words[4];
+	memcpy(words, id.mData, sizeof(words));
+	U32 hash = words[0] ^ words[1] ^ words[2] ^ words[3];
+	// Mix so that ids differing in a few bits land far apart
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6b;
+	hash ^= hash >> 13;
+	hash *= 0xc2b2ae35;
+	hash ^= hash >> 16;
+	return hash;
+}
+
+// Returns the slot holding id, or the free slot where it would go
+U32 LLSlabCache::findSlot(const LLUUID& id) const
+{
+	U32 index = hashID(id) & mTableMask;
+	while ((mTable[index].mFlags & SLOT_USED) && mTable[index].mID != id)
+	{
+		index = (index + 1) & mTableMask;
+	}
+	return index;
+}
+
+LLSlabCache::Slot* LLSlabCache::lookup(const LLUUID& id)
+{
+	if (mTable.empty())
+	{
+		return NULL;
+	}
+	Slot* slot = &mTable[findSlot(id)];
+	return (slot->mFlags & SLOT_USED) ? slot : NULL;
+}
+
+void LLSlabCache::insertSlot(const Slot& slot)
+{
+	// keep the table at most 3/4 full so probe runs stay short
+	if ((mEntryCount + 1) * 4 > mTable.size() * 3)
+	{
+		growTable();
+	}
+	U32 index = findSlot(slot.mID);
+	Slot& dest = mTable[index];
+	if (dest.mFlags & SLOT_USED)
+	{
+		mSlabs[dest.mSlab].mLiveBytes -= dest.mSize;
+	}
+	else
+	{
+		++mEntryCount;
+	}
+	dest = slot;
+	mSlabs[slot.mSlab].mLiveBytes += slot.mSize;
+}
+
+void LLSlabCache::eraseSlot(U32 index)
+{
+	mSlabs[mTable[index].mSlab].mLiveBytes -= mTable[index].mSize;
+	--mEntryCount;
+
+	// Shift later members of the probe run back into the hole so lookups
+	// never need tombstones.
+	U32 hole = index;
+	U32 next = (hole + 1) & mTableMask;
+	while (mTable[next].mFlags & SLOT_USED)
+	{
+		U32 home = hashID(mTable[next].mID) & mTableMask;
+		if (((next - home) & mTableMask) >= ((next - hole) & mTableMask))
+		{
+			mTable[hole] = mTable[next];
+			hole = next;
+		}
+		next = (next + 1) & mTableMask;
+	}
+	mTable[hole] = Slot();
+}
+
+void LLSlabCache::growTable()
+{
+	std::vector<Slot> old_table;
+	old_table.swap(mTable);
+	U32 size = llmax((U32)old_table.size() * 2, SLAB_MIN_TABLE_SIZE);
+	mTable.assign(size, Slot());
+	mTableMask = size - 1;
+	for (U32 i = 0; i < old_table.size(); ++i)
+	{
+		if (old_table[i].mFlags & SLOT_USED)
+		{
+			mTable[findSlot(old_table[i].mID)] = old_table[i];
+		}
+	}
+}
+
+BOOL LLSlabCache::allocate(S32 length, U32& slab, U32& location, std::vector<LLUUID>* evicted)
+{
+	if ((U32)length > mSlabSize - SLAB_HEADER_SIZE)
+	{
+		return FALSE;
+	}
+	if ((U64)mSlabs[mActiveSlab].mHead + length > mSlabSize)
+	{
+		// Move on to the oldest slab, making room in it first
+		U32 next = (mActiveSlab + 1) % mSlabs.size();
+		if (!compactSlab(next, length, evicted))
+		{
+			return FALSE;
+		}
+		mActiveSlab = next;
+		saveIndexLocked();
+	}
+	slab = mActiveSlab;
+	location = mSlabs[slab].mHead;
+	mSlabs[slab].mHead += length;
+	return TRUE;
+}
+
+// Rewinds the slab, sliding blobs read since they were last written or
+// moved down to its front in location order (so each one only moves
+// toward the start) and evicting the rest. At most half the slab is kept,
+// and always enough room for reserve bytes. Runs with mMutex held, so at
+// most SLAB_COMPACT_MAX_MOVE bytes are copied; past that, blobs that would
+// have to move are evicted too.
+BOOL LLSlabCache::compactSlab(U32 slab, S32 reserve, std::vector<LLUUID>* evicted)
+{
+	Slab& victim = mSlabs[slab];
+	if (victim.mWriters > 0)
+	{
+		// a slow write is still going into it
+		return FALSE;
+	}
+
+	// (location, table index) of everything in the slab
+	std::vector<std::pair<U32, U32> > members;
+	for (U32 i = 0; i < mTable.size(); ++i)
+	{
+		if ((mTable[i].mFlags & SLOT_USED) && mTable[i].mSlab == slab)
+		{
+			members.push_back(std::make_pair(mTable[i].mLocation, i));
+		}
+	}
+	std::sort(members.begin(), members.end());
+
+	// Bump the epoch on disk before moving anything, so an index saved
+	// earlier no longer trusts this slab.
+	++victim.mEpoch;
+	victim.mHead = SLAB_HEADER_SIZE;
+	BOOL header_ok = writeSlabHeader(slab);
+
+	U32 capacity = mSlabSize - SLAB_HEADER_SIZE;
+	U32 keep_limit = llmin(capacity / 2, capacity - (U32)reserve);
+	U32 moved = 0;
+	std::vector<U8> buffer;
+	std::vector<LLUUID> dropped;
+	for (U32 i = 0; i < members.size(); ++i)
+	{
+		Slot& slot = mTable[members[i].second];
+		BOOL keep = header_ok
+			&& (slot.mFlags & SLOT_READ)
+			&& (victim.mHead - SLAB_HEADER_SIZE) + (U32)slot.mSize <= keep_limit;
+		if (keep && slot.mLocation != victim.mHead)
+		{
+			keep = moved + (U32)slot.mSize <= SLAB_COMPACT_MAX_MOVE;
+		}
+		if (keep && slot.mLocation != victim.mHead)
+		{
+			moved += slot.mSize;
+			buffer.resize(slot.mSize);
+			keep = readData(slab, &buffer[0], slot.mLocation, slot.mSize) == slot.mSize
+				&& writeData(slab, &buffer[0], victim.mHead, slot.mSize) == slot.mSize;
+			mCompactMoveBytes += slot.mSize;
+		}
+		if (keep)
+		{
+			slot.mLocation = victim.mHead;
+			slot.mFlags &= ~SLOT_READ;
+			victim.mHead += slot.mSize;
+		}
+		else
+		{
+			dropped.push_back(slot.mID);
+		}
+	}
+
+	for (U32 i = 0; i < dropped.size(); ++i)
+	{
+		eraseSlot(findSlot(dropped[i]));
+		if (evicted)
+		{
+			evicted->push_back(dropped[i]);
+		}
+	}
+	mEvictCount += dropped.size();
+	++mCompactCount;
+	return TRUE;
+}
+
+BOOL LLSlabCache::writeSlabHeader(U32 slab)
+{
+	if (mReadOnly)
+	{
+		return FALSE;
+	}
+	LLSlabFileHeader header;
+	header.mMagic = SLAB_MAGIC;
+	header.mVersion = SLAB_VERSION;
+	header.mSlab = slab;
+	header.mEpoch = mSlabs[slab].mEpoch;
+	return writeData(slab, (U8*)&header, 0, sizeof(header)) == sizeof(header);
+}
+
+// Starts every slab over, empty. Slabs with writes in flight are marked
+// full instead, so those writes can't land on top of new data.
+void LLSlabCache::resetSlabs()
+{
+	for (U32 i = 0; i < mSlabs.size(); ++i)
+	{
+		Slab& slab = mSlabs[i];
+		LLSlabFileHeader header;
+		if (readData(i, (U8*)&header, 0, sizeof(header)) == sizeof(header)
+			&& header.mMagic == SLAB_MAGIC)
+		{
+			slab.mEpoch = llmax(slab.mEpoch, header.mEpoch);
+		}
+		++slab.mEpoch;
+		slab.mHead = slab.mWriters ? mSlabSize : (U32)SLAB_HEADER_SIZE;
+		slab.mLiveBytes = 0;
+		writeSlabHeader(i);
+	}
+	mActiveSlab = 0;
+}
+
+BOOL LLSlabCache::saveIndexLocked()
+{
+	if (mReadOnly)
+	{
+		return FALSE;
+	}
+
+	std::vector<U8> data;
+	LLSlabIndexHeader header;
+	header.mMagic = SLAB_INDEX_MAGIC;
+	header.mVersion = SLAB_VERSION;
+	header.mSlabCount = mSlabs.size();
+	header.mSlabSize = mSlabSize;
+	header.mActiveSlab = mActiveSlab;
+	header.mEntryCount = mEntryCount;
+	data.resize(sizeof(header)
+				+ mSlabs.size() * sizeof(LLSlabIndexSlab)
+				+ mEntryCount * sizeof(LLSlabIndexEntry));
+	U8* ptr = &data[0];
+	memcpy(ptr, &header, sizeof(header));
+	ptr += sizeof(header);
+	for (U32 i = 0; i < mSlabs.size(); ++i)
+	{
+		LLSlabIndexSlab slab;
+		slab.mEpoch = mSlabs[i].mEpoch;
+		slab.mHead = mSlabs[i].mHead;
+		memcpy(ptr, &slab, sizeof(slab));
+		ptr += sizeof(slab);
+	}
+	for (U32 i = 0; i < mTable.size(); ++i)
+	{
+		const Slot& slot = mTable[i];
+		if (slot.mFlags & SLOT_USED)
+		{
+			LLSlabIndexEntry entry;
+			memcpy(entry.mID, slot.mID.mData, UUID_BYTES);
+			entry.mSlab = slot.mSlab;
+			entry.mLocation = slot.mLocation;
+			entry.mSize = slot.mSize;
+			entry.mFlags = slot.mFlags;
+			memcpy(ptr, &entry, sizeof(entry));
+			ptr += sizeof(entry);
+		}
+	}
+
+	// Write it aside and swap it in, so a crash leaves the old index
+	std::string filename = mBasename + ".index";
+	std::string temp_filename = filename + ".tmp";
+	LLFILE* fp = LLFile::fopen(temp_filename, "wb");	/* Flawfinder: ignore */
+	if (!fp)
+	{
+		llwarns << "Can't write slab cache index " << temp_filename << llendl;
+		return FALSE;
+	}
+	BOOL ok = fwrite(&data[0], data.size(), 1, fp) == 1;
+	ok = (fclose(fp) == 0) && ok;
+	if (ok)
+	{
+		LLFile::remove(filename);
+		ok = LLFile::rename(temp_filename, filename) == 0;
+	}
+	if (!ok)
+	{
+		llwarns << "Failed to save slab cache index " << filename << llendl;
+		LLFile::remove(temp_filename);
+	}
+	return ok;
+}
+
+BOOL LLSlabCache::loadIndex()
+{
+	std::string filename = mBasename + ".index";
+	LLFILE* fp = LLFile::fopen(filename, "rb");	/* Flawfinder: ignore */
+	if (!fp)
+	{
+		return FALSE;
+	}
+	std::vector<U8> data;
+	fseek(fp, 0, SEEK_END);
+	long file_size = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	BOOL ok = file_size >= (long)sizeof(LLSlabIndexHeader);
+	if (ok)
+	{
+		data.resize(file_size);
+		ok = fread(&data[0], file_size, 1, fp) == 1;
+	}
+	fclose(fp);
+	if (!ok)
+	{
+		return FALSE;
+	}
+
+	LLSlabIndexHeader header;
+	memcpy(&header, &data[0], sizeof(header));
+	if (header.mMagic != SLAB_INDEX_MAGIC
+		|| header.mVersion != SLAB_VERSION
+		|| header.mSlabCount != mSlabs.size()
+		|| header.mSlabSize != mSlabSize
+		|| header.mActiveSlab >= mSlabs.size()
+		|| (size_t)file_size != sizeof(header)
+							+ mSlabs.size() * sizeof(LLSlabIndexSlab)
+							+ header.mEntryCount * sizeof(LLSlabIndexEntry))
+	{
+		llinfos << "Slab cache index " << filename << " doesn't match, starting over" << llendl;
+		return FALSE;
+	}
+
+	// Slabs rewound after the index was saved have a newer epoch on disk;
+	// nothing the index says about them can be trusted.
+	const U8* ptr = &data[0] + sizeof(header);
+	std::vector<BOOL> valid(mSlabs.size(), FALSE);
+	for (U32 i = 0; i < mSlabs.size(); ++i)
+	{
+		LLSlabIndexSlab slab;
+		memcpy(&slab, ptr, sizeof(slab));
+		ptr += sizeof(slab);
+
+		LLSlabFileHeader slab_header;
+		BOOL header_ok = readData(i, (U8*)&slab_header, 0, sizeof(slab_header)) == sizeof(slab_header)
+			&& slab_header.mMagic == SLAB_MAGIC;
+		if (header_ok && slab_header.mEpoch == slab.mEpoch
+			&& slab.mHead >= (U32)SLAB_HEADER_SIZE && slab.mHead <= mSlabSize)
+		{
+			valid[i] = TRUE;
+			mSlabs[i].mEpoch = slab.mEpoch;
+			mSlabs[i].mHead = slab.mHead;
+		}
+		else
+		{
+			mSlabs[i].mEpoch = llmax(slab.mEpoch, header_ok ? slab_header.mEpoch : 0) + 1;
+			mSlabs[i].mHead = SLAB_HEADER_SIZE;
+			writeSlabHeader(i);
+		}
+	}
+
+	U32 table_size = SLAB_MIN_TABLE_SIZE;
+	while (table_size * 3 < header.mEntryCount * 4 + 4)
+	{
+		table_size *= 2;
+	}
+	mTable.assign(table_size, Slot());
+	mTableMask = table_size - 1;
+	for (U32 i = 0; i < header.mEntryCount; ++i)
+	{
+		LLSlabIndexEntry entry;
+		memcpy(&entry, ptr, sizeof(entry));
+		ptr += sizeof(entry);
+		if (entry.mSlab >= mSlabs.size() || !valid[entry.mSlab]
+			|| entry.mSize <= 0 || entry.mLocation < (U32)SLAB_HEADER_SIZE
+			|| (U64)entry.mLocation + entry.mSize > mSlabs[entry.mSlab].mHead)
+		{
+			continue;
+		}
+		Slot slot;
+		memcpy(slot.mID.mData, entry.mID, UUID_BYTES);
+		slot.mSlab = (U16)entry.mSlab;
+		slot.mLocation = entry.mLocation;
+		slot.mSize = entry.mSize;
+		slot.mFlags = (U16)(entry.mFlags & (SLOT_USED | SLOT_READ));
+		insertSlot(slot);
+	}
+	mActiveSlab = header.mActiveSlab;
+	return TRUE;
+}
+
+//----------------------------------------------------------------------------
+
+S32 LLSlabCache::readData(U32 slab, U8* buffer, U32 location, S32 length)
+{
+	return LLFile::readAt(mSlabs[slab].mFP, buffer, location, length);
+}
+
+S32 LLSlabCache::writeData(U32 slab, const U8* buffer, U32 location, S32 length)
+{
+	return LLFile::writeAt(mSlabs[slab].mFP, buffer, location, length);
+}
+
+std::string LLSlabCache::getSlabFilename(U32 slab) const
+{
+	std::ostringstream filename;
+	filename << mBasename << "." << slab << ".slab";
+	return filename.str();
+}
@@ -0,0 +1,150 @@
+/**
+ * @file llslabcache.h
+ * @brief Cache of UUID keyed blobs stored in a few large slab files
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLSLABCACHE_H
+#define LL_LLSLABCACHE_H
+
+#include <vector>
+#include "llfile.h"
+#include "lluuid.h"
+#include "llthread.h"
+
+// LLSlabCache keeps whole blobs (texture bodies, for instance) in a
+// handful of preallocated slab files instead of one file per blob.
+// Writes are appended to the active slab. When it fills up, the oldest
+// slab is compacted in place: blobs read since they were written slide
+// to its front, the rest are evicted, and it becomes the active slab.
+// An open addressing table in memory maps ids to their slab and
+// location, and is saved to an index file so a warm start needs one read
+// instead of a directory walk. All file I/O is positional and done
+// outside the lock, except while a slab is being compacted.
+class LLSlabCache
+{
+public:
+	LLSlabCache();
+	~LLSlabCache();
+
+	// Opens or creates <basename>.<n>.slab for each slab and reloads
+	// <basename>.index. A layout that doesn't match, or no index at all,
+	// starts the cache empty.
+	BOOL open(const std::string& basename, U32 slab_count, U32 slab_size, BOOL read_only);
+	// Saves the index and closes the slab files
+	void close();
+	BOOL isOpen() const { return !mSlabs.empty(); }
+
+	// Returns 0 if the id isn't cached
+	S32 getSize(const LLUUID& id);
+	// Returns the number of bytes read, 0 if the id isn't cached
+	S32 read(const LLUUID& id, U8* buffer, S32 offset, S32 length);
+	// Stores the whole blob, replacing any earlier one for that id.
+	// Ids dropped to make room are added to evicted, when given.
+	// Returns the number of bytes written, 0 if there was no room.
+	S32 write(const LLUUID& id, const U8* buffer, S32 length, std::vector<LLUUID>* evicted = NULL);
+	BOOL remove(const LLUUID& id);
+	// Forgets every blob and rewinds all the slabs
+	void clear();
+	BOOL saveIndex();
+
+	U32 getEntryCount();
+	S64 getUsedBytes();
+	S64 getCapacity() const { return (S64)mSlabs.size() * (mSlabSize - SLAB_HEADER_SIZE); }
+	void dumpStatistics();
+
+	// Deletes the slab and index files of a cache that isn't open
+	static void removeFiles(const std::string& basename, U32 slab_count);
+
+	enum { SLAB_HEADER_SIZE = 4096 };	// slab data starts after this
+
+protected:
+	struct Slot
+	{
+		Slot() : mLocation(0), mSize(0), mSlab(0), mFlags(0) {}
+		LLUUID mID;
+		U32 mLocation;		// offset in the slab file
+		S32 mSize;
+		U16 mSlab;
+		U16 mFlags;
+	};
+	enum
+	{
+		SLOT_USED = 0x1,
+		SLOT_READ = 0x2		// read since written or last compacted
+	};
+
+	struct Slab
+	{
+		Slab() : mFP(NULL), mHead(SLAB_HEADER_SIZE), mEpoch(0), mLiveBytes(0), mWriters(0) {}
+		LLFILE* mFP;
+		U32 mHead;			// next free byte
+		U32 mEpoch;			// bumped each time the slab is rewound
+		S64 mLiveBytes;
+		S32 mWriters;		// writes in flight into the slab
+	};
+
+	// mMutex must be LOCKED for all of these
+	U32 findSlot(const LLUUID& id) const;
+	Slot* lookup(const LLUUID& id);
+	void insertSlot(const Slot& slot);
+	void eraseSlot(U32 index);
+	void growTable();
+	BOOL allocate(S32 length, U32& slab, U32& location, std::vector<LLUUID>* evicted);
+	BOOL compactSlab(U32 slab, S32 reserve, std::vector<LLUUID>* evicted);
+	BOOL writeSlabHeader(U32 slab);
+	BOOL saveIndexLocked();
+	BOOL loadIndex();
+	void resetSlabs();
+
+	S32 readData(U32 slab, U8* buffer, U32 location, S32 length);
+	S32 writeData(U32 slab, const U8* buffer, U32 location, S32 length);
+
+	static U32 hashID(const LLUUID& id);
+	std::string getSlabFilename(U32 slab) const;
+
+protected:
+	LLMutex mMutex;
+	std::string mBasename;
+	BOOL mReadOnly;
+	U32 mSlabSize;
+	std::vector<Slab> mSlabs;
+	U32 mActiveSlab;
+	std::vector<Slot> mTable;	// size is a power of two
+	U32 mTableMask;
+	U32 mEntryCount;
+
+	// statistics
+	U32 mCompactCount;
+	U32 mEvictCount;
+	S64 mCompactMoveBytes;
+	U32 mMissedReads;
+};
+
+#endif
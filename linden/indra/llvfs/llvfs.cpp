@@ -51,6 +51,8 @@
 const S32 FILE_BLOCK_MASK = 0x000003FF;	 // 1024-byte blocks
 const S32 VFS_CLEANUP_SIZE = 5242880;  // how much space we free up in a single stroke
 const S32 BLOCK_LENGTH_INVALID = -1;	// mLength for invalid LLVFSFileBlocks
+const S32 VFS_COMPACT_MAX_BLOCKS = 32;	// files looked at per compaction step
+const F32 VFS_COMPACT_FRAGMENTATION = 0.25f;	// don't start a compaction pass below this
 
 LLVFS *gVFS = NULL;
 
@@ -77,6 +79,13 @@ public:
 		return lhs->mLocation < rhs->mLocation;
 	}
 
+	static bool locationSortPredicateDescending(
+		const LLVFSBlock* lhs,
+		const LLVFSBlock* rhs)
+	{
+		return lhs->mLocation > rhs->mLocation;
+	}
+
 public:
 	U32 mLocation;
 	S32	mLength;		// allocated block size
@@ -127,6 +136,7 @@ public:
 		mSize = 0;
 		mIndexLocation = -1;
 		mAccessTime = (U32)time(NULL);
+		mIOCount = 0;
 
 		for (S32 i = 0; i < (S32)VFSLOCK_COUNT; i++)
 		{
@@ -216,6 +226,7 @@ public:
 	S32  mIndexLocation; // location of index entry
 	U32  mAccessTime;
 	BOOL mLocks[VFSLOCK_COUNT]; // number of outstanding locks of each type
+	S32  mIOCount;		// reads and writes in progress outside mDataMutex
     
 	static const S32 SERIAL_SIZE;
 };
@@ -234,9 +245,19 @@ const S32 LLVFSFileBlock::SERIAL_SIZE = 34;
      
 
 LLVFS::LLVFS(const std::string& index_filename, const std::string& data_filename, const BOOL read_only, const U32 presize, const BOOL remove_after_crash)
-:	mRemoveAfterCrash(remove_after_crash)
+:	mFreeBinMask(0),
+	mFreeBlockCount(0),
+	mTotalFreeSize(0),
+	mRemoveAfterCrash(remove_after_crash),
+	mCompactLocation(U32_MAX),
+	mCompactNext(0),
+	mAllocCount(0),
+	mAllocTime(0.0),
+	mMaxAllocTime(0.0),
+	mCompactMoveCount(0),
+	mCompactMoveBytes(0)
 {
-	mDataMutex = new LLMutex(0);
+	mDataMutex = new LLCondition(0);
 
 	S32 i;
 	for (i = 0; i < VFSLOCK_COUNT; i++)
@@ -606,7 +627,10 @@ LLVFS::~LLVFS()
 	}
 	mFileBlocks.clear();
 	
-	mFreeBlocksByLength.clear();
+	for (S32 bin = 0; bin < FREE_BIN_COUNT; bin++)
+	{
+		mFreeBlocksByLength[bin].clear();
+	}
 
 	for_each(mFreeBlocksByLocation.begin(), mFreeBlocksByLocation.end(), DeletePairedPointer());
     
@@ -632,17 +656,15 @@ void LLVFS::presizeDataFile(const U32 size)
 	}
 
 	// we're creating this file for the first time, size it
-	fseek(mDataFP, size-1, SEEK_SET);
-	S32 tmp = 0;
-	tmp = (S32)fwrite(&tmp, 1, 1, mDataFP);
-	// fflush(mDataFP);
+	U8 zero = 0;
+	S32 tmp = writeData(&zero, size-1, 1);
 
 	// also remove any index, since this vfs is now blank
 	LLFile::remove(mIndexFilename);
 
 	if (tmp)
 	{
-		llinfos << "Pre-sized VFS data file to " << ftell(mDataFP) << " bytes" << llendl;
+		llinfos << "Pre-sized VFS data file to " << size << " bytes" << llendl;
 	}
 	else
 	{
@@ -650,6 +672,52 @@ void LLVFS::presizeDataFile(const U32 size)
 	}
 }
 
+S32 LLVFS::readData(U8 *buffer, U32 location, S32 length)
+{
+	return LLFile::readAt(mDataFP, buffer, location, length);
+}
+
+S32 LLVFS::writeData(const U8 *buffer, U32 location, S32 length)
+{
+	return LLFile::writeAt(mDataFP, buffer, location, length);
+}
+
+// mDataMutex must be LOCKED before calling this
+void LLVFS::beginBlockIO(LLVFSFileBlock *block)
+{
+	++block->mIOCount;
+}
+
+// mDataMutex must be LOCKED before calling this
+void LLVFS::endBlockIO(LLVFSFileBlock *block)
+{
+	if (--block->mIOCount == 0)
+	{
+		mDataMutex->broadcast();
+	}
+}
+
+// mDataMutex must be LOCKED before calling this
+// Waiting unlocks mDataMutex, so anything found before calling this
+// must be looked up again afterwards.
+LLVFSFileBlock *LLVFS::waitForIdleBlock(const LLVFSFileSpecifier &spec)
+{
+	while (TRUE)
+	{
+		fileblock_map::iterator it = mFileBlocks.find(spec);
+		if (it == mFileBlocks.end())
+		{
+			return NULL;
+		}
+		LLVFSFileBlock *block = (*it).second;
+		if (block->mIOCount == 0)
+		{
+			return block;
+		}
+		mDataMutex->wait();
+	}
+}
+
 BOOL LLVFS::getExists(const LLUUID &file_id, const LLAssetType::EType file_type)
 {
 	LLVFSFileBlock *block = NULL;
@@ -733,8 +801,7 @@ BOOL LLVFS::checkAvailable(S32 max_size)
 {
 	lockData();
 	
-	blocks_length_map_t::iterator iter = mFreeBlocksByLength.lower_bound(max_size); // first entry >= size
-	const BOOL res(iter == mFreeBlocksByLength.end() ? FALSE : TRUE);
+	const BOOL res(findBlockLength(max_size) ? TRUE : FALSE);
 
 	unlockData();
 	
@@ -759,13 +826,9 @@ BOOL LLVFS::setMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type
 
 	lockData();
 	
+	// the data may move, so let reads and writes of it finish first
 	LLVFSFileSpecifier spec(file_id, file_type);
-	LLVFSFileBlock *block = NULL;
-	fileblock_map::iterator it = mFileBlocks.find(spec);
-	if (it != mFileBlocks.end())
-	{
-		block = (*it).second;
-	}
+	LLVFSFileBlock *block = waitForIdleBlock(spec);
     
 	// round all sizes upward to KB increments
 	// SJB: Need to not round for the new texture-pipeline code so we know the correct
@@ -862,11 +925,9 @@ BOOL LLVFS::setMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type
 					{
 						// move the file into the new block
 						U8 *buffer = new U8[block->mSize];
-						fseek(mDataFP, block->mLocation, SEEK_SET);
-						if (fread(buffer, block->mSize, 1, mDataFP) == 1)
+						if (readData(buffer, block->mLocation, block->mSize) == block->mSize)
 						{
-							fseek(mDataFP, new_data_location, SEEK_SET);
-							if (fwrite(buffer, block->mSize, 1, mDataFP) != 1)
+							if (writeData(buffer, new_data_location, block->mSize) != block->mSize)
 							{
 								llwarns << "Short write" << llendl;
 							}
@@ -956,6 +1017,9 @@ void LLVFS::renameFile(const LLUUID &file_id, const LLAssetType::EType file_type
 	
 	LLVFSFileSpecifier new_spec(new_id, new_type);
 	LLVFSFileSpecifier old_spec(file_id, file_type);
+
+	// any file being replaced is freed, so let its reads finish first
+	waitForIdleBlock(new_spec);
 	
 	fileblock_map::iterator it = mFileBlocks.find(old_spec);
 	if (it != mFileBlocks.end())
@@ -1043,10 +1107,9 @@ void LLVFS::removeFile(const LLUUID &file_id, const LLAssetType::EType file_type
     lockData();
 	
 	LLVFSFileSpecifier spec(file_id, file_type);
-	fileblock_map::iterator it = mFileBlocks.find(spec);
-	if (it != mFileBlocks.end())
+	LLVFSFileBlock *block = waitForIdleBlock(spec);
+	if (block)
 	{
-		LLVFSFileBlock *block = (*it).second;
 		removeFileBlock(block);
 	}
 	else
@@ -1069,7 +1132,7 @@ S32 LLVFS::getData(const LLUUID &file_id, const LLAssetType::EType file_type, U8
 	llassert(location >= 0);
 	llassert(length >= 0);
 
-	BOOL do_read = FALSE;
+	LLVFSFileBlock *block = NULL;
 	
     lockData();
 	
@@ -1077,13 +1140,14 @@ S32 LLVFS::getData(const LLUUID &file_id, const LLAssetType::EType file_type, U8
 	fileblock_map::iterator it = mFileBlocks.find(spec);
 	if (it != mFileBlocks.end())
 	{
-		LLVFSFileBlock *block = (*it).second;
+		block = (*it).second;
 
 		block->mAccessTime = (U32)time(NULL);
     
 		if (location > block->mSize)
 		{
 			llwarns << "VFS: Attempt to read location " << location << " in file " << file_id << " of length " << block->mSize << llendl;
+			block = NULL;
 		}
 		else
 		{
@@ -1092,17 +1156,21 @@ S32 LLVFS::getData(const LLUUID &file_id, const LLAssetType::EType file_type, U8
 				length = block->mSize - location;
 			}
 			location += block->mLocation;
-			do_read = TRUE;
+			beginBlockIO(block);
 		}
 	}
+	
+	unlockData();
 
-	if (do_read)
+	if (block)
 	{
-		fseek(mDataFP, location, SEEK_SET);
-		bytesread = (S32)fread(buffer, 1, length, mDataFP);
+		// reads of other blocks and their bookkeeping can go ahead meanwhile
+		bytesread = readData(buffer, location, length);
+
+		lockData();
+		endBlockIO(block);
+		unlockData();
 	}
-	
-	unlockData();
 
 	return bytesread;
 }
@@ -1168,13 +1236,24 @@ S32 LLVFS::storeData(const LLUUID &file_id, const LLAssetType::EType file_type,
 			}
 			U32 file_location = location + block->mLocation;
 			
-			fseek(mDataFP, file_location, SEEK_SET);
-			S32 write_len = (S32)fwrite(buffer, 1, length, mDataFP);
+			S32 write_len;
+			if (in_loc == -1)
+			{
+				// appends stay in order with each other
+				write_len = writeData(buffer, file_location, length);
+			}
+			else
+			{
+				beginBlockIO(block);
+				unlockData();
+				write_len = writeData(buffer, file_location, length);
+				lockData();
+				endBlockIO(block);
+			}
 			if (write_len != length)
 			{
 				llwarns << llformat("VFS Write Error: %d != %d",write_len,length) << llendl;
 			}
-			// fflush(mDataFP);
 			
 			if (location + length > block->mSize)
 			{
@@ -1266,31 +1345,64 @@ BOOL LLVFS::isLocked(const LLUUID &file_id, const LLAssetType::EType file_type,
 // protected
 //============================================================================
 
+// static
+S32 LLVFS::getLengthBin(S32 length)
+{
+	S32 bin = 0;
+	for (length >>= 11; length && bin < FREE_BIN_COUNT - 1; length >>= 1)
+	{
+		bin++;
+	}
+	return bin;
+}
+
+void LLVFS::insertBlockLength(LLVFSBlock *block)
+{
+	S32 bin = getLengthBin(block->mLength);
+	mFreeBlocksByLength[bin].insert(blocks_length_map_t::value_type(std::make_pair(block->mLength, block->mLocation), block));
+	mFreeBinMask |= 1U << bin;
+	mFreeBlockCount++;
+	mTotalFreeSize += block->mLength;
+}
+
 void LLVFS::eraseBlockLength(LLVFSBlock *block)
 {
 	// find the corresponding map entry in the length map and erase it
-	S32 length = block->mLength;
-	blocks_length_map_t::iterator iter = mFreeBlocksByLength.lower_bound(length);
-	blocks_length_map_t::iterator end = mFreeBlocksByLength.end();
-	bool found_block = false;
-	while(iter != end)
-	{
-		LLVFSBlock *tblock = iter->second;
-		llassert(tblock->mLength == length); // there had -better- be an entry with our length!
-		if (tblock == block)
-		{
-			mFreeBlocksByLength.erase(iter);
-			found_block = true;
-			break;
-		}
-		++iter;
-	}
-	if(!found_block)
+	S32 bin = getLengthBin(block->mLength);
+	blocks_length_map_t::iterator iter = mFreeBlocksByLength[bin].find(std::make_pair(block->mLength, block->mLocation));
+	if (iter == mFreeBlocksByLength[bin].end() || iter->second != block)
 	{
 		llerrs << "eraseBlock could not find block" << llendl;
 	}
+	mFreeBlocksByLength[bin].erase(iter);
+	if (mFreeBlocksByLength[bin].empty())
+	{
+		mFreeBinMask &= ~(1U << bin);
+	}
+	mFreeBlockCount--;
+	mTotalFreeSize -= block->mLength;
 }
 
+LLVFSBlock *LLVFS::findBlockLength(S32 size)
+{
+	S32 bin = getLengthBin(size);
+	blocks_length_map_t::iterator iter = mFreeBlocksByLength[bin].lower_bound(std::make_pair(size, (U32)0));
+	if (iter != mFreeBlocksByLength[bin].end())
+	{
+		return iter->second;
+	}
+
+	// everything in a larger bin is big enough, take the smallest
+	for (U32 mask = mFreeBinMask >> (bin + 1); mask; mask >>= 1)
+	{
+		bin++;
+		if (mask & 1)
+		{
+			return mFreeBlocksByLength[bin].begin()->second;
+		}
+	}
+	return NULL;
+}
 
 // Remove block from both free lists (by location and by length).
 void LLVFS::eraseBlock(LLVFSBlock *block)
@@ -1345,7 +1457,7 @@ void LLVFS::addFreeBlock(LLVFSBlock *block)
 		eraseBlockLength(prev_block);
 		eraseBlock(next_block);
 		prev_block->mLength += block->mLength + next_block->mLength;
-		mFreeBlocksByLength.insert(blocks_length_map_t::value_type(prev_block->mLength, prev_block));
+		insertBlockLength(prev_block);
 		delete block;
 		block = NULL;
 		delete next_block;
@@ -1358,7 +1470,7 @@ void LLVFS::addFreeBlock(LLVFSBlock *block)
 		// therefore only need to update the length map. JC
 		eraseBlockLength(prev_block);
 		prev_block->mLength += block->mLength;
-		mFreeBlocksByLength.insert(blocks_length_map_t::value_type(prev_block->mLength, prev_block)); // multimap insert
+		insertBlockLength(prev_block);
 		delete block;
 		block = NULL;
 	}
@@ -1372,7 +1484,7 @@ void LLVFS::addFreeBlock(LLVFSBlock *block)
 		next_block->mLength += block->mLength;
 		// Don't hint here, next_free_it iterator may be invalid.
 		mFreeBlocksByLocation.insert(blocks_location_map_t::value_type(next_block->mLocation, next_block)); // multimap insert
-		mFreeBlocksByLength.insert(blocks_length_map_t::value_type(next_block->mLength, next_block)); // multimap insert			
+		insertBlockLength(next_block);
 		delete block;
 		block = NULL;
 	}
@@ -1381,7 +1493,7 @@ void LLVFS::addFreeBlock(LLVFSBlock *block)
 		// Can't merge with other free blocks.
 		// Hint that insert should go near next_free_it.
  		mFreeBlocksByLocation.insert(next_free_it, blocks_location_map_t::value_type(block->mLocation, block)); // multimap insert
- 		mFreeBlocksByLength.insert(blocks_length_map_t::value_type(block->mLength, block)); // multimap insert
+ 		insertBlockLength(block);
 	}
 }
 
@@ -1546,9 +1658,7 @@ LLVFSBlock *LLVFS::findFreeBlock(S32 size, LLVFSFileBlock *immune)
 	while (! block)
 	{
 		// look for a suitable free block
-		blocks_length_map_t::iterator iter = mFreeBlocksByLength.lower_bound(size); // first entry >= size
-		if (iter != mFreeBlocksByLength.end())
-			block = iter->second;
+		block = findBlockLength(size);
     	
 		// no large enough free blocks, time to clean out some junk
 		if (! block)
@@ -1563,6 +1673,7 @@ LLVFSBlock *LLVFS::findFreeBlock(S32 size, LLVFSFileBlock *immune)
 
 					if (tmp != immune &&
 						tmp->mLength > 0 &&
+						! tmp->mIOCount &&
 						! tmp->mLocks[VFSLOCK_READ] &&
 						! tmp->mLocks[VFSLOCK_APPEND] &&
 						! tmp->mLocks[VFSLOCK_OPEN])
@@ -1627,10 +1738,172 @@ LLVFSBlock *LLVFS::findFreeBlock(S32 size, LLVFSFileBlock *immune)
 	{
 		llwarns << "VFS: Spent " << time << " seconds in findFreeBlock!" << llendl;
 	}
+	mAllocCount++;
+	mAllocTime += time;
+	mMaxAllocTime = llmax(mMaxAllocTime, (F64)time);
 
 	return block;
 }
 
+BOOL LLVFS::compact(S32 max_bytes)
+{
+	if (!isValid())
+	{
+		llerrs << "Attempting to use invalid VFS!" << llendl;
+	}
+	if (mReadOnly)
+	{
+		return FALSE;
+	}
+
+	lockData();
+
+	if (mCompactFiles.empty())
+	{
+		if (getFragmentationLocked() < VFS_COMPACT_FRAGMENTATION)
+		{
+			unlockData();
+			return FALSE;
+		}
+
+		// Starting a pass. Order the files top down once, rather than on
+		// every step; files written since are left for the next pass.
+		std::vector<LLVFSFileBlock*> blocks;
+		for (fileblock_map::iterator it = mFileBlocks.begin(); it != mFileBlocks.end(); ++it)
+		{
+			if ((*it).second->mLength > 0)
+			{
+				blocks.push_back((*it).second);
+			}
+		}
+		std::sort(blocks.begin(), blocks.end(), LLVFSFileBlock::locationSortPredicateDescending);
+		for (std::vector<LLVFSFileBlock*>::iterator it = blocks.begin(); it != blocks.end(); ++it)
+		{
+			mCompactFiles.push_back(**it);
+		}
+		mCompactNext = 0;
+		mCompactLocation = U32_MAX;
+	}
+
+	std::vector<U8> buffer;
+	S32 moved = 0;
+	BOOL more = TRUE;
+	S32 looked_at = 0;
+	for ( ; mCompactNext < (S32)mCompactFiles.size() && looked_at < VFS_COMPACT_MAX_BLOCKS;
+		  ++mCompactNext, ++looked_at)
+	{
+		// skip files removed, renamed or moved up since the pass started
+		fileblock_map::iterator it = mFileBlocks.find(mCompactFiles[mCompactNext]);
+		if (it == mFileBlocks.end())
+		{
+			continue;
+		}
+		LLVFSFileBlock *block = (*it).second;
+		if (block->mLength <= 0 || block->mLocation >= mCompactLocation)
+		{
+			continue;
+		}
+
+		// once no free space is left below the cursor, it is all packed
+		if (mFreeBlocksByLocation.empty()
+			|| mFreeBlocksByLocation.begin()->first >= block->mLocation)
+		{
+			more = FALSE;
+			break;
+		}
+		if (block->mSize > max_bytes || block->mIOCount)
+		{
+			mCompactLocation = block->mLocation;
+			continue;
+		}
+		if (moved + block->mSize > max_bytes)
+		{
+			// next time
+			break;
+		}
+		mCompactLocation = block->mLocation;
+
+		// first free block below that it fits in
+		LLVFSBlock *free_block = NULL;
+		for (blocks_location_map_t::iterator iter = mFreeBlocksByLocation.begin();
+			 iter != mFreeBlocksByLocation.end() && iter->first < block->mLocation; ++iter)
+		{
+			if (iter->second->mLength >= block->mLength)
+			{
+				free_block = iter->second;
+				break;
+			}
+		}
+		if (!free_block)
+		{
+			continue;
+		}
+
+		// The copy goes into free space, and the index only points at
+		// it once it is written, so a crash part way loses nothing.
+		U32 old_location = block->mLocation;
+		U32 new_location = free_block->mLocation;
+		useFreeSpace(free_block, block->mLength);
+		if (block->mSize > 0)
+		{
+			buffer.resize(block->mSize);
+			if (readData(&buffer[0], old_location, block->mSize) != block->mSize
+				|| writeData(&buffer[0], new_location, block->mSize) != block->mSize)
+			{
+				llwarns << "VFS: Failed to move " << block->mFileID << " while compacting" << llendl;
+				addFreeBlock(new LLVFSBlock(new_location, block->mLength));
+				continue;
+			}
+		}
+		block->mLocation = new_location;
+		sync(block);
+		addFreeBlock(new LLVFSBlock(old_location, block->mLength));
+
+		moved += block->mSize;
+		mCompactMoveCount++;
+		mCompactMoveBytes += block->mSize;
+	}
+	if (mCompactNext >= (S32)mCompactFiles.size())
+	{
+		more = FALSE;
+	}
+	if (!more)
+	{
+		mCompactLocation = U32_MAX;
+		mCompactFiles.clear();
+	}
+
+	unlockData();
+	return more;
+}
+
+F32 LLVFS::getFragmentation()
+{
+	lockData();
+	F32 fragmentation = getFragmentationLocked();
+	unlockData();
+	return fragmentation;
+}
+
+// mDataMutex must be LOCKED before calling this
+F32 LLVFS::getFragmentationLocked()
+{
+	if (!mTotalFreeSize)
+	{
+		return 0.f;
+	}
+	S32 max_free_size = 0;
+	for (S32 bin = FREE_BIN_COUNT - 1; bin >= 0; bin--)
+	{
+		if (!mFreeBlocksByLength[bin].empty())
+		{
+			max_free_size = mFreeBlocksByLength[bin].rbegin()->first.first;
+			break;
+		}
+	}
+	return 1.f - (F32)max_free_size / (F32)mTotalFreeSize;
+}
+
 //============================================================================
 // public
 //============================================================================
@@ -1645,15 +1918,12 @@ void LLVFS::pokeFiles()
 	
 	// only write data if we actually read 4 bytes
 	// otherwise we're writing garbage and screwing up the file
-	fseek(mDataFP, 0, SEEK_SET);
-	if (fread(&word, sizeof(word), 1, mDataFP) == 1)
+	if (readData((U8 *)&word, 0, sizeof(word)) == sizeof(word))
 	{
-		fseek(mDataFP, 0, SEEK_SET);
-		if (fwrite(&word, sizeof(word), 1, mDataFP) != 1)
+		if (writeData((U8 *)&word, 0, sizeof(word)) != sizeof(word))
 		{
 			llwarns << "Could not write to data file" << llendl;
 		}
-		fflush(mDataFP);
 	}
 
 	fseek(mIndexFP, 0, SEEK_SET);
@@ -1960,7 +2230,7 @@ void LLVFS::dumpStatistics()
 	llinfos << "Invalid blocks: " << invalid_file_count << llendl;
 	llinfos << "File blocks:    " << mFileBlocks.size() << llendl;
 
-	S32 length_list_count = (S32)mFreeBlocksByLength.size();
+	S32 length_list_count = mFreeBlockCount;
 	S32 location_list_count = (S32)mFreeBlocksByLocation.size();
 	if (length_list_count == location_list_count)
 	{
@@ -1978,6 +2248,20 @@ void LLVFS::dumpStatistics()
 	llinfos << "Total free size: " << total_free_size/1024 << "K" << llendl;
 	llinfos << "Sum: " << (total_file_size + total_free_size) << " bytes" << llendl;
 	llinfos << llformat("%.0f%% full",((F32)(total_file_size)/(F32)(total_file_size+total_free_size))*100.f) << llendl;
+	llinfos << llformat("Fragmentation: %.0f%% of free space outside the largest free block",
+						getFragmentationLocked() * 100.f) << llendl;
+	for (S32 bin = 0; bin < FREE_BIN_COUNT; bin++)
+	{
+		if (!mFreeBlocksByLength[bin].empty())
+		{
+			llinfos << "Free bin " << (1 << (bin + 10)) / 1024 << "K: " << mFreeBlocksByLength[bin].size() << " blocks" << llendl;
+		}
+	}
+	llinfos << llformat("Allocations: %u, mean %.3f ms, max %.3f ms",
+						mAllocCount,
+						mAllocCount ? mAllocTime * 1000.0 / mAllocCount : 0.0,
+						mMaxAllocTime * 1000.0) << llendl;
+	llinfos << "Compaction moved " << mCompactMoveCount << " files, " << mCompactMoveBytes/1024 << "K" << llendl;
 
 	llinfos << " " << llendl;
 	for (std::map<LLAssetType::EType, std::pair<S32,S32> >::iterator iter = filetype_counts.begin();
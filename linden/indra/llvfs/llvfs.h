@@ -104,6 +104,15 @@ public:
 	void incLock(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock);
 	void decLock(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock);
 	BOOL isLocked(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock);
+
+	// Moves files down into free space nearer the start of the data
+	// file, so free space coalesces at the end. Copies at most
+	// max_bytes per call and leaves larger files where they are.
+	// Returns TRUE while the pass has more to do.
+	BOOL compact(S32 max_bytes);
+
+	// Fraction of the free space that is not in the largest free block.
+	F32 getFragmentation();
 	// ----------------------------------------------------------------
 
 	// Used to trigger evil WinXP behavior of "preloading" entire file into memory.
@@ -124,7 +133,12 @@ public:
 protected:
 	void removeFileBlock(LLVFSFileBlock *fileblock);
 	
+	void insertBlockLength(LLVFSBlock *block);
 	void eraseBlockLength(LLVFSBlock *block);
+	// Best fitting free block of at least size bytes, or NULL.
+	LLVFSBlock *findBlockLength(S32 size);
+	static S32 getLengthBin(S32 length);
+	F32 getFragmentationLocked();
 	void eraseBlock(LLVFSBlock *block);
 	void addFreeBlock(LLVFSBlock *block);
 	//void mergeFreeBlocks();
@@ -132,6 +146,19 @@ protected:
 	void sync(LLVFSFileBlock *block, BOOL remove = FALSE);
 	void presizeDataFile(const U32 size);
 
+	// Positional reads and writes of the data file. These leave the
+	// stdio file position alone, so they need no lock.
+	S32 readData(U8 *buffer, U32 location, S32 length);
+	S32 writeData(const U8 *buffer, U32 location, S32 length);
+
+	// Data is read and written with mDataMutex unlocked. A block with
+	// I/O in progress must not be moved, freed or deleted, so these
+	// bracket that I/O, and waitForIdleBlock() finds a block once it
+	// has none in progress. mDataMutex must be LOCKED to call them.
+	void beginBlockIO(LLVFSFileBlock *block);
+	void endBlockIO(LLVFSFileBlock *block);
+	LLVFSFileBlock *waitForIdleBlock(const LLVFSFileSpecifier &spec);
+
 	static LLFILE *openAndLock(const std::string& filename, const char* mode, BOOL read_lock);
 	static void unlockAndClose(FILE *fp);
 	
@@ -144,13 +171,23 @@ protected:
 	void unlockData() { mDataMutex->unlock(); }	
 	
 protected:
-	LLMutex* mDataMutex;
+	// Guards the index and block allocator, and is signalled when a
+	// block's last read or write in progress finishes.
+	LLCondition* mDataMutex;
 	
 	typedef std::map<LLVFSFileSpecifier, LLVFSFileBlock*> fileblock_map;
 	fileblock_map mFileBlocks;
 
-	typedef std::multimap<S32, LLVFSBlock*>	blocks_length_map_t;
-	blocks_length_map_t 	mFreeBlocksByLength;
+	// Free blocks are binned by power of two size class, under 2K
+	// up to 1G and over, each bin ordered by length then location.
+	// A search looks in the bin for its size, then takes the smallest
+	// block of the next non-empty bin, skipping the classes too small.
+	enum { FREE_BIN_COUNT = 21 };
+	typedef std::map<std::pair<S32, U32>, LLVFSBlock*> blocks_length_map_t;
+	blocks_length_map_t 	mFreeBlocksByLength[FREE_BIN_COUNT];
+	U32						mFreeBinMask;		// bit set for each non-empty bin
+	S32						mFreeBlockCount;
+	U32						mTotalFreeSize;
 	typedef std::multimap<U32, LLVFSBlock*>	blocks_location_map_t;
 	blocks_location_map_t 	mFreeBlocksByLocation;
 
@@ -167,6 +204,19 @@ protected:
 
 	S32 mLockCounts[VFSLOCK_COUNT];
 	BOOL mRemoveAfterCrash;
+
+	// compaction moves files below this location, from the top down
+	U32 mCompactLocation;
+	// the files of the current pass, top down, and the next to look at
+	std::vector<LLVFSFileSpecifier> mCompactFiles;
+	S32 mCompactNext;
+
+	// allocator and compaction statistics, for dumpStatistics()
+	U32 mAllocCount;
+	F64 mAllocTime;
+	F64 mMaxAllocTime;
+	U32 mCompactMoveCount;
+	U32 mCompactMoveBytes;
 };
 
 extern LLVFS *gVFS;
@@ -32,6 +32,7 @@
 
 #include "linden_common.h"
 #include "llvfsthread.h"
+#include "llfasttimer.h"
 #include "llstl.h"
 
 //============================================================================
@@ -168,6 +169,25 @@ S32 LLVFSThread::writeImmediate(LLVFS* vfs, const LLUUID &file_id, const LLAsset
 }
 
 
+LLVFSThread::handle_t LLVFSThread::compact(LLVFS* vfs, S32 bytes_per_step, U32 flags)
+{
+	handle_t handle = generateHandle();
+
+	// lowest priority, and requeued behind waiting writes after each step
+	Request* req = new Request(handle, 0, flags, FILE_COMPACT, vfs, LLUUID::null, LLAssetType::AT_NONE,
+							   NULL, 0, bytes_per_step);
+
+	bool res = addRequest(req);
+	if (!res)
+	{
+		llerrs << "LLVFSThread::compact called after LLVFSThread::cleanupClass()" << llendl;
+		req->deleteRequest();
+		handle = nullHandle();
+	}
+
+	return handle;
+}
+
 // LLVFSThread::handle_t LLVFSThread::rename(LLVFS* vfs, const LLUUID &file_id, const LLAssetType::EType file_type,
 // 										  const LLUUID &new_id, const LLAssetType::EType new_type, U32 flags)
 // {
@@ -205,7 +225,7 @@ LLVFSThread::Request::Request(handle_t handle, U32 priority, U32 flags,
 	mBytes(numbytes),
 	mBytesRead(0)
 {
-	llassert(mBuffer);
+	llassert(mBuffer || mOperation == FILE_COMPACT);
 
 	if (numbytes <= 0 && mOperation != FILE_RENAME)
 	{
@@ -227,6 +247,10 @@ LLVFSThread::Request::Request(handle_t handle, U32 priority, U32 flags,
 	{
 		mVFS->incLock(mFileID, mFileType, VFSLOCK_APPEND);
 	}
+	else if (mOperation == FILE_COMPACT)
+	{
+		// no file to lock
+	}
 	else // if (mOperation == FILE_READ)
 	{
 		mVFS->incLock(mFileID, mFileType, VFSLOCK_READ);
@@ -244,6 +268,10 @@ void LLVFSThread::Request::finishRequest(bool completed)
 	{
 		mVFS->decLock(mFileID, mFileType, VFSLOCK_APPEND);
 	}
+	else if (mOperation == FILE_COMPACT)
+	{
+		// no file to unlock
+	}
 	else // if (mOperation == FILE_READ)
 	{
 		mVFS->decLock(mFileID, mFileType, VFSLOCK_READ);
@@ -271,8 +299,11 @@ void LLVFSThread::Request::deleteRequest()
 	LLQueuedThread::QueuedRequest::deleteRequest();
 }
 
+static LLFastTimer::DeclareTimer FTM_VFS_REQUEST("VFS Request");
+
 bool LLVFSThread::Request::processRequest()
 {
+	LLFastTimer t(FTM_VFS_REQUEST);
 	bool complete = false;
 	if (mOperation ==  FILE_READ)
 	{
@@ -296,6 +327,11 @@ bool LLVFSThread::Request::processRequest()
 		complete = true;
 		//llinfos << llformat("LLVFSThread::RENAME '%s': %d bytes arg:%d",getFilename(),mBytesRead) << llendl;
 	}
+	else if (mOperation == FILE_COMPACT)
+	{
+		// not complete until the pass has nothing left to move
+		complete = !mVFS->compact(mBytes);
+	}
 	else
 	{
 		llerrs << llformat("LLVFSThread::unknown operation: %d", mOperation) << llendl;
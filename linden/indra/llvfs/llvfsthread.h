@@ -53,7 +53,8 @@ public:
 	enum operation_t {
 		FILE_READ,
 		FILE_WRITE,
-		FILE_RENAME
+		FILE_RENAME,
+		FILE_COMPACT
 	};
 
 	//------------------------------------------------------------------------
@@ -106,7 +107,7 @@ public:
 		
 		U8* mBuffer;	// dest for reads, source for writes, new UUID for rename
 		S32 mOffset;	// offset into file, -1 = append (WRITE only)
-		S32 mBytes;		// bytes to read from file, -1 = all (new mFileType for rename)
+		S32 mBytes;		// bytes to read from file, -1 = all (new mFileType for rename, bytes per step for compact)
 		S32	mBytesRead;	// bytes read from file
 	};
 
@@ -127,6 +128,11 @@ public:
 	// SJB: rename seems to have issues, especially when threaded
 // 	handle_t rename(LLVFS* vfs, const LLUUID &file_id, const LLAssetType::EType file_type,
 // 					const LLUUID &new_id, const LLAssetType::EType new_type, U32 flags);
+	// Background compaction pass over vfs, run a step at a time
+	// between other requests, copying at most bytes_per_step each step.
+	// Only worth queueing when threaded, since unthreaded every step
+	// runs on the main thread in updateClass().
+	handle_t compact(LLVFS* vfs, S32 bytes_per_step = 64*1024, U32 flags = FLAG_AUTO_COMPLETE);
 	// Return number of bytes read
 	S32 readImmediate(LLVFS* vfs, const LLUUID &file_id, const LLAssetType::EType file_type,
 					  U8* buffer, S32 offset, S32 numbytes);
@@ -254,8 +254,12 @@ LLSD LLControlVariable::getSaveValue() const
 	return mValues[0];
 }
 
+// Left to static zero initialization so it is usable before apr is.
+LLAtomicU32 LLControlGroup::sLookupCount;
+
 LLPointer<LLControlVariable> LLControlGroup::getControl(const std::string& name)
 {
+	sLookupCount++;
 	ctrl_name_table_t::iterator iter = mNameTable.find(name);
 	return iter == mNameTable.end() ? LLPointer<LLControlVariable>() : iter->second;
 }
@@ -33,6 +33,7 @@
 #ifndef LL_LLCONTROL_H
 #define LL_LLCONTROL_H
 
+#include "llapr.h"
 #include "llevent.h"
 #include "llnametable.h"
 #include "llmap.h"
@@ -162,6 +163,11 @@ public:
 	
 	LLPointer<LLControlVariable> getControl(const std::string& name);
 
+	// Number of name lookups since the viewer last sampled it. Every
+	// getXXX() and setXXX() call does one; LLCachedControl avoids them.
+	// Any thread may look a setting up, so the count is atomic.
+	static LLAtomicU32 sLookupCount;
+
 	struct ApplyFunctor
 	{
 		virtual ~ApplyFunctor() {};
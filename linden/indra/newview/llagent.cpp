@@ -1728,13 +1728,14 @@ F32 LLAgent::getCameraZoomFraction()
 {
 	// 0.f -> camera zoomed all the way out
 	// 1.f -> camera zoomed all the way in
+	static LLCachedControl<bool> disable_camera_constraints(gSavedSettings, "DisableCameraConstraints");
 	LLObjectSelectionHandle selection = LLSelectMgr::getInstance()->getSelection();
 	if (selection->getObjectCount() && selection->getSelectType() == SELECT_TYPE_HUD)
 	{
 		// already [0,1]
 		return mHUDTargetZoom;
 	}
-	else if (gSavedSettings.getBOOL("DisableCameraConstraints"))
+	else if (disable_camera_constraints)
 	{
 		return mCameraZoomFraction;
 	}
@@ -2621,10 +2622,11 @@ void LLAgent::propagate(const F32 dt)
 		LLVector3 land_vel = getVelocity();
 		land_vel.mV[VZ] = 0.f;
 
+		static LLCachedControl<bool> automatic_fly(gSavedSettings, "AutomaticFly");
 		if (!in_air 
 			&& mUpKey < 0 
 			&& land_vel.magVecSquared() < MAX_VELOCITY_AUTO_LAND_SQUARED
-			&& gSavedSettings.getBOOL("AutomaticFly"))
+			&& automatic_fly)
 		{
 			// land automatically
 			setFlying(FALSE);
@@ -2718,8 +2720,10 @@ void LLAgent::updateLookAt(const S32 mouse_x, const S32 mouse_y)
 			F32 y_from_center = 
 				((F32) mouse_y / (F32) gViewerWindow->getWindowHeight() ) - 0.5f;
 
-			frameCamera.yaw( - x_from_center * gSavedSettings.getF32("YawFromMousePosition") * DEG_TO_RAD);
-			frameCamera.pitch( - y_from_center * gSavedSettings.getF32("PitchFromMousePosition") * DEG_TO_RAD);
+			static LLCachedControl<F32> yaw_from_mouse_position(gSavedSettings, "YawFromMousePosition");
+			frameCamera.yaw( - x_from_center * yaw_from_mouse_position * DEG_TO_RAD);
+			static LLCachedControl<F32> pitch_from_mouse_position(gSavedSettings, "PitchFromMousePosition");
+			frameCamera.pitch( - y_from_center * pitch_from_mouse_position * DEG_TO_RAD);
 			lookAtType = LOOKAT_TARGET_FREELOOK;
 		}
 
@@ -3354,7 +3358,8 @@ void LLAgent::updateCamera()
 		{
 			const F32 SMOOTHING_HALF_LIFE = 0.02f;
 			
-			F32 smoothing = LLCriticalDamp::getInterpolant(gSavedSettings.getF32("CameraPositionSmoothing") * SMOOTHING_HALF_LIFE, FALSE);
+			static LLCachedControl<F32> camera_position_smoothing(gSavedSettings, "CameraPositionSmoothing");
+			F32 smoothing = LLCriticalDamp::getInterpolant(camera_position_smoothing * SMOOTHING_HALF_LIFE, FALSE);
 					
 			if (!mFocusObject)  // we differentiate on avatar mode 
 			{
@@ -3628,7 +3633,8 @@ LLVector3d LLAgent::calcThirdPersonFocusOffset()
 {
 	// ...offset from avatar
 	LLVector3d focus_offset;
-	focus_offset.setVec(gSavedSettings.getVector3("FocusOffsetDefault"));
+	static LLCachedControl<LLVector3> focus_offset_default(gSavedSettings, "FocusOffsetDefault");
+	focus_offset.setVec(focus_offset_default);
 
 	LLQuaternion agent_rot = mFrameAgent.getQuaternion();
 	if (!mAvatarObject.isNull() && mAvatarObject->getParent())
@@ -3777,7 +3783,8 @@ LLVector3d LLAgent::calcCameraPositionTargetGlobal(BOOL *hit_limit)
 		}
 		else
 		{
-			local_camera_offset = mCameraZoomFraction * mCameraOffsetDefault * gSavedSettings.getF32("CameraOffsetScale");
+			static LLCachedControl<F32> camera_offset_scale(gSavedSettings, "CameraOffsetScale");
+			local_camera_offset = mCameraZoomFraction * mCameraOffsetDefault * camera_offset_scale;
 			
 			// are we sitting down?
 			if (mAvatarObject.notNull() && mAvatarObject->getParent())
@@ -3834,7 +3841,8 @@ LLVector3d LLAgent::calcCameraPositionTargetGlobal(BOOL *hit_limit)
 				camera_distance = local_camera_offset.normalize();
 			}
 
-			mTargetCameraDistance = (gSavedSettings.getBOOL("DisableMinZoomDist")) ? camera_distance : llmax(camera_distance, MIN_CAMERA_DISTANCE);
+			static LLCachedControl<bool> disable_min_zoom_dist(gSavedSettings, "DisableMinZoomDist");
+			mTargetCameraDistance = (disable_min_zoom_dist) ? camera_distance : llmax(camera_distance, MIN_CAMERA_DISTANCE);
 
 			if (mTargetCameraDistance != mCurrentCameraDistance)
 			{
@@ -3881,7 +3889,8 @@ LLVector3d LLAgent::calcCameraPositionTargetGlobal(BOOL *hit_limit)
 					}
 					else
 					{
-						target_lag = vel * gSavedSettings.getF32("DynamicCameraStrength") / 30.f;
+						static LLCachedControl<F32> dynamic_camera_strength(gSavedSettings, "DynamicCameraStrength");
+						target_lag = vel * dynamic_camera_strength / 30.f;
 					}
 
 					mCameraLag = lerp(mCameraLag, target_lag, lag_interp);
@@ -3916,7 +3925,8 @@ LLVector3d LLAgent::calcCameraPositionTargetGlobal(BOOL *hit_limit)
 		camera_position_global = focusPosGlobal + mCameraFocusOffset;
 	}
 
-	if (!gSavedSettings.getBOOL("DisableCameraConstraints") && !gAgent.isGodlike())
+	static LLCachedControl<bool> disable_camera_constraints(gSavedSettings, "DisableCameraConstraints");
+	if (!disable_camera_constraints && !gAgent.isGodlike())
 	{
 		LLViewerRegion* regionp = LLWorld::getInstance()->getRegionFromPosGlobal(
 			camera_position_global);
@@ -4033,7 +4043,8 @@ F32 LLAgent::getCameraMinOffGround()
 	}
 	else
 	{
-		if (gSavedSettings.getBOOL("DisableCameraConstraints"))
+		static LLCachedControl<bool> disable_camera_constraints(gSavedSettings, "DisableCameraConstraints");
+		if (disable_camera_constraints)
 		{
 			return -1000.f;
 		}
@@ -126,6 +126,9 @@
 #include "llsdserialize.h"
 
 #include "llworld.h"
+#include "lldrawable.h"
+#include "llface.h"
+#include "llviewerpartsim.h"
 #include "llhudeffecttrail.h"
 #include "llhudeffectlookat.h"
 #include "llvectorperfoptions.h"
@@ -148,6 +151,7 @@
 #include "llagentpilot.h"
 #include "llsrv.h"
 #include "llvovolume.h"
+#include "llvocache.h"
 #include "llflexibleobject.h" 
 #include "llvosurfacepatch.h"
 #include "llslider.h"
@@ -322,6 +326,14 @@ std::string gLoginPage;
 std::vector<std::string> gLoginURIs;
 static std::string gHelperURI;
 
+// background compaction of the VFS, started once the cache is up
+static LLVFSThread::handle_t gVFSCompactHandle = LLVFSThread::nullHandle();
+// Without a VFS thread the compaction pass runs in what is left of the
+// idle time instead, a small step at a time.
+static BOOL gVFSCompactInIdle = FALSE;
+const S32 VFS_IDLE_COMPACT_STEP = 16*1024;	// bytes copied per step
+const F64 VFS_IDLE_COMPACT_TIME = 0.002;	// seconds per frame at most
+
 //FIXME 
 //LLAppViewer::LLUpdaterInfo *LLAppViewer::sUpdaterInfo = NULL ;
 
@@ -438,6 +450,30 @@ static void settings_to_globals()
 	ViewerTime::sUseUTCTime = gSavedSettings.getBOOL("UseUTCTime");
 }
 
+// Start or finish a fast timer trace capture as requested through
+// the FastTimerTraceFrames debug setting.
+static void update_fast_timer_trace()
+{
+	static S32 frames_left = 0;
+	if (!LLFastTimer::isTraceCapturing())
+	{
+		S32 frames = gSavedSettings.getS32("FastTimerTraceFrames");
+		if (frames > 0)
+		{
+			gSavedSettings.setS32("FastTimerTraceFrames", 0);
+			std::string filename = gDirUtilp->getExpandedFilename(LL_PATH_LOGS, "fast_timer_trace.json");
+			if (LLFastTimer::beginTraceCapture(filename))
+			{
+				frames_left = frames;
+			}
+		}
+	}
+	else if (--frames_left <= 0)
+	{
+		LLFastTimer::endTraceCapture();
+	}
+}
+
 static void settings_modify()
 {
 	LLRenderTarget::sUseFBO				= gSavedSettings.getBOOL("RenderUseFBO");
@@ -601,6 +637,11 @@ bool LLAppViewer::init()
     // Called before threads are created.
     LLCurl::initClass();
 
+	// Memory pools for classes created thousands of times a second
+	LLViewerPart::initMemPool();
+	LLFace::initMemPool();
+	LLDrawable::initMemPool();
+
     initThreads();
 
     writeSystemInfo();
@@ -656,6 +697,11 @@ bool LLAppViewer::init()
 		LLError::setPrintLocation(true);
 	}
 
+	if (gSavedSettings.getBOOL("AsyncLogging"))
+	{
+		LLError::startAsyncLogging();
+	}
+
 	// ZWAGOTH: This resolves a bunch of skin updating problems and makes skinning
 	// SIGNIFICANLTLY easier. User colors > skin colors > default skin colors.
 	// This also will get rid of the Invalid control... spam when a skin doesn't have that color
@@ -917,6 +963,7 @@ bool LLAppViewer::mainLoop()
 	while (!LLApp::isExiting())
 	{
 		LLFastTimer::reset(); // Should be outside of any timer instances
+		update_fast_timer_trace();
 		try
 		{
 			LLFastTimer t(LLFastTimer::FTM_FRAME);
@@ -1076,6 +1123,7 @@ bool LLAppViewer::mainLoop()
  					work_pending += LLAppViewer::getTextureFetch()->update(1); // unpauses the texture fetch thread
 					io_pending += LLVFSThread::updateClass(1);
 					io_pending += LLLFSThread::updateClass(1);
+					io_pending += LLVOCacheFile::updateClass(1);
 					if (io_pending > 1000)
 					{
 						ms_sleep(llmin(io_pending/100,100)); // give the vfs some time to catch up
@@ -1090,6 +1138,16 @@ bool LLAppViewer::mainLoop()
 						break;
 					}
 				}
+				if (gVFSCompactInIdle)
+				{
+					LLTimer compact_timer;
+					do
+					{
+						gVFSCompactInIdle = gVFS->compact(VFS_IDLE_COMPACT_STEP);
+					}
+					while (gVFSCompactInIdle
+						   && compact_timer.getElapsedTimeF64() < VFS_IDLE_COMPACT_TIME);
+				}
 				if ((LLStartUp::getStartupState() >= STATE_CLEANUP) &&
 					(frameTimer.getElapsedTimeF64() > FRAME_STALL_THRESHOLD))
 				{
@@ -1297,11 +1355,15 @@ bool LLAppViewer::cleanup()
 
 	cleanup_menus();
 
+	// Don't wait on a compaction pass, it can pick up again next run.
+	LLVFSThread::sLocal->abortRequest(gVFSCompactHandle, true);
+
 	// Wait for any pending VFS IO
 	while (1)
 	{
 		S32 pending = LLVFSThread::updateClass(0);
 		pending += LLLFSThread::updateClass(0);
+		pending += LLVOCacheFile::updateClass(0);
 		if (!pending)
 		{
 			break;
@@ -1457,6 +1519,7 @@ bool LLAppViewer::cleanup()
 		pending += LLAppViewer::getTextureFetch()->update(1); // unpauses the texture fetch thread
 		pending += LLVFSThread::updateClass(0);
 		pending += LLLFSThread::updateClass(0);
+		pending += LLVOCacheFile::updateClass(0);
 		F64 idle_time = idleTimer.getElapsedTimeF64();
 		if (!pending || idle_time >= max_idle_time)
 		{
@@ -1469,7 +1532,9 @@ bool LLAppViewer::cleanup()
 	// shutdown all worker threads before deleting them in case of co-dependencies
 	sTextureCache->shutdown();
 	sTextureFetch->shutdown();
+	sImageDecodeThread->dumpDecodeStats();
 	sImageDecodeThread->shutdown();
+	LLFastTimer::endTraceCapture();
 	delete sTextureCache;
     sTextureCache = NULL;
 	delete sTextureFetch;
@@ -1491,6 +1556,7 @@ bool LLAppViewer::cleanup()
 	LLImage::cleanupClass();
 	LLVFSThread::cleanupClass();
 	LLLFSThread::cleanupClass();
+	LLVOCacheFile::cleanupClass();
 
 	llinfos << "VFS Thread finished" << llendflush;
 
@@ -1575,9 +1641,16 @@ bool LLAppViewer::initThreads()
 
 	LLVFSThread::initClass(enable_threads && false);
 	LLLFSThread::initClass(enable_threads && false);
+	// The region object caches are read and written on their own thread
+	LLVOCacheFile::initClass(enable_threads && true);
 
 	// Image decoding
-	LLAppViewer::sImageDecodeThread = new LLImageDecodeThread(enable_threads && true);
+	S32 decode_threads = gSavedSettings.getS32("ImageDecodeThreads");
+	if (decode_threads <= 0)
+	{
+		decode_threads = LLImageDecodeThread::getDefaultNumThreads();
+	}
+	LLAppViewer::sImageDecodeThread = new LLImageDecodeThread(enable_threads && true, decode_threads);
 	LLAppViewer::sTextureCache = new LLTextureCache(enable_threads && true);
 	LLAppViewer::sTextureFetch = new LLTextureFetch(LLAppViewer::getTextureCache(), sImageDecodeThread, enable_threads && true);
 	LLImage::initClass(gSavedSettings.getBOOL("UseKDUIfAvailable"));
@@ -2600,6 +2673,8 @@ void LLAppViewer::handleViewerCrash()
 	// Close the debug file
 	pApp->writeDebugInfo();
 
+	// Get anything still queued into the log before closing it.
+	LLError::flushAsyncLog();
 	LLError::logToFile("");
 
 // On Mac, we send the report on the next run, since we need macs crash report
@@ -3122,6 +3197,14 @@ bool LLAppViewer::initCache()
 	else
 	{
 		LLVFile::initClass();
+		if (LLVFSThread::sLocal->getThreaded())
+		{
+			gVFSCompactHandle = LLVFSThread::sLocal->compact(gVFS);
+		}
+		else
+		{
+			gVFSCompactInIdle = TRUE;
+		}
 		return true;
 	}
 }
@@ -110,6 +110,8 @@ void LLDrawable::init()
 	mSpatialBridge = NULL;
 }
 
+MEM_TYPE_POOL_IMPL(LLDrawable, LLMemType::MTYPE_DRAWABLE, 256, false)
+
 // static
 void LLDrawable::initClass()
 {
@@ -43,6 +43,7 @@
 #include "v4coloru.h"
 #include "llquaternion.h"
 #include "xform.h"
+#include "llmempool.h"
 #include "llmemtype.h"
 #include "llprimitive.h"
 #include "lldarray.h"
@@ -72,7 +73,7 @@ public:
 	static void initClass();
 
 	LLDrawable()				{ init(); }
-	MEM_TYPE_NEW(LLMemType::MTYPE_DRAWABLE);
+	MEM_TYPE_POOL_NEW;
 	
 	void markDead();			// Mark this drawable as dead
 	BOOL isDead() const			{ return isState(DEAD); }
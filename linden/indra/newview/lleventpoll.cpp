@@ -180,7 +180,10 @@ namespace
 		
 		lldebugs <<	"LLEventPollResponder::makeRequest	<" << mCount <<	"> ack = "
 				 <<	LLSDXMLStreamer(mAcknowledge) << llendl;
-		LLHTTPClient::post(mPollURL, request, this);
+		// ahead of other caps requests to the region, which
+		// can wait for it
+		LLHTTPClient::post(mPollURL, request, this, LLSD(),
+						   HTTP_REQUEST_EXPIRY_SECS, LLCurl::PRIORITY_EVENT_POLL);
 	}
 
 	void LLEventPollResponder::handleMessage(const	LLSD& content)
@@ -58,6 +58,8 @@
 
 BOOL LLFace::sSafeRenderSelect = TRUE; // FALSE
 
+MEM_TYPE_POOL_IMPL(LLFace, LLMemType::MTYPE_DRAWABLE, 256, false)
+
 #define DOTVEC(a,b) (a.mV[0]*b.mV[0] + a.mV[1]*b.mV[1] + a.mV[2]*b.mV[2])
 
 
@@ -63,6 +63,7 @@ const F32 MIN_TEX_ANIM_SIZE = 512.f;
 class LLFace
 {
 public:
+	MEM_TYPE_POOL_NEW;
 
 	enum EMasks
 	{
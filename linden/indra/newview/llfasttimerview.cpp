@@ -252,6 +252,7 @@ LLFastTimerView::LLFastTimerView(const std::string& name, const LLRect& rect)
 			}
 			llassert(level < FTV_DISPLAY_NUM);
 			ft_display_table[i].desc = text;
+			LLFastTimer::setTimerName(ft_display_table[i].timer, text);
 			ft_display_table[i].level = level;
 			if (level > 0)
 			{
@@ -437,9 +438,11 @@ void LLFastTimerView::draw()
 	// Make sure all timers are accounted for
 	// Set 'FTM_OTHER' to unaccounted ticks last frame
 	{
-		S32 display_timer[LLFastTimer::FTM_NUM_TYPES];
+		// Declared timers have no line of their own, so they go in 'Other' too
+		S32 num_timers = LLFastTimer::getNumTimers();
+		S32 display_timer[LLFastTimer::FTM_MAX_TIMERS];
 		S32 hidx = LLFastTimer::sLastFrameIndex % LLFastTimer::FTM_HISTORY_NUM;
-		for (S32 i=0; i < LLFastTimer::FTM_NUM_TYPES; i++)
+		for (S32 i=0; i < num_timers; i++)
 		{
 			display_timer[i] = 0;
 		}
@@ -450,7 +453,7 @@ void LLFastTimerView::draw()
 		}
 		LLFastTimer::sCountHistory[hidx][LLFastTimer::FTM_OTHER] = 0;
 		LLFastTimer::sCallHistory[hidx][LLFastTimer::FTM_OTHER] = 0;
-		for (S32 tidx = 0; tidx < LLFastTimer::FTM_NUM_TYPES; tidx++)
+		for (S32 tidx = 0; tidx < num_timers; tidx++)
 		{
 			U64 counts = LLFastTimer::sCountHistory[hidx][tidx];
 			if (counts > 0 && display_timer[tidx] == 0)
@@ -40,6 +40,8 @@
 #include "llresmgr.h"
 
 #include "llmath.h"
+#include "llmemtype.h"
+#include "llmemoryview.h"
 #include "llviewerwindow.h"
 
 LLFloaterMemLeak* LLFloaterMemLeak::sInstance = NULL;
@@ -66,7 +68,8 @@ void LLFloaterMemLeak::release()
 {
 	for(S32 i = 0 ; i < (S32)mLeakedMem.size() ; i++)
 	{
-		delete[] mLeakedMem[i] ;
+		delete[] mLeakedMem[i].first ;
+		LLMemType::trackFree(LLMemType::MTYPE_TEMP1, mLeakedMem[i].second) ;
 	}
 	mLeakedMem.clear() ;
 
@@ -103,8 +106,10 @@ void LLFloaterMemLeak::idle()
 
 		if(p)
 		{
-			mLeakedMem.push_back(p) ;
+			mLeakedMem.push_back(std::make_pair(p, sMemLeakingSpeed)) ;
 			sTotalLeaked += sMemLeakingSpeed ;
+			// leaked blocks show up under Temp1 in the memory view
+			LLMemType::trackAlloc(LLMemType::MTYPE_TEMP1, sMemLeakingSpeed) ;
 		}
 	}
 	if(!p)
@@ -167,6 +172,11 @@ void LLFloaterMemLeak::onClickRelease(void* userData)
 	sStatus = RELEASE ;
 }
 
+void LLFloaterMemLeak::onClickDump(void* userData)
+{
+	LLMemoryView::dumpStatsToFile() ;
+}
+
 void LLFloaterMemLeak::onClickClose(void* userData)
 {
 	if (sInstance)
@@ -185,6 +195,7 @@ BOOL LLFloaterMemLeak::postBuild(void)
 	childSetAction("start_btn", onClickStart, this);
 	childSetAction("stop_btn", onClickStop, this);
 	childSetAction("release_btn", onClickRelease, this);
+	childSetAction("dump_btn", onClickDump, this);
 	childSetAction("close_btn", onClickClose, this);
 
 	return TRUE ;
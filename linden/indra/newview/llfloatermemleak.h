@@ -54,6 +54,7 @@ public:
 	static void onClickStart(void* userData);
 	static void onClickStop(void* userData);
 	static void onClickRelease(void* userData);
+	static void onClickDump(void* userData);
 	static void onClickClose(void* userData);
 		
 	/// show off our menu
@@ -84,7 +85,7 @@ private:
 	static S32 sStatus ; //0: stop ; >0: start ; <0: release
 	static BOOL sbAllocationFailed ;
 
-	std::vector<char*> mLeakedMem ;	
+	std::vector<std::pair<char*, U32> > mLeakedMem ; //block and its size
 };
 
 #endif // LL_LLFLOATERMEMLEAK_H
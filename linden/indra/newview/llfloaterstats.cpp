@@ -140,6 +140,15 @@ void LLFloaterStats::buildStats()
 	stat_barp->mLabelSpacing = 500.f;
 	stat_barp->mPerSec = TRUE;
 
+	stat_barp = render_statviewp->addStat("Settings Lookups", &(LLViewerStats::getInstance()->mSettingsLookupStat), "DebugStatModeSettingsLookups");
+	stat_barp->setUnitLabel("/fr");
+	stat_barp->mMinBar = 0.f;
+	stat_barp->mMaxBar = 200.f;
+	stat_barp->mTickSpacing = 50.f;
+	stat_barp->mLabelSpacing = 100.f;
+	stat_barp->mPerSec = FALSE;
+	stat_barp->mPrecision = 0;
+
 
 	// Texture statistics
 	LLStatView *texture_statviewp = render_statviewp->addStatView("texture stat view", "Texture", "OpenDebugStatTexture", rect);
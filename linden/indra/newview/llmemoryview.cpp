@@ -40,6 +40,10 @@
 #include "llgl.h"
 #include "llmath.h"
 #include "llfontgl.h"
+#include "lldate.h"
+#include "lldir.h"
+#include "llfile.h"
+#include "llmemory.h"
 #include "llmemtype.h"
 
 #include "llcharacter.h"
@@ -57,12 +61,12 @@ mDelay(120)
 {
 	setVisible(FALSE);
 	mDumpTimer.reset();
-
-#ifdef MEM_DUMP_DATA
-	// clear out file.
-	LLFILE *dump = LLFile::fopen("memusagedump.txt", "w");
-	fclose(dump);
-#endif
+	mRateTimer.reset();
+	for (S32 i = 0; i < LLMemType::MTYPE_NUM_TYPES; i++)
+	{
+		mLastAllocCount[i] = LLMemType::sAllocCount[i];
+		mAllocRate[i] = 0.f;
+	}
 }
 
 LLMemoryView::~LLMemoryView()
@@ -127,6 +131,8 @@ static const struct mtv_display_info mtv_display_table[] =
 	{ LLMemType::MTYPE_REGIONS,			"Regions",			&LLColor4::blue1 },
 	{ LLMemType::MTYPE_VOLUME,			"Volume",			&LLColor4::pink1 },
 	{ LLMemType::MTYPE_PRIMITIVE,		"Profile",			&LLColor4::pink2 },
+	{ LLMemType::MTYPE_INVENTORY,		"Inventory",		&LLColor4::blue4 },
+	{ LLMemType::MTYPE_NETWORK,			"Network",			&LLColor4::blue5 },
  	{ LLMemType::MTYPE_TEMP1,			"Temp1",			&LLColor4::red1 },
  	{ LLMemType::MTYPE_TEMP2,			"Temp2",			&LLColor4::magenta1 },
  	{ LLMemType::MTYPE_TEMP3,			"Temp3",			&LLColor4::red2 },
@@ -150,7 +156,7 @@ void LLMemoryView::draw()
 	gGL.getTexUnit(0)->unbind(LLTexUnit::TT_TEXTURE);
 	gl_rect_2d(0, height, width, 0, LLColor4(0.f, 0.f, 0.f, 0.25f));
 	
-#if MEM_TRACK_TYPE
+	updateAllocRates();
 
 	S32 left, top, right, bottom;
 	S32 x, y;
@@ -203,7 +209,7 @@ void LLMemoryView::draw()
 			peak += maxbytes;
 			S32 mbytes = bytes >> 20;
 
-			tdesc = llformat("%s [%4d MB] in %06d NEWS",mtv_display_table[i].desc,mbytes, LLMemType::sNewCount[tidx]);
+			tdesc = llformat("%-16s [%4d MB] %7d live %7.0f/s",mtv_display_table[i].desc,mbytes, LLMemType::sNewCount[tidx], mAllocRate[tidx]);
 			LLFontGL::getFontMonospace()->renderUTF8(tdesc, 0, x, y, LLColor4::white, LLFontGL::LEFT, LLFontGL::TOP);
 			
 			y -= (texth + 2);
@@ -227,8 +233,13 @@ void LLMemoryView::draw()
 		}
 		
 		x = xleft;
-		tdesc = llformat("Total Bytes: %d MB Overhead: %d KB Avs %d Motions:%d Loading:%d Loaded:%d Active:%d Dep:%d",
-						 LLMemType::sTotalMem >> 20, LLMemType::sOverheadMem >> 10,
+		S32 tracked = 0;
+		for (S32 tidx = 0; tidx < LLMemType::MTYPE_OTHER; tidx++)
+		{
+			tracked += LLMemType::sMemCount[tidx];
+		}
+		tdesc = llformat("Tracked: %d MB RSS: %d MB Avs %d Motions:%d Loading:%d Loaded:%d Active:%d Dep:%d",
+						 tracked >> 20, (S32)(getCurrentRSS() >> 20),
 						 num_avatars, num_motions, num_loading_motions, num_loaded_motions, num_active_motions, num_deprecated_motions);
 		LLFontGL::getFontMonospace()->renderUTF8(tdesc, 0, x, y, LLColor4::white, LLFontGL::LEFT, LLFontGL::TOP);
 	}
@@ -262,12 +273,26 @@ void LLMemoryView::draw()
 	}
 
 	dumpData();
-
-#endif
 	
 	LLView::draw();
 }
 
+void LLMemoryView::updateAllocRates()
+{
+	F32 elapsed = mRateTimer.getElapsedTimeF32();
+	if (elapsed < 1.f)
+	{
+		return;
+	}
+	mRateTimer.reset();
+	for (S32 i = 0; i < LLMemType::MTYPE_NUM_TYPES; i++)
+	{
+		U32 count = LLMemType::sAllocCount[i];
+		mAllocRate[i] = (F32)(count - mLastAllocCount[i]) / elapsed;
+		mLastAllocCount[i] = count;
+	}
+}
+
 void LLMemoryView::setDataDumpInterval(float delay)
 {
 	mDelay = delay;
@@ -275,32 +300,24 @@ void LLMemoryView::setDataDumpInterval(float delay)
 
 void LLMemoryView::dumpData()
 {
-#if MEM_TRACK_TYPE && MEM_DUMP_DATA
 	if (mDelay && (mDumpTimer.getElapsedTimeF32() > mDelay ))
 	{
 		// reset timer
 		mDumpTimer.reset();
-		// append dump info to text file
-		LLFILE *dump = LLFile::fopen("memusagedump.txt", "a");
-
-		if (dump)
-		{
-			// write out total memory usage
-			fprintf (dump, "Total memory in use = %09d (%03d MB)\n", LLMemType::sTotalMem, LLMemType::sTotalMem>>20);
-			fprintf (dump, "High Water Mark = %09d (%03d MB)\n\n", LLMemType::sMaxTotalMem, LLMemType::sMaxTotalMem>>20);
-			// dump out usage of 'new' for each memory type
-			for (S32 i=0; i<LLMemType::MTYPE_NUM_TYPES; i++)
-			{
-				if (LLMemType::sMemCount[i])
-				{
-					std::string outData = llformat("MEM: % 20s %09d %03d MB (%09d %03d MB) in %06d News", LLMemType::sTypeDesc[i], LLMemType::sMemCount[i], LLMemType::sMemCount[i]>>20, LLMemType::sMaxMemCount[i], LLMemType::sMaxMemCount[i]>>20, LLMemType::sNewCount[i]);
-					fprintf (dump, "%s\n", outData.c_str());
-				}
-			}
-			fprintf (dump, "\n\n");
+		dumpStatsToFile();
+	}
+}
 
-			fclose(dump);
-		}
+//static
+void LLMemoryView::dumpStatsToFile()
+{
+	std::string filename = gDirUtilp->getExpandedFilename(LL_PATH_LOGS, "memusagedump.txt");
+	llofstream dump(filename.c_str(), std::ios_base::app);
+	if (dump.is_open())
+	{
+		dump << "Memory usage at " << LLDate::now().asString() << "\n";
+		LLMemType::dumpStats(dump);
+		dump << "\n";
+		llinfos << "Memory usage appended to " << filename << llendl;
 	}
-#endif
 }
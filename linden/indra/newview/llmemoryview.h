@@ -34,6 +34,7 @@
 #define LL_LLMEMORYVIEW_H
 
 #include "llview.h"
+#include "llmemtype.h"
 
 class LLMemoryView : public LLView
 {
@@ -46,12 +47,19 @@ public:
 	virtual BOOL handleHover(S32 x, S32 y, MASK mask);
 	virtual void draw();
 
+	// Appends LLMemType::dumpStats() to memusagedump.txt in the log directory.
+	static void dumpStatsToFile();
+
 private:
 	void setDataDumpInterval(float delay);
 	void dumpData();
+	void updateAllocRates();
 
 	float mDelay;
 	LLFrameTimer mDumpTimer;
+	LLFrameTimer mRateTimer;
+	U32 mLastAllocCount[LLMemType::MTYPE_NUM_TYPES];
+	F32 mAllocRate[LLMemType::MTYPE_NUM_TYPES];
 
 private:
 };
@@ -580,6 +580,17 @@ bool idle_startup()
 				msg->startLogging();
 			}
 
+			if (gSavedSettings.getBOOL("NetworkReceiveThread"))
+			{
+				msg->startReceiveThread();
+			}
+
+			std::string capture_file = gSavedSettings.getString("PacketCaptureFile");
+			if (!capture_file.empty())
+			{
+				msg->startPacketCapture(gDirUtilp->getExpandedFilename(LL_PATH_LOGS, capture_file));
+			}
+
 			// start the xfer system. by default, choke the downloads
 			// a lot...
 			const S32 VIEWER_MAX_XFER = 3;
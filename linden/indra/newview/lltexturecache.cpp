@@ -36,8 +36,10 @@
 
 #include "llapr.h"
 #include "lldir.h"
+#include "llfasttimer.h"
 #include "llimage.h"
 #include "lllfsthread.h"
+#include "llslabcache.h"
 #include "llviewercontrol.h"
 
 // Included to allow LLTextureCache::purgeTextures() to pause watchdog timeout
@@ -51,10 +53,14 @@
 //  Entry size same as header packet, so we're not 0-padding unless whole image is contained in header.
 // cache/textures/[0-F]/UUID.texture
 //  Actual texture body files
+// cache/textures/bodies.[0-7].slab, cache/textures/bodies.index
+//  Or, with TextureCacheSlabs, all the bodies in a few slab files (see LLSlabCache)
 
 const S32 TEXTURE_CACHE_ENTRY_SIZE = FIRST_PACKET_SIZE; 
 const F32 TEXTURE_CACHE_PURGE_AMOUNT = .20f; // % amount to reduce the cache by when it exceeds its limit
-const F32 TEXTURE_CACHE_LRU_SIZE = .10f; // % amount for LRU list (low overhead to regenerate)
+const U32 TEXTURE_CACHE_EVICT_BUDGET = 16; // most bodies dropped per write while over the limit
+const U32 TEXTURE_CACHE_SLAB_COUNT = 8;
+const S64 TEXTURE_CACHE_MAX_SLAB_SIZE = 1024*1024*1024;
 
 class LLTextureCacheWorker : public LLWorkerClass
 {
@@ -452,8 +458,7 @@ bool LLTextureCacheRemoteWorker::doRead()
 	// Fourth state / stage : read the rest of the data from the UUID based cached file
 	if (!done && (mState == BODY))
 	{
-		std::string filename = mCache->getTextureFileName(mID);
-		S32 filesize = LLAPRFile::size(filename);
+		S32 filesize = mCache->getBodySize(mID);
 
 		if (filesize && (filesize + TEXTURE_CACHE_ENTRY_SIZE) > mOffset)
 		{
@@ -493,9 +498,8 @@ bool LLTextureCacheRemoteWorker::doRead()
 			mReadData = data;
 
 			// Read the data at last
-			S32 bytes_read = LLAPRFile::readEx(filename, 
-											 mReadData + data_offset,
-											 file_offset, file_size);
+			S32 bytes_read = mCache->readBody(mID, mReadData + data_offset,
+											  file_offset, file_size);
 			if (bytes_read != file_size)
 			{
 				llwarns << "LLTextureCacheWorker: "  << mID
@@ -511,7 +515,7 @@ bool LLTextureCacheRemoteWorker::doRead()
 		{
 			// No body, we're done.
 			mDataSize = llmax(TEXTURE_CACHE_ENTRY_SIZE - mOffset, 0);
-			lldebugs << "No body file for: " << filename << llendl;
+			lldebugs << "No body for: " << mID << llendl;
 		}	
 		// Nothing else to do at that point...
 		done = true;
@@ -630,12 +634,8 @@ bool LLTextureCacheRemoteWorker::doWrite()
 		S32 file_size = mDataSize - TEXTURE_CACHE_ENTRY_SIZE;
 		if ((file_size > 0) && mCache->updateTextureEntryList(mID, file_size))
 		{
-			// build the cache file name from the UUID
-			std::string filename = mCache->getTextureFileName(mID);			
-// 			llinfos << "Writing Body: " << filename << " Bytes: " << file_offset+file_size << llendl;
-			S32 bytes_written = LLAPRFile::writeEx(	filename, 
-													mWriteData + TEXTURE_CACHE_ENTRY_SIZE,
-													0, file_size);
+// 			llinfos << "Writing Body: " << mID << " Bytes: " << file_size << llendl;
+			S32 bytes_written = mCache->writeBody(mID, mWriteData + TEXTURE_CACHE_ENTRY_SIZE, file_size);
 			if (bytes_written <= 0)
 			{
 				llwarns << "LLTextureCacheWorker: "  << mID
@@ -657,9 +657,12 @@ bool LLTextureCacheRemoteWorker::doWrite()
 	return done;
 }
 
+static LLFastTimer::DeclareTimer FTM_TEXTURE_CACHE_WORK("Texture Cache Work");
+
 //virtual
 bool LLTextureCacheWorker::doWork(S32 param)
 {
+	LLFastTimer t(FTM_TEXTURE_CACHE_WORK);
 	bool res = false;
 	if (param == 0) // read
 	{
@@ -740,13 +743,15 @@ LLTextureCache::LLTextureCache(bool threaded)
 	  mListMutex(NULL),
 	  mHeaderAPRFile(NULL),
 	  mReadOnly(FALSE),
+	  mBodySlabs(NULL),
 	  mTexturesSizeTotal(0),
-	  mDoPurge(FALSE)
+	  mEvicting(false)
 {
 }
 
 LLTextureCache::~LLTextureCache()
 {
+	delete mBodySlabs; // saves its index
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -811,56 +816,76 @@ std::string LLTextureCache::getTextureFileName(const LLUUID& id)
 	return filename;
 }
 
-bool LLTextureCache::updateTextureEntryList(const LLUUID& id, S32 bodysize)
+S32 LLTextureCache::getBodySize(const LLUUID& id)
 {
-	bool res = false;
-	bool purge = false;
+	if (mBodySlabs)
 	{
-		mHeaderMutex.lock();
-		size_map_t::iterator iter1 = mTexturesSizeMap.find(id);
-		if (iter1 == mTexturesSizeMap.end() || iter1->second < bodysize)
-		{
-			llassert_always(bodysize > 0);
+		return mBodySlabs->getSize(id);
+	}
+	return LLAPRFile::size(getTextureFileName(id));
+}
 
-			S32 oldbodysize = 0;
-			if (iter1 != mTexturesSizeMap.end())
-			{
-				oldbodysize = iter1->second;
-			}
-						
-			Entry entry;
-			S32 idx = openAndReadEntry(id, entry, false);
-			if (idx < 0)
-			{
-				llwarns << "Failed to open entry: " << id << llendl;
-				mHeaderMutex.unlock();
-				removeFromCache(id);
-				return false;
-			}			
-			else if (oldbodysize != entry.mBodySize)
-			{
-				llwarns << "Entry mismatch in mTextureSizeMap / mHeaderIDMap"
-					   << " idx=" << idx << " oldsize=" << oldbodysize << " entrysize=" << entry.mBodySize << llendl;
-			}
-			entry.mBodySize = bodysize;
-			writeEntryAndClose(idx, entry);
-			
-			mTexturesSizeTotal -= oldbodysize;
-			mTexturesSizeTotal += bodysize;
-			
-			if (mTexturesSizeTotal > sCacheMaxTexturesSize)
-			{
-				purge = true;
-			}
-			res = true;
+S32 LLTextureCache::readBody(const LLUUID& id, U8* data, S32 offset, S32 size)
+{
+	if (mBodySlabs)
+	{
+		return mBodySlabs->read(id, data, offset, size);
+	}
+	return LLAPRFile::readEx(getTextureFileName(id), data, offset, size);
+}
+
+S32 LLTextureCache::writeBody(const LLUUID& id, const U8* data, S32 size)
+{
+	if (mBodySlabs)
+	{
+		std::vector<LLUUID> evicted;
+		S32 bytes_written = mBodySlabs->write(id, data, size, &evicted);
+		if (!evicted.empty())
+		{
+			bodiesEvicted(id, evicted);
 		}
+		return bytes_written;
+	}
+	return LLAPRFile::writeEx(getTextureFileName(id), (void*)data, 0, size);
+}
+
+bool LLTextureCache::updateTextureEntryList(const LLUUID& id, S32 bodysize)
+{
+	mHeaderMutex.lock();
+	S32 oldbodysize = 0;
+	id_map_t::iterator iter1 = mHeaderIDMap.find(id);
+	if (iter1 != mHeaderIDMap.end())
+	{
+		oldbodysize = mBodySizes[iter1->second];
 	}
-	if (purge)
+	if (oldbodysize >= bodysize)
 	{
-		mDoPurge = TRUE;
+		mHeaderMutex.unlock();
+		return false;
 	}
+	llassert_always(bodysize > 0);
+
+	Entry entry;
+	S32 idx = openAndReadEntry(id, entry, false);
+	if (idx < 0)
+	{
+		llwarns << "Failed to open entry: " << id << llendl;
+		mHeaderMutex.unlock();
+		removeFromCache(id);
+		return false;
+	}
+	else if (oldbodysize != entry.mBodySize)
+	{
+		llwarns << "Entry mismatch in mBodySizes / texture.entries"
+				<< " idx=" << idx << " oldsize=" << oldbodysize << " entrysize=" << entry.mBodySize << llendl;
+	}
+	entry.mBodySize = bodysize;
+	writeEntryAndClose(idx, entry);
+
+	// Make room a little at a time, here on the cache thread
+	evictBodies(idx, TEXTURE_CACHE_EVICT_BUDGET);
 	mHeaderMutex.unlock();
-	return res;
+	return true;
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -873,6 +898,7 @@ S64 LLTextureCache::sCacheMaxTexturesSize = 0; // no limit
 const char* entries_filename = "texture.entries";
 const char* cache_filename = "texture.cache";
 const char* textures_dirname = "textures";
+const char* slabs_basename = "bodies";
 
 void LLTextureCache::setDirNames(ELLPath location)
 {
@@ -880,6 +906,7 @@ void LLTextureCache::setDirNames(ELLPath location)
 	mHeaderEntriesFileName = gDirUtilp->getExpandedFilename(location, entries_filename);
 	mHeaderDataFileName = gDirUtilp->getExpandedFilename(location, cache_filename);
 	mTexturesDirName = gDirUtilp->getExpandedFilename(location, textures_dirname);
+	mBodySlabsBasename = mTexturesDirName + delem + slabs_basename;
 }
 
 void LLTextureCache::purgeCache(ELLPath location)
@@ -919,11 +946,42 @@ S64 LLTextureCache::initCache(ELLPath location, S64 max_size, BOOL read_only)
 	if (!mReadOnly)
 	{
 		LLFile::mkdir(mTexturesDirName);
+	}
+
+	if (gSavedSettings.getBOOL("TextureCacheSlabs"))
+	{
+		S64 slab_size = llmin(sCacheMaxTexturesSize / TEXTURE_CACHE_SLAB_COUNT, TEXTURE_CACHE_MAX_SLAB_SIZE);
+		mBodySlabs = new LLSlabCache;
+		if (!mBodySlabs->open(mBodySlabsBasename, TEXTURE_CACHE_SLAB_COUNT, (U32)slab_size, mReadOnly))
+		{
+			LL_WARNS("TextureCache") << "Can't open texture slabs, using one file per texture" << LL_ENDL;
+			delete mBodySlabs;
+			mBodySlabs = NULL;
+		}
+	}
+
+	if (!mReadOnly)
+	{
 		const char* subdirs = "0123456789abcdef";
+		std::string delem = gDirUtilp->getDirDelimiter();
 		for (S32 i=0; i<16; i++)
 		{
-			std::string dirname = mTexturesDirName + gDirUtilp->getDirDelimiter() + subdirs[i];
-			LLFile::mkdir(dirname);
+			std::string dirname = mTexturesDirName + delem + subdirs[i];
+			if (!mBodySlabs)
+			{
+				LLFile::mkdir(dirname);
+			}
+			else if (LLFile::isdir(dirname))
+			{
+				// Body files left from before switching to slabs
+				gDirUtilp->deleteFilesInDir(dirname, delem + "*");
+				LLFile::rmdir(dirname);
+			}
+		}
+		if (!mBodySlabs)
+		{
+			// and slabs left from before switching back
+			LLSlabCache::removeFiles(mBodySlabsBasename, TEXTURE_CACHE_SLAB_COUNT);
 		}
 	}
 	readHeaderCache();
@@ -997,34 +1055,35 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
 				idx = *(mFreeList.begin());
 				mFreeList.erase(mFreeList.begin());
 			}
-			else
+			else if (!mEntryLRU.empty())
 			{
-				// Look for a still valid entry in the LRU
-				for (std::set<LLUUID>::iterator iter2 = mLRU.begin(); iter2 != mLRU.end();)
+				// Reuse the least recently used entry, dropping its body
+				idx = mEntryLRU.front();
+				Entry oldentry;
+				S32 offset = sizeof(EntriesInfo) + idx * sizeof(Entry);
+				LLAPRFile* aprfile = openHeaderEntriesFile(true, offset);
+				S32 bytes_read = aprfile->read((void*)&oldentry, (S32)sizeof(Entry));
+				llassert_always(bytes_read == sizeof(Entry));
+				closeHeaderEntriesFile();
+				mHeaderIDMap.erase(oldentry.mID);
+				if (mBodySizes[idx] > 0)
 				{
-					std::set<LLUUID>::iterator curiter2 = iter2++;
-					LLUUID oldid = *curiter2;
-					// Erase entry from LRU regardless
-					mLRU.erase(curiter2);
-					// Look up entry and use it if it is valid
-					id_map_t::iterator iter3 = mHeaderIDMap.find(oldid);
-					if (iter3 != mHeaderIDMap.end() && iter3->second >= 0)
-					{
-						idx = iter3->second;
-						mHeaderIDMap.erase(oldid);
-						mTexturesSizeMap.erase(oldid);
-						break;
-					}
+					removeBody(oldentry.mID);
+					setBodySize(idx, 0);
 				}
-				// if (idx < 0) at this point, we will rebuild the LRU 
-				//  and retry if called from setHeaderCacheEntry(),
-				//  otherwise this shouldn't happen and will trigger an error
+				mEntryLRU.remove(idx);
 			}
 			if (idx >= 0)
 			{
 				// Set the header index
 				mHeaderIDMap[id] = idx;
-				llassert_always(mTexturesSizeMap.erase(id) == 0);
+				if (idx >= (S32)mBodySizes.size())
+				{
+					mBodySizes.resize(idx + 1, 0);
+					mEntryLRU.resize(idx + 1);
+					mBodyLRU.resize(idx + 1);
+				}
+				llassert_always(mBodySizes[idx] == 0);
 				// Initialize the entry (will get written later)
 				entry.init(id, time(NULL));
 				// Update Header
@@ -1041,8 +1100,6 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
 	}
 	else
 	{
-		// Remove this entry from the LRU if it exists
-		mLRU.erase(id);
 		// Read the entry
 		S32 offset = sizeof(EntriesInfo) + idx * sizeof(Entry);
 		LLAPRFile* aprfile = openHeaderEntriesFile(true, offset);
@@ -1062,9 +1119,14 @@ void LLTextureCache::writeEntryAndClose(S32 idx, Entry& entry)
 		{
 			entry.mTime = time(NULL);
 			llassert_always(entry.mImageSize == 0 || entry.mImageSize == -1 || entry.mImageSize > entry.mBodySize);
-			if (entry.mBodySize > 0)
+			setBodySize(idx, entry.mBodySize);
+			if (entry.mImageSize < 0)
 			{
-				mTexturesSizeMap[entry.mID] = entry.mBodySize;
+				mEntryLRU.remove(idx);
+			}
+			else
+			{
+				mEntryLRU.touch(idx);
 			}
 // 			llinfos << "Updating TE: " << idx << ": " << id << " Size: " << entry.mBodySize << " Time: " << entry.mTime << llendl;
 			S32 offset = sizeof(EntriesInfo) + idx * sizeof(Entry);
@@ -1082,10 +1144,16 @@ U32 LLTextureCache::openAndReadEntries(std::vector<Entry>& entries)
 	U32 num_entries = mHeaderEntriesInfo.mEntries;
 
 	mHeaderIDMap.clear();
-	mTexturesSizeMap.clear();
 	mFreeList.clear();
+	mEntryLRU.clear();
+	mBodyLRU.clear();
+	mBodySizes.clear();
 	mTexturesSizeTotal = 0;
+	mEntryLRU.resize(num_entries);
+	mBodyLRU.resize(num_entries);
+	mBodySizes.resize(num_entries, 0);
 
+	std::vector<std::pair<U32, S32> > lru; // (time, idx)
 	LLAPRFile* aprfile = openHeaderEntriesFile(false, (S32)sizeof(EntriesInfo));
 	for (U32 idx=0; idx<num_entries; idx++)
 	{
@@ -1107,15 +1175,25 @@ U32 LLTextureCache::openAndReadEntries(std::vector<Entry>& entries)
 		else
 		{
 			mHeaderIDMap[entry.mID] = idx;
-			if (entry.mBodySize > 0)
-			{
-				mTexturesSizeMap[entry.mID] = entry.mBodySize;
-				mTexturesSizeTotal += entry.mBodySize;
-			}
+			mBodySizes[idx] = entry.mBodySize;
+			mTexturesSizeTotal += entry.mBodySize;
+			lru.push_back(std::make_pair(entry.mTime, (S32)idx));
 			llassert_always(entry.mImageSize == 0 || entry.mImageSize > entry.mBodySize);
 		}
 	}
 	closeHeaderEntriesFile();
+
+	// The only sort: from here on the lists stay in order as entries are used
+	std::sort(lru.begin(), lru.end());
+	for (std::vector<std::pair<U32, S32> >::iterator iter = lru.begin(); iter != lru.end(); ++iter)
+	{
+		S32 idx = iter->second;
+		mEntryLRU.touch(idx);
+		if (mBodySizes[idx] > 0)
+		{
+			mBodyLRU.touch(idx);
+		}
+	}
 	return num_entries;
 }
 
@@ -1144,8 +1222,6 @@ void LLTextureCache::readHeaderCache()
 {
 	mHeaderMutex.lock();
 
-	mLRU.clear(); // always clear the LRU
-
 	readEntriesHeader();
 	
 	if (mHeaderEntriesInfo.mVersion != sHeaderCacheVersion)
@@ -1205,17 +1281,6 @@ void LLTextureCache::readHeaderCache()
 				}
 				llassert_always(purge_list.size() >= entries_to_purge);
 			}
-			else
-			{
-				S32 lru_entries = (S32)((F32)sCacheMaxEntries * TEXTURE_CACHE_LRU_SIZE);
-				for (std::set<lru_data_t>::iterator iter = lru.begin(); iter != lru.end(); ++iter)
-				{
-					mLRU.insert(iter->second);
-// 					llinfos << "LRU: " << iter->first << " : " << iter->second << llendl;
-					if (--lru_entries <= 0)
-						break;
-				}
-			}
 			
 			if (purge_list.size() > 0)
 			{
@@ -1271,16 +1336,26 @@ void LLTextureCache::purgeAllTextures(bool purge_directories)
 				LLFile::rmdir(dirname);
 			}
 		}
+		if (mBodySlabs)
+		{
+			mBodySlabs->clear();
+		}
+		else
+		{
+			LLSlabCache::removeFiles(mBodySlabsBasename, TEXTURE_CACHE_SLAB_COUNT);
+		}
 		if (purge_directories)
 		{
 			LLFile::rmdir(mTexturesDirName);
 		}
 	}
 	mHeaderIDMap.clear();
-	mTexturesSizeMap.clear();
-	mTexturesSizeTotal = 0;
+	mEntryLRU.clear();
+	mBodyLRU.clear();
+	mBodySizes.clear();
 	mFreeList.clear();
 	mTexturesSizeTotal = 0;
+	mEvicting = false;
 
 	// Info with 0 entries
 	mHeaderEntriesInfo.mVersion = sHeaderCacheVersion;
@@ -1305,93 +1380,49 @@ void LLTextureCache::purgeTextures(bool validate)
 
 	llinfos << "TEXTURE CACHE: Purging." << llendl;
 
-	// Read the entries list
-	std::vector<Entry> entries;
-	U32 num_entries = openAndReadEntries(entries);
-	if (!num_entries)
-	{
-		writeEntriesAndClose(entries);
-		return; // nothing to purge
-	}
-	
-	// Use mTexturesSizeMap to collect UUIDs of textures with bodies
-	typedef std::set<std::pair<U32,S32> > time_idx_set_t;
-	std::set<std::pair<U32,S32> > time_idx_set;
-	for (size_map_t::iterator iter1 = mTexturesSizeMap.begin();
-		 iter1 != mTexturesSizeMap.end(); ++iter1)
-	{
-		if (iter1->second > 0)
-		{
-			id_map_t::iterator iter2 = mHeaderIDMap.find(iter1->first);
-			if (iter2 != mHeaderIDMap.end())
-			{
-				S32 idx = iter2->second;
-				time_idx_set.insert(std::make_pair(entries[idx].mTime, idx));
-// 				llinfos << "TIME: " << entries[idx].mTime << " TEX: " << entries[idx].mID << " IDX: " << idx << " Size: " << entries[idx].mImageSize << llendl;
-			}
-		}
-	}
-	
-	// Validate 1/256th of the files on startup
-	U32 validate_idx = 0;
+	U32 purge_count = 0;
 	if (validate)
 	{
-		validate_idx = gSavedSettings.getU32("CacheValidateCounter");
+		// Read the entries list
+		std::vector<Entry> entries;
+		U32 num_entries = openAndReadEntries(entries);
+
+		// Validate 1/256th of the files on startup
+		U32 validate_idx = gSavedSettings.getU32("CacheValidateCounter");
 		U32 next_idx = (++validate_idx) % 256;
 		gSavedSettings.setU32("CacheValidateCounter", next_idx);
 		LL_DEBUGS("TextureCache") << "TEXTURE CACHE: Validating: " << validate_idx << LL_ENDL;
-	}
 
-	S64 cache_size = mTexturesSizeTotal;
-	S64 purged_cache_size = (sCacheMaxTexturesSize * (S64)((1.f-TEXTURE_CACHE_PURGE_AMOUNT)*100)) / 100;
-	S32 purge_count = 0;
-	for (time_idx_set_t::iterator iter = time_idx_set.begin();
-		 iter != time_idx_set.end(); ++iter)
-	{
-		S32 idx = iter->second;
-		bool purge_entry = false;
-		std::string filename = getTextureFileName(entries[idx].mID);
-		if (cache_size >= purged_cache_size)
-		{
-			purge_entry = true;
-		}
-		else if (validate)
+		std::vector<S32> bad_bodies;
+		for (U32 idx = 0; idx < num_entries; ++idx)
 		{
-			// make sure file exists and is the correct size
-			S32 uuididx = entries[idx].mID.mData[0];
-			if (uuididx == validate_idx)
+			const Entry& entry = entries[idx];
+			if (entry.mImageSize < 0 || entry.mBodySize <= 0)
+			{
+				continue;
+			}
+			// make sure the body exists and is the correct size
+			// (slab bodies are checked against the index in memory, so all of them are)
+			S32 uuididx = entry.mID.mData[0];
+			if (mBodySlabs || uuididx == validate_idx)
 			{
- 				LL_DEBUGS("TextureCache") << "Validating: " << filename << "Size: " << entries[idx].mBodySize << LL_ENDL;
-				S32 bodysize = LLAPRFile::size(filename);
-				if (bodysize != entries[idx].mBodySize)
+ 				LL_DEBUGS("TextureCache") << "Validating: " << entry.mID << "Size: " << entry.mBodySize << LL_ENDL;
+				S32 bodysize = getBodySize(entry.mID);
+				if (bodysize != entry.mBodySize)
 				{
-					LL_WARNS("TextureCache") << "TEXTURE CACHE BODY HAS BAD SIZE: " << bodysize << " != " << entries[idx].mBodySize
-							<< filename << LL_ENDL;
-					purge_entry = true;
+					LL_WARNS("TextureCache") << "TEXTURE CACHE BODY HAS BAD SIZE: " << bodysize << " != " << entry.mBodySize
+							<< " " << entry.mID << LL_ENDL;
+					bad_bodies.push_back(idx);
 				}
 			}
 		}
-		else
-		{
-			break;
-		}
-		
-		if (purge_entry)
-		{
-			purge_count++;
-	 		LL_DEBUGS("TextureCache") << "PURGING: " << filename << LL_ENDL;
-			LLAPRFile::remove(filename);
-			cache_size -= entries[idx].mBodySize;
-			mTexturesSizeTotal -= entries[idx].mBodySize;
-			entries[idx].mBodySize = 0;
-			mTexturesSizeMap.erase(entries[idx].mID);
-		}
+		dropBodies(bad_bodies);
+		purge_count += bad_bodies.size();
 	}
 
-	LL_DEBUGS("TextureCache") << "TEXTURE CACHE: Writing Entries: " << num_entries << LL_ENDL;
+	// Get under the limit in one go here; writes keep it there afterwards
+	purge_count += evictBodies(-1, 0);
 
-	writeEntriesAndClose(entries);
-	
 	if (!mThreaded)
 	{
 		// *FIX:Mani - watchdog back on.
@@ -1400,7 +1431,7 @@ void LLTextureCache::purgeTextures(bool validate)
 	
 	LL_INFOS("TextureCache") << "TEXTURE CACHE:"
 			<< " PURGED: " << purge_count
-			<< " ENTRIES: " << num_entries
+			<< " ENTRIES: " << mHeaderEntriesInfo.mEntries
 			<< " CACHE SIZE: " << mTexturesSizeTotal / 1024*1024 << " MB"
 			<< llendl;
 }
@@ -1450,7 +1481,7 @@ S32 LLTextureCache::getHeaderCacheEntry(const LLUUID& id, S32& imagesize)
 // Writes imagesize to the header, updates timestamp
 S32 LLTextureCache::setHeaderCacheEntry(const LLUUID& id, S32 imagesize)
 {
-	mHeaderMutex.lock();
+	LLMutexLock lock(&mHeaderMutex);
 	llassert_always(imagesize >= 0);
 	Entry entry;
 	S32 idx = openAndReadEntry(id, entry, true);
@@ -1458,16 +1489,6 @@ S32 LLTextureCache::setHeaderCacheEntry(const LLUUID& id, S32 imagesize)
 	{
 		entry.mImageSize = imagesize;
 		writeEntryAndClose(idx, entry);
-		mHeaderMutex.unlock();
-	}
-	else // retry
-	{
-		mHeaderMutex.unlock();
-		readHeaderCache(); // We couldn't write an entry, so refresh the LRU
-		mHeaderMutex.lock();
-		llassert_always(!mLRU.empty() || mHeaderEntriesInfo.mEntries < sCacheMaxEntries);
-		mHeaderMutex.unlock();
-		idx = setHeaderCacheEntry(id, imagesize); // assert above ensures no inf. recursion
 	}
 	return idx;
 }
@@ -1548,14 +1569,6 @@ LLTextureCache::handle_t LLTextureCache::writeToCache(const LLUUID& id, U32 prio
 		delete responder;
 		return LLWorkerThread::nullHandle();
 	}
-	if (mDoPurge)
-	{
-		// NOTE: This may cause an occasional hiccup,
-		//  but it really needs to be done on the control thread
-		//  (i.e. here)		
-		purgeTextures(false);
-		mDoPurge = FALSE;
-	}
 	LLMutexLock lock(&mWorkersMutex);
 	LLTextureCacheWorker* worker = new LLTextureCacheRemoteWorker(this, priority, id,
 																  data, datasize, 0,
@@ -1617,7 +1630,6 @@ bool LLTextureCache::removeHeaderCacheEntry(const LLUUID& id)
 			writeEntryAndClose(idx, entry);
 			mFreeList.insert(idx);
 			mHeaderIDMap.erase(id);
-			mTexturesSizeMap.erase(id);
 			return true;
 		}
 	}
@@ -1631,10 +1643,175 @@ void LLTextureCache::removeFromCache(const LLUUID& id)
 	{
 		removeHeaderCacheEntry(id);
 		LLMutexLock lock(&mHeaderMutex);
+		removeBody(id);
+	}
+}
+
+// mHeaderMutex must be locked
+void LLTextureCache::removeBody(const LLUUID& id)
+{
+	if (mBodySlabs)
+	{
+		mBodySlabs->remove(id);
+	}
+	else
+	{
 		LLAPRFile::remove(getTextureFileName(id));
 	}
 }
 
+// The slabs dropped these bodies to make room while writing the body for
+// writing_id. Clear them from their entries so they get written again when
+// fetched.
+void LLTextureCache::bodiesEvicted(const LLUUID& writing_id, const std::vector<LLUUID>& ids)
+{
+	LLMutexLock lock(&mHeaderMutex);
+	std::vector<S32> indices;
+	for (std::vector<LLUUID>::const_iterator iter = ids.begin(); iter != ids.end(); ++iter)
+	{
+		id_map_t::iterator iter2 = mHeaderIDMap.find(*iter);
+		if (*iter != writing_id && iter2 != mHeaderIDMap.end() && mBodySizes[iter2->second] > 0)
+		{
+			indices.push_back(iter2->second);
+		}
+	}
+	dropBodies(indices);
+}
+
+// Keeps the body size, the total and the body LRU in step.
+// mHeaderMutex must be locked.
+void LLTextureCache::setBodySize(S32 idx, S32 bodysize)
+{
+	mTexturesSizeTotal += bodysize - mBodySizes[idx];
+	mBodySizes[idx] = bodysize;
+	if (bodysize > 0)
+	{
+		mBodyLRU.touch(idx);
+	}
+	else
+	{
+		mBodyLRU.remove(idx);
+	}
+}
+
+// Drops the bodies of these entries, rewriting just their records in one
+// pass over texture.entries. Their times are left alone, dropping a body
+// isn't a use. mHeaderMutex must be locked.
+void LLTextureCache::dropBodies(const std::vector<S32>& indices)
+{
+	if (indices.empty() || mReadOnly)
+	{
+		return;
+	}
+	LLAPRFile* aprfile = openHeaderEntriesFile(false, 0);
+	for (std::vector<S32>::const_iterator iter = indices.begin(); iter != indices.end(); ++iter)
+	{
+		S32 idx = *iter;
+		S32 offset = sizeof(EntriesInfo) + idx * sizeof(Entry);
+		Entry entry;
+		aprfile->seek(APR_SET, offset);
+		S32 bytes_read = aprfile->read((void*)&entry, (S32)sizeof(Entry));
+		llassert_always(bytes_read == sizeof(Entry));
+		LL_DEBUGS("TextureCache") << "PURGING: " << entry.mID << LL_ENDL;
+		removeBody(entry.mID);
+		entry.mBodySize = 0;
+		aprfile->seek(APR_SET, offset);
+		S32 bytes_written = aprfile->write((void*)&entry, (S32)sizeof(Entry));
+		llassert_always(bytes_written == sizeof(Entry));
+		setBodySize(idx, 0);
+	}
+	closeHeaderEntriesFile();
+}
+
+// Once the bodies grow past sCacheMaxTexturesSize, drops the least
+// recently used ones until they are back under the purge target. Stops
+// after budget bodies (0 for no limit) so each write does a little of it.
+// Returns the number dropped. mHeaderMutex must be locked.
+U32 LLTextureCache::evictBodies(S32 keep_idx, U32 budget)
+{
+	if (mTexturesSizeTotal > sCacheMaxTexturesSize)
+	{
+		mEvicting = true;
+	}
+	if (!mEvicting)
+	{
+		return 0;
+	}
+
+	S64 purged_cache_size = (sCacheMaxTexturesSize * (S64)((1.f-TEXTURE_CACHE_PURGE_AMOUNT)*100)) / 100;
+	S64 cache_size = mTexturesSizeTotal;
+	std::vector<S32> victims;
+	for (S32 idx = mBodyLRU.front();
+		 idx >= 0 && cache_size > purged_cache_size && (!budget || victims.size() < budget);
+		 idx = mBodyLRU.next(idx))
+	{
+		if (idx != keep_idx)
+		{
+			victims.push_back(idx);
+			cache_size -= mBodySizes[idx];
+		}
+	}
+	dropBodies(victims);
+
+	if (mTexturesSizeTotal <= purged_cache_size)
+	{
+		mEvicting = false;
+	}
+	return victims.size();
+}
+
+void LLTextureCache::LRUList::touch(S32 idx)
+{
+	llassert_always(idx >= 0 && idx < (S32)mLinks.size());
+	if (mLinks[idx].mLinked)
+	{
+		if (idx == mTail)
+		{
+			return;
+		}
+		remove(idx);
+	}
+	Link& link = mLinks[idx];
+	link.mPrev = mTail;
+	link.mNext = -1;
+	link.mLinked = true;
+	if (mTail >= 0)
+	{
+		mLinks[mTail].mNext = idx;
+	}
+	else
+	{
+		mHead = idx;
+	}
+	mTail = idx;
+}
+
+void LLTextureCache::LRUList::remove(S32 idx)
+{
+	if (!contains(idx))
+	{
+		return;
+	}
+	Link& link = mLinks[idx];
+	if (link.mPrev >= 0)
+	{
+		mLinks[link.mPrev].mNext = link.mNext;
+	}
+	else
+	{
+		mHead = link.mNext;
+	}
+	if (link.mNext >= 0)
+	{
+		mLinks[link.mNext].mPrev = link.mPrev;
+	}
+	else
+	{
+		mTail = link.mPrev;
+	}
+	link = Link();
+}
+
 //////////////////////////////////////////////////////////////////////////////
 
 LLTextureCache::ReadResponder::ReadResponder()
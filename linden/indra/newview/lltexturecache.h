@@ -41,6 +41,7 @@
 #include "llworkerthread.h"
 
 class LLTextureCacheWorker;
+class LLSlabCache;
 
 class LLTextureCache : public LLWorkerThread
 {
@@ -68,6 +69,33 @@ private:
 		U32 mTime; // seconds since 1/1/1970
 	};
 
+	// Entries in least recently used order, linked through their index in
+	// texture.entries so that touching or dropping one is O(1)
+	class LRUList
+	{
+	public:
+		LRUList() : mHead(-1), mTail(-1) {}
+		void resize(S32 count) { mLinks.resize(count); }
+		void clear() { mLinks.clear(); mHead = mTail = -1; }
+		bool empty() const { return mHead < 0; }
+		S32 front() const { return mHead; }
+		S32 next(S32 idx) const { return mLinks[idx].mNext; }
+		bool contains(S32 idx) const { return idx < (S32)mLinks.size() && mLinks[idx].mLinked; }
+		void touch(S32 idx); // moves or adds idx at the most recently used end
+		void remove(S32 idx);
+	private:
+		struct Link
+		{
+			Link() : mPrev(-1), mNext(-1), mLinked(false) {}
+			S32 mPrev;
+			S32 mNext;
+			bool mLinked;
+		};
+		std::vector<Link> mLinks;
+		S32 mHead;
+		S32 mTail;
+	};
+
 	
 public:
 
@@ -138,6 +166,10 @@ protected:
 	std::string getLocalFileName(const LLUUID& id);
 	std::string getTextureFileName(const LLUUID& id);
 	void addCompleted(Responder* responder, bool success);
+	// Bodies live in one file each, or in mBodySlabs when it is open
+	S32 getBodySize(const LLUUID& id);
+	S32 readBody(const LLUUID& id, U8* data, S32 offset, S32 size);
+	S32 writeBody(const LLUUID& id, const U8* data, S32 size);
 	
 protected:
 	//void setFileAPRPool(apr_pool_t* pool) { mFileAPRPool = pool ; }
@@ -158,6 +190,11 @@ private:
 	S32 getHeaderCacheEntry(const LLUUID& id, S32& imagesize);
 	S32 setHeaderCacheEntry(const LLUUID& id, S32 imagesize);
 	bool removeHeaderCacheEntry(const LLUUID& id);
+	void removeBody(const LLUUID& id);
+	void bodiesEvicted(const LLUUID& writing_id, const std::vector<LLUUID>& ids);
+	void setBodySize(S32 idx, S32 bodysize);
+	void dropBodies(const std::vector<S32>& indices);
+	U32 evictBodies(S32 keep_idx, U32 budget);
 	
 private:
 	// Internal
@@ -183,16 +220,18 @@ private:
 	std::string mHeaderDataFileName;
 	EntriesInfo mHeaderEntriesInfo;
 	std::set<S32> mFreeList; // deleted entries
-	std::set<LLUUID> mLRU;
+	LRUList mEntryLRU; // all live entries
+	LRUList mBodyLRU; // entries with a body
 	typedef std::map<LLUUID,S32> id_map_t;
 	id_map_t mHeaderIDMap;
 
 	// BODIES (TEXTURES minus headers)
 	std::string mTexturesDirName;
-	typedef std::map<LLUUID,S32> size_map_t;
-	size_map_t mTexturesSizeMap;
+	std::string mBodySlabsBasename;
+	LLSlabCache* mBodySlabs; // NULL when each body is its own file
+	std::vector<S32> mBodySizes; // by entry index
 	S64 mTexturesSizeTotal;
-	LLAtomic32<BOOL> mDoPurge;
+	bool mEvicting; // dropping bodies until back under the purge target
 
 	// Statics
 	static F32 sHeaderCacheVersion;
@@ -41,6 +41,7 @@
 #include "llappviewer.h"
 #include "llcurl.h"
 #include "lldir.h"
+#include "llfasttimer.h"
 #include "llhttpclient.h"
 #include "llhttpstatuscodes.h"
 #include "llimage.h"
@@ -568,9 +569,12 @@ void LLTextureFetchWorker::startWork(S32 param)
 
 #include "llviewerimagelist.h" // debug
 
+static LLFastTimer::DeclareTimer FTM_TEXTURE_FETCH_WORK("Texture Fetch Work");
+
 // Called from LLWorkerThread::processRequest()
 bool LLTextureFetchWorker::doWork(S32 param)
 {
+	LLFastTimer t(FTM_TEXTURE_FETCH_WORK);
 	LLMutexLock lock(&mWorkMutex);
 
 	if ((mFetcher->isQuitting() || (mImagePriority <= 0.0f) || getFlags(LLWorkerClass::WCF_DELETE_REQUESTED)))
@@ -841,7 +845,8 @@ bool LLTextureFetchWorker::doWork(S32 param)
 				std::vector<std::string> headers;
 				headers.push_back("Accept: image/x-j2c");
 				res = mFetcher->mCurlGetRequest->getByteRange(mUrl, headers, offset, mRequestedSize,
-															  new HTTPGetResponder(mFetcher, mID, LLTimer::getTotalTime(), mRequestedSize, offset));
+															  new HTTPGetResponder(mFetcher, mID, LLTimer::getTotalTime(), mRequestedSize, offset),
+															  LLCurl::PRIORITY_TEXTURE);
 			}
 			if (!res)
 			{
@@ -2085,8 +2090,12 @@ S32 LLTextureFetch::getFetchState(const LLUUID& id, F32& data_progress_p, F32& r
 void LLTextureFetch::dump()
 {
 	llinfos << "LLTextureFetch REQUESTS:" << llendl;
-	for (request_queue_t::iterator iter = mRequestQueue.begin();
-		 iter != mRequestQueue.end(); ++iter)
+	std::vector<QueuedRequest*> requests;
+	lockData();
+	mRequestQueue.getRequests(requests);
+	unlockData();
+	for (std::vector<QueuedRequest*>::iterator iter = requests.begin();
+		 iter != requests.end(); ++iter)
 	{
 		LLQueuedThread::QueuedRequest* qreq = *iter;
 		LLWorkerThread::WorkRequest* wreq = (LLWorkerThread::WorkRequest*)qreq;
@@ -525,6 +525,8 @@ bool rlvHandleShowNameTagsChanged(const LLSD& newvalue)
 
 void settings_setup_listeners()
 {
+	LLCachedControlBase::initClass();
+
 	gSavedSettings.getControl("FirstPersonAvatarVisible")->getSignal()->connect(boost::bind(&handleRenderAvatarMouselookChanged, _1));
 	gSavedSettings.getControl("RenderFarClip")->getSignal()->connect(boost::bind(&handleRenderFarClipChanged, _1));
 	gSavedSettings.getControl("RenderTerrainDetail")->getSignal()->connect(boost::bind(&handleTerrainDetailChanged, _1));
@@ -751,6 +753,47 @@ template <> eControlType get_control_type<LLSD>(const LLSD& in, LLSD& out)
 	return TYPE_LLSD; 
 }
 
+template <> U32 convert_from_llsd<U32>(const LLSD& sd)
+{
+	return (U32)sd.asInteger();
+}
+
+template <> S32 convert_from_llsd<S32>(const LLSD& sd)
+{
+	return sd.asInteger();
+}
+
+template <> F32 convert_from_llsd<F32>(const LLSD& sd)
+{
+	return (F32)sd.asReal();
+}
+
+template <> bool convert_from_llsd<bool>(const LLSD& sd)
+{
+	return sd.asBoolean();
+}
+
+template <> std::string convert_from_llsd<std::string>(const LLSD& sd)
+{
+	return sd.asString();
+}
+
+template <> LLSD convert_from_llsd<LLSD>(const LLSD& sd)
+{
+	return sd;
+}
+
+LLMutex* LLCachedControlBase::sMutex = NULL;
+
+//static
+void LLCachedControlBase::initClass()
+{
+	if (!sMutex)
+	{
+		sMutex = new LLMutex(NULL);
+	}
+}
+
 
 #if TEST_CACHED_CONTROL
 
@@ -35,6 +35,7 @@
 
 #include <map>
 #include "llcontrol.h"
+#include "llthread.h"
 
 // Enabled this definition to compile a 'hacked' viewer that
 // allows a hacked godmode to be toggled on and off.
@@ -74,13 +75,51 @@ eControlType get_control_type(const T& in, LLSD& out)
 	return TYPE_COUNT;
 }
 
+//! Helper function for LLCachedControl
+template <class T>
+T convert_from_llsd(const LLSD& sd)
+{
+	T value;
+	value = sd;
+	return value;
+}
+
+//! Shared state for every LLCachedControl
+class LLCachedControlBase
+{
+public:
+	//! Call once from the main thread after APR is up. Until then
+	//! only one thread exists and no locking is needed.
+	static void initClass();
+
+protected:
+	//! Held while a cached value is written, and by get() on other
+	//! threads while one is read.
+	class Lock
+	{
+	public:
+		Lock()	{ if (sMutex) sMutex->lock(); }
+		~Lock()	{ if (sMutex) sMutex->unlock(); }
+	};
+
+	static LLMutex* sMutex;
+};
+
 //! Publish/Subscribe object to interact with LLControlGroups.
 
 //! An LLCachedControl instance to connect to a LLControlVariable
 //! without have to manually create and bind a listener to a local
-//! object.
+//! object. Reading the cached value costs no name lookup, so use
+//! these instead of gSavedSettings.getXXX() on per-frame paths:
+//!
+//!   static LLCachedControl<bool> freeze_time(gSavedSettings, "FreezeTime");
+//!   if (freeze_time) ...
+//!
+//! The value is updated through the control's signal, which fires on
+//! the main thread where settings change. Main thread code may read
+//! it directly; other threads must use get().
 template <class T>
-class LLCachedControl
+class LLCachedControl : public LLCachedControlBase
 {
     T mCachedValue;
     LLPointer<LLControlVariable> mControl;
@@ -105,13 +144,29 @@ public:
 		}
 		else
 		{
-			mCachedValue = (const T&)mControl->getValue();
+			mCachedValue = convert_from_llsd<T>(mControl->getValue());
 		}
 
-		// Add a listener to the controls signal...
-		mControl->getSignal()->connect(
-			boost::bind(&LLCachedControl<T>::handleValueChange, this, _1)
-			);
+		connect();
+	}
+
+	//! Bind to a control which the settings file already declares.
+	LLCachedControl(LLControlGroup& group, const std::string& name)
+	{
+		mControl = group.getControl(name);
+		if(mControl.isNull())
+		{
+			llwarns << "Caching undeclared control " << name << llendl;
+			declareTypedControl(group, name, T(), "Declared In Code");
+			mControl = group.getControl(name);
+			if(mControl.isNull())
+			{
+				llerrs << "The control could not be created!!!" << llendl;
+			}
+		}
+		mCachedValue = convert_from_llsd<T>(mControl->getValue());
+
+		connect();
 	}
 
 	~LLCachedControl()
@@ -125,11 +180,27 @@ public:
 	LLCachedControl& operator =(const T& newvalue)
 	{
 	   setTypeValue(*mControl, newvalue);
+	   return *this;
 	}
 
-	operator const T&() { return mCachedValue; }
+	operator const T&() const { return mCachedValue; }
+
+	//! Copy of the value which is safe to take from any thread.
+	T get() const
+	{
+		Lock lock;
+		return mCachedValue;
+	}
 
 private:
+	void connect()
+	{
+		// Add a listener to the controls signal...
+		mConnection = mControl->getSignal()->connect(
+			boost::bind(&LLCachedControl<T>::handleValueChange, this, _1)
+			);
+	}
+
 	void declareTypedControl(LLControlGroup& group, 
 							 const std::string& name, 
 							 const T& default_value,
@@ -145,7 +216,9 @@ private:
 
 	bool handleValueChange(const LLSD& newvalue)
 	{
-		mCachedValue = (const T &)newvalue;
+		T value = convert_from_llsd<T>(newvalue);
+		Lock lock;
+		mCachedValue = value;
 		return true;
 	}
 
@@ -171,6 +244,13 @@ template <> eControlType get_control_type<LLColor3>(const LLColor3& in, LLSD& ou
 template <> eControlType get_control_type<LLColor4U>(const LLColor4U& in, LLSD& out); 
 template <> eControlType get_control_type<LLSD>(const LLSD& in, LLSD& out);
 
+template <> U32 convert_from_llsd<U32>(const LLSD& sd);
+template <> S32 convert_from_llsd<S32>(const LLSD& sd);
+template <> F32 convert_from_llsd<F32>(const LLSD& sd);
+template <> bool convert_from_llsd<bool>(const LLSD& sd);
+template <> std::string convert_from_llsd<std::string>(const LLSD& sd);
+template <> LLSD convert_from_llsd<LLSD>(const LLSD& sd);
+
 //#define TEST_CACHED_CONTROL 1
 #ifdef TEST_CACHED_CONTROL
 void test_cached_control();
@@ -71,6 +71,9 @@ const F32 LLViewerPartSim::PART_ADAPT_RATE_MULT_RECIP = 1.0f/PART_ADAPT_RATE_MUL
 
 U32 LLViewerPart::sNextPartID = 1;
 
+// Particles come and go by the thousand every second in busy areas.
+MEM_TYPE_POOL_IMPL(LLViewerPart, LLMemType::MTYPE_PARTICLES, 1024, false)
+
 F32 calc_desired_size(LLVector3 pos, LLVector2 scale)
 {
 	F32 desired_size = (pos-LLViewerCamera::getInstance()->getOrigin()).magVec();
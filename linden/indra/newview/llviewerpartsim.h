@@ -36,6 +36,7 @@
 #include "lldarrayptr.h"
 #include "llframetimer.h"
 #include "llmemory.h"
+#include "llmempool.h"
 #include "llpartdata.h"
 #include "llviewerpartsource.h"
 
@@ -59,6 +60,7 @@ public:
 	~LLViewerPart();
 public:
 	LLViewerPart();
+	MEM_TYPE_POOL_NEW;
 
 	void init(LLPointer<LLViewerPartSource> sourcep, LLViewerImage *imagep, LLVPCallback cb);
 
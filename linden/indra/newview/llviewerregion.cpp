@@ -68,7 +68,10 @@
 
 // Viewer object cache version, change if object update
 // format changes. JC
-const U32 INDRA_OBJECT_CACHE_VERSION = 14;
+const U32 INDRA_OBJECT_CACHE_VERSION = 15;
+
+// zero, version, cache id and entry count, followed by the index
+const S32 OBJECT_CACHE_HEADER_SIZE = 2 * sizeof(U32) + UUID_BYTES + sizeof(S32);
 
 
 extern BOOL gNoRender;
@@ -169,6 +172,7 @@ LLViewerRegion::LLViewerRegion(const U64 &handle,
 	mProductSKU("unknown"),
 	mProductName("unknown"),
 	mCacheLoaded(FALSE),
+	mHandshakeReplyPending(FALSE),
 	mCacheEntriesCount(0),
 	mCacheID(),
 	mEventPoll(NULL),
@@ -210,6 +214,10 @@ LLViewerRegion::LLViewerRegion(const U64 &handle,
 	initStats();
 
 	mCacheStart.append(mCacheEnd);
+	// Start reading the cache file now, loadCache() needs it once the
+	// region handshake arrives
+	mCacheFile = new LLVOCacheFile();
+	mCacheFile->startRead(getCacheFilename());
 	
 	//create object partitions
 	//MUST MATCH declaration of eObjectPartitions
@@ -274,11 +282,22 @@ LLViewerRegion::~LLViewerRegion()
 }
 
 
-void LLViewerRegion::loadCache()
+std::string LLViewerRegion::getCacheFilename() const
+{
+	return gDirUtilp->getExpandedFilename(LL_PATH_CACHE,"") + gDirUtilp->getDirDelimiter() +
+		llformat("objects_%d_%d.slc", U32(mHandle>>32)/REGION_WIDTH_UNITS, U32(mHandle)/REGION_WIDTH_UNITS );
+}
+
+BOOL LLViewerRegion::loadCache()
 {
 	if (mCacheLoaded)
 	{
-		return;
+		return TRUE;
+	}
+
+	if (mCacheFile.notNull() && !mCacheFile->isDone())
+	{
+		return FALSE;
 	}
 
 	// Presume success.  If it fails, we don't want to try again.
@@ -286,66 +305,67 @@ void LLViewerRegion::loadCache()
 
 	LLVOCacheEntry *entry;
 
-	std::string filename;
-	filename = gDirUtilp->getExpandedFilename(LL_PATH_CACHE,"") + gDirUtilp->getDirDelimiter() +
-		llformat("objects_%d_%d.slc",U32(mHandle>>32)/REGION_WIDTH_UNITS, U32(mHandle)/REGION_WIDTH_UNITS );
-
-	LLFILE* fp = LLFile::fopen(filename, "rb");		/* Flawfinder: ignore */
-	if (!fp)
+	LLPointer<LLVOCacheFile> file = mCacheFile;
+	mCacheFile = NULL;
+	if (file.isNull() || !file->hasData())
 	{
 		// might not have a file, which is normal
-		return;
+		return TRUE;
 	}
+	const U8* data = file->getData();
+	S32 size = file->getSize();
 
-	U32 zero;
-	size_t nread;
-	nread = fread(&zero, sizeof(U32), 1, fp);
-	if (nread != 1 || zero)
+	U32 zero = 1;
+	if (size >= OBJECT_CACHE_HEADER_SIZE)
+	{
+		memcpy(&zero, data, sizeof(U32));
+	}
+	if (zero)
 	{
 		// a non-zero value here means bad things!
 		// skip reading the cached values
 		llinfos << "Cache file invalid" << llendl;
-		fclose(fp);
-		return;
+		return TRUE;
 	}
 
 	U32 version;
-	nread = fread(&version, sizeof(U32), 1, fp);
-	if (nread != 1 || version != INDRA_OBJECT_CACHE_VERSION)
+	memcpy(&version, data + sizeof(U32), sizeof(U32));
+	if (version != INDRA_OBJECT_CACHE_VERSION)
 	{
 		// a version mismatch here means we've changed the binary format!
 		// skip reading the cached values
 		llinfos << "Cache version changed, discarding" << llendl;
-		fclose(fp);
-		return;
+		return TRUE;
 	}
 
 	LLUUID cache_id;
-	nread = fread(&cache_id.mData, 1, UUID_BYTES, fp);
-	if (nread != UUID_BYTES || mCacheID != cache_id)
+	memcpy(&cache_id.mData, data + 2 * sizeof(U32), UUID_BYTES);
+	if (mCacheID != cache_id)
 	{
 		llinfos << "Cache ID doesn't match for this region, discarding"
 			<< llendl;
-		fclose(fp);
-		return;
+		return TRUE;
 	}
 
 	S32 num_entries;
-	nread = fread(&num_entries, sizeof(S32), 1, fp);
-	if (nread != 1)
+	memcpy(&num_entries, data + 2 * sizeof(U32) + UUID_BYTES, sizeof(S32));
+	if (num_entries < 0
+		|| num_entries > (size - OBJECT_CACHE_HEADER_SIZE) / LLVOCacheEntry::INDEX_RECORD_SIZE)
 	{
 		llinfos << "Short read, discarding" << llendl;
-		fclose(fp);
-		return;
+		return TRUE;
 	}
-	
+
+	// Only the index is parsed here, entries copy their data out of the
+	// file when they are hit
+	S32 data_start = OBJECT_CACHE_HEADER_SIZE + num_entries * LLVOCacheEntry::INDEX_RECORD_SIZE;
 	S32 i;
 	for (i = 0; i < num_entries; i++)
 	{
-		entry = new LLVOCacheEntry(fp);
+		entry = new LLVOCacheEntry(file, OBJECT_CACHE_HEADER_SIZE + i * LLVOCacheEntry::INDEX_RECORD_SIZE, data_start);
 		if (!entry->getLocalID())
 		{
-			llwarns << "Aborting cache file load for " << filename << ", cache file corruption!" << llendl;
+			llwarns << "Aborting cache file load for " << getCacheFilename() << ", cache file corruption!" << llendl;
 			delete entry;
 			entry = NULL;
 			break;
@@ -354,8 +374,7 @@ void LLViewerRegion::loadCache()
 		mCacheMap[entry->getLocalID()] = entry;
 		mCacheEntriesCount++;
 	}
-
-	fclose(fp);
+	return TRUE;
 }
 
 
@@ -366,53 +385,46 @@ void LLViewerRegion::saveCache()
 		return;
 	}
 
-	S32 num_entries = mCacheEntriesCount;
-	if (0 == num_entries)
+	if (0 == mCacheEntriesCount)
 	{
 		return;
 	}
 
-	std::string filename;
-	filename = gDirUtilp->getExpandedFilename(LL_PATH_CACHE,"") + gDirUtilp->getDirDelimiter() +
-		llformat("objects_%d_%d.slc", U32(mHandle>>32)/REGION_WIDTH_UNITS, U32(mHandle)/REGION_WIDTH_UNITS );
+	LLVOCacheEntry *entry;
 
-	LLFILE* fp = LLFile::fopen(filename, "wb");		/* Flawfinder: ignore */
-	if (!fp)
+	S32 num_entries = 0;
+	S32 data_size = 0;
+	for (entry = mCacheStart.getNext(); entry && (entry != &mCacheEnd); entry = entry->getNext())
 	{
-		llwarns << "Unable to write cache file " << filename << llendl;
-		return;
+		num_entries++;
+		data_size += entry->getDataSize();
 	}
 
+	// Build the whole file here and let the LFS thread write it out
+	S32 data_start = OBJECT_CACHE_HEADER_SIZE + num_entries * LLVOCacheEntry::INDEX_RECORD_SIZE;
+	S32 size = data_start + data_size;
+	U8* buffer = new U8[size];
+
 	// write out zero to indicate a version cache file
 	U32 zero = 0;
-	if (fwrite(&zero, sizeof(U32), 1, fp) != 1)
-	{
-		llwarns << "Short write" << llendl;
-	}
+	memcpy(buffer, &zero, sizeof(U32));
 
 	// write out version number
 	U32 version = INDRA_OBJECT_CACHE_VERSION;
-	if (fwrite(&version, sizeof(U32), 1, fp) != 1)
-	{
-		llwarns << "Short write" << llendl;
-	}
+	memcpy(buffer + sizeof(U32), &version, sizeof(U32));
 
 	// write the cache id for this sim
-	if (fwrite(&mCacheID.mData, 1, UUID_BYTES, fp) != UUID_BYTES)
-	{
-		llwarns << "Short write" << llendl;
-	}
+	memcpy(buffer + 2 * sizeof(U32), &mCacheID.mData, UUID_BYTES);
 
-	if (fwrite(&num_entries, sizeof(S32), 1, fp) != 1)
-	{
-		llwarns << "Short write" << llendl;
-	}
-
-	LLVOCacheEntry *entry;
+	memcpy(buffer + 2 * sizeof(U32) + UUID_BYTES, &num_entries, sizeof(S32));
 
+	S32 index_offset = OBJECT_CACHE_HEADER_SIZE;
+	S32 data_offset = data_start;
 	for (entry = mCacheStart.getNext(); entry && (entry != &mCacheEnd); entry = entry->getNext())
 	{
-		entry->writeToFile(fp);
+		entry->writeToBuffer(buffer + index_offset, buffer + data_offset, data_offset);
+		index_offset += LLVOCacheEntry::INDEX_RECORD_SIZE;
+		data_offset += entry->getDataSize();
 	}
 
 	mCacheMap.clear();
@@ -421,7 +433,7 @@ void LLViewerRegion::saveCache()
 	mCacheStart.deleteAll();
 	mCacheStart.init();
 
-	fclose(fp);
+	LLVOCacheFile::write(getCacheFilename(), buffer, size);
 }
 
 void LLViewerRegion::sendMessage()
@@ -1383,13 +1395,26 @@ void LLViewerRegion::unpackRegionHandshake()
 
 
 	// Now that we have the name, we can load the cache file
-	// off disk.
-	loadCache();
+	// off disk.  It may still be reading, then the reply goes out
+	// from updateHandshakeReply() once it's done.
+	mHandshakeHost = msg->getSender();
+	mHandshakeReplyPending = TRUE;
+	updateHandshakeReply();
+}
+
+void LLViewerRegion::updateHandshakeReply()
+{
+	if (!mHandshakeReplyPending || !loadCache())
+	{
+		return;
+	}
+	mHandshakeReplyPending = FALSE;
 
 	// After loading cache, signal that simulator can start
 	// sending data.
 	// TODO: Send all upstream viewer->sim handshake info here.
-	LLHost host = msg->getSender();
+	LLMessageSystem *msg = gMessageSystem;
+	LLHost host = mHandshakeHost;
 	msg->newMessage("RegionHandshakeReply");
 	msg->nextBlock("AgentData");
 	msg->addUUID("AgentID", gAgent.getID());
@@ -94,9 +94,14 @@ public:
 				   const F32 region_width_meters);
 	~LLViewerRegion();
 
-	// Call this after you have the region name and handle.
-	void loadCache();
+	// Call this after you have the region name and handle.  Returns
+	// FALSE, without blocking, while the cache file is still being read.
+	BOOL loadCache();
 
+	// Sends the handshake reply once the cache is loaded
+	void updateHandshakeReply();
+
+	// Hands the cache file to the LFS thread
 	void saveCache();
 
 	void sendMessage(); // Send the current message to this region's simulator
@@ -294,6 +299,7 @@ protected:
 	void disconnectAllNeighbors();
 	void initStats();
 	void setFlags(BOOL b, U32 flags);
+	std::string getCacheFilename() const;
 
 public:
 	LLWind  mWind;
@@ -388,6 +394,14 @@ private:
 	// Cache ID is unique per-region, across renames, moving locations,
 	// etc.
 	LLUUID mCacheID;
+
+	// Cache file being read in the background, until loadCache()
+	LLPointer<LLVOCacheFile>				mCacheFile;
+
+	// The simulator starts sending objects once it has the handshake
+	// reply, so it waits for the cache
+	BOOL									mHandshakeReplyPending;
+	LLHost									mHandshakeHost;
 	
 	typedef std::map<std::string, std::string> CapabilityMap;
 	CapabilityMap mCapabilities;
@@ -236,6 +236,7 @@ void LLViewerStats::resetStats()
 	LLViewerStats::getInstance()->mPacketsLostStat.reset();
 	LLViewerStats::getInstance()->mPacketsOutStat.reset();
 	LLViewerStats::getInstance()->mFPSStat.reset();
+	LLViewerStats::getInstance()->mSettingsLookupStat.reset();
 	LLViewerStats::getInstance()->mTexturePacketsStat.reset();
 }
 
@@ -561,6 +562,11 @@ void update_statistics(U32 frame_count)
 	}
 
 	LLViewerStats::getInstance()->mFPSStat.addValue(1);
+	// Subtract what we sampled rather than zeroing, so lookups made by
+	// other threads in the meantime are counted next time.
+	U32 settings_lookups = LLControlGroup::sLookupCount;
+	LLControlGroup::sLookupCount -= settings_lookups;
+	LLViewerStats::getInstance()->mSettingsLookupStat.addValue((F32)settings_lookups);
 	F32 layer_bits = (F32)(gVLManager.getLandBits() + gVLManager.getWindBits() + gVLManager.getCloudBits());
 	LLViewerStats::getInstance()->mLayersKBitStat.addValue(layer_bits/1024.f);
 	LLViewerStats::getInstance()->mObjectKBitStat.addValue(gObjectBits/1024.f);
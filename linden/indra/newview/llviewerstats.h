@@ -51,6 +51,7 @@ public:
 	LLStat mObjectsComparedStat;
 	LLStat mObjectsOccludedStat;
 	LLStat mFPSStat;
+	LLStat mSettingsLookupStat;	// Settings looked up by name per frame
 	LLStat mPacketsInStat;
 	LLStat mPacketsLostStat;
 	LLStat mPacketsOutStat;
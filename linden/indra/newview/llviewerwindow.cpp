@@ -297,7 +297,8 @@ public:
 		U32 ypos = 64;
 		const U32 y_inc = 20;
 
-		if (gSavedSettings.getBOOL("DebugShowTime"))
+		static LLCachedControl<bool> debug_show_time(gSavedSettings, "DebugShowTime");
+		if (debug_show_time)
 		{
 			const U32 y_inc2 = 15;
 			for (std::map<S32,LLFrameTimer>::reverse_iterator iter = gDebugTimers.rbegin();
@@ -403,7 +404,8 @@ public:
 			ypos += y_inc;
 		}*/
 		
-		if (gSavedSettings.getBOOL("DebugShowRenderInfo"))
+		static LLCachedControl<bool> debug_show_render_info(gSavedSettings, "DebugShowRenderInfo");
+		if (debug_show_render_info)
 		{
 			if (gPipeline.getUseVertexShaders() == 0)
 			{
@@ -471,7 +473,8 @@ public:
 				LLVertexBuffer::sSetCount = LLImageGL::sUniqueCount = 
 				gPipeline.mNumVisibleNodes = LLPipeline::sVisibleLightCount = 0;
 		}
-		if (gSavedSettings.getBOOL("DebugShowRenderMatrices"))
+		static LLCachedControl<bool> debug_show_render_matrices(gSavedSettings, "DebugShowRenderMatrices");
+		if (debug_show_render_matrices)
 		{
 			addText(xpos, ypos, llformat("%.4f    .%4f    %.4f    %.4f", gGLProjection[12], gGLProjection[13], gGLProjection[14], gGLProjection[15]));
 			ypos += y_inc;
@@ -504,7 +507,8 @@ public:
 			addText(xpos, ypos, "View Matrix");
 			ypos += y_inc;
 		}
-		if (gSavedSettings.getBOOL("DebugShowColor"))
+		static LLCachedControl<bool> debug_show_color(gSavedSettings, "DebugShowColor");
+		if (debug_show_color)
 		{
 			U8 color[4];
 			LLCoordGL coord = gViewerWindow->getCurrentMouse();
@@ -513,7 +517,8 @@ public:
 			ypos += y_inc;
 		}
 		// only display these messages if we are actually rendering beacons at this moment
-		if (LLPipeline::getRenderBeacons(NULL) && gSavedSettings.getBOOL("BeaconsEnabled"))
+		static LLCachedControl<bool> beacons_enabled(gSavedSettings, "BeaconsEnabled");
+		if (LLPipeline::getRenderBeacons(NULL) && beacons_enabled)
 		{
 			if (LLPipeline::getRenderParticleBeacons(NULL))
 			{
@@ -2035,7 +2040,8 @@ void LLViewerWindow::draw()
 	//S32 screen_x, screen_y;
 
 	// HACK for timecode debugging
-	if (gSavedSettings.getBOOL("DisplayTimecode"))
+	static LLCachedControl<bool> display_timecode(gSavedSettings, "DisplayTimecode");
+	if (display_timecode)
 	{
 		// draw timecode block
 		std::string text;
@@ -2496,7 +2502,8 @@ BOOL LLViewerWindow::handlePerFrameHover()
 
 	LLVector2 mouse_vel; 
 
-	if (gSavedSettings.getBOOL("MouseSmooth"))
+	static LLCachedControl<bool> mouse_smooth(gSavedSettings, "MouseSmooth");
+	if (mouse_smooth)
 	{
 		static F32 fdx = 0.f;
 		static F32 fdy = 0.f;
@@ -2704,7 +2711,8 @@ BOOL LLViewerWindow::handlePerFrameHover()
 		}
 	}		
 	
-	if (tool && tool != gToolNull  && tool != LLToolCompInspect::getInstance() && tool != LLToolDragAndDrop::getInstance() && !gSavedSettings.getBOOL("FreezeTime"))
+	static LLCachedControl<bool> freeze_time(gSavedSettings, "FreezeTime");
+	if (tool && tool != gToolNull  && tool != LLToolCompInspect::getInstance() && tool != LLToolDragAndDrop::getInstance() && !freeze_time)
 	{ 
 		LLMouseHandler *captor = gFocusMgr.getMouseCapture();
 		// With the null, inspect, or drag and drop tool, don't muck
@@ -2845,7 +2853,8 @@ BOOL LLViewerWindow::handlePerFrameHover()
 		gFloaterView->syncFloaterTabOrder();
 	}
 
-	if (gSavedSettings.getBOOL("ChatBarStealsFocus") 
+	static LLCachedControl<bool> chat_bar_steals_focus(gSavedSettings, "ChatBarStealsFocus");
+	if (chat_bar_steals_focus 
 		&& gChatBar 
 		&& gFocusMgr.getKeyboardFocus() == NULL 
 		&& gChatBar->isInVisibleChain())
@@ -2886,13 +2895,15 @@ BOOL LLViewerWindow::handlePerFrameHover()
 
 	BOOL do_pick = FALSE;
 
-	F32 picks_moving = gSavedSettings.getF32("PicksPerSecondMouseMoving");
+	static LLCachedControl<F32> picks_per_second_mouse_moving(gSavedSettings, "PicksPerSecondMouseMoving");
+	F32 picks_moving = picks_per_second_mouse_moving;
 	if ((mouse_moved_since_pick) && (picks_moving > 0.0) && (mPickTimer.getElapsedTimeF32() > 1.0f / picks_moving))
 	{
 		do_pick = TRUE;
 	}
 
-	F32 picks_stationary = gSavedSettings.getF32("PicksPerSecondMouseStationary");
+	static LLCachedControl<F32> picks_per_second_mouse_stationary(gSavedSettings, "PicksPerSecondMouseStationary");
+	F32 picks_stationary = picks_per_second_mouse_stationary;
 	if ((!mouse_moved_since_pick) && (picks_stationary > 0.0) && (mPickTimer.getElapsedTimeF32() > 1.0f / picks_stationary))
 	{
 		do_pick = TRUE;
@@ -3076,7 +3087,8 @@ void LLViewerWindow::renderSelections( BOOL for_gl_pick, BOOL pick_parcel_walls,
 					BOOL moveable_object_selected = FALSE;
 					BOOL all_selected_objects_move = TRUE;
 					BOOL all_selected_objects_modify = TRUE;
-					BOOL selecting_linked_set = !gSavedSettings.getBOOL("EditLinkedParts");
+					static LLCachedControl<bool> edit_linked_parts(gSavedSettings, "EditLinkedParts");
+					BOOL selecting_linked_set = !edit_linked_parts;
 
 					for (LLObjectSelection::iterator iter = LLSelectMgr::getInstance()->getSelection()->begin();
 						 iter != LLSelectMgr::getInstance()->getSelection()->end(); iter++)
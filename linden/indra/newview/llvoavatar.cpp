@@ -3457,13 +3457,20 @@ void LLVOAvatar::idleUpdateNameTag(const LLVector3& root_pos_last)
 	}
 
 	const F32 time_visible = mTimeVisible.getElapsedTimeF32();
-	const F32 NAME_SHOW_TIME = gSavedSettings.getF32("RenderNameShowTime");	// seconds
-	const F32 FADE_DURATION = gSavedSettings.getF32("RenderNameFadeDuration"); // seconds
+	static LLCachedControl<F32> render_name_show_time(gSavedSettings, "RenderNameShowTime");
+	static LLCachedControl<F32> render_name_fade_duration(gSavedSettings, "RenderNameFadeDuration");
+	static LLCachedControl<bool> use_chat_bubbles(gSavedSettings, "UseChatBubbles");
+	static LLCachedControl<bool> render_name_hide_self(gSavedSettings, "RenderNameHideSelf");
+	static LLCachedControl<bool> show_client_color(gSavedSettings, "ShowClientColor");
+	static LLCachedControl<bool> show_client_name_tag(gSavedSettings, "ShowClientNameTag");
+	static LLCachedControl<bool> small_avatar_names(gSavedSettings, "SmallAvatarNames");
+	const F32 NAME_SHOW_TIME = render_name_show_time;	// seconds
+	const F32 FADE_DURATION = render_name_fade_duration; // seconds
 // [RLVa:KB] - Checked: 2009-07-08 (RLVa-1.0.0e) | Added: RLVa-0.2.0b
 	bool fRlvShowNames = gRlvHandler.hasBehaviour(RLV_BHVR_SHOWNAMES);
 // [/RLVa:KB]
 	BOOL visible_avatar = isVisible() || mNeedsAnimUpdate;
-	BOOL visible_chat = gSavedSettings.getBOOL("UseChatBubbles") && (mChats.size() || mTyping);
+	BOOL visible_chat = use_chat_bubbles && (mChats.size() || mTyping);
 	BOOL render_name =	visible_chat ||
 						(visible_avatar &&
 // [RLVa:KB] - Checked: 2009-08-11 (RLVa-1.0.1h) | Added: RLVa-1.0.0h
@@ -3477,7 +3484,7 @@ void LLVOAvatar::idleUpdateNameTag(const LLVector3& root_pos_last)
 	{
 		render_name = render_name
 						&& !gAgent.cameraMouselook()
-						&& (visible_chat || !gSavedSettings.getBOOL("RenderNameHideSelf"));
+						&& (visible_chat || !render_name_hide_self);
 	}
 
 	if ( render_name )
@@ -3560,11 +3567,11 @@ void LLVOAvatar::idleUpdateNameTag(const LLVector3& root_pos_last)
 					// Set your own name to the Imprudence color -- MC
 					client_color = LLColor4(0.79f,0.44f,0.88f);
 				}
-				if (gSavedSettings.getBOOL("ShowClientColor"))
+				if (show_client_color)
 				{
 					avatar_name_color = client_color;
 				}
-				if (!gSavedSettings.getBOOL("ShowClientNameTag"))
+				if (!show_client_name_tag)
 				{
 					client.clear();
 				}
@@ -3657,7 +3664,7 @@ void LLVOAvatar::idleUpdateNameTag(const LLVector3& root_pos_last)
 
 				BOOL need_comma = FALSE;
 
-				bool show_client = client.length() != 0 && gSavedSettings.getBOOL("ShowClientNameTag");
+				bool show_client = client.length() != 0 && show_client_name_tag;
 				if (is_away || is_muted || is_busy || show_client)
 				{
 					line += " (";
@@ -3788,7 +3795,7 @@ void LLVOAvatar::idleUpdateNameTag(const LLVector3& root_pos_last)
 			}
 			else
 			{
-				if (gSavedSettings.getBOOL("SmallAvatarNames"))
+				if (small_avatar_names)
 				{
 					mNameText->setFont(LLFontGL::getFontSansSerif());
 				}
@@ -3826,11 +3833,13 @@ void LLVOAvatar::idleUpdateTractorBeam()
 		return;
 	}
 
+	static LLCachedControl<bool> particle_chat(gSavedSettings, "ParticleChat");
+
 	// This is only done for yourself (maybe it should be in the agent?)
 	if (!needsRenderBeam() || !mIsBuilt)
 	{
 		mBeam = NULL;
-		if(gSavedSettings.getBOOL("ParticleChat"))
+		if(particle_chat)
 		{
 			if(sPartsNow != FALSE)
 			{
@@ -3869,7 +3878,7 @@ void LLVOAvatar::idleUpdateTractorBeam()
 			// get point from pointat effect
 			mBeam->setPositionGlobal(gAgent.mPointAt->getPointAtPosGlobal());
 
-			if(gSavedSettings.getBOOL("ParticleChat"))
+			if(particle_chat)
 			{
 				if(sPartsNow != TRUE)
 				{
@@ -4411,7 +4420,8 @@ BOOL LLVOAvatar::updateCharacter(LLAgent &agent)
 	const LLUUID AGENT_FOOTSTEP_ANIMS[] = {ANIM_AGENT_WALK, ANIM_AGENT_RUN, ANIM_AGENT_LAND};
 	const S32 NUM_AGENT_FOOTSTEP_ANIMS = LL_ARRAY_SIZE(AGENT_FOOTSTEP_ANIMS);
 
-	if ( gAudiop && !gSavedSettings.getBOOL("MuteAmbient") && isAnyAnimationSignaled(AGENT_FOOTSTEP_ANIMS, NUM_AGENT_FOOTSTEP_ANIMS) )
+	static LLCachedControl<bool> mute_ambient(gSavedSettings, "MuteAmbient");
+	if ( gAudiop && !mute_ambient && isAnyAnimationSignaled(AGENT_FOOTSTEP_ANIMS, NUM_AGENT_FOOTSTEP_ANIMS) )
 	{
 		BOOL playSound = FALSE;
 		LLVector3 foot_pos_agent;
@@ -7332,7 +7342,8 @@ BOOL LLVOAvatar::updateIsFullyLoaded()
 
 BOOL LLVOAvatar::isFullyLoaded()
 {
-	if (gSavedSettings.getBOOL("RenderUnloadedAvatar"))
+	static LLCachedControl<bool> render_unloaded_avatar(gSavedSettings, "RenderUnloadedAvatar");
+	if (render_unloaded_avatar)
 		return TRUE;
 	else
 		return mFullyLoaded;
@@ -36,6 +36,164 @@
 
 #include "llerror.h"
 
+// Index records, in file order
+struct LLVOCacheIndexRecord
+{
+	U32 mLocalID;
+	U32 mCRC;
+	S32 mHitCount;
+	S32 mDupeCount;
+	S32 mCRCChangeCount;
+	S32 mOffset;		// from the start of the file
+	S32 mSize;
+};
+
+// Biggest object update we believe, anything else is corruption
+const S32 MAX_CACHE_ENTRY_SIZE = 10000;
+
+//---------------------------------------------------------------------------
+// LLVOCacheFile
+//---------------------------------------------------------------------------
+
+LLLFSThread* LLVOCacheFile::sThread = NULL;
+
+//static
+void LLVOCacheFile::initClass(bool threaded)
+{
+	llassert(sThread == NULL);
+	sThread = new LLLFSThread(threaded);
+}
+
+//static
+S32 LLVOCacheFile::updateClass(U32 ms_elapsed)
+{
+	if (!sThread)
+	{
+		return 0;
+	}
+	sThread->update(ms_elapsed);
+	return sThread->getPending();
+}
+
+//static
+void LLVOCacheFile::cleanupClass()
+{
+	if (!sThread)
+	{
+		return;
+	}
+	// Let the writes finish
+	while (sThread->getPending())
+	{
+		sThread->update(0);
+	}
+	sThread->shutdown();
+	delete sThread;
+	sThread = NULL;
+}
+
+LLVOCacheFile::LLVOCacheFile()
+:	mData(NULL),
+	mSize(0),
+	mBytesRead(0),
+	mDone(TRUE),
+	mHandle(LLLFSThread::nullHandle())
+{
+}
+
+void LLVOCacheFile::startRead(const std::string& filename)
+{
+	llassert(mData == NULL);
+	// might not have a file, which is normal
+	mSize = LLAPRFile::size(filename);
+	if (mSize > 0)
+	{
+		mData = new U8[mSize];
+		if (sThread)
+		{
+			mDone = FALSE;
+			mHandle = sThread->read(filename, mData, 0, mSize, this);
+		}
+		else
+		{
+			mBytesRead = LLAPRFile::readEx(filename, mData, 0, mSize);
+		}
+	}
+}
+
+LLVOCacheFile::~LLVOCacheFile()
+{
+	delete [] mData;
+}
+
+// virtual, called from the cache thread
+void LLVOCacheFile::completed(S32 bytes)
+{
+	mBytesRead = bytes;
+	mDone = TRUE;
+}
+
+namespace
+{
+	class LLVOCacheWriteResponder : public LLLFSThread::Responder
+	{
+	public:
+		LLVOCacheWriteResponder(const std::string& filename, U8* buffer, S32 size)
+		:	mFilename(filename),
+			mBuffer(buffer),
+			mSize(size)
+		{
+		}
+
+		~LLVOCacheWriteResponder()
+		{
+			delete [] mBuffer;
+		}
+
+		// called from the cache thread
+		/*virtual*/ void completed(S32 bytes)
+		{
+			std::string temp_filename = mFilename + ".tmp";
+			BOOL ok = (bytes == mSize);
+			if (ok)
+			{
+				LLFile::remove(mFilename);
+				ok = LLFile::rename(temp_filename, mFilename) == 0;
+			}
+			if (!ok)
+			{
+				llwarns << "Unable to write cache file " << mFilename << llendl;
+				LLFile::remove(temp_filename);
+			}
+		}
+
+	private:
+		std::string mFilename;
+		U8* mBuffer;
+		S32 mSize;
+	};
+}
+
+// static
+void LLVOCacheFile::write(const std::string& filename, U8* buffer, S32 size)
+{
+	LLPointer<LLVOCacheWriteResponder> responder = new LLVOCacheWriteResponder(filename, buffer, size);
+	std::string temp_filename = filename + ".tmp";
+	// The write doesn't truncate, so a bigger leftover would keep its tail
+	LLFile::remove(temp_filename);
+	if (sThread)
+	{
+		// Same priority class as the reads, so a region that comes back
+		// before its cache file is written reads the new one
+		U32 priority = LLQueuedThread::PRIORITY_NORMAL | sThread->priorityCounter();
+		sThread->write(temp_filename, buffer, 0, size, responder, priority);
+	}
+	else
+	{
+		responder->completed(LLAPRFile::writeEx(temp_filename, buffer, 0, size));
+	}
+}
+
 //---------------------------------------------------------------------------
 // LLVOCacheEntry
 //---------------------------------------------------------------------------
@@ -50,6 +208,8 @@ LLVOCacheEntry::LLVOCacheEntry(U32 local_id, U32 crc, LLDataPackerBinaryBuffer &
 	mBuffer = new U8[dp.getBufferSize()];
 	mDP.assignBuffer(mBuffer, dp.getBufferSize());
 	mDP = dp;
+	mFileOffset = 0;
+	mFileSize = 0;
 }
 
 LLVOCacheEntry::LLVOCacheEntry()
@@ -61,45 +221,39 @@ LLVOCacheEntry::LLVOCacheEntry()
 	mCRCChangeCount = 0;
 	mBuffer = NULL;
 	mDP.assignBuffer(mBuffer, 0);
+	mFileOffset = 0;
+	mFileSize = 0;
 }
 
-
-static inline void checkedRead(LLFILE *fp, void *data, size_t nbytes)
-{
-	if (fread(data, 1, nbytes, fp) != nbytes)
-	{
-		llwarns << "Short read" << llendl;
-		memset(data, 0, nbytes);
-	}
-}
-
-LLVOCacheEntry::LLVOCacheEntry(LLFILE *fp)
+LLVOCacheEntry::LLVOCacheEntry(LLVOCacheFile* file, S32 index_offset, S32 data_start)
 {
-	S32 size;
-	checkedRead(fp, &mLocalID, sizeof(U32));
-	checkedRead(fp, &mCRC, sizeof(U32));
-	checkedRead(fp, &mHitCount, sizeof(S32));
-	checkedRead(fp, &mDupeCount, sizeof(S32));
-	checkedRead(fp, &mCRCChangeCount, sizeof(S32));
-
-	checkedRead(fp, &size, sizeof(S32));
+	LLVOCacheIndexRecord record;
+	memcpy(&record, file->getData() + index_offset, sizeof(record));
+	mLocalID = record.mLocalID;
+	mCRC = record.mCRC;
+	mHitCount = record.mHitCount;
+	mDupeCount = record.mDupeCount;
+	mCRCChangeCount = record.mCRCChangeCount;
+	mBuffer = NULL;
+	mDP.assignBuffer(mBuffer, 0);
+	mFileOffset = 0;
+	mFileSize = 0;
 
 	// Corruption in the cache entries
-	if ((size > 10000) || (size < 1))
+	if ((record.mSize > MAX_CACHE_ENTRY_SIZE) || (record.mSize < 1)
+		|| (record.mOffset < data_start)
+		|| (record.mOffset > file->getSize() - record.mSize))
 	{
-		// We've got a bogus size, skip reading it.
-		// We won't bother seeking, because the rest of this file
-		// is likely bogus, and will be tossed anyway.
-		llwarns << "Bogus cache entry, size " << size << ", aborting!" << llendl;
+		llwarns << "Bogus cache entry, size " << record.mSize
+			<< " offset " << record.mOffset << llendl;
 		mLocalID = 0;
 		mCRC = 0;
-		mBuffer = NULL;
 		return;
 	}
 
-	mBuffer = new U8[size];
-	checkedRead(fp, mBuffer, size);
-	mDP.assignBuffer(mBuffer, size);
+	mFile = file;
+	mFileOffset = record.mOffset;
+	mFileSize = record.mSize;
 }
 
 LLVOCacheEntry::~LLVOCacheEntry()
@@ -107,10 +261,23 @@ LLVOCacheEntry::~LLVOCacheEntry()
 	delete [] mBuffer;
 }
 
+// Copies the data out of the cache file the first time it is needed
+void LLVOCacheEntry::decode()
+{
+	if (mFile.notNull())
+	{
+		mBuffer = new U8[mFileSize];
+		memcpy(mBuffer, mFile->getData() + mFileOffset, mFileSize);
+		mDP.assignBuffer(mBuffer, mFileSize);
+		mFile = NULL;
+	}
+}
+
 
 // New CRC means the object has changed.
 void LLVOCacheEntry::assignCRC(U32 crc, LLDataPackerBinaryBuffer &dp)
 {
+	decode();
 	if (  (mCRC != crc)
 		||(mDP.getBufferSize() == 0))
 	{
@@ -127,6 +294,10 @@ void LLVOCacheEntry::assignCRC(U32 crc, LLDataPackerBinaryBuffer &dp)
 
 LLDataPackerBinaryBuffer *LLVOCacheEntry::getDP(U32 crc)
 {
+	if (mCRC == crc)
+	{
+		decode();
+	}
 	if (  (mCRC != crc)
 		||(mDP.getBufferSize() == 0))
 	{
@@ -154,22 +325,26 @@ void LLVOCacheEntry::dump() const
 		<< llendl;
 }
 
-static inline void checkedWrite(LLFILE *fp, const void *data, size_t nbytes)
+S32 LLVOCacheEntry::getDataSize() const
 {
-	if (fwrite(data, 1, nbytes, fp) != nbytes)
-	{
-		llwarns << "Short write" << llendl;
-	}
+	return mFile.notNull() ? mFileSize : mDP.getBufferSize();
 }
 
-void LLVOCacheEntry::writeToFile(LLFILE *fp) const
+void LLVOCacheEntry::writeToBuffer(U8* record, U8* dest, S32 data_offset) const
 {
-	checkedWrite(fp, &mLocalID, sizeof(U32));
-	checkedWrite(fp, &mCRC, sizeof(U32));
-	checkedWrite(fp, &mHitCount, sizeof(S32));
-	checkedWrite(fp, &mDupeCount, sizeof(S32));
-	checkedWrite(fp, &mCRCChangeCount, sizeof(S32));
-	S32 size = mDP.getBufferSize();
-	checkedWrite(fp, &size, sizeof(S32));
-	checkedWrite(fp, mBuffer, size);
+	LLVOCacheIndexRecord index;
+	index.mLocalID = mLocalID;
+	index.mCRC = mCRC;
+	index.mHitCount = mHitCount;
+	index.mDupeCount = mDupeCount;
+	index.mCRCChangeCount = mCRCChangeCount;
+	index.mOffset = data_offset;
+	index.mSize = getDataSize();
+	memcpy(record, &index, sizeof(index));
+
+	const U8* data = mFile.notNull() ? mFile->getData() + mFileOffset : mBuffer;
+	if (index.mSize)
+	{
+		memcpy(dest, data, index.mSize);
+	}
 }
@@ -36,8 +36,60 @@
 #include "lluuid.h"
 #include "lldatapacker.h"
 #include "lldlinked.h"
+#include "lllfsthread.h"
+#include "llmemory.h"
 
 
+//---------------------------------------------------------------------------
+// Cache files
+//
+// An object cache file (objects_X_Y.slc) is a header, an index with one
+// fixed size record per entry, then the packed update data of every
+// entry.  The whole file is read through LLLFSThread as soon as the
+// region is created, and entries only copy their data out of it when they
+// are hit, so loading a region with thousands of cached objects parses a
+// small table instead of decoding each object.  The reads and writes go
+// through their own LLLFSThread, which runs threaded even though the
+// shared one doesn't, so the file I/O stays off the main thread.
+class LLVOCacheFile : public LLLFSThread::Responder
+{
+protected:
+	~LLVOCacheFile();
+public:
+	LLVOCacheFile();
+
+	static void initClass(bool threaded);
+	static S32 updateClass(U32 ms_elapsed);	// Returns the number pending
+	static void cleanupClass();
+
+	// Starts reading filename, if there is one.  The caller must already
+	// hold an LLPointer to this, the request only holds a second one.
+	void startRead(const std::string& filename);
+
+	// TRUE once the read is done, or if there was nothing to read
+	BOOL isDone()					{ return mDone; }
+	// Once done, FALSE if there is no file or it was short
+	BOOL hasData() const			{ return mBytesRead > 0 && mBytesRead == mSize; }
+	const U8* getData() const		{ return mData; }
+	S32 getSize() const				{ return mBytesRead; }
+
+	/*virtual*/ void completed(S32 bytes);
+
+	// Takes buffer and writes it to filename through LLLFSThread.  It goes
+	// to a temporary file first, renamed once it is complete, so a crash
+	// or a short write leaves the previous cache file in place.
+	static void write(const std::string& filename, U8* buffer, S32 size);
+
+protected:
+	U8*						mData;
+	S32						mSize;
+	S32						mBytesRead;
+	LLAtomicS32				mDone;
+	LLLFSThread::handle_t	mHandle;
+
+	static LLLFSThread*		sThread;
+};
+
 //---------------------------------------------------------------------------
 // Cache entries
 class LLVOCacheEntry;
@@ -46,7 +98,10 @@ class LLVOCacheEntry : public LLDLinked<LLVOCacheEntry>
 {
 public:
 	LLVOCacheEntry(U32 local_id, U32 crc, LLDataPackerBinaryBuffer &dp);
-	LLVOCacheEntry(LLFILE *fp);
+	// Reads the index record at index_offset in file. Its data, which
+	// must lie past data_start, stays in file until the entry is hit.
+	// Local id is 0 if the record is bad.
+	LLVOCacheEntry(LLVOCacheFile* file, S32 index_offset, S32 data_start);
 	LLVOCacheEntry();
 	~LLVOCacheEntry();
 
@@ -56,12 +111,20 @@ public:
 	S32 getCRCChangeCount() const	{ return mCRCChangeCount; }
 
 	void dump() const;
-	void writeToFile(LLFILE *fp) const;
+	S32 getDataSize() const;
+	// Fills in the index record for this entry, whose data goes at
+	// data_offset, and copies the data to dest.
+	void writeToBuffer(U8* record, U8* dest, S32 data_offset) const;
 	void assignCRC(U32 crc, LLDataPackerBinaryBuffer &dp);
 	LLDataPackerBinaryBuffer *getDP(U32 crc);
 	void recordHit();
 	void recordDupe() { mDupeCount++; }
 
+	enum { INDEX_RECORD_SIZE = 28 };
+
+protected:
+	void decode();
+
 protected:
 	U32							mLocalID;
 	U32							mCRC;
@@ -70,6 +133,11 @@ protected:
 	S32							mCRCChangeCount;
 	LLDataPackerBinaryBuffer	mDP;
 	U8							*mBuffer;
+
+	// Not decoded yet, the data is still in the cache file
+	LLPointer<LLVOCacheFile>	mFile;
+	S32							mFileOffset;
+	S32							mFileSize;
 };
 
 #endif
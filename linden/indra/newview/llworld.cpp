@@ -640,6 +640,14 @@ void LLWorld::updateRegions(F32 max_update_time)
 {
 	LLTimer update_timer;
 	BOOL did_one = FALSE;
+
+	// Regions waiting on their cache file, outside the time slicing
+	// below so none of them wait on the others
+	for (region_list_t::iterator iter = mRegionList.begin();
+		 iter != mRegionList.end(); ++iter)
+	{
+		(*iter)->updateHandshakeReply();
+	}
 	
 	// Perform idle time updates for the regions (and associated surfaces)
 	for (region_list_t::iterator iter = mRegionList.begin();
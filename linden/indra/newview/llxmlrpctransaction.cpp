@@ -223,7 +223,7 @@ void LLXMLRPCTransaction::Impl::init(XMLRPC_REQUEST request, bool useGzip)
 {
 	if (!mCurlRequest)
 	{
-		mCurlRequest = new LLCurlEasyRequest();
+		mCurlRequest = new LLCurlEasyRequest(mURI);
 	}
 	
 	if (gSavedSettings.getBOOL("BrowserProxyEnabled"))
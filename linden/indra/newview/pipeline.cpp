@@ -1015,7 +1015,8 @@ U32 LLPipeline::addObject(LLViewerObject *vobj)
 		return 0;
 	}
 
-	if (gSavedSettings.getBOOL("RenderDelayCreation"))
+	static LLCachedControl<bool> render_delay_creation(gSavedSettings, "RenderDelayCreation");
+	if (render_delay_creation)
 	{
 		mCreateQ.push_back(vobj);
 	}
@@ -1078,7 +1079,8 @@ void LLPipeline::createObject(LLViewerObject* vobj)
 
 	markRebuild(drawablep, LLDrawable::REBUILD_ALL, TRUE);
 
-	if (drawablep->getVOVolume() && gSavedSettings.getBOOL("RenderAnimateRes"))
+	static LLCachedControl<bool> render_animate_res(gSavedSettings, "RenderAnimateRes");
+	if (drawablep->getVOVolume() && render_animate_res)
 	{
 		// fun animated res
 		drawablep->updateXform(TRUE);
@@ -1117,7 +1119,8 @@ void LLPipeline::resetFrameStats()
 //external functions for asynchronous updating
 void LLPipeline::updateMoveDampedAsync(LLDrawable* drawablep)
 {
-	if (gSavedSettings.getBOOL("FreezeTime"))
+	static LLCachedControl<bool> freeze_time(gSavedSettings, "FreezeTime");
+	if (freeze_time)
 	{
 		return;
 	}
@@ -1147,7 +1150,8 @@ void LLPipeline::updateMoveDampedAsync(LLDrawable* drawablep)
 
 void LLPipeline::updateMoveNormalAsync(LLDrawable* drawablep)
 {
-	if (gSavedSettings.getBOOL("FreezeTime"))
+	static LLCachedControl<bool> freeze_time(gSavedSettings, "FreezeTime");
+	if (freeze_time)
 	{
 		return;
 	}
@@ -1200,7 +1204,8 @@ void LLPipeline::updateMove()
 	LLFastTimer t(LLFastTimer::FTM_UPDATE_MOVE);
 	LLMemType mt(LLMemType::MTYPE_PIPELINE);
 
-	if (gSavedSettings.getBOOL("FreezeTime"))
+	static LLCachedControl<bool> freeze_time(gSavedSettings, "FreezeTime");
+	if (freeze_time)
 	{
 		return;
 	}
@@ -2071,7 +2076,8 @@ void renderScriptedBeacons(LLDrawable* drawablep)
 	{
 		if (gPipeline.sRenderBeacons)
 		{
-			gObjectList.addDebugBeacon(vobj->getPositionAgent(), "", LLColor4(1.f, 0.f, 0.f, 0.5f), LLColor4(1.f, 1.f, 1.f, 0.5f), gSavedSettings.getS32("DebugBeaconLineWidth"));
+			static LLCachedControl<S32> debug_beacon_line_width(gSavedSettings, "DebugBeaconLineWidth");
+			gObjectList.addDebugBeacon(vobj->getPositionAgent(), "", LLColor4(1.f, 0.f, 0.f, 0.5f), LLColor4(1.f, 1.f, 1.f, 0.5f), debug_beacon_line_width);
 		}
 
 		if (gPipeline.sRenderHighlight)
@@ -2097,7 +2103,8 @@ void renderScriptedTouchBeacons(LLDrawable* drawablep)
 	{
 		if (gPipeline.sRenderBeacons)
 		{
-			gObjectList.addDebugBeacon(vobj->getPositionAgent(), "", LLColor4(1.f, 0.f, 0.f, 0.5f), LLColor4(1.f, 1.f, 1.f, 0.5f), gSavedSettings.getS32("DebugBeaconLineWidth"));
+			static LLCachedControl<S32> debug_beacon_line_width(gSavedSettings, "DebugBeaconLineWidth");
+			gObjectList.addDebugBeacon(vobj->getPositionAgent(), "", LLColor4(1.f, 0.f, 0.f, 0.5f), LLColor4(1.f, 1.f, 1.f, 0.5f), debug_beacon_line_width);
 		}
 
 		if (gPipeline.sRenderHighlight)
@@ -2122,7 +2129,8 @@ void renderPhysicalBeacons(LLDrawable* drawablep)
 	{
 		if (gPipeline.sRenderBeacons)
 		{
-			gObjectList.addDebugBeacon(vobj->getPositionAgent(), "", LLColor4(0.f, 1.f, 0.f, 0.5f), LLColor4(1.f, 1.f, 1.f, 0.5f), gSavedSettings.getS32("DebugBeaconLineWidth"));
+			static LLCachedControl<S32> debug_beacon_line_width(gSavedSettings, "DebugBeaconLineWidth");
+			gObjectList.addDebugBeacon(vobj->getPositionAgent(), "", LLColor4(0.f, 1.f, 0.f, 0.5f), LLColor4(1.f, 1.f, 1.f, 0.5f), debug_beacon_line_width);
 		}
 
 		if (gPipeline.sRenderHighlight)
@@ -2147,7 +2155,8 @@ void renderParticleBeacons(LLDrawable* drawablep)
 		if (gPipeline.sRenderBeacons)
 		{
 			LLColor4 light_blue(0.5f, 0.5f, 1.f, 0.5f);
-			gObjectList.addDebugBeacon(vobj->getPositionAgent(), "", light_blue, LLColor4(1.f, 1.f, 1.f, 0.5f), gSavedSettings.getS32("DebugBeaconLineWidth"));
+			static LLCachedControl<S32> debug_beacon_line_width(gSavedSettings, "DebugBeaconLineWidth");
+			gObjectList.addDebugBeacon(vobj->getPositionAgent(), "", light_blue, LLColor4(1.f, 1.f, 1.f, 0.5f), debug_beacon_line_width);
 		}
 
 		if (gPipeline.sRenderHighlight)
@@ -2295,7 +2304,8 @@ void LLPipeline::postSort(LLCamera& camera)
 	}
 	
 	// only render if the flag is set. The flag is only set if we are in edit mode or the toggle is set in the menus
-	if (gSavedSettings.getBOOL("BeaconsEnabled") && !sShadowRender)
+	static LLCachedControl<bool> beacons_enabled(gSavedSettings, "BeaconsEnabled");
+	if (beacons_enabled && !sShadowRender)
 	{
 		if (sRenderScriptedTouchBeacons)
 		{
@@ -2334,7 +2344,8 @@ void LLPipeline::postSort(LLCamera& camera)
 				if (gPipeline.sRenderBeacons)
 				{
 					//pos += LLVector3(0.f, 0.f, 0.2f);
-					gObjectList.addDebugBeacon(pos, "", LLColor4(1.f, 1.f, 0.f, 0.5f), LLColor4(1.f, 1.f, 1.f, 0.5f), gSavedSettings.getS32("DebugBeaconLineWidth"));
+					static LLCachedControl<S32> debug_beacon_line_width(gSavedSettings, "DebugBeaconLineWidth");
+					gObjectList.addDebugBeacon(pos, "", LLColor4(1.f, 1.f, 0.f, 0.5f), LLColor4(1.f, 1.f, 1.f, 0.5f), debug_beacon_line_width);
 				}
 			}
 			// now deal with highlights for all those seeable sound sources
@@ -4887,7 +4898,8 @@ void LLPipeline::resetVertexBuffers()
 
 	LLVertexBuffer::unbind();
 
-	LLPipeline::sTextureBindTest = gSavedSettings.getBOOL("RenderDebugTextureBind");
+	static LLCachedControl<bool> render_debug_texture_bind(gSavedSettings, "RenderDebugTextureBind");
+	LLPipeline::sTextureBindTest = render_debug_texture_bind;
 }
 
 void LLPipeline::renderObjects(U32 type, U32 mask, BOOL texture)
@@ -4997,7 +5009,8 @@ void LLPipeline::renderBloom(BOOL for_snapshot, F32 zoom_factor, int subfield)
 		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 	}
 
-	U32 res_mod = gSavedSettings.getU32("RenderResolutionDivisor");
+	static LLCachedControl<U32> render_resolution_divisor(gSavedSettings, "RenderResolutionDivisor");
+	U32 res_mod = render_resolution_divisor;
 
 	LLVector2 tc1(0,0);
 	LLVector2 tc2((F32) gViewerWindow->getWindowDisplayWidth()*2,
@@ -5091,11 +5104,16 @@ void LLPipeline::renderBloom(BOOL for_snapshot, F32 zoom_factor, int subfield)
 		}
 		
 		gGlowExtractProgram.bind();
-		F32 minLum = llmax(gSavedSettings.getF32("RenderGlowMinLuminance"), 0.0f);
-		F32 maxAlpha = gSavedSettings.getF32("RenderGlowMaxExtractAlpha");		
-		F32 warmthAmount = gSavedSettings.getF32("RenderGlowWarmthAmount");	
-		LLVector3 lumWeights = gSavedSettings.getVector3("RenderGlowLumWeights");
-		LLVector3 warmthWeights = gSavedSettings.getVector3("RenderGlowWarmthWeights");
+		static LLCachedControl<F32> render_glow_min_luminance(gSavedSettings, "RenderGlowMinLuminance");
+		F32 minLum = llmax((F32)render_glow_min_luminance, 0.0f);
+		static LLCachedControl<F32> render_glow_max_extract_alpha(gSavedSettings, "RenderGlowMaxExtractAlpha");
+		F32 maxAlpha = render_glow_max_extract_alpha;		
+		static LLCachedControl<F32> render_glow_warmth_amount(gSavedSettings, "RenderGlowWarmthAmount");
+		F32 warmthAmount = render_glow_warmth_amount;	
+		static LLCachedControl<LLVector3> render_glow_lum_weights(gSavedSettings, "RenderGlowLumWeights");
+		LLVector3 lumWeights = render_glow_lum_weights;
+		static LLCachedControl<LLVector3> render_glow_warmth_weights(gSavedSettings, "RenderGlowWarmthWeights");
+		LLVector3 warmthWeights = render_glow_warmth_weights;
 		gGlowExtractProgram.uniform1f("minLuminance", minLum);
 		gGlowExtractProgram.uniform1f("maxExtractAlpha", maxAlpha);
 		gGlowExtractProgram.uniform3f("lumWeights", lumWeights.mV[0], lumWeights.mV[1], lumWeights.mV[2]);
@@ -5136,19 +5154,23 @@ void LLPipeline::renderBloom(BOOL for_snapshot, F32 zoom_factor, int subfield)
 
 
 	// power of two between 1 and 1024
-	U32 glowResPow = gSavedSettings.getS32("RenderGlowResolutionPow");
+	static LLCachedControl<S32> render_glow_resolution_pow(gSavedSettings, "RenderGlowResolutionPow");
+	U32 glowResPow = render_glow_resolution_pow;
 	const U32 glow_res = llmax(1, 
 		llmin(1024, 1 << glowResPow));
 
-	S32 kernel = gSavedSettings.getS32("RenderGlowIterations")*2;
-	F32 delta = gSavedSettings.getF32("RenderGlowWidth") / glow_res;
+	static LLCachedControl<S32> render_glow_iterations(gSavedSettings, "RenderGlowIterations");
+	S32 kernel = render_glow_iterations*2;
+	static LLCachedControl<F32> render_glow_width(gSavedSettings, "RenderGlowWidth");
+	F32 delta = render_glow_width / glow_res;
 	// Use half the glow width if we have the res set to less than 9 so that it looks
 	// almost the same in either case.
 	if (glowResPow < 9)
 	{
 		delta *= 0.5f;
 	}
-	F32 strength = gSavedSettings.getF32("RenderGlowStrength");
+	static LLCachedControl<F32> render_glow_strength(gSavedSettings, "RenderGlowStrength");
+	F32 strength = render_glow_strength;
 
 	gGlowProgram.bind();
 	gGlowProgram.uniform1f("glowStrength", strength);
@@ -5392,18 +5414,25 @@ void LLPipeline::bindDeferredShader(LLGLSLShader& shader, U32 light_index)
 	}
 
 	shader.uniform4fv("shadow_clip", 1, mSunClipPlanes.mV);
-	shader.uniform1f("sun_wash", gSavedSettings.getF32("RenderDeferredSunWash"));
-	shader.uniform1f("shadow_noise", gSavedSettings.getF32("RenderShadowNoise"));
-	shader.uniform1f("blur_size", gSavedSettings.getF32("RenderShadowBlurSize"));
-
-	shader.uniform1f("ssao_radius", gSavedSettings.getF32("RenderSSAOScale"));
-	shader.uniform1f("ssao_max_radius", gSavedSettings.getU32("RenderSSAOMaxScale"));
-
-	F32 ssao_factor = gSavedSettings.getF32("RenderSSAOFactor");
+	static LLCachedControl<F32> render_deferred_sun_wash(gSavedSettings, "RenderDeferredSunWash");
+	shader.uniform1f("sun_wash", render_deferred_sun_wash);
+	static LLCachedControl<F32> render_shadow_noise(gSavedSettings, "RenderShadowNoise");
+	shader.uniform1f("shadow_noise", render_shadow_noise);
+	static LLCachedControl<F32> render_shadow_blur_size(gSavedSettings, "RenderShadowBlurSize");
+	shader.uniform1f("blur_size", render_shadow_blur_size);
+
+	static LLCachedControl<F32> render_ssao_scale(gSavedSettings, "RenderSSAOScale");
+	shader.uniform1f("ssao_radius", render_ssao_scale);
+	static LLCachedControl<U32> render_ssao_max_scale(gSavedSettings, "RenderSSAOMaxScale");
+	shader.uniform1f("ssao_max_radius", render_ssao_max_scale);
+
+	static LLCachedControl<F32> render_ssao_factor(gSavedSettings, "RenderSSAOFactor");
+	F32 ssao_factor = render_ssao_factor;
 	shader.uniform1f("ssao_factor", ssao_factor);
 	shader.uniform1f("ssao_factor_inv", 1.0/ssao_factor);
 
-	LLVector3 ssao_effect = gSavedSettings.getVector3("RenderSSAOEffect");
+	static LLCachedControl<LLVector3> render_ssao_effect(gSavedSettings, "RenderSSAOEffect");
+	LLVector3 ssao_effect = render_ssao_effect;
 	F32 matrix_diag = (ssao_effect[0] + 2.0*ssao_effect[1])/3.0;
 	F32 matrix_nondiag = (ssao_effect[0] - ssao_effect[1])/3.0;
 	// This matrix scales (proj of color onto <1/rt(3),1/rt(3),1/rt(3)>) by
@@ -5415,7 +5444,8 @@ void LLPipeline::bindDeferredShader(LLGLSLShader& shader, U32 light_index)
 
 	shader.uniform2f("screen_res", mDeferredScreen.getWidth(), mDeferredScreen.getHeight());
 	shader.uniform1f("near_clip", LLViewerCamera::getInstance()->getNear()*2.f);
-	shader.uniform1f("alpha_soften", gSavedSettings.getF32("RenderDeferredAlphaSoften"));
+	static LLCachedControl<F32> render_deferred_alpha_soften(gSavedSettings, "RenderDeferredAlphaSoften");
+	shader.uniform1f("alpha_soften", render_deferred_alpha_soften);
 }
 
 void LLPipeline::renderDeferredLighting()
@@ -5522,9 +5552,12 @@ void LLPipeline::renderDeferredLighting()
 
 	LLVector3 gauss[32]; // xweight, yweight, offset
 
-	LLVector3 go = gSavedSettings.getVector3("RenderShadowGaussian");
-	U32 kern_length = llclamp(gSavedSettings.getU32("RenderShadowBlurSamples"), (U32) 1, (U32) 16)*2 - 1;
-	F32 blur_size = gSavedSettings.getF32("RenderShadowBlurSize");
+	static LLCachedControl<LLVector3> render_shadow_gaussian(gSavedSettings, "RenderShadowGaussian");
+	LLVector3 go = render_shadow_gaussian;
+	static LLCachedControl<U32> render_shadow_blur_samples(gSavedSettings, "RenderShadowBlurSamples");
+	U32 kern_length = llclamp((U32)render_shadow_blur_samples, (U32) 1, (U32) 16)*2 - 1;
+	static LLCachedControl<F32> render_shadow_blur_size(gSavedSettings, "RenderShadowBlurSize");
+	F32 blur_size = render_shadow_blur_size;
 
 	// sample symmetrically with the middle sample falling exactly on 0.0
 	F32 x = -(kern_length/2.0f) + 0.5f;
@@ -5914,10 +5947,12 @@ void LLPipeline::generateWaterReflection(LLCamera& camera_in)
 									  (1<<LLPipeline::RENDER_TYPE_SKY) |
 									  (1<<LLPipeline::RENDER_TYPE_CLOUDS));	
 
-				if (gSavedSettings.getBOOL("RenderWaterReflections"))
+				static LLCachedControl<bool> render_water_reflections(gSavedSettings, "RenderWaterReflections");
+				if (render_water_reflections)
 				{ //mask out selected geometry based on reflection detail
 
-					S32 detail = gSavedSettings.getS32("RenderReflectionDetail");
+					static LLCachedControl<S32> render_reflection_detail(gSavedSettings, "RenderReflectionDetail");
+					S32 detail = render_reflection_detail;
 					if (detail < 3)
 					{
 						mRenderTypeMask &= ~(1 << LLPipeline::RENDER_TYPE_PARTICLES);
@@ -6099,7 +6134,8 @@ void LLPipeline::generateSunShadow(LLCamera& camera)
 
 	//temporary hack to disable shadows but keep local lights
 	static BOOL clear = TRUE;
-	BOOL gen_shadow = gSavedSettings.getBOOL("RenderDeferredSunShadow");
+	static LLCachedControl<bool> render_deferred_sun_shadow(gSavedSettings, "RenderDeferredSunShadow");
+	BOOL gen_shadow = render_deferred_sun_shadow;
 	if (!gen_shadow)
 	{
 		if (clear)
@@ -6132,7 +6168,8 @@ void LLPipeline::generateSunShadow(LLCamera& camera)
 	LLVector3 up;
 
 	//clip contains parallel split distances for 3 splits
-	LLVector3 clip = gSavedSettings.getVector3("RenderShadowClipPlanes");
+	static LLCachedControl<LLVector3> render_shadow_clip_planes(gSavedSettings, "RenderShadowClipPlanes");
+	LLVector3 clip = render_shadow_clip_planes;
 
 	//far clip on last split is minimum of camera view distance and 128
 	mSunClipPlanes = LLVector4(clip, clip.mV[2] * clip.mV[2]/clip.mV[1]);
@@ -6149,7 +6186,8 @@ void LLPipeline::generateSunShadow(LLCamera& camera)
 	F32 dist[] = { 0.1f, mSunClipPlanes.mV[0], mSunClipPlanes.mV[1], mSunClipPlanes.mV[2], mSunClipPlanes.mV[3] };
 
 	//currently used for amount to extrude frusta corners for constructing shadow frusta
-	LLVector3 n = gSavedSettings.getVector3("RenderShadowNearDist");
+	static LLCachedControl<LLVector3> render_shadow_near_dist(gSavedSettings, "RenderShadowNearDist");
+	LLVector3 n = render_shadow_near_dist;
 	F32 nearDist[] = { n.mV[0], n.mV[1], n.mV[2], n.mV[2] };
 
 	for (S32 j = 0; j < 4; j++)
@@ -6415,7 +6453,8 @@ void LLPipeline::generateSunShadow(LLCamera& camera)
 		mSunShadow[j].flush();
 	}
 
-	if (!gSavedSettings.getBOOL("CameraOffset"))
+	static LLCachedControl<bool> camera_offset(gSavedSettings, "CameraOffset");
+	if (!camera_offset)
 	{
 		glh_set_current_modelview(saved_view);
 		glh_set_current_projection(saved_proj);
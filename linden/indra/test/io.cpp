@@ -37,8 +37,10 @@
 
 #include <iterator>
 
+#include "apr_file_io.h"
 #include "apr_pools.h"
 
+#include "llapr.h"
 #include "llbuffer.h"
 #include "llbufferstream.h"
 #include "lliosocket.h"
@@ -152,6 +154,17 @@ namespace tut
 {
 	struct buffer_data
 	{
+		buffer_data()
+		{
+			// start each test with pooling off and nothing pooled.
+			LLHeapBuffer::cleanupClass();
+		}
+
+		~buffer_data()
+		{
+			LLHeapBuffer::cleanupClass();
+		}
+
 		LLBufferArray mBuffer;
 	};
 	typedef test_group<buffer_data> buffer_test;
@@ -396,6 +409,174 @@ namespace tut
 	}
 #endif
 
+	template<> template<>
+	void buffer_object::test<10>()
+	{
+		LLChannelDescriptors ch = mBuffer.nextChannel();
+		mBuffer.append(ch.in(), (U8*)"one", 3);
+		mBuffer.append(ch.in(), (U8*)"two", 3);
+		mBuffer.append(ch.out(), (U8*)"out", 3);
+		mBuffer.append(ch.in(), (U8*)"three", 5);
+		S32 segments = std::distance(
+			mBuffer.beginSegment(),
+			mBuffer.endSegment());
+		ensure_equals("appends merged", segments, 3);
+		LLBufferArray::segment_iterator_t it = mBuffer.beginSegment();
+		ensure_equals("merged segment size", (*it).size(), 6);
+		ensure("merged content", (0 == memcmp((*it).data(), "onetwo", 6)));
+	}
+
+	template<> template<>
+	void buffer_object::test<11>()
+	{
+		LLChannelDescriptors ch = mBuffer.nextChannel();
+		mBuffer.append(ch.in(), (U8*)"hello ", 6);
+		mBuffer.append(ch.in(), (U8*)"world", 5);
+		U8* first = (*mBuffer.beginSegment()).data();
+		S32 len = 0;
+		U8* data = mBuffer.makeContiguous(ch.in(), len);
+		ensure_equals("contiguous length", len, 11);
+		ensure("no copy when contiguous", (data == first));
+		ensure("contiguous content", (0 == memcmp(data, "hello world", 11)));
+		data = mBuffer.makeContiguous(ch.out(), len);
+		ensure("empty channel", (NULL == data));
+		ensure_equals("empty channel length", len, 0);
+	}
+
+	template<> template<>
+	void buffer_object::test<12>()
+	{
+		// spread a channel over several buffers with another channel
+		// in between, then check it comes back in one piece.
+		LLChannelDescriptors ch = mBuffer.nextChannel();
+		const S32 CHUNK_SIZE = 1000;
+		const S32 CHUNK_COUNT = 100;
+		std::vector<U8> expected;
+		U8 chunk[CHUNK_SIZE];
+		for(S32 i = 0; i < CHUNK_COUNT; ++i)
+		{
+			memset(chunk, i, CHUNK_SIZE);
+			mBuffer.append(ch.in(), chunk, CHUNK_SIZE);
+			expected.insert(expected.end(), chunk, chunk + CHUNK_SIZE);
+			if(0 == (i % 10))
+			{
+				mBuffer.append(ch.out(), (U8*)"x", 1);
+			}
+		}
+		S32 len = 0;
+		U8* data = mBuffer.makeContiguous(ch.in(), len);
+		ensure_equals("contiguous length", len, CHUNK_SIZE * CHUNK_COUNT);
+		ensure("contiguous content", (0 == memcmp(data, &expected[0], len)));
+		ensure_equals("count unchanged", mBuffer.count(ch.in()), len);
+		ensure_equals("other channel intact", mBuffer.count(ch.out()), 10);
+		ensure(
+			"first segment on channel",
+			(*mBuffer.beginSegment()).isOnChannel(ch.in()));
+		S32 len2 = 0;
+		U8* data2 = mBuffer.makeContiguous(ch.in(), len2);
+		ensure("second call does not copy", (data == data2));
+		ensure_equals("second call length", len2, len);
+	}
+
+	template<> template<>
+	void buffer_object::test<13>()
+	{
+		ll_init_apr();
+		LLHeapBuffer::initClass();
+		const S32 BODY_SIZE = 256 * 1024;
+		std::vector<U8> body(BODY_SIZE, 'a');
+		{
+			LLBufferArray buffer;
+			LLChannelDescriptors ch = buffer.nextChannel();
+			buffer.append(ch.in(), &body[0], BODY_SIZE);
+			ensure("few buffers for a large body", buffer.capacity() < 2 * BODY_SIZE);
+		}
+		U32 allocations = LLHeapBuffer::getHeapAllocationCount();
+		{
+			LLBufferArray buffer;
+			LLChannelDescriptors ch = buffer.nextChannel();
+			buffer.append(ch.in(), &body[0], BODY_SIZE);
+			S32 len = 0;
+			buffer.makeContiguous(ch.in(), len);
+			ensure_equals("body size", len, BODY_SIZE);
+		}
+		{
+			LLBufferArray buffer;
+			LLChannelDescriptors ch = buffer.nextChannel();
+			buffer.append(ch.in(), &body[0], BODY_SIZE);
+		}
+		// the second array allocates a block for the contiguous copy.
+		ensure_equals(
+			"pooled blocks reused",
+			LLHeapBuffer::getHeapAllocationCount(),
+			allocations + 1);
+	}
+
+	template<> template<>
+	void buffer_object::test<14>()
+	{
+		// getSegment() finds every byte of every segment after the
+		// segments have been split, inserted, erased and collapsed.
+		LLChannelDescriptors ch = mBuffer.nextChannel();
+		U8 chunk[100];
+		for(S32 i = 0; i < 200; ++i)
+		{
+			memset(chunk, i, sizeof(chunk));
+			if(i % 3)
+			{
+				mBuffer.append((i % 2) ? ch.in() : ch.out(), chunk, sizeof(chunk));
+			}
+			else
+			{
+				mBuffer.prepend(ch.in(), chunk, 1 + (i % 50));
+			}
+		}
+		S32 step = 0;
+		LLBufferArray::segment_iterator_t it = mBuffer.beginSegment();
+		while(it != mBuffer.endSegment())
+		{
+			LLBufferArray::segment_iterator_t next = it;
+			++next;
+			if((*it).size() > 2)
+			{
+				switch(step++ % 3)
+				{
+				case 0:
+					mBuffer.splitAfter((*it).data() + (*it).size() / 2);
+					break;
+				case 1:
+					mBuffer.insertAfter(it, ch.out(), chunk, 7);
+					break;
+				default:
+					mBuffer.eraseSegment(it);
+					break;
+				}
+			}
+			it = next;
+		}
+		S32 len = 0;
+		mBuffer.makeContiguous(ch.out(), len);
+		ensure("collapsed", len > 0);
+
+		S32 segments = 0;
+		for(it = mBuffer.beginSegment(); it != mBuffer.endSegment(); ++it, ++segments)
+		{
+			U8* data = (*it).data();
+			S32 size = (*it).size();
+			ensure("first byte", mBuffer.getSegment(data) == it);
+			ensure("middle byte", mBuffer.getSegment(data + size / 2) == it);
+			ensure("last byte", mBuffer.getSegment(data + size - 1) == it);
+			LLSegment segment;
+			LLBufferArray::segment_iterator_t after =
+				mBuffer.constructSegmentAfter(data + size - 1, segment);
+			LLBufferArray::segment_iterator_t next = it;
+			ensure("constructed after", after == ++next);
+		}
+		ensure("many segments", segments > 100);
+		ensure("not in the array", mBuffer.getSegment(chunk) == mBuffer.endSegment());
+		ensure("null", mBuffer.getSegment(NULL) == mBuffer.endSegment());
+	}
+
 	/*
 	template<> template<>
 	void buffer_object::test<>()
@@ -1182,6 +1363,208 @@ namespace tut
 	}
 }
 
+namespace tut
+{
+	/**
+	 * @brief make sure the pump only wakes the chains which are ready.
+	 */
+	struct pump_conditional_data
+	{
+		class LLPipeConditionCounter : public LLIOPipe
+		{
+		public:
+			LLPipeConditionCounter(apr_file_t* source, S32 limit = 0) :
+				mSource(source),
+				mInitialized(false),
+				mSignalled(0),
+				mLimit(limit)
+			{
+			}
+			S32 signalled() const { return mSignalled; }
+
+		protected:
+			virtual EStatus process_impl(
+				const LLChannelDescriptors& channels,
+				buffer_ptr_t& buffer,
+				bool& eos,
+				LLSD& context,
+				LLPumpIO* pump)
+			{
+				if(!mInitialized)
+				{
+					apr_pollfd_t poll_fd;
+					poll_fd.p = NULL;
+					poll_fd.desc_type = APR_POLL_FILE;
+					poll_fd.reqevents = APR_POLLIN;
+					poll_fd.rtnevents = 0x0;
+					poll_fd.desc.f = mSource;
+					poll_fd.client_data = NULL;
+					pump->setConditional(this, &poll_fd);
+					mInitialized = true;
+					return STATUS_BREAK;
+				}
+				char byte;
+				apr_size_t len = 1;
+				apr_file_read(mSource, &byte, &len);
+				++mSignalled;
+
+				// end the chain once we have seen enough.
+				if(mLimit && (mSignalled >= mLimit)) return STATUS_STOP;
+				return STATUS_BREAK;
+			}
+
+			apr_file_t* mSource;
+			bool mInitialized;
+			S32 mSignalled;
+			S32 mLimit;
+		};
+
+		// the idle chains share their pipes so a thousand of them
+		// still fit in the default descriptor limit.
+		enum
+		{
+			IDLE_CHAINS = 1000,
+			IDLE_PIPES = 250,
+			ACTIVE_CHAINS = 50
+		};
+
+		pump_conditional_data()
+		{
+			apr_pool_create(&mPool, NULL);
+			mPump = new LLPumpIO(mPool);
+			for(S32 ii = 0; ii < IDLE_PIPES + ACTIVE_CHAINS; ++ii)
+			{
+				apr_file_t* in = NULL;
+				apr_file_t* out = NULL;
+				apr_file_pipe_create(&in, &out, mPool);
+				mReaders.push_back(in);
+				mWriters.push_back(out);
+			}
+			for(S32 ii = 0; ii < IDLE_CHAINS; ++ii)
+			{
+				addCounter(mReaders[ii % IDLE_PIPES]);
+			}
+			for(S32 ii = 0; ii < ACTIVE_CHAINS; ++ii)
+			{
+				addCounter(mReaders[IDLE_PIPES + ii]);
+			}
+
+			// let every chain set its conditional.
+			mPump->pump();
+		}
+
+		~pump_conditional_data()
+		{
+			delete mPump;
+			apr_pool_destroy(mPool);
+		}
+
+		LLPipeConditionCounter* addCounter(apr_file_t* in, S32 limit = 0)
+		{
+			LLPipeConditionCounter* counter =
+				new LLPipeConditionCounter(in, limit);
+			LLPumpIO::chain_t chain;
+			chain.push_back(LLIOPipe::ptr_t(counter));
+			mPump->addChain(chain, NEVER_CHAIN_EXPIRY_SECS);
+			mCounters.push_back(counter);
+			return counter;
+		}
+
+		void signal(apr_file_t* out, S32 count)
+		{
+			char byte = 'x';
+			for(S32 ii = 0; ii < count; ++ii)
+			{
+				apr_size_t len = 1;
+				apr_file_write(out, &byte, &len);
+			}
+		}
+
+		void signalActive()
+		{
+			for(S32 ii = IDLE_PIPES; ii < IDLE_PIPES + ACTIVE_CHAINS; ++ii)
+			{
+				signal(mWriters[ii], 1);
+			}
+		}
+
+		void ensureSignalled(const char* msg, S32 active_count)
+		{
+			for(S32 ii = 0; ii < IDLE_CHAINS + ACTIVE_CHAINS; ++ii)
+			{
+				S32 expected = (ii < IDLE_CHAINS) ? 0 : active_count;
+				ensure_equals(msg, mCounters[ii]->signalled(), expected);
+			}
+		}
+
+		apr_pool_t* mPool;
+		LLPumpIO* mPump;
+		std::vector<LLPipeConditionCounter*> mCounters;
+		std::vector<apr_file_t*> mReaders;
+		std::vector<apr_file_t*> mWriters;
+	};
+	typedef test_group<pump_conditional_data> pump_conditional_test_group;
+	typedef pump_conditional_test_group::object pump_conditional_object;
+	pump_conditional_test_group pump_conditional("pump conditionals");
+
+	template<> template<>
+	void pump_conditional_object::test<1>()
+	{
+		// nothing is ready, so nothing should run.
+		mPump->pump();
+		ensureSignalled("idle pump", 0);
+
+		signalActive();
+		mPump->pump();
+		ensureSignalled("signalled pump", 1);
+
+		// every byte was read, so the next pump is quiet again.
+		mPump->pump();
+		ensureSignalled("drained pump", 1);
+
+		signalActive();
+		mPump->pump();
+		ensureSignalled("signalled twice", 2);
+	}
+
+	template<> template<>
+	void pump_conditional_object::test<2>()
+	{
+		// repriming the pump has to keep watching the old chains.
+		mPump->prime(mPool);
+		signalActive();
+		mPump->pump();
+		ensureSignalled("signalled after prime", 1);
+	}
+
+	template<> template<>
+	void pump_conditional_object::test<3>()
+	{
+		// two chains watching one descriptor both hear about it, and
+		// the survivor keeps hearing about it once the other is done.
+		apr_file_t* in = NULL;
+		apr_file_t* out = NULL;
+		apr_file_pipe_create(&in, &out, mPool);
+		LLPipeConditionCounter* survivor = addCounter(in);
+		LLPipeConditionCounter* quitter = addCounter(in, 1);
+		LLIOPipe::ptr_t keep_quitter(quitter);
+		mPump->pump();
+		S32 chains = mPump->runningChains();
+
+		// one byte for each of them so neither read blocks.
+		signal(out, 2);
+		mPump->pump();
+		ensure_equals("survivor signalled", survivor->signalled(), 1);
+		ensure_equals("quitter signalled", quitter->signalled(), 1);
+		ensure_equals("quitter done", mPump->runningChains(), chains - 1);
+
+		signal(out, 1);
+		mPump->pump();
+		ensure_equals("survivor still watching", survivor->signalled(), 2);
+		ensureSignalled("others quiet", 0);
+	}
+}
+
 namespace tut
 {
 	struct rpc_server_data
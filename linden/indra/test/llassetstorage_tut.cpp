@@ -0,0 +1,306 @@
+/** 
+ * @file llassetstorage_tut.cpp
+ * @brief LLAssetRequestScheduler tests
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ * 
+ * Copyright (c) 2009, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "lltut.h"
+
+#include "llassetstorage.h"
+#include "llfile.h"
+#include "llhttpassetstorage.h"
+#include "lltestmessagesystem.h"
+#include "lltimer.h"
+
+namespace tut
+{
+	// Downloads straight from curl, without the message system transfers
+	class LLTestHTTPAssetStorage : public LLHTTPAssetStorage
+	{
+	public:
+		LLTestHTTPAssetStorage(const std::string& base_url)
+		:	LLHTTPAssetStorage(gMessageSystem, NULL, NULL, base_url, base_url, "localhost")
+		{
+		}
+
+		void request(const LLUUID& uuid, LLAssetType::EType type,
+					 LLGetAssetCallback callback, void* user_data)
+		{
+			_queueDataRequest(uuid, type, callback, user_data, FALSE, ASSET_PRIORITY_NORMAL);
+		}
+	};
+
+	static S32 sDownloadCalls = 0;
+	static S32 sDownloadResult = LL_ERR_NOERR;
+
+	static void download_done(LLVFS*, const LLUUID&, LLAssetType::EType,
+							  void* user_data, S32 result, LLExtStat)
+	{
+		++sDownloadCalls;
+		sDownloadResult = result;
+	}
+
+	struct llassetstorage_data
+	{
+		llassetstorage_data()
+		{
+			for (S32 i = 0; i < 8; ++i)
+			{
+				mID[i].generate();
+			}
+		}
+
+		LLUUID startNext(LLAssetRequestScheduler& scheduler, F64 now = 0.0)
+		{
+			LLUUID uuid;
+			LLAssetType::EType type = LLAssetType::AT_NONE;
+			EAssetPriority priority;
+			U32 download_id = scheduler.startNext(uuid, type, priority, now);
+			ensure("something to start", download_id != 0);
+			mDownloadID[uuid] = download_id;
+			return uuid;
+		}
+
+		bool finished(LLAssetRequestScheduler& scheduler, const LLUUID& uuid)
+		{
+			return scheduler.finished(uuid, LLAssetType::AT_TEXTURE, mDownloadID[uuid]);
+		}
+
+		LLUUID mID[8];
+		std::map<LLUUID, U32> mDownloadID;
+	};
+	typedef test_group<llassetstorage_data> llassetstorage_test;
+	typedef llassetstorage_test::object llassetstorage_object;
+	tut::llassetstorage_test llassetstorage("llassetstorage");
+
+	template<> template<>
+	void llassetstorage_object::test<1>()
+	{
+		// one entry per asset and type
+		LLAssetRequestScheduler scheduler;
+		ensure("first queued", scheduler.queue(mID[0], LLAssetType::AT_TEXTURE, ASSET_PRIORITY_NORMAL, 0.0));
+		ensure("duplicate not queued", !scheduler.queue(mID[0], LLAssetType::AT_TEXTURE, ASSET_PRIORITY_NORMAL, 1.0));
+		ensure("other type queued", scheduler.queue(mID[0], LLAssetType::AT_SOUND, ASSET_PRIORITY_NORMAL, 1.0));
+		ensure_equals("queued count", scheduler.getQueuedCount(), 2);
+
+		// a duplicate raises, never lowers
+		scheduler.queue(mID[0], LLAssetType::AT_SOUND, ASSET_PRIORITY_URGENT, 2.0);
+		scheduler.queue(mID[0], LLAssetType::AT_SOUND, ASSET_PRIORITY_BACKGROUND, 2.0);
+		ensure_equals("raised", scheduler.getQueuedCount(ASSET_PRIORITY_URGENT), 1);
+		ensure_equals("not lowered", scheduler.getQueuedCount(ASSET_PRIORITY_BACKGROUND), 0);
+
+		LLUUID uuid;
+		LLAssetType::EType type;
+		EAssetPriority priority;
+		ensure("started", scheduler.startNext(uuid, type, priority, 3.0) != 0);
+		ensure_equals("urgent first", type, LLAssetType::AT_SOUND);
+		ensure_equals("started at the raised priority", priority, ASSET_PRIORITY_URGENT);
+		ensure("running", scheduler.isRunning(mID[0], LLAssetType::AT_SOUND));
+		ensure("running not queued again", !scheduler.queue(mID[0], LLAssetType::AT_SOUND, ASSET_PRIORITY_NORMAL, 3.0));
+		ensure_equals("still one queued", scheduler.getQueuedCount(), 1);
+	}
+
+	template<> template<>
+	void llassetstorage_object::test<2>()
+	{
+		// highest priority first, oldest first within a priority
+		LLAssetRequestScheduler scheduler;
+		scheduler.queue(mID[0], LLAssetType::AT_TEXTURE, ASSET_PRIORITY_BACKGROUND, 0.0);
+		scheduler.queue(mID[1], LLAssetType::AT_TEXTURE, ASSET_PRIORITY_NORMAL, 1.0);
+		scheduler.queue(mID[2], LLAssetType::AT_TEXTURE, ASSET_PRIORITY_VISIBLE, 2.0);
+		scheduler.queue(mID[3], LLAssetType::AT_TEXTURE, ASSET_PRIORITY_NORMAL, 3.0);
+		scheduler.queue(mID[4], LLAssetType::AT_TEXTURE, ASSET_PRIORITY_URGENT, 4.0);
+
+		ensure_equals("urgent", startNext(scheduler), mID[4]);
+		ensure_equals("visible", startNext(scheduler), mID[2]);
+		ensure_equals("older normal", startNext(scheduler), mID[1]);
+		ensure_equals("newer normal", startNext(scheduler), mID[3]);
+		ensure_equals("background", startNext(scheduler), mID[0]);
+		ensure_equals("queue empty", scheduler.getQueuedCount(), 0);
+	}
+
+	template<> template<>
+	void llassetstorage_object::test<3>()
+	{
+		// no more than the limit run at once
+		LLAssetRequestScheduler scheduler;
+		scheduler.setMaxRunning(2);
+		for (S32 i = 0; i < 4; ++i)
+		{
+			scheduler.queue(mID[i], LLAssetType::AT_TEXTURE, ASSET_PRIORITY_NORMAL, 0.0);
+		}
+		startNext(scheduler);
+		startNext(scheduler);
+		LLUUID uuid;
+		LLAssetType::EType type;
+		EAssetPriority priority;
+		ensure("limit reached", !scheduler.startNext(uuid, type, priority, 0.0));
+		ensure_equals("running", scheduler.getRunningCount(), 2);
+
+		ensure("finished", finished(scheduler, mID[0]));
+		ensure_equals("slot freed", startNext(scheduler), mID[2]);
+		ensure("limit reached again", !scheduler.startNext(uuid, type, priority, 0.0));
+
+		// raising the limit lets the rest go
+		scheduler.setMaxRunning(3);
+		ensure_equals("new slot", startNext(scheduler), mID[3]);
+	}
+
+	template<> template<>
+	void llassetstorage_object::test<4>()
+	{
+		// priority changes while queued
+		LLAssetRequestScheduler scheduler;
+		scheduler.queue(mID[0], LLAssetType::AT_TEXTURE, ASSET_PRIORITY_VISIBLE, 0.0);
+		scheduler.queue(mID[1], LLAssetType::AT_TEXTURE, ASSET_PRIORITY_VISIBLE, 1.0);
+		scheduler.queue(mID[2], LLAssetType::AT_TEXTURE, ASSET_PRIORITY_NORMAL, 2.0);
+
+		// scrolled out of view
+		ensure("lowered", scheduler.setPriority(mID[0], LLAssetType::AT_TEXTURE, ASSET_PRIORITY_BACKGROUND));
+		// scrolled into view
+		ensure("raised", scheduler.setPriority(mID[2], LLAssetType::AT_TEXTURE, ASSET_PRIORITY_VISIBLE));
+		ensure_equals("visible count", scheduler.getQueuedCount(ASSET_PRIORITY_VISIBLE), 2);
+		ensure_equals("background count", scheduler.getQueuedCount(ASSET_PRIORITY_BACKGROUND), 1);
+
+		ensure_equals("first visible", startNext(scheduler), mID[1]);
+		ensure_equals("raised keeps its age", startNext(scheduler), mID[2]);
+		ensure_equals("lowered last", startNext(scheduler), mID[0]);
+		ensure("running not changed", !scheduler.setPriority(mID[0], LLAssetType::AT_TEXTURE, ASSET_PRIORITY_URGENT));
+	}
+
+	template<> template<>
+	void llassetstorage_object::test<5>()
+	{
+		// removal from either state
+		LLAssetRequestScheduler scheduler;
+		scheduler.setMaxRunning(1);
+		scheduler.queue(mID[0], LLAssetType::AT_TEXTURE, ASSET_PRIORITY_NORMAL, 0.0);
+		scheduler.queue(mID[1], LLAssetType::AT_TEXTURE, ASSET_PRIORITY_URGENT, 0.0);
+		scheduler.queue(mID[2], LLAssetType::AT_TEXTURE, ASSET_PRIORITY_NORMAL, 0.0);
+		startNext(scheduler);
+
+		ensure("queued removed", scheduler.remove(mID[0], LLAssetType::AT_TEXTURE));
+		ensure("not queued", !scheduler.isQueued(mID[0], LLAssetType::AT_TEXTURE));
+		ensure("removed twice", !scheduler.remove(mID[0], LLAssetType::AT_TEXTURE));
+		ensure_equals("normal count", scheduler.getQueuedCount(ASSET_PRIORITY_NORMAL), 1);
+
+		ensure("running removed", scheduler.remove(mID[1], LLAssetType::AT_TEXTURE));
+		ensure_equals("slot freed", scheduler.getRunningCount(), 0);
+		ensure_equals("next", startNext(scheduler), mID[2]);
+	}
+
+	template<> template<>
+	void llassetstorage_object::test<6>()
+	{
+		// statistics
+		LLAssetRequestScheduler scheduler;
+		scheduler.setMaxRunning(1);
+		scheduler.queue(mID[0], LLAssetType::AT_TEXTURE, ASSET_PRIORITY_NORMAL, 0.0);
+		scheduler.queue(mID[1], LLAssetType::AT_TEXTURE, ASSET_PRIORITY_NORMAL, 0.0);
+		scheduler.queue(mID[2], LLAssetType::AT_TEXTURE, ASSET_PRIORITY_NORMAL, 2.0);
+		ensure_equals("peak", scheduler.getPeakQueuedCount(), 3);
+
+		startNext(scheduler, 1.0);
+		finished(scheduler, mID[0]);
+		startNext(scheduler, 4.0);
+		finished(scheduler, mID[1]);
+		startNext(scheduler, 4.0);
+
+		ensure_equals("started", scheduler.getStartedCount(), 3U);
+		ensure_approximately_equals("mean wait", scheduler.getMeanWaitTime(), 7.0 / 3.0, 16);
+		ensure_approximately_equals("max wait", scheduler.getMaxWaitTime(), 4.0, 16);
+		ensure_equals("peak kept", scheduler.getPeakQueuedCount(), 3);
+	}
+
+	template<> template<>
+	void llassetstorage_object::test<7>()
+	{
+		// a late finish for a removed download leaves the newer one be
+		LLAssetRequestScheduler scheduler;
+		scheduler.setMaxRunning(1);
+		scheduler.queue(mID[0], LLAssetType::AT_TEXTURE, ASSET_PRIORITY_NORMAL, 0.0);
+		startNext(scheduler);
+		U32 old_id = mDownloadID[mID[0]];
+		scheduler.remove(mID[0], LLAssetType::AT_TEXTURE);
+
+		scheduler.queue(mID[0], LLAssetType::AT_TEXTURE, ASSET_PRIORITY_NORMAL, 1.0);
+		scheduler.queue(mID[1], LLAssetType::AT_TEXTURE, ASSET_PRIORITY_NORMAL, 1.0);
+		startNext(scheduler);
+		ensure("new download id", mDownloadID[mID[0]] != old_id);
+		ensure("late finish ignored", !scheduler.finished(mID[0], LLAssetType::AT_TEXTURE, old_id));
+		ensure("still running", scheduler.isRunning(mID[0], LLAssetType::AT_TEXTURE));
+		LLUUID uuid;
+		LLAssetType::EType type;
+		EAssetPriority priority;
+		ensure("slot still taken", !scheduler.startNext(uuid, type, priority, 2.0));
+		ensure("finished", finished(scheduler, mID[0]));
+		ensure_equals("slot freed", startNext(scheduler), mID[1]);
+	}
+
+	template<> template<>
+	void llassetstorage_object::test<8>()
+	{
+		// an HTTP download calls back as soon as curl is done with it
+		std::string dir = LLFile::tmpdir();
+		std::string template_file = dir + "llassetstorage_test.msg";
+		llofstream file(template_file);
+		file << "version 2.0\n"
+			 << "{\n"
+			 << "\tAssetUploadComplete Low 334 NotTrusted Unencoded\n"
+			 << "\t{\n\t\tAssetBlock Single\n"
+			 << "\t\t{ UUID LLUUID }\n\t\t{ Type S8 }\n\t\t{ Success BOOL }\n\t}\n"
+			 << "}\n";
+		file.close();
+		start_test_messaging_system(template_file);
+
+		{
+			// nothing is served here, so it fails at once
+			LLTestHTTPAssetStorage storage("file://" + dir + mID[0].asString());
+			gAssetStorage = &storage;
+			sDownloadCalls = 0;
+			storage.request(mID[1], LLAssetType::AT_SOUND, download_done, NULL);
+			ensure_equals("pending", storage.getNumPending(LLAssetStorage::RT_DOWNLOAD), 1);
+
+			LLTimer timer;
+			while (!sDownloadCalls && timer.getElapsedTimeF32() < 10.f)
+			{
+				storage.checkForTimeouts();
+				ms_sleep(1);
+			}
+			ensure_equals("called back once", sDownloadCalls, 1);
+			ensure_equals("failed", sDownloadResult, (S32)LL_ERR_ASSET_REQUEST_FAILED);
+			ensure_equals("none pending", storage.getNumPending(LLAssetStorage::RT_DOWNLOAD), 0);
+			gAssetStorage = NULL;
+		}
+
+		stop_test_messaging_system();
+		LLFile::remove(template_file);
+	}
+}
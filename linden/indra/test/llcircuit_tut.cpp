@@ -0,0 +1,343 @@
+/** 
+ * @file llcircuit_tut.cpp
+ * @brief LLCircuitData reliable packet and ack tracking tests
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ * 
+ * Copyright (c) 2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "lltut.h"
+
+#include <map>
+#if !LL_WINDOWS
+#include <netinet/in.h>
+#endif
+
+#include "llcircuit.h"
+#include "llrand.h"
+#include "lltestmessagesystem.h"
+#include "lltimer.h"
+#include "message.h"
+
+namespace tut
+{
+	static S32 sAcked = 0;
+	static S32 sTimedOut = 0;
+
+	static void reliable_callback(void**, S32 result)
+	{
+		if (result == LL_ERR_NOERR)
+		{
+			sAcked++;
+		}
+		else if (result == LL_ERR_TCP_TIMEOUT)
+		{
+			sTimedOut++;
+		}
+	}
+
+	// Gets at the protected half of LLCircuitData, which is otherwise
+	// only driven by the message system.
+	class LLTestCircuitData : public LLCircuitData
+	{
+	public:
+		LLTestCircuitData(const LLHost& host)
+		:	LLCircuitData(host, 0, 5.f, 100.f)
+		{
+			// Never let the throttle hold back resends.
+			F32 bps[TC_EOF];
+			for (S32 i = 0; i < TC_EOF; i++)
+			{
+				bps[i] = 1000000000.f;
+			}
+			getThrottleGroup().setNominalBPS(bps);
+		}
+
+		void send(TPACKETID id, S32 retries, F32 timeout)
+		{
+			U8 buffer[LL_PACKET_ID_SIZE + 4];
+			memset(buffer, 0, sizeof(buffer));
+			buffer[0] = LL_RELIABLE_FLAG;
+			U32 net_id = htonl(id);
+			memcpy(&buffer[PHL_PACKET_ID], &net_id, sizeof(net_id));
+
+			LLReliablePacketParams params;
+			params.set(mHost, retries, FALSE, timeout, reliable_callback, NULL, NULL);
+			addReliablePacket(gMessageSystem->mSocket, buffer, sizeof(buffer), &params);
+		}
+
+		// The reliable half of LLMessageSystem::checkMessages().
+		// Returns TRUE if the packet was a duplicate.
+		BOOL receive(TPACKETID id, BOOL resent)
+		{
+			checkPacketInID(id, resent);
+			if (resent && isDuplicateResend(id))
+			{
+				collectRAck(id);
+				return TRUE;
+			}
+			mRecentlyReceivedReliablePackets.insert(id, LLMessageSystem::getMessageTimeUsecs());
+			collectRAck(id);
+			return FALSE;
+		}
+
+		U32 getAckCount() const			{ return mAcks.size(); }
+		TPACKETID getAck(U32 i) const	{ return mAcks[i]; }
+		void popAcks(U32 count)			{ mAcks.pop(count); }
+		U32 getRecentCount() const		{ return mRecentlyReceivedReliablePackets.size(); }
+	};
+
+	struct LLCircuitTestData
+	{
+		LLHost mHost;
+
+		LLCircuitTestData()
+		:	mHost("127.0.0.1", 1)	// nothing listens, resends go nowhere
+		{
+			start_test_messaging_system();
+			sAcked = 0;
+			sTimedOut = 0;
+		}
+
+		~LLCircuitTestData()
+		{
+			stop_test_messaging_system();
+		}
+	};
+
+	typedef test_group<LLCircuitTestData> circuit_test;
+	typedef circuit_test::object circuit_object;
+	tut::circuit_test tcircuit("LLCircuit");
+
+	const S32 STRESS_PACKETS = 100000;
+	const S32 STRESS_BATCH = 100;
+	// Starting close to the top makes the stress tests wrap packet IDs.
+	const TPACKETID STRESS_FIRST_ID = LL_MAX_OUT_PACKET_ID - 50000;
+
+	template<> template<>
+	void circuit_object::test<1>()
+	{
+		// Window against a map, across a wrap.
+		LLPacketWindow<U32> window;
+		std::map<TPACKETID, U32> model;
+		for (S32 i = 0; i < STRESS_PACKETS; i++)
+		{
+			TPACKETID id = (STRESS_FIRST_ID + i) & LL_PACKET_ID_MASK;
+			window.insert(id, i);
+			model[id] = i;
+
+			// Drop most of them, leaving a few old ones behind
+			// so the window has to stretch.
+			if (ll_frand() < 0.95f)
+			{
+				TPACKETID doomed = (id - ll_rand(64)) & LL_PACKET_ID_MASK;
+				window.erase(doomed);
+				model.erase(doomed);
+			}
+		}
+		ensure_equals("size", window.size(), (U32)model.size());
+
+		U32 walked = 0;
+		U32* valuep;
+		TPACKETID id = window.oldest();
+		TPACKETID last = id;
+		for (; (valuep = window.findFrom(id)); id = ll_next_packet_id(id))
+		{
+			ensure("in map", model.find(id) != model.end());
+			ensure_equals("value", *valuep, model[id]);
+			// Values went in in sequence order.
+			ensure("order", (walked == 0) || (*window.find(last) < *valuep));
+			last = id;
+			walked++;
+		}
+		ensure_equals("walked", walked, (U32)model.size());
+
+		window.eraseBefore((STRESS_FIRST_ID + STRESS_PACKETS - 1000) & LL_PACKET_ID_MASK);
+		ensure("erased before", window.size() <= 1000);
+		ensure("kept newest", window.find((STRESS_FIRST_ID + STRESS_PACKETS - 1) & LL_PACKET_ID_MASK) != NULL);
+	}
+
+	template<> template<>
+	void circuit_object::test<2>()
+	{
+		// Send 100k reliable packets, lose some of them, and ack the
+		// rest out of order.  Lost packets get resent once and are
+		// acked within the next batch.
+		LLTestCircuitData cd(mHost);
+		U32 resent_before = gMessageSystem->mResentPackets;
+		F64 now = LLMessageSystem::getMessageTimeSeconds(TRUE);
+
+		std::vector<TPACKETID> batch;
+		std::vector<TPACKETID> lost;
+		std::vector<TPACKETID> late;
+		S32 lost_count = 0;
+		for (S32 i = 0; i < STRESS_PACKETS; i += STRESS_BATCH)
+		{
+			batch.clear();
+			for (S32 j = 0; j < STRESS_BATCH; j++)
+			{
+				TPACKETID id = (STRESS_FIRST_ID + i + j) & LL_PACKET_ID_MASK;
+				cd.send(id, 3, 1.f);
+				if (ll_frand() < 0.1f)
+				{
+					lost.push_back(id);
+					lost_count++;
+				}
+				else
+				{
+					batch.push_back(id);
+				}
+			}
+
+			// Acks for the last batch's stragglers arrive along with
+			// this batch's, all out of order, some twice.
+			batch.insert(batch.end(), late.begin(), late.end());
+			late.clear();
+			std::random_shuffle(batch.begin(), batch.end());
+			for (U32 k = 0; k < batch.size(); k++)
+			{
+				cd.ackReliablePacket(batch[k]);
+				if (ll_frand() < 0.05f)
+				{
+					cd.ackReliablePacket(batch[k]);
+				}
+			}
+
+			// Everything still unacked has expired by now.
+			now += 10.0;
+			ensure_equals("unacked", cd.resendUnackedPackets(now), (S32)lost.size());
+			late.swap(lost);
+		}
+		for (U32 k = 0; k < late.size(); k++)
+		{
+			cd.ackReliablePacket(late[k]);
+		}
+
+		ensure_equals("acked", sAcked, STRESS_PACKETS);
+		ensure_equals("timed out", sTimedOut, 0);
+		ensure_equals("resent", (S32)(gMessageSystem->mResentPackets - resent_before), lost_count);
+		ensure_equals("unacked count", cd.getUnackedPacketCount(), 0);
+		ensure_equals("unacked bytes", cd.getUnackedPacketBytes(), 0);
+	}
+
+	template<> template<>
+	void circuit_object::test<3>()
+	{
+		// Retries run out, then the final retry times out.
+		LLTestCircuitData cd(mHost);
+		F64 now = LLMessageSystem::getMessageTimeSeconds(TRUE);
+		cd.send(10, 1, 1.f);
+		cd.send(11, 0, 1.f);
+		cd.send(12, 2, 1.f);
+		ensure_equals("sent", cd.getUnackedPacketCount(), 3);
+
+		now += 10.0;
+		cd.resendUnackedPackets(now);
+		ensure_equals("no retries expired", sTimedOut, 1);
+
+		now += 10.0;
+		cd.resendUnackedPackets(now);
+		ensure_equals("final retries expired", sTimedOut, 2);
+		ensure_equals("one left", cd.getUnackedPacketCount(), 1);
+
+		cd.ackReliablePacket(12);
+		cd.ackReliablePacket(10);
+		ensure_equals("acked", sAcked, 1);
+		ensure_equals("all gone", cd.getUnackedPacketCount(), 0);
+	}
+
+	template<> template<>
+	void circuit_object::test<4>()
+	{
+		// Receive 100k reliable packets with loss, reordering and
+		// duplicate resends, pruning the duplicate list the way
+		// StartPingCheck does.
+		LLTestCircuitData cd(mHost);
+		std::vector<TPACKETID> lost;
+		std::vector<TPACKETID> seen;
+		S32 duplicates = 0;
+		S32 flagged = 0;
+		U32 acks = 0;
+		for (S32 i = 0; i < STRESS_PACKETS; i += STRESS_BATCH)
+		{
+			TPACKETID first = (STRESS_FIRST_ID + i) & LL_PACKET_ID_MASK;
+			seen.clear();
+			for (S32 j = 0; j < STRESS_BATCH; j++)
+			{
+				TPACKETID id = (first + j) & LL_PACKET_ID_MASK;
+				if ((j > 0) && (ll_frand() < 0.1f))
+				{
+					lost.push_back(id);
+					continue;
+				}
+				ensure("fresh packet", !cd.receive(id, FALSE));
+				seen.push_back(id);
+				acks++;
+			}
+
+			// The resends of the lost ones come in late and out of
+			// order, along with resends of packets whose ack the
+			// other end hasn't seen yet.
+			std::random_shuffle(lost.begin(), lost.end());
+			for (U32 k = 0; k < lost.size(); k++)
+			{
+				ensure("lost packet", !cd.receive(lost[k], TRUE));
+				acks++;
+			}
+			lost.clear();
+			for (U32 k = 0; k < seen.size(); k++)
+			{
+				if (ll_frand() < 0.05f)
+				{
+					duplicates++;
+					flagged += cd.receive(seen[k], TRUE) ? 1 : 0;
+					acks++;
+				}
+			}
+
+			// Every ack goes out, some piggybacked and some on
+			// their own.
+			ensure_equals("ack count", cd.getAckCount(), acks);
+			ensure_equals("ack order", cd.getAck(0), first);
+			while (cd.getAckCount() > 0)
+			{
+				cd.popAcks(ll_rand(250) + 1);
+			}
+			acks = 0;
+
+			// The other end has everything before this batch acked.
+			cd.clearDuplicateList(first);
+			ensure("recent list bounded", cd.getRecentCount() <= (U32)STRESS_BATCH);
+		}
+
+		ensure_equals("duplicates", flagged, duplicates);
+		ensure_equals("nothing lost", cd.getPacketsLost(), 0U);
+		gMessageSystem->mCircuitInfo.mSendAckMap.clear();
+	}
+}
@@ -0,0 +1,188 @@
+/** 
+ * @file llcurl_tut.cpp
+ * @brief LLCurl request scheduling tests
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ * 
+ * Copyright (c) 2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "lltut.h"
+
+#include "llcurl.h"
+#include "lltimer.h"
+
+namespace tut
+{
+	// Nothing listens here, so every request fails to connect right
+	// away and completes in the order it was started.
+	static const char REFUSED_URL_A[] = "http://127.0.0.1:1/";
+	static const char REFUSED_URL_B[] = "http://127.0.0.1:2/";
+
+	struct curl_request_data
+	{
+		class LLOrderResponder : public LLCurl::Responder
+		{
+		public:
+			LLOrderResponder(std::vector<std::string>& order, const std::string& name) :
+				mOrder(order),
+				mName(name)
+			{
+			}
+
+			virtual void completedRaw(
+				U32 status,
+				const std::string& reason,
+				const LLChannelDescriptors& channels,
+				const LLIOPipe::buffer_ptr_t& buffer)
+			{
+				mOrder.push_back(mName);
+			}
+
+		private:
+			std::vector<std::string>& mOrder;
+			std::string mName;
+		};
+
+		LLCurl::ResponderPtr responder(const std::string& name)
+		{
+			return new LLOrderResponder(mOrder, name);
+		}
+
+		void processUntil(LLCurlRequest& request, size_t count)
+		{
+			LLTimer timer;
+			timer.setTimerExpirySec(10.0f);
+			while(mOrder.size() < count && !timer.hasExpired())
+			{
+				request.process();
+				ms_sleep(1);
+			}
+		}
+
+		std::vector<std::string> mOrder;
+	};
+	typedef test_group<curl_request_data> curl_request_test;
+	typedef curl_request_test::object curl_request_object;
+	tut::curl_request_test curl_request("curl request");
+
+	template<> template<>
+	void curl_request_object::test<1>()
+	{
+		// queued requests start by priority, then in order of arrival
+		LLCurlRequest request;
+		request.setMaxConnectionsPerHost(1);
+		request.get(REFUSED_URL_A, responder("texture 1"), LLCurl::PRIORITY_TEXTURE);
+		request.get(REFUSED_URL_A, responder("texture 2"), LLCurl::PRIORITY_TEXTURE);
+		request.get(REFUSED_URL_A, responder("caps 1"), LLCurl::PRIORITY_CAPS);
+		request.get(REFUSED_URL_A, responder("event poll"), LLCurl::PRIORITY_EVENT_POLL);
+		request.get(REFUSED_URL_A, responder("caps 2"), LLCurl::PRIORITY_CAPS);
+		ensure_equals("waiting for the host", request.getQueued(), 4);
+
+		processUntil(request, 5);
+		ensure_equals("all completed", mOrder.size(), (size_t)5);
+		ensure_equals("running first", mOrder[0], "texture 1");
+		ensure_equals("event poll", mOrder[1], "event poll");
+		ensure_equals("caps first", mOrder[2], "caps 1");
+		ensure_equals("caps second", mOrder[3], "caps 2");
+		ensure_equals("texture last", mOrder[4], "texture 2");
+		ensure_equals("nothing queued", request.getQueued(), 0);
+	}
+
+	template<> template<>
+	void curl_request_object::test<2>()
+	{
+		// the cap is per host, so other hosts are not held up
+		LLCurlRequest request;
+		request.setMaxConnectionsPerHost(1);
+		request.get(REFUSED_URL_A, responder("a"), LLCurl::PRIORITY_TEXTURE);
+		request.get(REFUSED_URL_B, responder("b"), LLCurl::PRIORITY_TEXTURE);
+		ensure_equals("both running", request.getQueued(), 0);
+		request.get(REFUSED_URL_B, responder("b"), LLCurl::PRIORITY_TEXTURE);
+		ensure_equals("second b waits", request.getQueued(), 1);
+
+		processUntil(request, 3);
+		ensure_equals("all completed", mOrder.size(), (size_t)3);
+		ensure_equals("waiting one last", mOrder[2], "b");
+	}
+
+	template<> template<>
+	void curl_request_object::test<3>()
+	{
+		// easy requests share one multi per thread, with the same caps
+		// and priorities
+		S32 old_max = LLCurlEasyRequest::getMaxConnectionsPerHost();
+		LLCurlEasyRequest::setMaxConnectionsPerHost(1);
+
+		const char* names[] = { "caps 1", "caps 2", "event poll", "caps 3" };
+		const LLCurl::EPriority priorities[] = {
+			LLCurl::PRIORITY_CAPS, LLCurl::PRIORITY_CAPS,
+			LLCurl::PRIORITY_EVENT_POLL, LLCurl::PRIORITY_CAPS };
+		const S32 COUNT = 4;
+		LLCurlEasyRequest* requests[COUNT];
+		for (S32 i = 0; i < COUNT; ++i)
+		{
+			requests[i] = new LLCurlEasyRequest(REFUSED_URL_A);
+			requests[i]->sendRequest(REFUSED_URL_A, priorities[i]);
+		}
+		// one that gives up while it waits
+		LLCurlEasyRequest* dropped = new LLCurlEasyRequest(REFUSED_URL_A);
+		dropped->sendRequest(REFUSED_URL_A);
+		delete dropped;
+
+		LLTimer timer;
+		timer.setTimerExpirySec(10.0f);
+		while (mOrder.size() < (size_t)COUNT && !timer.hasExpired())
+		{
+			requests[0]->perform();
+			for (S32 i = 0; i < COUNT; ++i)
+			{
+				CURLcode result;
+				if (requests[i]->getResult(&result))
+				{
+					ensure("refused", result != CURLE_OK);
+					mOrder.push_back(names[i]);
+				}
+			}
+			ms_sleep(1);
+		}
+
+		for (S32 i = 0; i < COUNT; ++i)
+		{
+			ensure_equals("done", requests[i]->perform(), 0);
+			delete requests[i];
+		}
+		LLCurlEasyRequest::setMaxConnectionsPerHost(old_max);
+
+		ensure_equals("all completed", mOrder.size(), (size_t)COUNT);
+		ensure_equals("running first", mOrder[0], "caps 1");
+		ensure_equals("event poll", mOrder[1], "event poll");
+		ensure_equals("caps second", mOrder[2], "caps 2");
+		ensure_equals("caps last", mOrder[3], "caps 3");
+	}
+}
@@ -47,8 +47,10 @@ namespace
 
 #include <vector>
 
+#include "llapr.h"
 #include "llerrorcontrol.h"
 #include "llsd.h"
+#include "llthread.h"
 
 namespace
 {
@@ -750,7 +752,153 @@ namespace tut
 		ensure_message_contains(8, "big easy");
 		ensure_message_count(9);
 	}
-}	
+}
+
+namespace
+{
+	// Logs numbered messages from its own thread.
+	class LoggingThread : public LLThread
+	{
+	public:
+		LoggingThread(int id, int count)
+			: LLThread("Logging Thread"), mID(id), mCount(count), mDone(false) { }
+
+		/*virtual*/ void run()
+		{
+			for (int i = 0; i < mCount; ++i)
+			{
+				llinfos << "logging thread " << mID << " message " << i << llendl;
+			}
+			mDone = true;
+		}
+
+		// isStopped() is also true before the thread gets going.
+		bool isDone()	{ return mDone && isStopped(); }
+
+	private:
+		int mID;
+		int mCount;
+		volatile bool mDone;
+	};
+}
+
+namespace tut
+{
+	template<> template<>
+		// asynchronous messages wait in the queue until it is drained
+	void ErrorTestObject::test<17>()
+	{
+		ll_init_apr();
+		LLError::startAsyncLogging(100, false);
+		ensure("async", LLError::isAsyncLogging());
+
+		TestAlpha::doInfo();
+		TestBeta::doWarn();
+		ensure_message_count(0);
+
+		LLError::flushAsyncLog();
+		ensure_message_count(2);
+		ensure_message_contains(0, "INFO: ");
+		ensure_message_contains(0, "any idea");
+		ensure_message_contains(1, "WARNING: ");
+		ensure_message_contains(1, "bad word");
+
+		LLError::stopAsyncLogging();
+		ensure("sync", !LLError::isAsyncLogging());
+		TestAlpha::doInfo();
+		ensure_message_count(3);
+	}
+
+	template<> template<>
+		// errors are written at once, after anything already queued
+	void ErrorTestObject::test<18>()
+	{
+		ll_init_apr();
+		LLError::startAsyncLogging(100, false);
+		mRecorder.setWantsTime(true);
+		LLError::setTimeFunction(LLError::utcTime);
+
+		TestAlpha::doWarn();
+		TestAlpha::doError();
+		LLError::stopAsyncLogging();
+
+		ensure("fatal", fatalWasCalled);
+		ensure_message_count(3);
+		ensure_message_contains(0, "aim west");
+		ensure_message_contains(1, "error");
+		ensure_message_contains(2, "ate eels");
+		// queued messages keep the time they were logged at
+		ensure_contains("timestamped", mRecorder.message(0), "Z WARNING: ");
+	}
+
+	template<> template<>
+		// a full queue drops messages and reports how many
+	void ErrorTestObject::test<19>()
+	{
+		ll_init_apr();
+		LLError::startAsyncLogging(4, false);
+		unsigned int dropped = LLError::asyncLogDroppedCount();
+
+		for (int i = 0; i < 10; ++i)
+		{
+			TestAlpha::doInfo();
+		}
+		ensure_equals("dropped", LLError::asyncLogDroppedCount(), dropped + 6);
+
+		LLError::flushAsyncLog();
+		LLError::stopAsyncLogging();
+		ensure_message_count(5);
+		ensure_message_contains(3, "any idea");
+		ensure_message_contains(4, "6 log messages dropped");
+	}
+
+	template<> template<>
+		// many threads log through the drain thread without losing or
+		// reordering their messages
+	void ErrorTestObject::test<20>()
+	{
+		ll_init_apr();
+		LLError::startAsyncLogging(100000);
+
+		const int THREADS = 4;
+		const int MESSAGES = 500;
+		std::vector<LoggingThread*> threads;
+		for (int t = 0; t < THREADS; ++t)
+		{
+			threads.push_back(new LoggingThread(t, MESSAGES));
+			threads.back()->start();
+		}
+		for (int t = 0; t < THREADS; ++t)
+		{
+			while (!threads[t]->isDone())
+			{
+				ms_sleep(1);
+			}
+			delete threads[t];
+		}
+		LLError::stopAsyncLogging();
+
+		std::vector<int> next(THREADS, 0);
+		int seen = 0;
+		for (int n = 0; n < mRecorder.countMessages(); ++n)
+		{
+			std::string message = mRecorder.message(n);
+			std::string::size_type pos = message.find("logging thread ");
+			if (pos == std::string::npos)
+			{
+				continue;
+			}
+			int id = -1;
+			int i = -1;
+			sscanf(message.c_str() + pos, "logging thread %d message %d", &id, &i);
+			ensure("thread id", id >= 0 && id < THREADS);
+			ensure_equals("in order", i, next[id]);
+			next[id]++;
+			seen++;
+		}
+		ensure_equals("all delivered", seen, THREADS * MESSAGES);
+	}
+}
 
 /* Tests left:
 	handling of classes without LOG_CLASS
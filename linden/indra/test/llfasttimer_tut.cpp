@@ -0,0 +1,243 @@
+/**
+ * @file llfasttimer_tut.cpp
+ * @brief Tests for LLFastTimer
+ * @date 2010-06-14
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ * 
+ * Copyright (c) 2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#include <tut/tut.hpp>
+
+#include "linden_common.h"
+#include "llfasttimer.h"
+#include "llapr.h"
+#include "llfile.h"
+#include "llthread.h"
+#include "lltimer.h"
+#include "lltut.h"
+#include "lluuid.h"
+
+namespace tut
+{
+	static LLFastTimer::DeclareTimer FTM_TEST_OUTER("Test Outer");
+	static LLFastTimer::DeclareTimer FTM_TEST_INNER("Test Inner");
+	static LLFastTimer::DeclareTimer FTM_TEST_THREAD("Test Thread");
+
+	class TimerThread : public LLThread
+	{
+	public:
+		TimerThread() : LLThread("Timer Test Thread"), mDone(false) {}
+
+		/*virtual*/ void run()
+		{
+			for (S32 i = 0; i < 10; ++i)
+			{
+				LLFastTimer t(FTM_TEST_THREAD);
+			}
+			mDone = true;
+		}
+
+		volatile bool mDone;
+	};
+
+	struct LLFastTimerTestData
+	{
+		LLFastTimerTestData()
+		{
+			ll_init_apr();
+			LLFastTimer::initClass(); // safe to call repeatedly
+			LLFastTimer::reset();
+		}
+
+		// Finish the frame and return the slot it was stored in.
+		S32 endFrame()
+		{
+			LLFastTimer::reset();
+			return LLFastTimer::sLastFrameIndex % LLFastTimer::FTM_HISTORY_NUM;
+		}
+	};
+
+	typedef test_group<LLFastTimerTestData> fasttimer_group_t;
+	typedef fasttimer_group_t::object fasttimer_object_t;
+	tut::fasttimer_group_t fasttimer_instance("LLFastTimer");
+
+	template<> template<>
+	void fasttimer_object_t::test<1>()
+	{
+		// declared timers follow the enum and keep their names
+		ensure("declared index", FTM_TEST_OUTER.getIndex() >= LLFastTimer::FTM_NUM_TYPES);
+		ensure("distinct index", FTM_TEST_INNER.getIndex() != FTM_TEST_OUTER.getIndex());
+		ensure("timer count", LLFastTimer::getNumTimers() > FTM_TEST_THREAD.getIndex());
+		ensure_equals("name", LLFastTimer::getTimerName(FTM_TEST_INNER.getIndex()),
+			std::string("Test Inner"));
+	}
+
+	template<> template<>
+	void fasttimer_object_t::test<2>()
+	{
+		// the parent only counts its own time
+		{
+			LLFastTimer outer(FTM_TEST_OUTER);
+			ms_sleep(5);
+			{
+				LLFastTimer inner(FTM_TEST_INNER);
+				ms_sleep(20);
+			}
+		}
+		S32 hidx = endFrame();
+		U64 outer = LLFastTimer::sCountHistory[hidx][FTM_TEST_OUTER.getIndex()];
+		U64 inner = LLFastTimer::sCountHistory[hidx][FTM_TEST_INNER.getIndex()];
+		ensure_equals("outer calls", LLFastTimer::sCallHistory[hidx][FTM_TEST_OUTER.getIndex()], (U64)1);
+		ensure_equals("inner calls", LLFastTimer::sCallHistory[hidx][FTM_TEST_INNER.getIndex()], (U64)1);
+		ensure("outer counted", outer > 0);
+		ensure("outer excludes inner", inner > outer);
+
+		// nothing carries over into the next frame
+		hidx = endFrame();
+		ensure_equals("next frame", LLFastTimer::sCallHistory[hidx][FTM_TEST_OUTER.getIndex()], (U64)0);
+	}
+
+	template<> template<>
+	void fasttimer_object_t::test<3>()
+	{
+		// another thread gets its own stack and is folded into the frame
+		TimerThread* thread = new TimerThread;
+		{
+			LLFastTimer outer(FTM_TEST_OUTER);
+			thread->start();
+			while (!thread->mDone)
+			{
+				ms_sleep(1);
+			}
+		}
+		S32 hidx = endFrame();
+		ensure_equals("thread calls", LLFastTimer::sCallHistory[hidx][FTM_TEST_THREAD.getIndex()], (U64)10);
+		ensure_equals("main calls", LLFastTimer::sCallHistory[hidx][FTM_TEST_OUTER.getIndex()], (U64)1);
+		while (!thread->isStopped())
+		{
+			ms_sleep(1);
+		}
+		delete thread;
+	}
+
+	template<> template<>
+	void fasttimer_object_t::test<4>()
+	{
+		// many scopes in a frame are all counted, and the cost is logged
+		const S32 SCOPES = 100000;
+		LLTimer timer;
+		for (S32 i = 0; i < SCOPES; ++i)
+		{
+			LLFastTimer t(FTM_TEST_INNER);
+		}
+		F64 ns_per_scope = timer.getElapsedTimeF64() * 1.0e9 / SCOPES;
+		llinfos << "LLFastTimer scope cost: " << ns_per_scope << " ns" << llendl;
+		S32 hidx = endFrame();
+		ensure_equals("scope calls", LLFastTimer::sCallHistory[hidx][FTM_TEST_INNER.getIndex()], (U64)SCOPES);
+	}
+
+	template<> template<>
+	void fasttimer_object_t::test<5>()
+	{
+		LLUUID random;
+		random.generate();
+		std::ostringstream name;
+#if LL_WINDOWS
+		name << "fast_timer_trace_test-" << random << ".json";
+#else
+		name << "/tmp/fast_timer_trace_test-" << random << ".json";
+#endif
+		const std::string filename(name.str());
+		ensure("begin capture", LLFastTimer::beginTraceCapture(filename));
+		ensure("capturing", LLFastTimer::isTraceCapturing());
+		{
+			LLFastTimer outer(FTM_TEST_OUTER);
+		}
+		endFrame();
+		LLFastTimer::endTraceCapture();
+		ensure("stopped", !LLFastTimer::isTraceCapturing());
+
+		llifstream file(filename.c_str());
+		std::string trace((std::istreambuf_iterator<char>(file)),
+						  std::istreambuf_iterator<char>());
+		file.close();
+		LLFile::remove(filename);
+
+		ensure("header", trace.find("{\"traceEvents\":[") == 0);
+		ensure("event", trace.find("{\"name\":\"Test Outer\",\"ph\":\"X\"") != std::string::npos);
+		ensure("thread name", trace.find("\"args\":{\"name\":\"Main\"}") != std::string::npos);
+		ensure("footer", trace.find("]}") != std::string::npos);
+	}
+
+	template<> template<>
+	void fasttimer_object_t::test<6>()
+	{
+		// a thread which exits before the frame ends still counts, and
+		// its state is freed
+		LLUUID random;
+		random.generate();
+		std::ostringstream name;
+#if LL_WINDOWS
+		name << "fast_timer_trace_exit-" << random << ".json";
+#else
+		name << "/tmp/fast_timer_trace_exit-" << random << ".json";
+#endif
+		const std::string filename(name.str());
+		ensure("begin capture", LLFastTimer::beginTraceCapture(filename));
+
+		S32 threads = LLFastTimer::getThreadCount();
+		TimerThread* thread = new TimerThread;
+		thread->start();
+		while (!thread->mDone || !thread->isStopped())
+		{
+			ms_sleep(1);
+		}
+		delete thread;
+		// the state goes once the OS thread is gone, just after it stops
+		LLTimer timer;
+		while (LLFastTimer::getThreadCount() > threads && timer.getElapsedTimeF32() < 5.f)
+		{
+			ms_sleep(1);
+		}
+		ensure_equals("state freed", LLFastTimer::getThreadCount(), threads);
+
+		S32 hidx = endFrame();
+		ensure_equals("exited thread calls", LLFastTimer::sCallHistory[hidx][FTM_TEST_THREAD.getIndex()], (U64)10);
+		hidx = endFrame();
+		ensure_equals("counted once", LLFastTimer::sCallHistory[hidx][FTM_TEST_THREAD.getIndex()], (U64)0);
+
+		LLFastTimer::endTraceCapture();
+		llifstream file(filename.c_str());
+		std::string trace((std::istreambuf_iterator<char>(file)),
+						  std::istreambuf_iterator<char>());
+		file.close();
+		LLFile::remove(filename);
+		ensure("exited thread events", trace.find("{\"name\":\"Test Thread\",\"ph\":\"X\"") != std::string::npos);
+	}
+}
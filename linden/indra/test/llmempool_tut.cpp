@@ -0,0 +1,239 @@
+/**
+ * @file llmempool_tut.cpp
+ * @brief Tests for LLMemPool and LLMemType accounting
+ * @date 2010-06-28
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ * 
+ * Copyright (c) 2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#include <tut/tut.hpp>
+#include <sstream>
+#include <vector>
+
+#include "linden_common.h"
+#include "llmempool.h"
+#include "llmemtype.h"
+#include "lltut.h"
+
+namespace tut
+{
+	class PooledThing
+	{
+	public:
+		MEM_TYPE_POOL_NEW;
+
+		PooledThing() : mValue(0) {}
+		virtual ~PooledThing() {}
+
+		S32 mValue;
+	};
+
+	class BiggerPooledThing : public PooledThing
+	{
+	public:
+		char mPadding[200];
+	};
+
+	MEM_TYPE_POOL_IMPL(PooledThing, LLMemType::MTYPE_TEMP8, 4, false)
+
+	// Never has initMemPool() called on it
+	class LazyPooledThing
+	{
+	public:
+		MEM_TYPE_POOL_NEW;
+
+		S32 mValue;
+	};
+
+	MEM_TYPE_POOL_IMPL(LazyPooledThing, LLMemType::MTYPE_TEMP8, 4, false)
+
+	struct LLMemPoolTestData
+	{
+		LLMemPoolTestData()
+		{
+			PooledThing::initMemPool();
+		}
+	};
+
+	typedef test_group<LLMemPoolTestData> mempool_group_t;
+	typedef mempool_group_t::object mempool_object_t;
+	tut::mempool_group_t tut_mempool_group("LLMemPool");
+
+	// Pools stay registered for the life of the process, so the tests
+	// never destroy the ones they make.
+	static LLMemPool* make_pool(const char* name, size_t block_size, U32 blocks_per_chunk)
+	{
+		return new LLMemPool(name, LLMemType::MTYPE_TEMP7, block_size, blocks_per_chunk);
+	}
+
+	template<> template<>
+	void mempool_object_t::test<1>()
+	{
+		// Freed blocks are handed out again before a new chunk is made.
+		LLMemPool* pool = make_pool("reuse", 24, 8);
+		ensure_equals("rounded block size", (U32)pool->getBlockSize(), (U32)32);
+
+		void* a = pool->allocate(24);
+		void* b = pool->allocate(24);
+		ensure("distinct blocks", a != b);
+		ensure_equals("one chunk", pool->getChunkCount(), (U32)1);
+		ensure_equals("live", pool->getLiveCount(), (U32)2);
+		ensure_equals("free", pool->getFreeCount(), (U32)6);
+		ensure("aligned", ((size_t)a & 15) == 0 && ((size_t)b & 15) == 0);
+
+		pool->release(b, 24);
+		void* c = pool->allocate(24);
+		ensure("reused", c == b);
+
+		std::vector<void*> blocks;
+		for (S32 i = 0; i < 20; ++i)
+		{
+			blocks.push_back(pool->allocate(16));
+			ensure("aligned in chunk", ((size_t)blocks.back() & 15) == 0);
+		}
+		ensure_equals("grew", pool->getChunkCount(), (U32)3);
+		ensure_equals("live after growth", pool->getLiveCount(), (U32)22);
+
+		for (U32 i = 0; i < blocks.size(); ++i)
+		{
+			pool->release(blocks[i], 16);
+		}
+		pool->release(a, 24);
+		pool->release(c, 24);
+		ensure_equals("all returned", pool->getLiveCount(), (U32)0);
+		ensure_equals("all free", pool->getFreeCount(), (U32)24);
+		ensure_equals("chunks kept", pool->getChunkCount(), (U32)3);
+	}
+
+	template<> template<>
+	void mempool_object_t::test<2>()
+	{
+		// Oversize requests go to the heap and are counted separately.
+		LLMemPool* pool = make_pool("oversize", 16, 4);
+		void* p = pool->allocate(100);
+		ensure("allocated", p != NULL);
+		ensure("aligned", ((size_t)p & 15) == 0);
+		ensure_equals("heap", pool->getHeapCount(), (U32)1);
+		ensure_equals("no chunks", pool->getChunkCount(), (U32)0);
+		ensure_equals("no live blocks", pool->getLiveCount(), (U32)0);
+		pool->release(p, 100);
+		ensure_equals("heap released", pool->getHeapCount(), (U32)0);
+		pool->release(NULL, 16);
+	}
+
+	template<> template<>
+	void mempool_object_t::test<3>()
+	{
+		// Pool traffic is charged to the pool's type.
+		LLMemPool* pool = make_pool("accounting", 64, 4);
+		S32 bytes = LLMemType::sMemCount[LLMemType::MTYPE_TEMP7];
+		S32 news = LLMemType::sNewCount[LLMemType::MTYPE_TEMP7];
+		U32 allocs = LLMemType::sAllocCount[LLMemType::MTYPE_TEMP7];
+
+		void* a = pool->allocate(64);
+		void* b = pool->allocate(200);
+		ensure_equals("bytes", LLMemType::sMemCount[LLMemType::MTYPE_TEMP7], bytes + 264);
+		ensure_equals("live", LLMemType::sNewCount[LLMemType::MTYPE_TEMP7], news + 2);
+		ensure_equals("allocs", LLMemType::sAllocCount[LLMemType::MTYPE_TEMP7], allocs + 2);
+		ensure("peak", LLMemType::sMaxMemCount[LLMemType::MTYPE_TEMP7] >= bytes + 264);
+
+		pool->release(a, 64);
+		pool->release(b, 200);
+		ensure_equals("bytes released", LLMemType::sMemCount[LLMemType::MTYPE_TEMP7], bytes);
+		ensure_equals("live released", LLMemType::sNewCount[LLMemType::MTYPE_TEMP7], news);
+		ensure_equals("allocs are cumulative", LLMemType::sAllocCount[LLMemType::MTYPE_TEMP7], allocs + 2);
+	}
+
+	template<> template<>
+	void mempool_object_t::test<4>()
+	{
+		// Classes using MEM_TYPE_POOL_NEW, including derived classes too
+		// big for the pool.
+		LLMemPool& pool = PooledThing::getMemPool();
+		U32 live = pool.getLiveCount();
+		S32 bytes = LLMemType::sMemCount[LLMemType::MTYPE_TEMP8];
+
+		PooledThing* thing = new PooledThing;
+		PooledThing* bigger = new BiggerPooledThing;
+		ensure_equals("pooled", pool.getLiveCount(), live + 1);
+		ensure_equals("heap", pool.getHeapCount(), (U32)1);
+		ensure_equals("bytes", LLMemType::sMemCount[LLMemType::MTYPE_TEMP8],
+					  bytes + (S32)pool.getBlockSize() + (S32)sizeof(BiggerPooledThing));
+
+		delete bigger;
+		delete thing;
+		ensure_equals("pool released", pool.getLiveCount(), live);
+		ensure_equals("heap released", pool.getHeapCount(), (U32)0);
+		ensure_equals("bytes released", LLMemType::sMemCount[LLMemType::MTYPE_TEMP8], bytes);
+	}
+
+	template<> template<>
+	void mempool_object_t::test<5>()
+	{
+		// STL containers using LLMemTypeAllocator are charged to its type.
+		S32 bytes = LLMemType::sMemCount[LLMemType::MTYPE_TEMP6];
+		{
+			std::vector<S32, LLMemTypeAllocator<S32, LLMemType::MTYPE_TEMP6> > values;
+			values.reserve(100);
+			ensure("charged", LLMemType::sMemCount[LLMemType::MTYPE_TEMP6] >= bytes + 400);
+			for (S32 i = 0; i < 1000; ++i)
+			{
+				values.push_back(i);
+			}
+			ensure_equals("contents", values[999], 999);
+			ensure("grown", LLMemType::sMemCount[LLMemType::MTYPE_TEMP6] >= bytes + 4000);
+		}
+		ensure_equals("released", LLMemType::sMemCount[LLMemType::MTYPE_TEMP6], bytes);
+	}
+
+	template<> template<>
+	void mempool_object_t::test<6>()
+	{
+		// The dump names every type that has seen traffic, and every pool.
+		make_pool("dumped", 32, 4);
+		std::ostringstream str;
+		LLMemType::dumpStats(str);
+		std::string dump = str.str();
+		ensure("types", dump.find("TEMP7") != std::string::npos);
+		ensure("pools", dump.find("dumped") != std::string::npos);
+		ensure("class pools", dump.find("PooledThing") != std::string::npos);
+	}
+
+	template<> template<>
+	void mempool_object_t::test<7>()
+	{
+		// A class's pool is made on first use if nobody created it.
+		ensure("not created yet", LazyPooledThing::sMemPool == NULL);
+		LazyPooledThing* thing = new LazyPooledThing;
+		ensure("created", LazyPooledThing::sMemPool != NULL);
+		ensure_equals("pooled", LazyPooledThing::getMemPool().getLiveCount(), (U32)1);
+		delete thing;
+		ensure_equals("released", LazyPooledThing::getMemPool().getLiveCount(), (U32)0);
+	}
+}
@@ -0,0 +1,299 @@
+/** 
+ * @file llpacketcapture_tut.cpp
+ * @brief Tests for packet capture and replay
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ * 
+ * Copyright (c) 2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "lltut.h"
+
+#include "llapr.h"
+#include "llfile.h"
+#include "llpacketcapture.h"
+#include "lltestmessagesystem.h"
+#include "lltimer.h"
+#include "lluuid.h"
+#include "llzerocode.h"
+#include "message.h"
+#include "message_prehash.h"
+
+namespace tut
+{
+	static S32 sTestMessages = 0;
+	static U32 sTestSum = 0;
+
+	static void process_test_message(LLMessageSystem* msg, void**)
+	{
+		U32 value = 0;
+		msg->getU32Fast(_PREHASH_TestBlock1, _PREHASH_Test1, value);
+		sTestMessages++;
+		sTestSum += value;
+	}
+
+	struct LLPacketCaptureTestData
+	{
+		std::string mTestDir;
+		std::string mCaptureFile;
+
+		LLPacketCaptureTestData()
+		{
+			ll_init_apr();
+
+			LLUUID random;
+			random.generate();
+#if LL_WINDOWS
+			mTestDir = "C:\\packet-capture-test-" + random.asString();
+#else
+			mTestDir = "/tmp/packet-capture-test-" + random.asString();
+#endif
+			LLFile::mkdir(mTestDir);
+			mCaptureFile = mTestDir + "/packets.capture";
+
+			// Same layout as the TestMessage in message_template.msg
+			std::string template_file = mTestDir + "/message_template.msg";
+			llofstream file(template_file);
+			write_test_message_template(file);
+			file << "{\n"
+				 << "\tTestMessage Low 1 NotTrusted Zerocoded\n"
+				 << "\t{\n\t\tTestBlock1 Single\n\t\t{ Test1 U32 }\n\t}\n"
+				 << "\t{\n\t\tNeighborBlock Multiple 4\n"
+				 << "\t\t{ Test0 U32 }\n\t\t{ Test1 U32 }\n\t\t{ Test2 U32 }\n\t}\n"
+				 << "}\n";
+			file.close();
+
+			startMessaging();
+		}
+
+		void startMessaging()
+		{
+			start_test_messaging_system(mTestDir + "/message_template.msg");
+			gMessageSystem->setHandlerFuncFast(_PREHASH_TestMessage, process_test_message);
+			sTestMessages = 0;
+			sTestSum = 0;
+		}
+
+		~LLPacketCaptureTestData()
+		{
+			stop_test_messaging_system();
+
+			LLFile::remove(mCaptureFile);
+			LLFile::remove(mTestDir + "/message_template.msg");
+			LLFile::rmdir(mTestDir);
+		}
+
+		void sendTestMessage(const LLHost& host, U32 value, bool reliable = false)
+		{
+			LLMessageSystem* msg = gMessageSystem;
+			msg->newMessageFast(_PREHASH_TestMessage);
+			msg->nextBlockFast(_PREHASH_TestBlock1);
+			msg->addU32Fast(_PREHASH_Test1, value);
+			for (S32 i = 0; i < 4; ++i)
+			{
+				msg->nextBlockFast(_PREHASH_NeighborBlock);
+				msg->addU32Fast(_PREHASH_Test0, i);
+				msg->addU32Fast(_PREHASH_Test1, i);
+				msg->addU32Fast(_PREHASH_Test2, i);
+			}
+			if (reliable)
+			{
+				msg->sendReliable(host);
+			}
+			else
+			{
+				msg->sendMessage(host);
+			}
+		}
+
+		// Replays the capture into a fresh message system and returns
+		// packets per second.
+		F64 timeReplay(bool use_sse2)
+		{
+			stop_test_messaging_system();
+			startMessaging();
+			LLZeroCode::setUseSSE2(use_sse2);
+			LLTimer timer;
+			S32 replayed = gMessageSystem->replayPackets(mCaptureFile, false);
+			F64 elapsed = timer.getElapsedTimeF64();
+			ensure("replayed", replayed > 0);
+			return elapsed > 0.0 ? replayed / elapsed : 0.0;
+		}
+	};
+
+	typedef test_group<LLPacketCaptureTestData> LLPacketCaptureTestGroup;
+	typedef LLPacketCaptureTestGroup::object LLPacketCaptureTestObject;
+	LLPacketCaptureTestGroup packetCaptureTestGroup("LLPacketCapture");
+
+	template<> template<>
+	void LLPacketCaptureTestObject::test<1>()
+		// write and read back a capture
+	{
+		LLPacketCapture capture;
+		ensure("open", capture.open(mCaptureFile));
+		LLHost first(0x0100007f, 1000);
+		LLHost second(0x0200007f, 2000);
+		capture.writePacket(1000000, first, "abc", 3);
+		capture.writePacket(1000000 + 200000, second, "defgh", 5);
+		capture.writePacket(1000000 + 200001, first, "i", 1);
+		ensure_equals("written", capture.getPacketCount(), 3);
+		capture.close();
+
+		LLPacketReplay replay;
+		ensure("load", replay.load(mCaptureFile));
+		ensure_equals("count", replay.getPacketCount(), 3);
+		std::vector<LLHost> senders;
+		replay.getSenders(senders);
+		ensure_equals("senders", senders.size(), 2);
+
+		char buffer[NET_BUFFER_SIZE];
+		LLHost sender;
+		ensure_equals("first", replay.receivePacket(buffer, sender), 3);
+		ensure("first data", !memcmp(buffer, "abc", 3));
+		ensure_equals("first sender", sender, first);
+		ensure_equals("second", replay.receivePacket(buffer, sender), 5);
+		ensure("second data", !memcmp(buffer, "defgh", 5));
+		ensure_equals("second sender", sender, second);
+		ensure_equals("third", replay.receivePacket(buffer, sender), 1);
+		ensure("done", replay.isDone());
+		ensure_equals("past end", replay.receivePacket(buffer, sender), 0);
+
+		// realtime replay holds packets back until they are due
+		replay.rewind();
+		replay.setRealtime(true);
+		ensure_equals("due", replay.receivePacket(buffer, sender), 3);
+		ensure_equals("not due", replay.receivePacket(buffer, sender), 0);
+		LLTimer timer;
+		S32 size = 0;
+		while (!size && timer.getElapsedTimeF32() < 5.f)
+		{
+			size = replay.receivePacket(buffer, sender);
+		}
+		ensure_equals("due later", size, 5);
+		ensure("spacing", timer.getElapsedTimeF32() > 0.1f);
+	}
+
+	template<> template<>
+	void LLPacketCaptureTestObject::test<2>()
+		// garbage is not a capture
+	{
+		llofstream file(mCaptureFile);
+		file << "not a capture";
+		file.close();
+		LLPacketReplay replay;
+		ensure("rejected", !replay.load(mCaptureFile));
+		ensure_equals("replay", gMessageSystem->replayPackets(mCaptureFile, false), -1);
+	}
+
+	template<> template<>
+	void LLPacketCaptureTestObject::test<3>()
+		// capture traffic off a live socket, then replay it through the
+		// handlers with no network
+	{
+		ensure("message system", gMessageSystem && gMessageSystem->isOK());
+		LLHost self(LOOPBACK_ADDRESS_STRING, gMessageSystem->getListenPort());
+		gMessageSystem->enableCircuit(self, TRUE);
+		ensure("capture", gMessageSystem->startPacketCapture(mCaptureFile));
+
+		const S32 COUNT = 20;
+		for (S32 i = 0; i < COUNT; ++i)
+		{
+			sendTestMessage(self, i);
+		}
+		LLTimer timer;
+		S64 frame = 0;
+		while (sTestMessages < COUNT && timer.getElapsedTimeF32() < 5.f)
+		{
+			if (!gMessageSystem->checkMessages(frame++))
+			{
+				ms_sleep(1);
+			}
+		}
+		gMessageSystem->stopPacketCapture();
+		ensure_equals("received", sTestMessages, COUNT);
+		ensure_equals("sum", sTestSum, (U32)(COUNT * (COUNT - 1) / 2));
+
+		sTestMessages = 0;
+		sTestSum = 0;
+		ensure_equals("replayed", gMessageSystem->replayPackets(mCaptureFile, false), COUNT);
+		ensure_equals("handled", sTestMessages, COUNT);
+		ensure_equals("replayed sum", sTestSum, (U32)(COUNT * (COUNT - 1) / 2));
+		ensure("back on the network", gMessageSystem->mPacketRing.getReplay() == NULL);
+	}
+
+	template<> template<>
+	void LLPacketCaptureTestObject::test<4>()
+		// Benchmark: capture a stream of reliable, zero coded messages and
+		// their acks, then time replaying it through the circuit's packet
+		// windows and the zero code decoder, with each run scanner.
+	{
+		LLHost self(LOOPBACK_ADDRESS_STRING, gMessageSystem->getListenPort());
+		gMessageSystem->enableCircuit(self, TRUE);
+		ensure("capture", gMessageSystem->startPacketCapture(mCaptureFile));
+
+		const S32 COUNT = 4000;
+		const S32 BATCH = 50;
+		LLTimer timer;
+		S64 frame = 0;
+		for (S32 sent = 0; sent < COUNT && timer.getElapsedTimeF32() < 20.f; )
+		{
+			// small batches so the socket buffer never overflows
+			for (S32 i = 0; i < BATCH; ++i)
+			{
+				sendTestMessage(self, sent++, true);
+			}
+			while (sTestMessages < sent && timer.getElapsedTimeF32() < 20.f)
+			{
+				if (!gMessageSystem->checkMessages(frame++))
+				{
+					gMessageSystem->processAcks();
+					ms_sleep(1);
+				}
+			}
+		}
+		gMessageSystem->processAcks();
+		gMessageSystem->stopPacketCapture();
+		ensure_equals("received", sTestMessages, COUNT);
+
+		// best of three, each into a new circuit so nothing is a duplicate
+		F64 plain_rate = 0.0;
+		F64 sse2_rate = 0.0;
+		for (S32 round = 0; round < 3; ++round)
+		{
+			plain_rate = llmax(plain_rate, timeReplay(false));
+			ensure_equals("plain handled", sTestMessages, COUNT);
+			sse2_rate = llmax(sse2_rate, timeReplay(true));
+			ensure_equals("sse2 handled", sTestMessages, COUNT);
+		}
+		llinfos << "Replay of " << COUNT << " reliable zero coded messages: "
+				<< (S32)plain_rate << " packets/s plain, "
+				<< (S32)sse2_rate << " packets/s "
+				<< (LLZeroCode::getUseSSE2() ? "SSE2" : "plain (no SSE2)")
+				<< llendl;
+	}
+}
@@ -0,0 +1,249 @@
+/** 
+ * @file llpacketreceivethread_tut.cpp
+ * @brief Loopback tests for batched receive and LLPacketReceiveThread
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ * 
+ * Copyright (c) 2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include <tut/tut.hpp>
+
+#include "linden_common.h"
+#include "llapr.h"
+#include "llhost.h"
+#include "llpacketreceivethread.h"
+#include "llpacketring.h"
+#include "lltimer.h"
+#include "net.h"
+#include "lltut.h"
+
+namespace tut
+{
+	struct LLPacketReceiveThreadTestData
+	{
+		S32 mReceiveSocket;
+		S32 mSendSocket;
+		int mReceivePort;
+		int mSendPort;
+
+		LLPacketReceiveThreadTestData()
+			: mReceiveSocket(-1), mSendSocket(-1),
+			  mReceivePort(NET_USE_OS_ASSIGNED_PORT), mSendPort(NET_USE_OS_ASSIGNED_PORT)
+		{
+			ll_init_apr();
+			start_net(mReceiveSocket, mReceivePort);
+			start_net(mSendSocket, mSendPort);
+		}
+
+		~LLPacketReceiveThreadTestData()
+		{
+			end_net(mReceiveSocket);
+			end_net(mSendSocket);
+		}
+
+		// Packet i is (i % 200) + 16 bytes, starting with i.
+		void sendPackets(S32 first, S32 count)
+		{
+			char buffer[256];
+			for (S32 i = first; i < first + count; ++i)
+			{
+				S32 size = (i % 200) + 16;
+				memset(buffer, i & 0xff, size);
+				memcpy(buffer, &i, sizeof(i));
+				send_packet(mSendSocket, buffer, size, ip_string_to_u32(LOOPBACK_ADDRESS_STRING), mReceivePort);
+			}
+		}
+
+		void ensurePacket(const char* data, S32 size, S32 expected)
+		{
+			S32 i = -1;
+			memcpy(&i, data, sizeof(i));
+			ensure_equals("sequence", i, expected);
+			ensure_equals("size", size, (expected % 200) + 16);
+			ensure_equals("payload", (U8)data[size - 1], (U8)(expected & 0xff));
+		}
+	};
+
+	typedef test_group<LLPacketReceiveThreadTestData> packet_receive_group_t;
+	typedef packet_receive_group_t::object packet_receive_object_t;
+	tut::packet_receive_group_t tut_packet_receive_group("LLPacketReceiveThread");
+
+	template<> template<>
+	void packet_receive_object_t::test<1>()
+	{
+		// receive_packets() hands back waiting datagrams in batches.
+		ensure("sockets", mReceiveSocket >= 0 && mSendSocket >= 0);
+		ensure_equals("nothing waiting", wait_for_packet(mReceiveSocket, 0), FALSE);
+
+		const S32 COUNT = 100;
+		sendPackets(0, COUNT);
+		ensure("waiting", wait_for_packet(mReceiveSocket, 1000));
+
+		std::vector<char> storage(16 * NET_BUFFER_SIZE);
+		LLNetPacket packets[16];
+		for (S32 i = 0; i < 16; ++i)
+		{
+			packets[i].mData = &storage[i * NET_BUFFER_SIZE];
+		}
+
+		S32 received = 0;
+		LLTimer timer;
+		while (received < COUNT && timer.getElapsedTimeF32() < 5.f)
+		{
+			S32 count = receive_packets(mReceiveSocket, packets, 16);
+			ensure("batch limit", count <= 16);
+			for (S32 i = 0; i < count; ++i)
+			{
+				ensurePacket(packets[i].mData, packets[i].mSize, received + i);
+				ensure_equals("sender port", packets[i].mSenderPort, (U32)mSendPort);
+			}
+			received += count;
+			if (!count)
+			{
+				wait_for_packet(mReceiveSocket, 10);
+			}
+		}
+		ensure_equals("received", received, COUNT);
+		ensure_equals("drained", receive_packets(mReceiveSocket, packets, 16), 0);
+	}
+
+	template<> template<>
+	void packet_receive_object_t::test<2>()
+	{
+		// LLPacketRing reads through the thread once it is started.
+		LLPacketRing ring;
+		ring.startReceiveThread(mReceiveSocket);
+
+		const S32 COUNT = 2000;
+		char buffer[NET_BUFFER_SIZE];
+		S32 received = 0;
+		LLTimer timer;
+		for (S32 sent = 0; sent < COUNT; sent += 100)
+		{
+			sendPackets(sent, 100);
+			while (received < sent + 100 && timer.getElapsedTimeF32() < 10.f)
+			{
+				S32 size = ring.receivePacket(mReceiveSocket, buffer);
+				if (!size)
+				{
+					ms_sleep(1);
+					continue;
+				}
+				ensurePacket(buffer, size, received);
+				ensure_equals("sender", ring.getLastSender().getPort(), (U32)mSendPort);
+				ensure("timestamped", ring.getLastReceiveTime() != 0);
+				received++;
+			}
+		}
+		ensure_equals("received", received, COUNT);
+		ensure_equals("thread count", ring.getReceiveThread()->getPacketsReceived(), (U32)COUNT);
+		ensure("batched", ring.getReceiveThread()->getBatchesReceived() <= (U32)COUNT);
+		ring.stopReceiveThread();
+		ensure("stopped", ring.getReceiveThread() == NULL);
+	}
+
+	template<> template<>
+	void packet_receive_object_t::test<3>()
+	{
+		// A full ring leaves packets in the socket until there is room.
+		LLPacketReceiveThread thread(mReceiveSocket, 32);
+		thread.start();
+
+		const S32 COUNT = 200;
+		sendPackets(0, COUNT);
+
+		LLTimer timer;
+		while (thread.getRingFullCount() == 0 && timer.getElapsedTimeF32() < 5.f)
+		{
+			ms_sleep(1);
+		}
+		ensure("ring filled", thread.getRingFullCount() > 0);
+
+		char buffer[NET_BUFFER_SIZE];
+		LLHost sender;
+		LLHost receiving_if;
+		U64 receive_time = 0;
+		S32 received = 0;
+		while (received < COUNT && timer.getElapsedTimeF32() < 10.f)
+		{
+			S32 size = thread.receivePacket(buffer, sender, receiving_if, receive_time);
+			if (!size)
+			{
+				ms_sleep(1);
+				continue;
+			}
+			ensurePacket(buffer, size, received);
+			received++;
+		}
+		ensure_equals("received", received, COUNT);
+	}
+
+	template<> template<>
+	void packet_receive_object_t::test<4>()
+	{
+		// Packets delayed by the in throttle keep the interface they
+		// arrived on, the same as unthrottled ones.
+		LLPacketRing ring;
+		ring.startReceiveThread(mReceiveSocket);
+
+		const S32 COUNT = 20;
+		char buffer[NET_BUFFER_SIZE];
+		S32 received = 0;
+		LLTimer timer;
+		sendPackets(0, COUNT / 2);
+		while (received < COUNT / 2 && timer.getElapsedTimeF32() < 5.f)
+		{
+			S32 size = ring.receivePacket(mReceiveSocket, buffer);
+			if (!size)
+			{
+				ms_sleep(1);
+				continue;
+			}
+			ensurePacket(buffer, size, received);
+			received++;
+		}
+		ensure_equals("received unthrottled", received, COUNT / 2);
+		LLHost receiving_if = ring.getLastReceivingInterface();
+
+		ring.setUseInThrottle(TRUE);
+		sendPackets(COUNT / 2, COUNT / 2);
+		while (received < COUNT && timer.getElapsedTimeF32() < 10.f)
+		{
+			S32 size = ring.receivePacket(mReceiveSocket, buffer);
+			if (!size)
+			{
+				ms_sleep(1);
+				continue;
+			}
+			ensurePacket(buffer, size, received);
+			ensure_equals("receiving interface", ring.getLastReceivingInterface(), receiving_if);
+			received++;
+		}
+		ensure_equals("received throttled", received, COUNT);
+		ring.stopReceiveThread();
+	}
+}
@@ -0,0 +1,196 @@
+/**
+ * @file llqueuedthread_tut.cpp
+ * @brief Tests for the LLQueuedThread request queue
+ * @date 2010-06-14
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ * 
+ * Copyright (c) 2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#include <tut/tut.hpp>
+
+#include "linden_common.h"
+#include "llqueuedthread.h"
+#include "lltut.h"
+
+namespace tut
+{
+	class TestRequest : public LLQueuedThread::QueuedRequest
+	{
+	public:
+		TestRequest(LLQueuedThread::handle_t handle, U32 priority)
+			: LLQueuedThread::QueuedRequest(handle, priority)
+		{
+		}
+		/*virtual*/ bool processRequest() { return true; }
+
+		void destroy() { deleteRequest(); }
+		void reprioritize(U32 priority) { setPriority(priority); }
+	};
+
+	struct LLRequestQueueTestData
+	{
+		typedef LLQueuedThread::RequestQueue queue_t;
+		typedef LLQueuedThread::QueuedRequest request_t;
+
+		~LLRequestQueueTestData()
+		{
+			for (std::vector<TestRequest*>::iterator iter = mRequests.begin();
+				 iter != mRequests.end(); ++iter)
+			{
+				mQueue.erase(*iter);
+				(*iter)->destroy();
+			}
+		}
+
+		TestRequest* add(U32 priority)
+		{
+			TestRequest* req = new TestRequest(mRequests.size() + 1, priority);
+			mRequests.push_back(req);
+			mQueue.insert(req);
+			return req;
+		}
+
+		queue_t mQueue;
+		std::vector<TestRequest*> mRequests;
+	};
+
+	typedef test_group<LLRequestQueueTestData> LLRequestQueueTestGroup;
+	typedef LLRequestQueueTestGroup::object LLRequestQueueTestObject;
+
+	LLRequestQueueTestGroup requestQueueTestGroup("LLRequestQueue");
+
+	// Requests come out highest priority class first
+	template<> template<>
+	void LLRequestQueueTestObject::test<1>()
+	{
+		ensure("starts empty", mQueue.empty());
+		ensure("front of empty queue", mQueue.front() == NULL);
+
+		request_t* low = add(LLQueuedThread::PRIORITY_LOW);
+		request_t* immediate = add(LLQueuedThread::PRIORITY_IMMEDIATE);
+		request_t* normal = add(LLQueuedThread::PRIORITY_NORMAL);
+		request_t* high = add(LLQueuedThread::PRIORITY_HIGH);
+		request_t* zero = add(0);
+		ensure_equals("size", mQueue.size(), 5);
+
+		ensure("immediate", mQueue.pop() == immediate);
+		ensure("high", mQueue.pop() == high);
+		ensure("normal", mQueue.pop() == normal);
+		ensure("low", mQueue.pop() == low);
+		ensure("zero", mQueue.pop() == zero);
+		ensure("empty", mQueue.empty());
+		ensure("pop empty", mQueue.pop() == NULL);
+	}
+
+	// Equal priorities are first in, first out
+	template<> template<>
+	void LLRequestQueueTestObject::test<2>()
+	{
+		request_t* first = add(LLQueuedThread::PRIORITY_NORMAL | 5);
+		request_t* second = add(LLQueuedThread::PRIORITY_NORMAL | 5);
+		request_t* third = add(LLQueuedThread::PRIORITY_NORMAL | 5);
+		ensure("first", mQueue.pop() == first);
+		ensure("second", mQueue.pop() == second);
+		ensure("third", mQueue.pop() == third);
+	}
+
+	// Erase from the middle, head and tail of a bucket, and reprioritise
+	template<> template<>
+	void LLRequestQueueTestObject::test<3>()
+	{
+		request_t* a = add(LLQueuedThread::PRIORITY_NORMAL);
+		request_t* b = add(LLQueuedThread::PRIORITY_NORMAL);
+		request_t* c = add(LLQueuedThread::PRIORITY_NORMAL);
+		TestRequest* d = add(LLQueuedThread::PRIORITY_LOW);
+
+		ensure("erase middle", mQueue.erase(b));
+		ensure("erase twice", !mQueue.erase(b));
+		ensure_equals("size after erase", mQueue.size(), 3);
+
+		// move d above everything else
+		ensure("erase d", mQueue.erase(d));
+		d->reprioritize(LLQueuedThread::PRIORITY_URGENT);
+		mQueue.insert(d);
+
+		std::vector<request_t*> ordered;
+		mQueue.getRequests(ordered);
+		ensure_equals("ordered size", ordered.size(), 3);
+		ensure("ordered d", ordered[0] == d);
+		ensure("ordered a", ordered[1] == a);
+		ensure("ordered c", ordered[2] == c);
+
+		ensure("pop d", mQueue.pop() == d);
+		ensure("erase tail", mQueue.erase(c));
+		ensure("pop a", mQueue.pop() == a);
+		ensure("empty", mQueue.empty());
+	}
+
+	// Texture fetch priorities all sit in the LOWBITS of one priority class,
+	// so they share a few buckets and still have to come out in order
+	template<> template<>
+	void LLRequestQueueTestObject::test<4>()
+	{
+		const S32 COUNT = 500;
+		U32 seed = 12345;
+		for (S32 i = 0; i < COUNT; ++i)
+		{
+			seed = seed * 1103515245 + 12345;
+			F32 image_priority = (F32)(seed >> 8) / (F32)(1 << 24); // 0..1
+			U32 work_priority = (U32)(image_priority * (F32)LLQueuedThread::PRIORITY_LOWBITS);
+			add((i & 1 ? LLQueuedThread::PRIORITY_HIGH : LLQueuedThread::PRIORITY_LOW) | work_priority);
+		}
+
+		// reprioritise some while queued, as the fetcher does
+		for (S32 i = 0; i < COUNT; i += 7)
+		{
+			TestRequest* req = mRequests[i];
+			ensure("erase", mQueue.erase(req));
+			req->reprioritize(LLQueuedThread::PRIORITY_NORMAL | (req->getPriority() & LLQueuedThread::PRIORITY_LOWBITS));
+			mQueue.insert(req);
+		}
+
+		std::vector<request_t*> ordered;
+		mQueue.getRequests(ordered);
+		ensure_equals("ordered size", ordered.size(), (size_t)COUNT);
+
+		request_t* last = NULL;
+		for (S32 i = 0; i < COUNT; ++i)
+		{
+			request_t* req = mQueue.pop();
+			ensure("popped", req != NULL);
+			ensure("same as getRequests", req == ordered[i]);
+			if (last)
+			{
+				ensure("in order", !req->higherPriority(*last));
+			}
+			last = req;
+		}
+		ensure("empty", mQueue.empty());
+	}
+}
@@ -35,6 +35,7 @@
 #include "linden_common.h"
 #include "lltut.h"
 
+#include "llapr.h"
 #include "llsdtraits.h"
 #include "llstring.h"
 
@@ -759,6 +760,82 @@ namespace tut
 		ensure("type is a string", v.isString());
 	}
 
+	template<> template<>
+	void SDTestObject::test<15>()
+		// values built inside an arena
+	{
+		ll_init_apr();
+		LLSD::Arena::initClass(); // safe to call repeatedly
+
+		SDCleanupCheck check;
+		LLSD::Arena arena;
+		{
+			LLSD::ArenaScope scope(&arena);
+			{
+				SDAllocationCheck check("shared scalars", 0);
+				LLSD t = true;
+				LLSD f = false;
+				LLSD i = 42;
+				LLSD n = -1;
+				LLSD r = 0.0;
+				LLSD u = LLUUID::null;
+				ensureTypeAndValue("shared true", t, true);
+				ensureTypeAndValue("shared false", f, false);
+				ensureTypeAndValue("shared integer", i, 42);
+				ensureTypeAndValue("shared negative", n, -1);
+				ensureTypeAndValue("shared real", r, 0.0);
+				ensureTypeAndValue("shared uuid", u, LLUUID::null);
+
+				// shared values are copied before they are changed
+				LLSD j = i;
+				j = 43;
+				ensureTypeAndValue("modified copy", j, 43);
+				ensureTypeAndValue("original unchanged", i, 42);
+			}
+			ensure_equals("shared scalars not in arena", arena.outstandingCount(), 0U);
+
+			LLSD map;
+			map["a"] = 1000;
+			map["b"] = "string";
+			map["c"] = 3.5;
+			map["d"] = 2000;
+			ensure_equals("map values in arena", arena.outstandingCount(), 5U);
+			map["e"] = 1;
+			ensure_equals("shared map value not in arena", arena.outstandingCount(), 5U);
+			ensure("arena has storage", arena.bytesAllocated() > 0);
+		}
+		ensure_equals("arena values released", arena.outstandingCount(), 0U);
+
+		{
+			SDAllocationCheck check("no sharing outside an arena", 1);
+			LLSD i = 42;
+		}
+
+		// heap values made while an arena has storage don't count against it
+		{
+			LLSD in_arena;
+			{
+				LLSD::ArenaScope scope(&arena);
+				in_arena = "from the arena";
+			}
+			LLSD on_heap = "from the heap";
+			ensure_equals("only the arena value", arena.outstandingCount(), 1U);
+			on_heap = LLSD();
+			ensure_equals("heap value freed to the heap", arena.outstandingCount(), 1U);
+		}
+		ensure_equals("arena value freed", arena.outstandingCount(), 0U);
+
+		// values that outlive their arena keep its storage alive
+		LLSD survivor;
+		{
+			LLSD::Arena short_lived;
+			LLSD::ArenaScope scope(&short_lived);
+			survivor = "outlives the arena";
+		}
+		ensureTypeAndValue("value outliving arena", survivor, "outlives the arena");
+		survivor = LLSD();
+	}
+
 	/* TO DO:
 		conversion of undefined to UUID, Date, URI and Binary
 		conversion of undefined to map and array
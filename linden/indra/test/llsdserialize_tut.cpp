@@ -1267,6 +1267,22 @@ namespace tut
 				count2,
 				count1);
 
+			// the same bytes straight from memory
+			std::string bytes = str1.str();
+			LLSD actual_value_buffer;
+			S32 count5 = LLSDSerialize::fromBinary(
+				actual_value_buffer,
+				(const U8*)bytes.data(),
+				(S32)bytes.size());
+			ensure_equals(
+				"ensureBinaryAndNotation buffer count",
+				count5,
+				count1);
+			ensure_equals(
+				(msg + " (binarybuffer)").c_str(),
+				actual_value_buffer,
+				input);
+
 			// to notation and back again
 			std::stringstream str2;
 			S32 count3 = LLSDSerialize::toNotation(actual_value_bin, str2);
@@ -1439,6 +1455,132 @@ namespace tut
 		ensureBinaryAndNotation("map", test);
 		ensureBinaryAndXML("map", test);
 	}
+
+	template<> template<> 
+	void TestLLSDCompatibleObject::test<9>()
+	{
+		LLSD test;
+		test["foo"] = "bar";
+		test["baz"].append(100);
+		test["baz"].append(LLUUID::null);
+		std::stringstream str;
+		LLSDSerialize::toBinary(test, str);
+		std::string bytes = str.str();
+
+		// every truncation of a container must fail cleanly
+		LLSDBinaryBufferParser parser;
+		for(S32 len = 1; len < (S32)bytes.size(); ++len)
+		{
+			LLSD actual;
+			S32 count = parser.parse((const U8*)bytes.data(), len, actual);
+			ensure_equals("truncated count", count, (S32)LLSDParser::PARSE_FAILURE);
+			ensure("truncated result", actual.isUndefined());
+		}
+
+		LLSD actual;
+		ensure_equals("full count", parser.parse((const U8*)bytes.data(), bytes.size(), actual), 5);
+		ensure_equals("full bytes", parser.bytesRead(), (S32)bytes.size());
+		ensure_equals("full value", actual, test);
+	}
+
+	class LLSDEventRecorder : public LLSDParseHandler
+	{
+	public:
+		LLSDEventRecorder(S32 stop_after = -1) : mStopAfter(stop_after) {}
+
+		virtual bool beginMap()							{ return record("{"); }
+		virtual bool mapKey(const std::string& key)		{ return record("k:" + key); }
+		virtual bool endMap()							{ return record("}"); }
+		virtual bool beginArray()						{ return record("["); }
+		virtual bool endArray()							{ return record("]"); }
+		virtual bool value(const LLSD& value)			{ return record("v:" + value.asString()); }
+
+		std::string mEvents;
+
+	private:
+		bool record(const std::string& event)
+		{
+			mEvents += event + " ";
+			return (mStopAfter < 0) || (--mStopAfter > 0);
+		}
+
+		S32 mStopAfter;
+	};
+
+	struct TestLLSDStreamParsing
+	{
+		TestLLSDStreamParsing()
+		{
+			LLSD inner = LLSD::emptyMap();
+			inner["b"] = true;
+			mData = LLSD::emptyMap();
+			mData["a"].append(1);
+			mData["a"].append("x");
+			mData["a"].append(inner);
+			mData["c"] = LLSD();
+			mData["d"] = LLSD::emptyArray();
+		}
+
+		void ensureEvents(
+			const std::string& msg,
+			LLPointer<LLSDParser> parser,
+			const std::string& serialized)
+		{
+			static const std::string EXPECTED(
+				"{ k:a [ v:1 v:x { k:b v:true } ] k:c v: k:d [ ] } ");
+
+			std::istringstream stream(serialized);
+			LLSDEventRecorder recorder;
+			S32 count = parser->parse(
+				stream,
+				recorder,
+				LLSDSerialize::SIZE_UNLIMITED);
+			ensure_equals((msg + " count").c_str(), count, 8);
+			ensure_equals((msg + " events").c_str(), recorder.mEvents, EXPECTED);
+
+			parser->reset();
+			std::istringstream stream2(serialized);
+			LLSDEventRecorder stopper(5);
+			count = parser->parse(
+				stream2,
+				stopper,
+				LLSDSerialize::SIZE_UNLIMITED);
+			ensure_equals((msg + " aborted").c_str(), count, (S32)LLSDParser::PARSE_FAILURE);
+			ensure_equals((msg + " aborted events").c_str(), stopper.mEvents,
+				std::string("{ k:a [ v:1 v:x "));
+		}
+
+		LLSD mData;
+	};
+
+	typedef tut::test_group<TestLLSDStreamParsing> TestLLSDStreamParsingGroup;
+	typedef TestLLSDStreamParsingGroup::object TestLLSDStreamParsingObject;
+	TestLLSDStreamParsingGroup gTestLLSDStreamParsingGroup(
+		"llsd serialize streaming");
+
+	template<> template<> 
+	void TestLLSDStreamParsingObject::test<1>()
+	{
+		std::ostringstream str;
+		str << LLSDNotationStreamer(mData);
+		ensureEvents("notation", new LLSDNotationParser, str.str());
+	}
+
+	template<> template<> 
+	void TestLLSDStreamParsingObject::test<2>()
+	{
+		std::ostringstream str;
+		LLSDSerialize::toBinary(mData, str);
+		ensureEvents("binary", new LLSDBinaryParser, str.str());
+	}
+
+	template<> template<> 
+	void TestLLSDStreamParsingObject::test<3>()
+	{
+		std::ostringstream str;
+		LLSDSerialize::toXML(mData, str);
+		ensureEvents("xml", new LLSDXMLParser, str.str());
+	}
 }
 
 #endif
@@ -0,0 +1,248 @@
+/**
+ * @file llslabcache_tut.cpp
+ * @brief LLSlabCache tests
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "lltut.h"
+#include "lltestpattern.h"
+
+#include "llslabcache.h"
+
+namespace
+{
+	const U32 SLABS = 4;
+	const U32 SLAB_SIZE = 64 * 1024 + LLSlabCache::SLAB_HEADER_SIZE;
+}
+
+namespace tut
+{
+	struct llslabcache_data
+	{
+		llslabcache_data()
+		{
+			LLUUID random;
+			random.generate();
+			std::ostringstream name;
+#if LL_WINDOWS
+			name << "llslabcache-test-" << random;
+#else
+			name << "/tmp/llslabcache-test-" << random;
+#endif
+			mBasename = name.str();
+			mCache.open(mBasename, SLABS, SLAB_SIZE, FALSE);
+		}
+
+		~llslabcache_data()
+		{
+			mCache.close();
+			LLSlabCache::removeFiles(mBasename, SLABS);
+		}
+
+		LLUUID storeBlob(S32 blob, S32 size, std::vector<LLUUID>* evicted = NULL)
+		{
+			LLUUID id;
+			id.generate();
+			std::vector<U8> data(size);
+			for (S32 i = 0; i < size; ++i)
+			{
+				data[i] = pattern_byte(blob, i);
+			}
+			ensure_equals("stored", mCache.write(id, &data[0], size, evicted), size);
+			return id;
+		}
+
+		bool checkBlob(const LLUUID& id, S32 blob, S32 size)
+		{
+			std::vector<U8> data(size);
+			if (mCache.read(id, &data[0], 0, size) != size)
+			{
+				return false;
+			}
+			for (S32 i = 0; i < size; ++i)
+			{
+				if (data[i] != pattern_byte(blob, i))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		std::string mBasename;
+		LLSlabCache mCache;
+	};
+	typedef test_group<llslabcache_data> llslabcache_test;
+	typedef llslabcache_test::object llslabcache_object;
+	tut::llslabcache_test llslabcache("llslabcache");
+
+	template<> template<>
+	void llslabcache_object::test<1>()
+	{
+		ensure("open", mCache.isOpen());
+		LLUUID id = storeBlob(1, 3000);
+		ensure_equals("size", mCache.getSize(id), 3000);
+		ensure("round trip", checkBlob(id, 1, 3000));
+
+		U8 buffer[100];
+		ensure_equals("read in the middle", mCache.read(id, buffer, 1000, 100), 100);
+		ensure_equals("first byte", buffer[0], pattern_byte(1, 1000));
+		ensure_equals("read past the end is cut short", mCache.read(id, buffer, 2950, 100), 50);
+		ensure_equals("short read", buffer[49], pattern_byte(1, 2999));
+
+		// rewriting an id replaces the blob
+		std::vector<U8> data(500, 0x5a);
+		ensure_equals("rewritten", mCache.write(id, &data[0], 500), 500);
+		ensure_equals("new size", mCache.getSize(id), 500);
+		ensure_equals("new data", mCache.read(id, buffer, 499, 1), 1);
+		ensure_equals("new byte", buffer[0], (U8)0x5a);
+		ensure_equals("one entry", mCache.getEntryCount(), (U32)1);
+		ensure_equals("old blob not counted", mCache.getUsedBytes(), (S64)500);
+
+		ensure("removed", mCache.remove(id));
+		ensure_equals("removed size", mCache.getSize(id), 0);
+		ensure_equals("removed read", mCache.read(id, buffer, 0, 1), 0);
+		ensure("removed twice", !mCache.remove(id));
+	}
+
+	template<> template<>
+	void llslabcache_object::test<2>()
+	{
+		// the index is reloaded on a warm start
+		std::vector<LLUUID> ids;
+		for (S32 i = 0; i < 40; ++i)
+		{
+			ids.push_back(storeBlob(i, 1000 + i * 10));
+		}
+		mCache.remove(ids[7]);
+		mCache.close();
+
+		ensure("reopened", mCache.open(mBasename, SLABS, SLAB_SIZE, FALSE));
+		ensure_equals("entries", mCache.getEntryCount(), (U32)39);
+		ensure_equals("removed stays removed", mCache.getSize(ids[7]), 0);
+		for (S32 i = 0; i < 40; ++i)
+		{
+			if (i != 7)
+			{
+				ensure("blob kept", checkBlob(ids[i], i, 1000 + i * 10));
+			}
+		}
+
+		// a different layout starts over
+		mCache.close();
+		ensure("reopened bigger", mCache.open(mBasename, SLABS, SLAB_SIZE * 2, FALSE));
+		ensure_equals("empty", mCache.getEntryCount(), (U32)0);
+	}
+
+	template<> template<>
+	void llslabcache_object::test<3>()
+	{
+		// Once the slabs fill up, blobs that were read survive compaction
+		// and the others are evicted.
+		const S32 SIZE = 10000;
+		std::vector<LLUUID> ids;
+		for (S32 i = 0; i < 24; ++i)
+		{
+			ids.push_back(storeBlob(i, SIZE));
+		}
+		for (S32 i = 0; i < 24; i += 4)
+		{
+			ensure("read before", checkBlob(ids[i], i, SIZE));
+		}
+
+		std::vector<LLUUID> evicted;
+		for (S32 i = 24; i < 40; ++i)
+		{
+			ids.push_back(storeBlob(i, SIZE, &evicted));
+		}
+		ensure("something evicted", !evicted.empty());
+		for (U32 i = 0; i < evicted.size(); ++i)
+		{
+			ensure_equals("evicted is gone", mCache.getSize(evicted[i]), 0);
+		}
+		for (S32 i = 0; i < 24; i += 4)
+		{
+			ensure("read blob kept", checkBlob(ids[i], i, SIZE));
+		}
+		for (S32 i = 24; i < 40; ++i)
+		{
+			ensure("new blob kept", checkBlob(ids[i], i, SIZE));
+		}
+		ensure("used fits", mCache.getUsedBytes() <= mCache.getCapacity());
+		ensure_equals("too big", mCache.write(LLUUID::null, NULL, SLAB_SIZE), 0);
+	}
+
+	template<> template<>
+	void llslabcache_object::test<4>()
+	{
+		// An old index left by a crash doesn't trust slabs rewound since
+		std::vector<LLUUID> ids;
+		for (S32 i = 0; i < 12; ++i)
+		{
+			ids.push_back(storeBlob(i, 10000));
+		}
+		ensure("saved", mCache.saveIndex());
+		std::string index = mBasename + ".index";
+		std::string saved = mBasename + ".saved";
+		{
+			LLFILE* in = LLFile::fopen(index, "rb");
+			LLFILE* out = LLFile::fopen(saved, "wb");
+			char buffer[4096];
+			size_t n;
+			while ((n = fread(buffer, 1, sizeof(buffer), in)) > 0)
+			{
+				fwrite(buffer, 1, n, out);
+			}
+			fclose(in);
+			fclose(out);
+		}
+
+		// fill the other slabs, then rewind the first one
+		for (S32 i = 12; i < 30; ++i)
+		{
+			storeBlob(i + 100, 10000);
+		}
+		mCache.close();
+		LLFile::remove(index);
+		LLFile::rename(saved, index);
+
+		ensure("reopened", mCache.open(mBasename, SLABS, SLAB_SIZE, FALSE));
+		S32 kept = 0;
+		for (S32 i = 0; i < 12; ++i)
+		{
+			if (mCache.getSize(ids[i]))
+			{
+				ensure("stale index never gives other data", checkBlob(ids[i], i, 10000));
+				++kept;
+			}
+		}
+		ensure_equals("rewound slab dropped", kept, 6);
+	}
+}
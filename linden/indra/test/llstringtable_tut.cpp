@@ -0,0 +1,217 @@
+/**
+ * @file llstringtable_tut.cpp
+ * @brief Tests for LLStringTable
+ * @date 2010-06-21
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ * 
+ * Copyright (c) 2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#include <tut/tut.hpp>
+
+#include "linden_common.h"
+#include "llstringtable.h"
+#include "llapr.h"
+#include "llthread.h"
+#include "lltimer.h"
+#include "lltut.h"
+
+namespace tut
+{
+	// Looks up strings which were added before it started while the main
+	// thread keeps adding (and resizing) the table.
+	class StringTableReader : public LLThread
+	{
+	public:
+		StringTableReader(LLStringTable& table, const std::vector<char*>& known)
+			: LLThread("String Table Reader"),
+			  mTable(table), mKnown(known), mMisses(0), mPasses(0), mStop(false) {}
+
+		/*virtual*/ void run()
+		{
+			while (!mStop)
+			{
+				for (U32 i = 0; i < mKnown.size(); ++i)
+				{
+					if (mTable.checkString(mKnown[i]) != mKnown[i])
+					{
+						++mMisses;
+					}
+				}
+				++mPasses;
+			}
+		}
+
+		LLStringTable& mTable;
+		const std::vector<char*>& mKnown;
+		S32 mMisses;
+		volatile S32 mPasses;
+		volatile bool mStop;
+	};
+
+	struct LLStringTableTestData
+	{
+		LLStringTableTestData() : mTable(16) {}
+
+		LLStringTable mTable;
+	};
+
+	typedef test_group<LLStringTableTestData> stringtable_group_t;
+	typedef stringtable_group_t::object stringtable_object_t;
+	tut::stringtable_group_t stringtable_instance("LLStringTable");
+
+	template<> template<>
+	void stringtable_object_t::test<1>()
+	{
+		char* agent = mTable.addString("AgentData");
+		ensure("added", agent != NULL);
+		ensure_equals("contents", std::string(agent), std::string("AgentData"));
+		ensure("interned", mTable.addString(std::string("AgentData")) == agent);
+		ensure("check", mTable.checkString("AgentData") == agent);
+		ensure("missing", mTable.checkString("AgentDat") == NULL);
+		ensure("null", mTable.checkString((const char*)NULL) == NULL);
+		ensure_equals("unique", mTable.mUniqueEntries, 1);
+	}
+
+	template<> template<>
+	void stringtable_object_t::test<2>()
+	{
+		// entries are counted, the last remove frees the string
+		char* name = mTable.addString("RegionHandle");
+		mTable.addString("RegionHandle");
+		mTable.removeString("RegionHandle");
+		ensure("still there", mTable.checkString("RegionHandle") == name);
+		mTable.removeString("RegionHandle");
+		ensure("removed", mTable.checkString("RegionHandle") == NULL);
+		ensure_equals("unique", mTable.mUniqueEntries, 0);
+
+		// the freed slot does not hide strings probed past it
+		for (S32 i = 0; i < 8; ++i)
+		{
+			mTable.addString(llformat("Name%d", i));
+		}
+		mTable.removeString("Name3");
+		for (S32 i = 0; i < 8; ++i)
+		{
+			std::string str = llformat("Name%d", i);
+			ensure(str.c_str(), (mTable.checkString(str) != NULL) == (i != 3));
+		}
+	}
+
+	template<> template<>
+	void stringtable_object_t::test<3>()
+	{
+		// growing keeps every returned pointer valid
+		std::vector<char*> added;
+		for (S32 i = 0; i < 1000; ++i)
+		{
+			added.push_back(mTable.addString(llformat("Var%d", i)));
+		}
+		ensure("grew", mTable.mMaxEntries >= 1000 * 4 / 3);
+		ensure_equals("unique", mTable.mUniqueEntries, 1000);
+		for (S32 i = 0; i < 1000; ++i)
+		{
+			ensure("stable", mTable.checkString(llformat("Var%d", i)) == added[i]);
+		}
+
+		// add/remove churn is cleaned up instead of growing forever
+		S32 size = mTable.mMaxEntries;
+		for (S32 i = 0; i < 50000; ++i)
+		{
+			std::string str = llformat("Temp%d", i);
+			mTable.addString(str);
+			mTable.removeString(str.c_str());
+		}
+		ensure_equals("size", mTable.mMaxEntries, size);
+		ensure("still stable", mTable.checkString("Var42") == added[42]);
+	}
+
+	template<> template<>
+	void stringtable_object_t::test<4>()
+	{
+		// names longer than an entry can hold map to the stored prefix
+		std::string long_name(MAX_STRINGS_LENGTH + 10, 'x');
+		char* stored = mTable.addString(long_name);
+		ensure_equals("truncated", strlen(stored), (size_t)(MAX_STRINGS_LENGTH - 1));
+		ensure("same entry", mTable.addString(long_name) == stored);
+	}
+
+	template<> template<>
+	void stringtable_object_t::test<5>()
+	{
+		ll_init_apr();
+		LLStringTable table(16, true);
+		std::vector<char*> known;
+		for (S32 i = 0; i < 256; ++i)
+		{
+			known.push_back(table.addString(llformat("Block%d", i)));
+		}
+
+		StringTableReader* reader = new StringTableReader(table, known);
+		reader->start();
+		while (!reader->mPasses)
+		{
+			ms_sleep(1);
+		}
+		S32 size = table.mMaxEntries;
+		for (S32 i = 0; i < 20000; ++i)
+		{
+			table.addString(llformat("Added%d", i));
+		}
+		reader->mStop = true;
+		while (!reader->isStopped())
+		{
+			ms_sleep(1);
+		}
+		ensure("resized while reading", table.mMaxEntries > size);
+		ensure_equals("reader misses", reader->mMisses, 0);
+		delete reader;
+	}
+
+	template<> template<>
+	void stringtable_object_t::test<6>()
+	{
+		// the message system looks up every non-prehashed block and
+		// variable name, so a lookup has to stay well under a microsecond
+		std::vector<std::string> names;
+		for (S32 i = 0; i < 1000; ++i)
+		{
+			names.push_back(llformat("MessageVariable%d", i));
+			mTable.addString(names.back());
+		}
+		const S32 LOOKUPS = 200000;
+		LLTimer timer;
+		for (S32 i = 0; i < LOOKUPS; ++i)
+		{
+			mTable.checkString(names[i % 1000].c_str());
+		}
+		F64 ns_per_lookup = timer.getElapsedTimeF64() * 1.0e9 / LOOKUPS;
+		llinfos << "LLStringTable lookup cost: " << ns_per_lookup << " ns" << llendl;
+		ensure("lookup cost", ns_per_lookup < 1000.0);
+	}
+}
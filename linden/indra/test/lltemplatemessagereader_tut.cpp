@@ -0,0 +1,269 @@
+/** 
+ * @file lltemplatemessagereader_tut.cpp
+ * @brief Tests for lazy and LLMsgData decoding in LLTemplateMessageReader
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ * 
+ * Copyright (c) 2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "lltut.h"
+
+#include "llmessagetemplate.h"
+#include "lltemplatemessagebuilder.h"
+#include "lltemplatemessagereader.h"
+#include "lltestmessagesystem.h"
+#include "lltimer.h"
+#include "message_prehash.h"
+#include "v3math.h"
+
+namespace tut
+{
+	static LLTemplateMessageBuilder::message_template_name_map_t readerNameMap;
+	static LLTemplateMessageReader::message_template_number_map_t readerNumberMap;
+	static S32 sHandled = 0;
+
+	static void process_test_message(LLMessageSystem*, void**)
+	{
+		sHandled++;
+	}
+
+	struct LLTemplateMessageReaderTestData
+	{
+		LLMessageTemplate mTemplate;
+		U8 mBuffer[MAX_BUFFER_SIZE];
+		U32 mBuiltSize;
+		BOOL mWasLazy;
+
+		LLTemplateMessageReaderTestData()
+			: mTemplate(init(), 1, MFT_HIGH), mBuiltSize(0),
+			  mWasLazy(LLTemplateMessageReader::getLazyDecode())
+		{
+			// Shaped like ObjectUpdate: a single region block followed by
+			// a variable number of object blocks with fixed and variable
+			// length fields.
+			LLMessageBlock* region = new LLMessageBlock(_PREHASH_Test0, MBT_SINGLE);
+			region->addVariable(_PREHASH_Test0, MVT_U64, 8);
+			region->addVariable(_PREHASH_Test1, MVT_U16, 2);
+			mTemplate.addBlock(region);
+
+			LLMessageBlock* objects = new LLMessageBlock(_PREHASH_Test1, MBT_VARIABLE);
+			objects->addVariable(_PREHASH_Test0, MVT_U32, 4);
+			objects->addVariable(_PREHASH_Test1, MVT_LLVector3, 12);
+			objects->addVariable(_PREHASH_Test2, MVT_VARIABLE, 2);
+			mTemplate.addBlock(objects);
+			mTemplate.setHandlerFunc(process_test_message, NULL);
+
+			readerNameMap[_PREHASH_TestMessage] = &mTemplate;
+			readerNumberMap[1] = &mTemplate;
+		}
+
+		~LLTemplateMessageReaderTestData()
+		{
+			LLTemplateMessageReader::setLazyDecode(mWasLazy);
+		}
+
+		static const char* init()
+		{
+			if (!gMessageSystem)
+			{
+				start_test_messaging_system();
+			}
+			return _PREHASH_TestMessage;
+		}
+
+		void buildMessage(S32 num_objects)
+		{
+			LLTemplateMessageBuilder builder(readerNameMap);
+			builder.newMessage(_PREHASH_TestMessage);
+			builder.nextBlock(_PREHASH_Test0);
+			builder.addU64(_PREHASH_Test0, U64(0x0123456789abcdefULL));
+			builder.addU16(_PREHASH_Test1, 0x4321);
+			for (S32 i = 0; i < num_objects; ++i)
+			{
+				builder.nextBlock(_PREHASH_Test1);
+				builder.addU32(_PREHASH_Test0, 1000 + i);
+				builder.addVector3(_PREHASH_Test1, LLVector3(i, i * 2.f, i * 3.f));
+				std::string name = llformat("object %d", i);
+				builder.addBinaryData(_PREHASH_Test2, name.c_str(), name.size() + 1);
+			}
+			memset(mBuffer, 0, LL_PACKET_ID_SIZE);
+			mBuiltSize = builder.buildMessage(mBuffer, MAX_BUFFER_SIZE, 0);
+		}
+
+		void readMessage(LLTemplateMessageReader& reader, bool lazy)
+		{
+			LLTemplateMessageReader::setLazyDecode(lazy);
+			reader.clearMessage();
+			ensure("valid", reader.validateMessage(mBuffer, mBuiltSize, LLHost()));
+			ensure("read", reader.readMessage(mBuffer, LLHost()));
+		}
+
+		void ensureMessage(LLTemplateMessageReader& reader, S32 num_objects)
+		{
+			U64 region = 0;
+			U16 port = 0;
+			reader.getU64(_PREHASH_Test0, _PREHASH_Test0, region);
+			reader.getU16(_PREHASH_Test0, _PREHASH_Test1, port);
+			ensure("U64", region == U64(0x0123456789abcdefULL));
+			ensure_equals("U16", port, 0x4321);
+			ensure_equals("blocks", reader.getNumberOfBlocks(_PREHASH_Test1), num_objects);
+
+			// read out of template order to exercise the lookup
+			for (S32 i = num_objects - 1; i >= 0; --i)
+			{
+				std::string name;
+				reader.getString(_PREHASH_Test1, _PREHASH_Test2, name, i);
+				ensure_equals("string", name, llformat("object %d", i));
+				ensure_equals("size", reader.getSize(_PREHASH_Test1, i, _PREHASH_Test2), (S32)name.size() + 1);
+
+				LLVector3 pos;
+				U32 id = 0;
+				reader.getVector3(_PREHASH_Test1, _PREHASH_Test1, pos, i);
+				reader.getU32(_PREHASH_Test1, _PREHASH_Test0, id, i);
+				ensure_equals("U32", id, (U32)(1000 + i));
+				ensure_equals("vector", pos, LLVector3(i, i * 2.f, i * 3.f));
+			}
+		}
+	};
+
+	typedef test_group<LLTemplateMessageReaderTestData> LLTemplateMessageReaderTestGroup;
+	typedef LLTemplateMessageReaderTestGroup::object LLTemplateMessageReaderTestObject;
+	LLTemplateMessageReaderTestGroup templateMessageReaderTestGroup("LLTemplateMessageReader");
+
+	template<> template<>
+	void LLTemplateMessageReaderTestObject::test<1>()
+		// lazy and LLMsgData decoding agree
+	{
+		buildMessage(12);
+		LLTemplateMessageReader reader(readerNumberMap);
+		readMessage(reader, true);
+		ensureMessage(reader, 12);
+		ensure_equals("fixed size", reader.getSize(_PREHASH_Test0, _PREHASH_Test1), 2);
+		ensure_equals("missing block", reader.getSize(_PREHASH_Test1, 12, _PREHASH_Test0), LL_BLOCK_NOT_IN_MESSAGE);
+		ensure_equals("missing variable", reader.getSize(_PREHASH_Test0, _PREHASH_Test2), LL_VARIABLE_NOT_IN_BLOCK);
+
+		readMessage(reader, false);
+		ensureMessage(reader, 12);
+		ensure_equals("fixed size", reader.getSize(_PREHASH_Test0, _PREHASH_Test1), 2);
+		ensure_equals("missing block", reader.getSize(_PREHASH_Test1, 12, _PREHASH_Test0), LL_BLOCK_NOT_IN_MESSAGE);
+		ensure_equals("missing variable", reader.getSize(_PREHASH_Test0, _PREHASH_Test2), LL_VARIABLE_NOT_IN_BLOCK);
+	}
+
+	template<> template<>
+	void LLTemplateMessageReaderTestObject::test<2>()
+		// copying a lazily decoded message rebuilds the same packet
+	{
+		buildMessage(5);
+		LLTemplateMessageReader reader(readerNumberMap);
+		readMessage(reader, true);
+
+		LLTemplateMessageBuilder builder(readerNameMap);
+		builder.newMessage(reader.getMessageName());
+		reader.copyToBuilder(builder);
+		U8 copy[MAX_BUFFER_SIZE];
+		memset(copy, 0, LL_PACKET_ID_SIZE);
+		U32 copy_size = builder.buildMessage(copy, MAX_BUFFER_SIZE, 0);
+		ensure_equals("copy size", copy_size, mBuiltSize);
+		ensure("copy data", !memcmp(copy, mBuffer, mBuiltSize));
+	}
+
+	template<> template<>
+	void LLTemplateMessageReaderTestObject::test<3>()
+		// a reader is reset, not rebuilt, between messages
+	{
+		LLTemplateMessageReader reader(readerNumberMap);
+		buildMessage(20);
+		readMessage(reader, true);
+		ensureMessage(reader, 20);
+
+		buildMessage(3);
+		readMessage(reader, true);
+		ensureMessage(reader, 3);
+
+		// the reader owns its copy of the packet
+		memset(mBuffer, 0xaa, sizeof(mBuffer));
+		ensureMessage(reader, 3);
+	}
+
+	template<> template<>
+	void LLTemplateMessageReaderTestObject::test<4>()
+		// truncated packets read as zeros either way
+	{
+		buildMessage(2);
+		// cut the last object's variable data short
+		mBuiltSize -= 4;
+
+		LLTemplateMessageReader reader(readerNumberMap);
+		for (S32 lazy = 1; lazy >= 0; --lazy)
+		{
+			readMessage(reader, lazy);
+			U32 id = 0;
+			reader.getU32(_PREHASH_Test1, _PREHASH_Test0, id, 1);
+			ensure_equals("intact field", id, (U32)1001);
+
+			U64 region = 0;
+			reader.getU64(_PREHASH_Test0, _PREHASH_Test0, region);
+			ensure("intact region", region == U64(0x0123456789abcdefULL));
+		}
+
+		// lazily, the short variable field comes back empty
+		readMessage(reader, true);
+		ensure_equals("empty", reader.getSize(_PREHASH_Test1, 1, _PREHASH_Test2), 0);
+	}
+
+	template<> template<>
+	void LLTemplateMessageReaderTestObject::test<5>()
+		// every ObjectUpdate sized message reaches its handler and reads
+		// the same either way; the decode times are logged
+	{
+		buildMessage(40);
+		LLTemplateMessageReader reader(readerNumberMap);
+		const S32 ITERATIONS = 2000;
+		sHandled = 0;
+		F32 times[2];
+		for (S32 lazy = 0; lazy < 2; ++lazy)
+		{
+			LLTimer timer;
+			for (S32 i = 0; i < ITERATIONS; ++i)
+			{
+				readMessage(reader, lazy);
+				for (S32 b = 0; b < 40; ++b)
+				{
+					U32 id = 0;
+					reader.getU32(_PREHASH_Test1, _PREHASH_Test0, id, b);
+					ensure_equals("id", id, (U32)(1000 + b));
+				}
+			}
+			times[lazy] = timer.getElapsedTimeF32();
+		}
+		ensure_equals("every message handled", sHandled, 2 * ITERATIONS);
+		llinfos << "Decoded " << ITERATIONS << " messages with LLMsgData in "
+				<< times[0] << "s, lazily in " << times[1] << "s" << llendl;
+	}
+}
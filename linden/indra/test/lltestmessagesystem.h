@@ -0,0 +1,117 @@
+/**
+ * @file lltestmessagesystem.h
+ * @brief Message system setup shared by the message tests
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLTESTMESSAGESYSTEM_H
+#define LL_LLTESTMESSAGESYSTEM_H
+
+#include <ostream>
+
+#include "llapr.h"
+#include "lltransfermanager.h"
+#include "llversionserver.h"
+#include "message.h"
+
+/**
+ * @brief Writes the header of a message template and the messages that
+ * start_messaging_system() registers handlers for, laid out as in
+ * message_template.msg.  Tests append their own messages after it.
+ */
+inline void write_test_message_template(std::ostream& file)
+{
+	file << "version 2.0\n"
+		 << "{\n\tStartPingCheck High 1 NotTrusted Unencoded\n"
+		 << "\t{\n\t\tPingID Single\n\t\t{ PingID U8 }\n\t\t{ OldestUnacked U32 }\n\t}\n}\n"
+		 << "{\n\tCompletePingCheck High 2 NotTrusted Unencoded\n"
+		 << "\t{\n\t\tPingID Single\n\t\t{ PingID U8 }\n\t}\n}\n"
+		 << "{\n\tOpenCircuit Fixed 0xFFFFFFFC NotTrusted Unencoded UDPBlackListed\n"
+		 << "\t{\n\t\tCircuitInfo Single\n\t\t{ IP IPADDR }\n\t\t{ Port IPPORT }\n\t}\n}\n"
+		 << "{\n\tCloseCircuit Fixed 0xFFFFFFFD NotTrusted Unencoded\n}\n"
+		 << "{\n\tAddCircuitCode Low 2 Trusted Unencoded\n"
+		 << "\t{\n\t\tCircuitCode Single\n\t\t{ Code U32 }\n\t\t{ SessionID LLUUID }\n\t\t{ AgentID LLUUID }\n\t}\n}\n"
+		 << "{\n\tUseCircuitCode Low 3 NotTrusted Unencoded\n"
+		 << "\t{\n\t\tCircuitCode Single\n\t\t{ Code U32 }\n\t\t{ SessionID LLUUID }\n\t\t{ ID LLUUID }\n\t}\n}\n"
+		 << "{\n\tPacketAck Fixed 0xFFFFFFFB NotTrusted Unencoded\n"
+		 << "\t{\n\t\tPackets Variable\n\t\t{ ID U32 }\n\t}\n}\n"
+		 << "{\n\tCreateTrustedCircuit Low 392 NotTrusted Unencoded\n"
+		 << "\t{\n\t\tDataBlock Single\n\t\t{ EndPointID LLUUID }\n\t\t{ Digest Fixed 32 }\n\t}\n}\n"
+		 << "{\n\tDenyTrustedCircuit Low 393 NotTrusted Unencoded\n"
+		 << "\t{\n\t\tDataBlock Single\n\t\t{ EndPointID LLUUID }\n\t}\n}\n"
+		 << "{\n\tRequestTrustedCircuit Low 394 Trusted Unencoded\n}\n"
+		 << "{\n\tError Low 423 NotTrusted Zerocoded\n"
+		 << "\t{\n\t\tAgentData Single\n\t\t{ AgentID LLUUID }\n\t}\n"
+		 << "\t{\n\t\tData Single\n\t\t{ Code S32 }\n\t\t{ Token Variable 1 }\n\t\t{ ID LLUUID }\n"
+		 << "\t\t{ System Variable 1 }\n\t\t{ Message Variable 2 }\n\t\t{ Data Variable 2 }\n\t}\n}\n"
+		 << "{\n\tTransferRequest Low 153 NotTrusted Zerocoded\n"
+		 << "\t{\n\t\tTransferInfo Single\n\t\t{ TransferID LLUUID }\n\t\t{ ChannelType S32 }\n"
+		 << "\t\t{ SourceType S32 }\n\t\t{ Priority F32 }\n\t\t{ Params Variable 2 }\n\t}\n}\n"
+		 << "{\n\tTransferInfo Low 154 NotTrusted Zerocoded\n"
+		 << "\t{\n\t\tTransferInfo Single\n\t\t{ TransferID LLUUID }\n\t\t{ ChannelType S32 }\n"
+		 << "\t\t{ TargetType S32 }\n\t\t{ Status S32 }\n\t\t{ Size S32 }\n\t\t{ Params Variable 2 }\n\t}\n}\n"
+		 << "{\n\tTransferPacket High 17 NotTrusted Unencoded\n"
+		 << "\t{\n\t\tTransferData Single\n\t\t{ TransferID LLUUID }\n\t\t{ ChannelType S32 }\n"
+		 << "\t\t{ Packet S32 }\n\t\t{ Status S32 }\n\t\t{ Data Variable 2 }\n\t}\n}\n"
+		 << "{\n\tTransferAbort Low 155 NotTrusted Zerocoded\n"
+		 << "\t{\n\t\tTransferInfo Single\n\t\t{ TransferID LLUUID }\n\t\t{ ChannelType S32 }\n\t}\n}\n";
+}
+
+/**
+ * @brief Starts a disconnected message system reading its templates from
+ * template_file, which need not exist.
+ */
+inline void start_test_messaging_system(const std::string& template_file = "notafile")
+{
+	ll_init_apr();
+	start_messaging_system(template_file, 0,
+						   LL_VERSION_MAJOR,
+						   LL_VERSION_MINOR,
+						   LL_VERSION_PATCH,
+						   FALSE,
+						   "notasharedsecret",
+						   NULL,
+						   false,
+						   5.f,
+						   100.f);
+}
+
+/**
+ * @brief Throws away the message system, for tests that start a fresh one
+ * each time.
+ */
+inline void stop_test_messaging_system()
+{
+	// not end_messaging_system()
+	gTransferManager.cleanup();
+	delete gMessageSystem;
+	gMessageSystem = NULL;
+}
+
+#endif // LL_LLTESTMESSAGESYSTEM_H
@@ -0,0 +1,302 @@
+/** 
+ * @file llvfs_tut.cpp
+ * @brief LLVFS tests
+ * @date 2009-06-02
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ * 
+ * Copyright (c) 2009, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "lltut.h"
+#include "lltestpattern.h"
+
+#include "llvfs.h"
+#include "llthread.h"
+#include "lltimer.h"
+
+namespace
+{
+	// Reads its files over and over, checking what comes back.
+	class LLVFSReaderThread : public LLThread
+	{
+	public:
+		LLVFSReaderThread(LLVFS* vfs, const std::vector<LLUUID>& ids, S32 first, S32 size) :
+			LLThread("vfs reader"),
+			mVFS(vfs),
+			mIDs(ids),
+			mFirst(first),
+			mSize(size),
+			mBadReads(0),
+			mReads(0)
+		{
+		}
+
+		virtual void run()
+		{
+			std::vector<U8> buffer(mSize);
+			for (S32 pass = 0; pass < 50; ++pass)
+			{
+				for (S32 i = mFirst; i < mFirst + 4; ++i)
+				{
+					S32 read = mVFS->getData(mIDs[i], LLAssetType::AT_SOUND, &buffer[0], 0, mSize);
+					++mReads;
+					if (read != mSize)
+					{
+						++mBadReads;
+						continue;
+					}
+					for (S32 j = 0; j < mSize; ++j)
+					{
+						if (buffer[j] != pattern_byte(i, j))
+						{
+							++mBadReads;
+							break;
+						}
+					}
+				}
+			}
+		}
+
+		LLVFS* mVFS;
+		const std::vector<LLUUID>& mIDs;
+		S32 mFirst;
+		S32 mSize;
+		S32 mBadReads;
+		S32 mReads;
+	};
+}
+
+namespace tut
+{
+	struct llvfs_data
+	{
+		llvfs_data()
+		{
+			LLUUID random;
+			random.generate();
+			std::ostringstream name;
+#if LL_WINDOWS
+			name << "llvfs-test-" << random;
+#else
+			name << "/tmp/llvfs-test-" << random;
+#endif
+			mIndexFilename = name.str() + ".index";
+			mDataFilename = name.str() + ".data";
+			mVFS = new LLVFS(mIndexFilename, mDataFilename, FALSE, 4 * 1024 * 1024, FALSE);
+		}
+
+		~llvfs_data()
+		{
+			delete mVFS;
+			LLFile::remove(mIndexFilename);
+			LLFile::remove(mDataFilename);
+		}
+
+		LLUUID storeFile(S32 file, S32 size)
+		{
+			LLUUID id;
+			id.generate();
+			std::vector<U8> data(size);
+			for (S32 i = 0; i < size; ++i)
+			{
+				data[i] = pattern_byte(file, i);
+			}
+			ensure("sized", mVFS->setMaxSize(id, LLAssetType::AT_SOUND, size));
+			ensure_equals("stored", mVFS->storeData(id, LLAssetType::AT_SOUND, &data[0], 0, size), size);
+			return id;
+		}
+
+		std::string mIndexFilename;
+		std::string mDataFilename;
+		LLVFS* mVFS;
+	};
+	typedef test_group<llvfs_data> llvfs_test;
+	typedef llvfs_test::object llvfs_object;
+	tut::llvfs_test llvfs("llvfs");
+
+	template<> template<>
+	void llvfs_object::test<1>()
+	{
+		ensure("valid", mVFS->isValid());
+		LLUUID id = storeFile(1, 3000);
+		ensure_equals("size", mVFS->getSize(id, LLAssetType::AT_SOUND), 3000);
+
+		U8 buffer[100];
+		ensure_equals("read in the middle", mVFS->getData(id, LLAssetType::AT_SOUND, buffer, 1000, 100), 100);
+		ensure_equals("first byte", buffer[0], pattern_byte(1, 1000));
+		ensure_equals("last byte", buffer[99], pattern_byte(1, 1099));
+		ensure_equals("read past the end is cut short", mVFS->getData(id, LLAssetType::AT_SOUND, buffer, 2950, 100), 50);
+		ensure_equals("short read", buffer[49], pattern_byte(1, 2999));
+
+		// appends go on the end
+		U8 more[10];
+		memset(more, 0x5a, sizeof(more));
+		ensure("grown", mVFS->setMaxSize(id, LLAssetType::AT_SOUND, 4096));
+		ensure_equals("appended", mVFS->storeData(id, LLAssetType::AT_SOUND, more, -1, sizeof(more)), (S32)sizeof(more));
+		ensure_equals("new size", mVFS->getSize(id, LLAssetType::AT_SOUND), 3010);
+		ensure_equals("appended read", mVFS->getData(id, LLAssetType::AT_SOUND, buffer, 3000, 10), 10);
+		ensure_equals("appended byte", buffer[9], (U8)0x5a);
+		ensure_equals("data kept", mVFS->getData(id, LLAssetType::AT_SOUND, buffer, 0, 1), 1);
+		ensure_equals("first byte kept", buffer[0], pattern_byte(1, 0));
+	}
+
+	template<> template<>
+	void llvfs_object::test<2>()
+	{
+		// removed and renamed files
+		LLUUID id = storeFile(2, 1024);
+		LLUUID new_id;
+		new_id.generate();
+		mVFS->renameFile(id, LLAssetType::AT_SOUND, new_id, LLAssetType::AT_SOUND);
+		U8 buffer[16];
+		ensure_equals("old name gone", mVFS->getData(id, LLAssetType::AT_SOUND, buffer, 0, 16), 0);
+		ensure_equals("new name read", mVFS->getData(new_id, LLAssetType::AT_SOUND, buffer, 0, 16), 16);
+		ensure_equals("renamed data", buffer[15], pattern_byte(2, 15));
+
+		mVFS->removeFile(new_id, LLAssetType::AT_SOUND);
+		ensure("removed", !mVFS->getExists(new_id, LLAssetType::AT_SOUND));
+		ensure_equals("removed read", mVFS->getData(new_id, LLAssetType::AT_SOUND, buffer, 0, 16), 0);
+	}
+
+	template<> template<>
+	void llvfs_object::test<3>()
+	{
+		// Readers run alongside files being moved, replaced and removed,
+		// and never see another file's data.
+		const S32 THREADS = 4;
+		const S32 SIZE = 8192;
+		std::vector<LLUUID> ids;
+		for (S32 i = 0; i < THREADS * 4; ++i)
+		{
+			ids.push_back(storeFile(i, SIZE));
+		}
+
+		std::vector<LLVFSReaderThread*> threads;
+		for (S32 i = 0; i < THREADS; ++i)
+		{
+			threads.push_back(new LLVFSReaderThread(mVFS, ids, i * 4, SIZE));
+			threads.back()->start();
+		}
+
+		for (S32 i = 0; i < 50; ++i)
+		{
+			if (i < 32)
+			{
+				// move files while they are being read
+				ensure("reader file grown", mVFS->setMaxSize(ids[i % 16], LLAssetType::AT_SOUND, SIZE * (2 + i / 16)));
+			}
+			LLUUID churn = storeFile(100 + i, SIZE);
+			// growing past the next file moves the data
+			mVFS->setMaxSize(churn, LLAssetType::AT_SOUND, SIZE * 4);
+			mVFS->removeFile(churn, LLAssetType::AT_SOUND);
+		}
+
+		LLTimer timer;
+		for (S32 i = 0; i < THREADS; ++i)
+		{
+			while (!threads[i]->isStopped() && timer.getElapsedTimeF32() < 30.f)
+			{
+				ms_sleep(1);
+			}
+			ensure("reader finished", threads[i]->isStopped());
+			ensure_equals("all read", threads[i]->mReads, 200);
+			ensure_equals("no bad reads", threads[i]->mBadReads, 0);
+			delete threads[i];
+		}
+	}
+
+	template<> template<>
+	void llvfs_object::test<4>()
+	{
+		// compaction packs files down and coalesces the free space
+		const S32 FILES = 64;
+		std::vector<LLUUID> ids;
+		std::vector<S32> sizes;
+		for (S32 i = 0; i < FILES; ++i)
+		{
+			// most of the 4MB, so the holes are most of the free space
+			sizes.push_back(48 * 1024 - 100 * (i % 5));
+			ids.push_back(storeFile(i, sizes.back()));
+		}
+		for (S32 i = 0; i < FILES; i += 2)
+		{
+			mVFS->removeFile(ids[i], LLAssetType::AT_SOUND);
+		}
+		ensure("fragmented", mVFS->getFragmentation() > 0.25f);
+
+		S32 steps = 0;
+		while (mVFS->compact(64 * 1024) && steps < 1000)
+		{
+			++steps;
+		}
+		ensure("took several steps", steps > 1);
+		ensure("pass finished", steps < 1000);
+		ensure("free space coalesced", mVFS->getFragmentation() < 0.01f);
+		ensure("nothing left to do", !mVFS->compact(64 * 1024));
+
+		for (S32 i = 1; i < FILES; i += 2)
+		{
+			std::vector<U8> buffer(sizes[i]);
+			ensure_equals("read after move", mVFS->getData(ids[i], LLAssetType::AT_SOUND, &buffer[0], 0, sizes[i]), sizes[i]);
+			S32 j = 0;
+			while (j < sizes[i] && buffer[j] == pattern_byte(i, j))
+			{
+				++j;
+			}
+			ensure_equals("data moved intact", j, sizes[i]);
+		}
+	}
+
+	template<> template<>
+	void llvfs_object::test<5>()
+	{
+		// files bigger than a step are left alone
+		const S32 SIZE = 96 * 1024;
+		std::vector<LLUUID> ids;
+		for (S32 i = 0; i < 41; ++i)
+		{
+			ids.push_back(storeFile(i, SIZE));
+		}
+		mVFS->removeFile(ids[0], LLAssetType::AT_SOUND);
+		F32 fragmentation = mVFS->getFragmentation();
+		ensure("fragmented", fragmentation > 0.25f);
+
+		while (mVFS->compact(SIZE / 2))
+		{
+		}
+		ensure_equals("nothing moved", mVFS->getFragmentation(), fragmentation);
+
+		while (mVFS->compact(SIZE))
+		{
+		}
+		ensure("hole filled", mVFS->getFragmentation() < 0.01f);
+		U8 buffer[16];
+		ensure_equals("moved file read", mVFS->getData(ids[40], LLAssetType::AT_SOUND, buffer, SIZE - 16, 16), 16);
+		ensure_equals("moved file data", buffer[15], pattern_byte(40, SIZE - 1));
+	}
+}
@@ -34,7 +34,93 @@
 #include "linden_common.h"
 #include "lltut.h"
 
+#include "llfile.h"
+#include "lltestmessagesystem.h"
+#include "lltimer.h"
+#include "lluuid.h"
 #include "llxfer_file.h"
+#include "llxfer_mem.h"
+#include "llxfermanager.h"
+#include "message.h"
+
+namespace
+{
+	// Records packets instead of sending them. Packet last_packet is
+	// the end of the file.
+	class LLXferWindowTester : public LLXfer
+	{
+	public:
+		LLXferWindowTester(S32 last_packet) :
+			LLXfer(-1),
+			mLastPacket(last_packet)
+		{
+			mStatus = e_LL_XFER_PENDING;
+		}
+
+		virtual void sendPacket(S32 packet_num)
+		{
+			mSent.push_back(packet_num);
+			mWaitingForACK = TRUE;
+			if (packet_num == mLastPacket)
+			{
+				mStatus = e_LL_XFER_COMPLETE;
+			}
+			else if (mStatus != e_LL_XFER_COMPLETE)
+			{
+				mStatus = e_LL_XFER_IN_PROGRESS;
+			}
+		}
+
+		S32 mLastPacket;
+		std::vector<S32> mSent;
+	};
+
+	// Records confirms instead of sending them, so packets can be
+	// handed to receiveXferPacket() without a message system.
+	class LLXferReceiveTester : public LLXferManager
+	{
+	public:
+		LLXferReceiveTester() : LLXferManager(NULL) {}
+
+		void receive(LLXfer* xferp, S32 packet, BOOL is_eof, const std::string& data)
+		{
+			std::vector<char> buf(data.begin(), data.end());
+			if (0 == packet)
+			{
+				// the first packet leads with the size of the whole xfer
+				buf.insert(buf.begin(), sizeof(S32), 0);
+				htonmemcpy(&buf[0], &mXferSize, MVT_S32, sizeof(S32));
+			}
+			receiveXferPacket(NULL, xferp, encodePacketNum(packet, is_eof), &buf[0], (S32)buf.size());
+		}
+
+		virtual void acknowledgePacket(LLMessageSystem* mesgsys, U64 id, S32 packetnum)
+		{
+			mConfirmed.push_back(packetnum);
+		}
+
+		S32 mXferSize;
+		std::vector<S32> mConfirmed;
+	};
+
+	std::string sReceived;
+	S32 sReceivedCount = 0;
+
+	void xfer_mem_done(void* data, S32 size, void** user_data, S32 result, LLExtStat ext_status)
+	{
+		sReceived.assign((char*)data, size);
+		++sReceivedCount;
+	}
+
+	S32 sFileResult = 1;
+	BOOL sFileDone = FALSE;
+
+	void xfer_file_done(void** user_data, S32 result, LLExtStat ext_status)
+	{
+		sFileResult = result;
+		sFileDone = TRUE;
+	}
+}
 
 namespace tut
 {
@@ -60,4 +146,193 @@ namespace tut
 		ensure("oversized local_filename nul-terminated",
 		       xff.getFileName().length() < LL_MAX_PATH);
 	}
+
+	template<> template<>
+	void llxfer_object::test<2>()
+	{
+		// a packet at a time until the window is opened
+		LLXferWindowTester xfer(2);
+		xfer.sendNextPacket();
+		ensure_equals("first packet only", xfer.mSent.size(), (size_t)1);
+		ensure("confirm does not finish", !xfer.confirmPacket(0));
+		ensure_equals("next packet sent", xfer.mSent.size(), (size_t)2);
+		ensure_equals("next packet number", xfer.mSent.back(), 1);
+		ensure("repeated confirm ignored", !xfer.confirmPacket(0));
+		ensure_equals("nothing extra sent", xfer.mSent.size(), (size_t)2);
+		ensure("not done yet", !xfer.confirmPacket(1));
+		ensure("done on last confirm", xfer.confirmPacket(2));
+		ensure("not waiting", !xfer.mWaitingForACK);
+	}
+
+	template<> template<>
+	void llxfer_object::test<3>()
+	{
+		LLXferWindowTester xfer(20);
+		xfer.mWindowSize = 4;
+		xfer.sendNextPacket();
+		xfer.confirmPacket(0);
+		ensure_equals("window filled", xfer.mSent.size(), (size_t)5);
+		ensure_equals("window end", xfer.mSent.back(), 4);
+
+		// packet 1 is lost, later ones are confirmed.
+		xfer.confirmPacket(2);
+		xfer.confirmPacket(3);
+		ensure_equals("window held by the gap", xfer.mSent.size(), (size_t)5);
+		xfer.confirmPacket(4);
+		ensure_equals("gap resent after three confirms", xfer.mSent.back(), 1);
+		xfer.resendLastPacket();
+		ensure_equals("timeout resends the gap", xfer.mSent.back(), 1);
+		xfer.confirmPacket(1);
+		ensure_equals("window slides past the gap", xfer.mAckedPacketNum, 4);
+		ensure_equals("window refilled", xfer.mSent.back(), 8);
+		ensure_equals("in flight", xfer.mPacketNum - xfer.mAckedPacketNum, 4);
+	}
+
+	template<> template<>
+	void llxfer_object::test<4>()
+	{
+		// selective confirms finish the xfer whatever order they come in
+		LLXferWindowTester xfer(9);
+		xfer.mWindowSize = 16;
+		xfer.sendNextPacket();
+		xfer.confirmPacket(0);
+		ensure_equals("all sent", xfer.mSent.size(), (size_t)10);
+		ensure_equals("complete once sent", (S32)xfer.mStatus, (S32)e_LL_XFER_COMPLETE);
+		BOOL done = FALSE;
+		for (S32 packet = 9; packet > 0; --packet)
+		{
+			ensure("not done before all confirmed", !done);
+			done = xfer.confirmPacket(packet);
+		}
+		ensure("done when all confirmed", done);
+		ensure_equals("still complete", (S32)xfer.mStatus, (S32)e_LL_XFER_COMPLETE);
+	}
+
+	template<> template<>
+	void llxfer_object::test<5>()
+	{
+		// packets past a gap are confirmed and held, then delivered
+		// in order once the gap is filled
+		LLXferReceiveTester manager;
+		manager.mXferSize = 12;
+		LLXfer_Mem* xferp = new LLXfer_Mem();
+		xferp->initializeRequest(1, "", LL_PATH_NONE, LLHost(), FALSE, xfer_mem_done, NULL);
+		xferp->mStatus = e_LL_XFER_IN_PROGRESS;
+		xferp->mNext = manager.mReceiveList;
+		manager.mReceiveList = xferp;
+		sReceivedCount = 0;
+
+		manager.receive(xferp, 0, FALSE, "abc");
+		manager.receive(xferp, 2, FALSE, "ghi");
+		manager.receive(xferp, 3, TRUE, "jkl");
+		ensure_equals("early packets confirmed", manager.mConfirmed.size(), (size_t)3);
+		ensure_equals("early packets held", xferp->mEarlyPackets.size(), (size_t)2);
+		ensure_equals("still waiting for the gap", xferp->mPacketNum, 1);
+		ensure_equals("not finished", sReceivedCount, 0);
+
+		manager.receive(xferp, 2, FALSE, "ghi");
+		ensure_equals("repeated early packet held once", xferp->mEarlyPackets.size(), (size_t)2);
+
+		manager.receive(xferp, 1, FALSE, "def");
+		ensure_equals("finished", sReceivedCount, 1);
+		ensure_equals("data in order", sReceived, std::string("abcdefghijkl"));
+		ensure("xfer removed", (NULL == manager.mReceiveList));
+	}
+
+	template<> template<>
+	void llxfer_object::test<6>()
+	{
+		// a windowed file xfer over a live loopback circuit survives
+		// losing packets in both directions
+		LLUUID random;
+		random.generate();
+#if LL_WINDOWS
+		std::string test_dir = "C:\\xfer-test-" + random.asString();
+#else
+		std::string test_dir = "/tmp/xfer-test-" + random.asString();
+#endif
+		LLFile::mkdir(test_dir);
+		std::string template_file = test_dir + "/message_template.msg";
+		std::string source_file = test_dir + "/source";
+		std::string dest_file = test_dir + "/dest";
+
+		// Same layout as the xfer messages in message_template.msg
+		llofstream templ(template_file);
+		write_test_message_template(templ);
+		templ << "{\n\tRequestXfer Low 156 NotTrusted Zerocoded\n"
+			  << "\t{\n\t\tXferID Single\n\t\t{ ID U64 }\n\t\t{ Filename Variable 1 }\n"
+			  << "\t\t{ FilePath U8 }\n\t\t{ DeleteOnCompletion BOOL }\n\t\t{ UseBigPackets BOOL }\n"
+			  << "\t\t{ VFileID LLUUID }\n\t\t{ VFileType S16 }\n\t}\n}\n"
+			  << "{\n\tSendXferPacket High 18 NotTrusted Unencoded\n"
+			  << "\t{\n\t\tXferID Single\n\t\t{ ID U64 }\n\t\t{ Packet U32 }\n\t}\n"
+			  << "\t{\n\t\tDataPacket Single\n\t\t{ Data Variable 2 }\n\t}\n}\n"
+			  << "{\n\tConfirmXferPacket High 19 NotTrusted Unencoded\n"
+			  << "\t{\n\t\tXferID Single\n\t\t{ ID U64 }\n\t\t{ Packet U32 }\n\t}\n}\n"
+			  << "{\n\tAbortXfer Low 157 NotTrusted Unencoded\n"
+			  << "\t{\n\t\tXferID Single\n\t\t{ ID U64 }\n\t\t{ Result S32 }\n\t}\n}\n";
+		templ.close();
+
+		// 40 packets at the default chunk size
+		std::string data;
+		for (S32 i = 0; i < 40000; ++i)
+		{
+			data += (char)('a' + (i * 7) % 26);
+		}
+		llofstream source(source_file, llofstream::binary);
+		source << data;
+		source.close();
+
+		start_test_messaging_system(template_file);
+		ensure("message system", gMessageSystem && gMessageSystem->isOK());
+		start_xfer_manager(NULL);
+		gXferManager->registerCallbacks(gMessageSystem);
+		gXferManager->setXferWindowSize(8);
+		LLHost self(LOOPBACK_ADDRESS_STRING, gMessageSystem->getListenPort());
+		gMessageSystem->enableCircuit(self, TRUE);
+
+		sFileDone = FALSE;
+		sFileResult = 1;
+		gXferManager->expectFileForTransfer(source_file);
+		gXferManager->requestFile(dest_file, source_file, LL_PATH_NONE, self,
+								  FALSE, xfer_file_done, NULL);
+
+		// Once the window is open drop a pair of packets every so often,
+		// taking out data and confirms alike.
+		S32 drops = 0;
+		S32 drop_after = 4;
+		LLTimer timer;
+		S64 frame = 0;
+		while (!sFileDone && timer.getElapsedTimeF32() < 30.f)
+		{
+			LLXfer* sendp = gXferManager->mSendList;
+			if (sendp && (sendp->mWindowSize > 1)
+				&& (sendp->mAckedPacketNum >= drop_after) && (drops < 4))
+			{
+				gMessageSystem->mPacketRing.dropPackets(2);
+				drop_after += 8;
+				++drops;
+			}
+			if (!gMessageSystem->checkMessages(frame++))
+			{
+				gXferManager->retransmitUnackedPackets();
+				ms_sleep(1);
+			}
+		}
+
+		ensure("finished", sFileDone);
+		ensure_equals("result", sFileResult, (S32)LL_ERR_NOERR);
+		ensure_equals("packets dropped", drops, 4);
+		std::string received;
+		llifstream dest(dest_file, llifstream::binary);
+		std::getline(dest, received, '\0');
+		dest.close();
+		ensure("data intact", received == data);
+
+		cleanup_xfer_manager();
+		stop_test_messaging_system();
+		LLFile::remove(dest_file);
+		LLFile::remove(source_file);
+		LLFile::remove(template_file);
+		LLFile::rmdir(test_dir);
+	}
 }
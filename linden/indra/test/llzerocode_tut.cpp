@@ -0,0 +1,335 @@
+/** 
+ * @file llzerocode_tut.cpp
+ * @brief LLZeroCode tests
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ * 
+ * Copyright (c) 2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "lltut.h"
+
+#include "llrand.h"
+#include "lltimer.h"
+#include "llzerocode.h"
+
+namespace tut
+{
+	// The byte at a time zero coder LLZeroCode replaced, as it was
+	// in lltemplatemessagebuilder.cpp, less the packet header.
+	static S32 reference_encode(const U8* in, S32 size, U8* out)
+	{
+		S32 count = size;
+		S32 net_gain = 0;
+		U8 num_zeroes = 0;
+		const U8* inptr = in;
+		U8* outptr = out;
+		while (count--)
+		{
+			if (!(*inptr))
+			{
+				if (num_zeroes)
+				{
+					if (++num_zeroes > 254)
+					{
+						*outptr++ = num_zeroes;
+						num_zeroes = 0;
+					}
+					net_gain--;
+				}
+				else
+				{
+					*outptr++ = 0;
+					net_gain++;
+					num_zeroes = 1;
+				}
+				inptr++;
+			}
+			else
+			{
+				if (num_zeroes)
+				{
+					*outptr++ = num_zeroes;
+					num_zeroes = 0;
+				}
+				*outptr++ = *inptr++;
+			}
+		}
+		if (num_zeroes)
+		{
+			*outptr++ = num_zeroes;
+		}
+		return net_gain;
+	}
+
+	// And the decoder from LLMessageSystem::zeroCodeExpand(), returning
+	// -1 wherever that one called MX_WROTE_PAST_BUFFER_SIZE.
+	static S32 reference_decode(const U8* in, S32 size, U8* out, S32 out_size)
+	{
+		S32 count = size;
+		const U8* inptr = in;
+		U8* outptr = out;
+		while (count--)
+		{
+			if (outptr > (&out[out_size-1]))
+			{
+				return -1;
+			}
+			if (!((*outptr++ = *inptr++)))
+			{
+				while (((count--)) && (!(*inptr)))
+				{
+					*outptr++ = *inptr++;
+					if (outptr > (&out[out_size-256]))
+					{
+						return -1;
+					}
+					memset(outptr,0,255);
+					outptr += 255;
+				}
+				if (count < 0)
+				{
+					break;
+				}
+				if (outptr > (&out[out_size-(*inptr)]))
+				{
+					return -1;
+				}
+				memset(outptr,0,(*inptr) - 1);
+				outptr += ((*inptr) - 1);
+				inptr++;
+			}
+		}
+		return (S32)(outptr - out);
+	}
+
+	// Mostly short runs of zeroes and literals, now and then a long one,
+	// like an ObjectUpdate.
+	static S32 random_packet(U8* data, S32 max_size)
+	{
+		S32 size = ll_rand(max_size) + 1;
+		S32 i = 0;
+		while (i < size)
+		{
+			S32 run = (ll_rand(8) == 0) ? ll_rand(600) : ll_rand(20);
+			bool zeroes = (ll_rand(2) == 0);
+			for (S32 j = 0; (j < run) && (i < size); ++j)
+			{
+				data[i++] = zeroes ? 0 : (U8)(ll_rand(255) + 1);
+			}
+		}
+		return size;
+	}
+
+	const S32 PACKET_SIZE = 1200;
+	const S32 OUT_SIZE = 4000;
+	const S32 FUZZ_PACKETS = 20000;
+
+	struct LLZeroCodeTestData
+	{
+		~LLZeroCodeTestData()
+		{
+			LLZeroCode::initClass();
+		}
+	};
+
+	typedef test_group<LLZeroCodeTestData> zerocode_test;
+	typedef zerocode_test::object zerocode_object;
+	tut::zerocode_test tzerocode("LLZeroCode");
+
+	template<> template<>
+	void zerocode_object::test<1>()
+	{
+		// Scanners agree with each other at every length and offset.
+		U8 data[64];
+		for (S32 i = 0; i < 2000; ++i)
+		{
+			for (S32 j = 0; j < 64; ++j)
+			{
+				data[j] = ll_rand(4) ? (U8)(ll_rand(255) + 1) : 0;
+			}
+			U32 start = ll_rand(64);
+			U32 size = ll_rand(64 - start + 1);
+
+			LLZeroCode::setUseSSE2(false);
+			U32 zero = LLZeroCode::findZero(data + start, size);
+			U32 non_zero = LLZeroCode::findNonZero(data + start, size);
+			LLZeroCode::setUseSSE2(true);
+			ensure_equals("find zero", LLZeroCode::findZero(data + start, size), zero);
+			ensure_equals("find non-zero", LLZeroCode::findNonZero(data + start, size), non_zero);
+			ensure("zero", (zero == size) || (data[start + zero] == 0));
+			ensure("non-zero", (non_zero == size) || (data[start + non_zero] != 0));
+		}
+	}
+
+	template<> template<>
+	void zerocode_object::test<2>()
+	{
+		// Encoding matches the old encoder byte for byte, with and
+		// without SSE2, and decodes back to what went in.
+		U8 packet[PACKET_SIZE];
+		U8 expected[2 * PACKET_SIZE];
+		U8 encoded[2 * PACKET_SIZE];
+		U8 decoded[OUT_SIZE];
+		for (S32 i = 0; i < FUZZ_PACKETS; ++i)
+		{
+			S32 size = random_packet(packet, PACKET_SIZE);
+			S32 expected_gain = reference_encode(packet, size, expected);
+			for (S32 sse2 = 0; sse2 < 2; ++sse2)
+			{
+				LLZeroCode::setUseSSE2(sse2 != 0);
+				S32 gain = LLZeroCode::encode(packet, size, encoded);
+				ensure_equals("net gain", gain, expected_gain);
+				ensure_equals("estimated gain", LLZeroCode::getNetGain(packet, size), expected_gain);
+				ensure("encoded", !memcmp(encoded, expected, size + gain));
+
+				S32 decoded_size = LLZeroCode::decode(encoded, size + gain, decoded, OUT_SIZE);
+				ensure_equals("decoded size", decoded_size, size);
+				ensure("decoded", !memcmp(decoded, packet, size));
+			}
+		}
+	}
+
+	template<> template<>
+	void zerocode_object::test<3>()
+	{
+		// Decoding garbage, including runs that don't fit, matches the
+		// old decoder, overflow checks and all.
+		U8 packet[PACKET_SIZE];
+		U8 expected[OUT_SIZE];
+		U8 decoded[OUT_SIZE];
+		S32 overflows = 0;
+		for (S32 i = 0; i < FUZZ_PACKETS; ++i)
+		{
+			S32 size = random_packet(packet, 100);
+			// Sprinkle in run lengths.
+			for (S32 j = 0; j < size; ++j)
+			{
+				if ((packet[j] == 0) && (j + 1 < size) && ll_rand(2))
+				{
+					packet[j + 1] = (U8)(ll_rand(255) + 1);
+				}
+			}
+			S32 expected_size = reference_decode(packet, size, expected, OUT_SIZE);
+			if (expected_size < 0)
+			{
+				overflows++;
+			}
+			for (S32 sse2 = 0; sse2 < 2; ++sse2)
+			{
+				LLZeroCode::setUseSSE2(sse2 != 0);
+				S32 decoded_size = LLZeroCode::decode(packet, size, decoded, OUT_SIZE);
+				ensure_equals("decoded size", decoded_size, expected_size);
+				if (expected_size > 0)
+				{
+					ensure("decoded", !memcmp(decoded, expected, expected_size));
+				}
+			}
+		}
+		ensure("hit some overflows", overflows > 0);
+	}
+
+	template<> template<>
+	void zerocode_object::test<4>()
+	{
+		// Run length edge cases.
+		const S32 lengths[] = { 1, 2, 15, 16, 17, 254, 255, 256, 509, 510, 511, 765, 1000 };
+		U8 packet[1100];
+		U8 expected[2 * 1100];
+		U8 encoded[2 * 1100];
+		for (U32 i = 0; i < LL_ARRAY_SIZE(lengths); ++i)
+		{
+			S32 size = lengths[i] + 2;
+			memset(packet, 0, size);
+			packet[0] = 'a';
+			packet[size - 1] = 'z';
+			S32 expected_gain = reference_encode(packet, size, expected);
+			for (S32 sse2 = 0; sse2 < 2; ++sse2)
+			{
+				LLZeroCode::setUseSSE2(sse2 != 0);
+				ensure_equals("net gain", LLZeroCode::encode(packet, size, encoded), expected_gain);
+				ensure("encoded", !memcmp(encoded, expected, size + expected_gain));
+			}
+		}
+	}
+
+	template<> template<>
+	void zerocode_object::test<5>()
+	{
+		// Benchmark: encode and decode the same packets with the old
+		// byte at a time coder and with each run scanner, and log the
+		// throughput.  Nothing is asserted about the timings.
+		const S32 PACKETS = 2000;
+		const S32 PASSES = 10;
+		std::vector<U8> packets(PACKETS * PACKET_SIZE);
+		std::vector<S32> sizes(PACKETS);
+		S64 total = 0;
+		for (S32 i = 0; i < PACKETS; ++i)
+		{
+			sizes[i] = random_packet(&packets[i * PACKET_SIZE], PACKET_SIZE);
+			total += sizes[i];
+		}
+		U8 encoded[2 * PACKET_SIZE];
+		U8 decoded[OUT_SIZE];
+
+		F64 rate[3];
+		for (S32 coder = 0; coder < 3; ++coder)
+		{
+			LLZeroCode::setUseSSE2(coder == 2);
+			LLTimer timer;
+			for (S32 pass = 0; pass < PASSES; ++pass)
+			{
+				for (S32 i = 0; i < PACKETS; ++i)
+				{
+					const U8* packet = &packets[i * PACKET_SIZE];
+					S32 size = sizes[i];
+					S32 decoded_size;
+					if (coder)
+					{
+						S32 gain = LLZeroCode::encode(packet, size, encoded);
+						decoded_size = LLZeroCode::decode(encoded, size + gain, decoded, OUT_SIZE);
+					}
+					else
+					{
+						S32 gain = reference_encode(packet, size, encoded);
+						decoded_size = reference_decode(encoded, size + gain, decoded, OUT_SIZE);
+					}
+					ensure_equals("decoded size", decoded_size, size);
+				}
+			}
+			F64 elapsed = timer.getElapsedTimeF64();
+			rate[coder] = (elapsed > 0.0) ? (total * PASSES) / elapsed / 1000000.0 : 0.0;
+		}
+		llinfos << "Zero code encode+decode of " << PACKETS << " packets: "
+				<< (S32)rate[0] << " MB/s byte at a time, "
+				<< (S32)rate[1] << " MB/s by runs, "
+				<< (S32)rate[2] << " MB/s by runs "
+				<< (LLZeroCode::getUseSSE2() ? "with SSE2" : "(no SSE2 on this CPU)")
+				<< llendl;
+	}
+}